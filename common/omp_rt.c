@@ -0,0 +1,210 @@
+/**
+* @file omp_rt.c
+* @brief Small OpenMP loop runtime shared by the OpenMP benchmarks, see omp_rt.h
+*
+* C, and valid C++ for the benchmarks building it with g++.
+*/
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
+#include "omp_rt.h"
+
+/**
+* Loop statistics of one thread, on a cache line of its own
+*/
+typedef struct omp_rt_stat{
+	double busy;		/**< time from entering loops to the end of its own iterations */
+	double wall;		/**< thread 0: time in loops, closing barrier or join included */
+	double team;		/**< thread 0: wall times the threads running the loop */
+	long calls;		/**< thread 0: loops */
+	long forks;		/**< thread 0: loops run in a parallel region of their own */
+	char pad[64 - 3 * sizeof(double) - 2 * sizeof(long)];
+} omp_rt_stat;
+
+static int omp_rt_nthreads = 1;
+static int omp_rt_keep_team = 1;
+static int omp_rt_pinned = 0;
+static omp_rt_stat *omp_rt_stats = NULL;
+
+/**
+* Pins every thread of a team of nthreads to one of the CPUs the process may run on, in order
+* @return whether the threads were pinned
+*/
+static int omp_rt_pin(int nthreads){
+#ifdef __linux__
+	const char *bind = getenv("OMP_RT_BIND");
+	cpu_set_t allowed;
+	int ok = 1;
+
+	if((bind && !strcmp(bind, "0")) || getenv("OMP_PROC_BIND") || getenv("OMP_PLACES"))
+		return 0;
+	if(sched_getaffinity(0, sizeof(allowed), &allowed) || CPU_COUNT(&allowed) < 1)
+		return 0;
+
+	#pragma omp parallel num_threads(nthreads) reduction(&&: ok)
+	{
+		int k = omp_get_thread_num() % CPU_COUNT(&allowed), cpu = 0;
+		cpu_set_t one;
+
+		for(; cpu < CPU_SETSIZE; cpu++)
+			if(CPU_ISSET(cpu, &allowed) && k-- == 0)
+				break;
+		CPU_ZERO(&one);
+		CPU_SET(cpu, &one);
+		ok = !sched_setaffinity(0, sizeof(one), &one);
+	}
+	return ok;
+#else
+	(void)nthreads;
+	return 0;
+#endif
+}
+
+void omp_rt_init(int nthreads){
+	const char *keep = getenv("OMP_RT_PERSISTENT");
+	void *stats;
+
+	if(nthreads <= 0)
+		nthreads = omp_get_max_threads();
+	omp_rt_nthreads = nthreads;
+	omp_rt_keep_team = !(keep && !strcmp(keep, "0"));
+	omp_set_num_threads(nthreads);
+
+	free(omp_rt_stats);
+	if(posix_memalign(&stats, 64, nthreads * sizeof(omp_rt_stat))){
+		fprintf(stderr, "omp_rt: unable to allocate memory\n");
+		exit(1);
+	}
+	omp_rt_stats = (omp_rt_stat *)stats;
+	omp_rt_stats_reset();
+
+	/* also starts the threads, outside of the timed part */
+	omp_rt_pinned = omp_rt_pin(nthreads);
+	if(!omp_rt_pinned){
+		#pragma omp parallel
+		{
+		}
+	}
+}
+
+int omp_rt_threads(void){
+	return omp_rt_nthreads;
+}
+
+int omp_rt_persistent(void){
+	return omp_rt_keep_team;
+}
+
+/**
+* The share of the calling thread of a loop
+*/
+static void omp_rt_loop(int begin, int end, omp_rt_sched sched, int chunk, omp_rt_body body, void *arg){
+	int n = end - begin, nt = omp_get_num_threads(), id = omp_get_thread_num();
+	double t = omp_get_wtime();
+	int nchunks, c;
+
+	if(n > 0 && sched == OMP_RT_STATIC && chunk <= 0){
+		/* the blocks of schedule(static): the first n % nt threads get one more */
+		int q = n / nt, r = n % nt;
+		int b = begin + id * q + (id < r ? id : r);
+		int e = b + q + (id < r);
+		if(b < e)
+			body(b, e, arg);
+	}
+	else if(n > 0){
+		if(chunk <= 0)
+			chunk = n / (8 * nt) > 0 ? n / (8 * nt) : 1;
+		nchunks = (n - 1) / chunk + 1;
+		if(sched == OMP_RT_STATIC){
+			for(c = id; c < nchunks; c += nt)
+				body(begin + c * chunk, c == nchunks - 1 ? end : begin + (c + 1) * chunk, arg);
+		}
+		else if(sched == OMP_RT_DYNAMIC){
+			#pragma omp for schedule(dynamic) nowait
+			for(c = 0; c < nchunks; c++)
+				body(begin + c * chunk, c == nchunks - 1 ? end : begin + (c + 1) * chunk, arg);
+		}
+		else{
+			#pragma omp for schedule(guided) nowait
+			for(c = 0; c < nchunks; c++)
+				body(begin + c * chunk, c == nchunks - 1 ? end : begin + (c + 1) * chunk, arg);
+		}
+	}
+
+	if(omp_rt_stats && id < omp_rt_nthreads)
+		omp_rt_stats[id].busy += omp_get_wtime() - t;
+}
+
+/**
+* Counts a loop of nt threads that took wall seconds, on thread 0
+*/
+static void omp_rt_count(double wall, int nt, int fork){
+	if(omp_rt_stats && omp_get_thread_num() == 0){
+		omp_rt_stats[0].wall += wall;
+		omp_rt_stats[0].team += wall * nt;
+		omp_rt_stats[0].calls++;
+		omp_rt_stats[0].forks += fork;
+	}
+}
+
+static void omp_rt_run(int begin, int end, omp_rt_sched sched, int chunk, omp_rt_body body, void *arg, int wait){
+	double t = omp_get_wtime();
+
+	if(omp_in_parallel()){
+		omp_rt_loop(begin, end, sched, chunk, body, arg);
+		if(wait){
+			#pragma omp barrier
+		}
+		omp_rt_count(omp_get_wtime() - t, omp_get_num_threads(), 0);
+	}
+	else if(omp_rt_nthreads > 1 && end - begin > 1){
+		int nt = 1;
+		#pragma omp parallel
+		{
+			#pragma omp master
+			nt = omp_get_num_threads();
+			omp_rt_loop(begin, end, sched, chunk, body, arg);
+		}
+		omp_rt_count(omp_get_wtime() - t, nt, 1);
+	}
+	else{
+		omp_rt_loop(begin, end, sched, chunk, body, arg);
+		omp_rt_count(omp_get_wtime() - t, 1, 0);
+	}
+}
+
+void omp_rt_for(int begin, int end, omp_rt_sched sched, int chunk, omp_rt_body body, void *arg){
+	omp_rt_run(begin, end, sched, chunk, body, arg, 1);
+}
+
+void omp_rt_for_nowait(int begin, int end, omp_rt_sched sched, int chunk, omp_rt_body body, void *arg){
+	omp_rt_run(begin, end, sched, chunk, body, arg, 0);
+}
+
+void omp_rt_stats_reset(void){
+	if(omp_rt_stats)
+		memset(omp_rt_stats, 0, omp_rt_nthreads * sizeof(omp_rt_stat));
+}
+
+void omp_rt_report(const char *name){
+	double busy = 0, lost;
+	const omp_rt_stat *s = omp_rt_stats;
+	int i;
+
+	if(!s)
+		return;
+	for(i = 0; i < omp_rt_nthreads; i++)
+		busy += s[i].busy;
+	lost = s[0].team > busy ? s[0].team - busy : 0;
+	printf("omp_rt: %s: %d threads%s, %ld loops (%ld forks), %.3f ms in loops, overhead %.2f us per loop (%.1f%%)\n",
+	       name, omp_rt_nthreads, omp_rt_pinned ? " pinned" : "", s[0].calls, s[0].forks, s[0].wall * 1e3,
+	       s[0].calls ? lost / omp_rt_nthreads / s[0].calls * 1e6 : 0.0,
+	       s[0].team > 0 ? 100.0 * lost / s[0].team : 0.0);
+}
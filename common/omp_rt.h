@@ -0,0 +1,96 @@
+/**
+* @file omp_rt.h
+* @brief Small OpenMP loop runtime shared by the OpenMP benchmarks
+*
+* The benchmarks used to open a parallel region (and call omp_set_num_threads) for every sweep of their time
+* loop, paying a fork/join per sweep. With this runtime the thread team is sized and pinned once by omp_rt_init,
+* the whole time loop runs in one parallel region and every sweep is an omp_rt_for, which only ends in a barrier:
+*
+*	omp_rt_init(nthreads);
+*	#pragma omp parallel if (omp_rt_persistent())
+*	for (i = 0; i < iterations; i++)
+*		omp_rt_for(0, n, OMP_RT_STATIC, 0, sweep, &args);
+*	omp_rt_report("sweep");
+*
+* omp_rt_for called outside an active parallel region opens one for the loop (a fork). OMP_RT_PERSISTENT=0 in
+* the environment makes omp_rt_persistent() false, so the same code forks per loop, to measure the difference.
+* Every call is counted and timed; omp_rt_report prints the time spent in loops and the part of it that was
+* not loop body on an average thread (fork/join, barrier wait, imbalance, scheduling) per call.
+*
+* Threads are pinned to the allowed CPUs in order, unless OMP_PROC_BIND or OMP_PLACES is set (the OpenMP
+* runtime places them then) or OMP_RT_BIND=0.
+*/
+#ifndef OMP_RT_H
+#define OMP_RT_H
+
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+* Distribution of the iterations of an omp_rt_for
+*/
+typedef enum omp_rt_sched{
+	OMP_RT_STATIC,	/**< contiguous block per thread, or chunks round robin if chunk > 0 */
+	OMP_RT_DYNAMIC,	/**< chunks handed out first come, first served */
+	OMP_RT_GUIDED	/**< chunks handed out in runs shrinking with the remaining work */
+} omp_rt_sched;
+
+/**
+* Loop body: iterations begin to end-1 of the loop
+*/
+typedef void (*omp_rt_body)(int begin, int end, void *arg);
+
+/**
+* Sizes the thread team, pins its threads and starts them, resets the statistics. Call outside parallel regions,
+* before the timed part of the benchmark.
+* @param nthreads The number of threads, omp_get_max_threads() if not positive
+*/
+void omp_rt_init(int nthreads);
+
+/**
+* @return the number of threads of the team
+*/
+int omp_rt_threads(void);
+
+/**
+* @return whether the caller should run its time loop in one parallel region (see the file comment)
+*/
+int omp_rt_persistent(void);
+
+/**
+* Runs body over begin to end-1 on the team and waits for all of it. Inside a parallel region every thread of
+* the team has to make the same calls, as for an omp for.
+* @param begin The first iteration
+* @param end One past the last iteration
+* @param sched The distribution of the iterations
+* @param chunk The iterations per body call, for OMP_RT_DYNAMIC and OMP_RT_GUIDED a default if not positive
+* @param body The loop body
+* @param arg Passed to body
+*/
+void omp_rt_for(int begin, int end, omp_rt_sched sched, int chunk, omp_rt_body body, void *arg);
+
+/**
+* omp_rt_for without the closing barrier, for a loop whose results are not read by other threads before their
+* next barrier
+*/
+void omp_rt_for_nowait(int begin, int end, omp_rt_sched sched, int chunk, omp_rt_body body, void *arg);
+
+/**
+* Zeroes the loop statistics
+*/
+void omp_rt_stats_reset(void);
+
+/**
+* Prints the loop statistics since omp_rt_init or omp_rt_stats_reset
+* @param name The name of the loops
+*/
+void omp_rt_report(const char *name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
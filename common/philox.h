@@ -0,0 +1,109 @@
+/**
+* @file philox.h
+* @brief Counter-based uniform and normal RNG (Philox4x32-10) shared by the C/OpenMP benchmarks
+*
+* Every draw is a pure function of (key, stream, counter): there is no per-index seed array to advance, so draws
+* can be computed in any order, by any thread, and inside vectorized loops while giving the same numbers.
+* Typical use is one stream per particle/element and the iteration (frame) number as the counter.
+* @see J. K. Salmon, M. A. Moraes, R. O. Dror, D. E. Shaw, "Parallel Random Numbers: As Easy as 1, 2, 3", SC11
+*/
+#ifndef PHILOX_H
+#define PHILOX_H
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+#define PHILOX_ROUNDS 10
+#define PHILOX_PI 3.14159265358979323846
+
+/**
+* One 128-bit block of random bits
+*/
+typedef struct philox4x32{
+	uint32_t v[4];
+} philox4x32;
+
+/**
+* Philox4x32 bijection: 10 rounds of multiply/xor over the counter, keyed by a 64-bit key
+* @param ctr The counter block
+* @param k0 The low word of the key
+* @param k1 The high word of the key
+* @return the random block for this counter and key
+*/
+static inline philox4x32 philox4x32_10(philox4x32 ctr, uint32_t k0, uint32_t k1){
+	int r;
+	uint64_t p0, p1;
+	for(r = 0; r < PHILOX_ROUNDS; r++){
+		p0 = (uint64_t)PHILOX_M0 * ctr.v[0];
+		p1 = (uint64_t)PHILOX_M1 * ctr.v[2];
+		ctr.v[0] = (uint32_t)(p1 >> 32) ^ ctr.v[1] ^ k0;
+		ctr.v[2] = (uint32_t)(p0 >> 32) ^ ctr.v[3] ^ k1;
+		ctr.v[1] = (uint32_t)p1;
+		ctr.v[3] = (uint32_t)p0;
+		k0 += PHILOX_W0;
+		k1 += PHILOX_W1;
+	}
+	return ctr;
+}
+
+/**
+* Random block for the given key, stream and counter
+* @param key The generator seed
+* @param stream The stream (e.g. particle index)
+* @param counter The position within the stream (e.g. frame number)
+* @return 128 random bits
+*/
+static inline philox4x32 philox_block(uint64_t key, uint64_t stream, uint64_t counter){
+	philox4x32 ctr;
+	ctr.v[0] = (uint32_t)counter;
+	ctr.v[1] = (uint32_t)(counter >> 32);
+	ctr.v[2] = (uint32_t)stream;
+	ctr.v[3] = (uint32_t)(stream >> 32);
+	return philox4x32_10(ctr, (uint32_t)key, (uint32_t)(key >> 32));
+}
+
+/**
+* Converts random bits to a double by filling the 52-bit mantissa of a number in [1, 2), integer-only so that it vectorizes
+* @return a uniformly distributed number [0, 1)
+*/
+static inline double philox_to_double(uint32_t lo, uint32_t hi){
+	uint64_t bits = 0x3FF0000000000000ull | ((((uint64_t)hi << 32) | lo) >> 12);
+	double d;
+	memcpy(&d, &bits, sizeof(d));
+	return d - 1.0;
+}
+
+/**
+* Generates a uniformly distributed random number
+* @note This function is stateless and thread-safe
+* @param key The generator seed
+* @param stream The stream
+* @param counter The position within the stream
+* @return a uniformly distributed number [0, 1)
+*/
+static inline double philox_uniform(uint64_t key, uint64_t stream, uint64_t counter){
+	philox4x32 r = philox_block(key, stream, counter);
+	return philox_to_double(r.v[0], r.v[1]);
+}
+
+/**
+* Generates a normally distributed random number using the Box-Muller transformation of the two halves of one block
+* @note This function is stateless and thread-safe
+* @param key The generator seed
+* @param stream The stream
+* @param counter The position within the stream
+* @return a normally distributed number with mean 0 and variance 1
+*/
+static inline double philox_normal(uint64_t key, uint64_t stream, uint64_t counter){
+	philox4x32 r = philox_block(key, stream, counter);
+	double u = 1.0 - philox_to_double(r.v[0], r.v[1]);				// (0, 1], keeps log finite
+	double v = philox_to_double(r.v[2], r.v[3]);
+	return sqrt(-2*log(u))*cos(2*PHILOX_PI*v);
+}
+
+#endif
@@ -35,4 +35,11 @@ void rgbToComponents(T *d_r, T *d_g, T *d_b, unsigned char * src, int width, int
 template<typename T>
 void bwToComponent(T *d_c, unsigned char * src, int width, int height);
 
+/* The same on host buffers (components_cpu.cpp) */
+template<typename T>
+void rgbToComponentsCPU(T *r, T *g, T *b, unsigned char * src, int width, int height);
+
+template<typename T>
+void bwToComponentCPU(T *c, unsigned char * src, int width, int height);
+
 #endif
@@ -0,0 +1,48 @@
+/*
+ * CPU (OpenMP) versions of the component converters of components.cu:
+ * the same normalization, on host buffers.
+ */
+
+#include "components.h"
+
+/* Store float component */
+static inline void storeComponent(float *c, unsigned char v, int pos)
+{
+    c[pos] = (v/255.0f) - 0.5f;
+}
+
+/* Store integer component */
+static inline void storeComponent(int *c, unsigned char v, int pos)
+{
+    c[pos] = v - 128;
+}
+
+/* Separate compoents of 8bit RGB source image */
+template<typename T>
+void rgbToComponentsCPU(T *r, T *g, T *b, unsigned char * src, int width, int height)
+{
+    int pixels = width*height;
+
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < pixels; i++) {
+        storeComponent(r, src[3*i],   i);
+        storeComponent(g, src[3*i+1], i);
+        storeComponent(b, src[3*i+2], i);
+    }
+}
+template void rgbToComponentsCPU<float>(float *r, float *g, float *b, unsigned char * src, int width, int height);
+template void rgbToComponentsCPU<int>(int *r, int *g, int *b, unsigned char * src, int width, int height);
+
+/* Copy a 8bit source image data into a color compoment of type T */
+template<typename T>
+void bwToComponentCPU(T *c, unsigned char * src, int width, int height)
+{
+    int pixels = width*height;
+
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < pixels; i++) {
+        storeComponent(c, src[i], i);
+    }
+}
+template void bwToComponentCPU<float>(float *c, unsigned char *src, int width, int height);
+template void bwToComponentCPU<int>(int *c, unsigned char *src, int width, int height);
@@ -157,72 +157,29 @@ template int nStage2dDWT<int>(int*, int*, int*, int, int, int, bool, int*);
 
 */
 
-void samplesToChar(unsigned char * dst, float * src, int samplesNum)
-{
-    int i;
-
-    for(i = 0; i < samplesNum; i++) {
-        float r = (src[i]+0.5f) * 255;
-        if (r > 255) r = 255; 
-        if (r < 0)   r = 0; 
-        dst[i] = (unsigned char)r;
-    }
-}
-
-void samplesToChar(unsigned char * dst, int * src, int samplesNum)
-{
-    int i;
-
-    for(i = 0; i < samplesNum; i++) {
-        int r = src[i]+128;
-        if (r > 255) r = 255;
-        if (r < 0)   r = 0; 
-        dst[i] = (unsigned char)r;
-    }
-}
-
 ///* Write output linear orderd*/
 template<typename T>
 int writeLinear(T *component_cuda, int pixWidth, int pixHeight,
                 const char * filename, const char * suffix)
 {
-    unsigned char * result;
     T *gpu_output;
-    int i;
+    int ret;
     int size;
     int samplesNum = pixWidth*pixHeight;
 
     size = samplesNum*sizeof(T);
     cudaMallocHost((void **)&gpu_output, size);
     cudaCheckError("Malloc host");
-    memset(gpu_output, 0, size);
-    result = (unsigned char *)malloc(samplesNum);
     cudaMemcpy(gpu_output, component_cuda, size, cudaMemcpyDeviceToHost);
     cudaCheckError("Memcopy device to host");
 
-    /* T to char */
-    samplesToChar(result, gpu_output, samplesNum);
-
-    /* Write component */
-    char outfile[strlen(filename)+strlen(suffix)];
-    strcpy(outfile, filename);
-    strcpy(outfile+strlen(filename), suffix);
-    i = open(outfile, O_CREAT|O_WRONLY, 0644);
-    if (i == -1) {
-        error(0,errno,"cannot access %s", outfile);
-        return -1;
-    }
-    printf("\nWriting to %s (%d x %d)\n", outfile, pixWidth, pixHeight);
-    ssize_t x ;
-    x = write(i, result, samplesNum);
-    close(i);
+    /* T to char and write component (dwt_cpu.cpp) */
+    ret = writeLinearCPU(gpu_output, pixWidth, pixHeight, filename, suffix);
 
     /* Clean up */
     cudaFreeHost(gpu_output);
     cudaCheckError("Cuda free host memory");
-    free(result);
-    if(x == 0) return 1;
-    return 0;
+    return ret;
 }
 template int writeLinear<float>(float *component_cuda, int pixWidth, int pixHeight, const char * filename, const char * suffix); 
 template int writeLinear<int>(int *component_cuda, int pixWidth, int pixHeight, const char * filename, const char * suffix); 
@@ -232,128 +189,23 @@ template<typename T>
 int writeNStage2DDWT(T *component_cuda, int pixWidth, int pixHeight, 
                      int stages, const char * filename, const char * suffix) 
 {
-    struct band {
-        int dimX; 
-        int dimY;
-    };
-    struct dimensions {
-        struct band LL;
-        struct band HL;
-        struct band LH;
-        struct band HH;
-    };
-
-    unsigned char * result;
-    T *src, *dst;
-    int i,s;
+    T *src;
+    int ret;
     int size;
-    int offset;
-    int yOffset;
     int samplesNum = pixWidth*pixHeight;
-    struct dimensions * bandDims;
-
-    bandDims = (struct dimensions *)malloc(stages * sizeof(struct dimensions));
 
-    bandDims[0].LL.dimX = DIVANDRND(pixWidth,2);
-    bandDims[0].LL.dimY = DIVANDRND(pixHeight,2);
-    bandDims[0].HL.dimX = pixWidth - bandDims[0].LL.dimX;
-    bandDims[0].HL.dimY = bandDims[0].LL.dimY;
-    bandDims[0].LH.dimX = bandDims[0].LL.dimX;
-    bandDims[0].LH.dimY = pixHeight - bandDims[0].LL.dimY;
-    bandDims[0].HH.dimX = bandDims[0].HL.dimX;
-    bandDims[0].HH.dimY = bandDims[0].LH.dimY;
-
-    for (i = 1; i < stages; i++) {
-        bandDims[i].LL.dimX = DIVANDRND(bandDims[i-1].LL.dimX,2);
-        bandDims[i].LL.dimY = DIVANDRND(bandDims[i-1].LL.dimY,2);
-        bandDims[i].HL.dimX = bandDims[i-1].LL.dimX - bandDims[i].LL.dimX;
-        bandDims[i].HL.dimY = bandDims[i].LL.dimY;
-        bandDims[i].LH.dimX = bandDims[i].LL.dimX;
-        bandDims[i].LH.dimY = bandDims[i-1].LL.dimY - bandDims[i].LL.dimY;
-        bandDims[i].HH.dimX = bandDims[i].HL.dimX;
-        bandDims[i].HH.dimY = bandDims[i].LH.dimY;
-    }
-
-#if 0
-    printf("Original image pixWidth x pixHeight: %d x %d\n", pixWidth, pixHeight);
-    for (i = 0; i < stages; i++) {
-        printf("Stage %d: LL: pixWidth x pixHeight: %d x %d\n", i, bandDims[i].LL.dimX, bandDims[i].LL.dimY);
-        printf("Stage %d: HL: pixWidth x pixHeight: %d x %d\n", i, bandDims[i].HL.dimX, bandDims[i].HL.dimY);
-        printf("Stage %d: LH: pixWidth x pixHeight: %d x %d\n", i, bandDims[i].LH.dimX, bandDims[i].LH.dimY);
-        printf("Stage %d: HH: pixWidth x pixHeight: %d x %d\n", i, bandDims[i].HH.dimX, bandDims[i].HH.dimY);
-    }
-#endif
-    
     size = samplesNum*sizeof(T);
     cudaMallocHost((void **)&src, size);
     cudaCheckError("Malloc host");
-    dst = (T*)malloc(size);
-    memset(src, 0, size);
-    memset(dst, 0, size);
-    result = (unsigned char *)malloc(samplesNum);
     cudaMemcpy(src, component_cuda, size, cudaMemcpyDeviceToHost);
     cudaCheckError("Memcopy device to host");
 
-    // LL Band
-    size = bandDims[stages-1].LL.dimX * sizeof(T);
-    for (i = 0; i < bandDims[stages-1].LL.dimY; i++) {
-        memcpy(dst+i*pixWidth, src+i*bandDims[stages-1].LL.dimX, size);
-    }
-
-    for (s = stages - 1; s >= 0; s--) {
-        // HL Band
-        size = bandDims[s].HL.dimX * sizeof(T);
-        offset = bandDims[s].LL.dimX * bandDims[s].LL.dimY;
-        for (i = 0; i < bandDims[s].HL.dimY; i++) {
-            memcpy(dst+i*pixWidth+bandDims[s].LL.dimX,
-                src+offset+i*bandDims[s].HL.dimX, 
-                size);
-        }
-
-        // LH band
-        size = bandDims[s].LH.dimX * sizeof(T);
-        offset += bandDims[s].HL.dimX * bandDims[s].HL.dimY;
-        yOffset = bandDims[s].LL.dimY;
-        for (i = 0; i < bandDims[s].HL.dimY; i++) {
-            memcpy(dst+(yOffset+i)*pixWidth,
-                src+offset+i*bandDims[s].LH.dimX, 
-                size);
-        }
-
-        //HH band
-        size = bandDims[s].HH.dimX * sizeof(T);
-        offset += bandDims[s].LH.dimX * bandDims[s].LH.dimY;
-        yOffset = bandDims[s].HL.dimY;
-        for (i = 0; i < bandDims[s].HH.dimY; i++) {
-            memcpy(dst+(yOffset+i)*pixWidth+bandDims[s].LH.dimX,
-                src+offset+i*bandDims[s].HH.dimX, 
-                size);
-        }
-    }
-
-    /* Write component */
-    samplesToChar(result, dst, samplesNum);
-
-    char outfile[strlen(filename)+strlen(suffix)];
-    strcpy(outfile, filename);
-    strcpy(outfile+strlen(filename), suffix);
-    i = open(outfile, O_CREAT|O_WRONLY, 0644);
-    if (i == -1) {
-        error(0,errno,"cannot access %s", outfile);
-        return -1;
-    }
-    printf("\nWriting to %s (%d x %d)\n", outfile, pixWidth, pixHeight);
-    ssize_t x;
-    x = write(i, result, samplesNum);
-    close(i);
+    /* Reorder bands and write component (dwt_cpu.cpp) */
+    ret = writeNStage2DDWTCPU(src, pixWidth, pixHeight, stages, filename, suffix);
 
     cudaFreeHost(src);
     cudaCheckError("Cuda free host memory");
-    free(dst);
-    free(result);
-    free(bandDims);
-    if (x == 0) return 1;
-    return 0;
+    return ret;
 }
 template int writeNStage2DDWT<float>(float *component_cuda, int pixWidth, int pixHeight, int stages, const char * filename, const char * suffix); 
 template int writeNStage2DDWT<int>(int *component_cuda, int pixWidth, int pixHeight, int stages, const char * filename, const char * suffix); 
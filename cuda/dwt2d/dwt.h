@@ -37,4 +37,24 @@ template<typename T>
 int writeLinear(T *component_cuda, int width, int height, 
                      const char * filename, const char * suffix);
 
+/* CPU (OpenMP) DWT and writers of host buffers (dwt_cpu.cpp) */
+template<typename T> 
+int nStage2dDWTCPU(T *in, T *out, T * backup, int pixWidth, int pixHeight, int stages, bool forward);
+
+template<typename T>
+int writeNStage2DDWTCPU(T *component, int width, int height, 
+                        int stages, const char * filename, const char * suffix);
+template<typename T>
+int writeLinearCPU(T *component, int width, int height, 
+                   const char * filename, const char * suffix);
+
+/* Number of samples of a and b differing by more than the tolerance of T:
+   0 for 5/3, CPU_DWT_TOLERANCE for 9/7 */
+template<typename T>
+int compareDWT(const T *a, const T *b, int samplesNum, const char *name);
+
+/* Reverse (forward) CPU DWT of a forward (reverse) result, compared with orig */
+template<typename T>
+int roundTripDWTCPU(const T *result, const T *orig, int pixWidth, int pixHeight, int stages, bool forward);
+
 #endif
@@ -0,0 +1,313 @@
+/*
+ * Host side of dwt2d: the CPU (OpenMP) DWT driver, output writers working on
+ * host buffers (shared with the CUDA path in dwt.cu) and comparison of two
+ * DWT results.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <math.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <error.h>
+#include <algorithm>
+#include "dwt_cpu/dwt.h"
+#include "dwt.h"
+#include "common.h"
+
+/* Overall DWT runs timed by nStage2dDWTCPU (after the first one) */
+#ifndef CPU_DWT_ITERATIONS
+#define CPU_DWT_ITERATIONS 11
+#endif
+
+/* Largest difference of 9/7 results accepted by compareDWT */
+#ifndef CPU_DWT_TOLERANCE
+#define CPU_DWT_TOLERANCE 1e-4
+#endif
+
+static inline void fdwtCPU(float *in, float *out, int width, int height, int levels)
+{
+        dwt_cpu::fdwt97(in, out, width, height, levels);
+}
+
+static inline void fdwtCPU(int *in, int *out, int width, int height, int levels)
+{
+        dwt_cpu::fdwt53(in, out, width, height, levels);
+}
+
+static inline void rdwtCPU(float *in, float *out, int width, int height, int levels)
+{
+        dwt_cpu::rdwt97(in, out, width, height, levels);
+}
+
+static inline void rdwtCPU(int *in, int *out, int width, int height, int levels)
+{
+        dwt_cpu::rdwt53(in, out, width, height, levels);
+}
+
+static double wtime()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec*1e-6;
+}
+
+template<typename T>
+int nStage2dDWTCPU(T * in, T * out, T * backup, int pixWidth, int pixHeight, int stages, bool forward)
+{
+    printf("\n*** %d stages of 2D %s DWT (CPU):\n", stages, forward ? "forward" : "reverse");
+
+    /* create backup of input, because each test iteration overwrites it */
+    const int size = pixHeight * pixWidth * sizeof(T);
+    memcpy(backup, in, size);
+
+    if(forward)
+        fdwtCPU(in, out, pixWidth, pixHeight, stages);
+    else
+        rdwtCPU(in, out, pixWidth, pixHeight, stages);
+
+    /* Measure time of overall DWT, input restored before each run */
+    double times[CPU_DWT_ITERATIONS];
+    double sum = 0;
+    for(int i = 0; i < CPU_DWT_ITERATIONS; i++) {
+        memcpy(in, backup, size);
+        double t = wtime();
+        if(forward)
+            fdwtCPU(in, out, pixWidth, pixHeight, stages);
+        else
+            rdwtCPU(in, out, pixWidth, pixHeight, stages);
+        times[i] = (wtime() - t) * 1000;
+        sum += times[i];
+    }
+    std::sort(times, times + CPU_DWT_ITERATIONS);
+    const double median = (times[CPU_DWT_ITERATIONS / 2]
+                         + times[(CPU_DWT_ITERATIONS - 1) / 2]) * 0.5;
+    printf("  Overall DWT:   %7.3f ms (mean)   %7.3f ms (median)   %7.3f ms (min)  "
+           "(%d x %d)   %.1f MP/s\n", sum / CPU_DWT_ITERATIONS, median, times[0],
+           pixWidth, pixHeight, pixWidth * (double)pixHeight / (median * 1000));
+    return 0;
+}
+template int nStage2dDWTCPU<float>(float*, float*, float*, int, int, int, bool);
+template int nStage2dDWTCPU<int>(int*, int*, int*, int, int, int, bool);
+
+/* Allowed difference of the CPU and GPU transforms or of a round trip:
+   5/3 is exact, 9/7 is not (float rounding, FMA on the GPU) */
+static inline double dwtTolerance(int) { return 0; }
+static inline double dwtTolerance(float) { return CPU_DWT_TOLERANCE; }
+
+/* Number of samples of a and b differing by more than tolerance */
+template<typename T>
+int compareDWT(const T *a, const T *b, int samplesNum, const char *name)
+{
+    const double tolerance = dwtTolerance(T());
+    int bad = 0, first = -1;
+    double maxDiff = 0;
+
+    for (int i = 0; i < samplesNum; i++) {
+        double diff = fabs((double)a[i] - (double)b[i]);
+        maxDiff = std::max(diff, maxDiff);
+        if (diff > tolerance) {
+            if (first < 0) first = i;
+            bad++;
+        }
+    }
+    printf("  %s: max difference %g, %d of %d samples over %g: %s\n",
+           name, maxDiff, bad, samplesNum, tolerance, bad ? "FAIL" : "PASS");
+    if (first >= 0)
+        printf("  first mismatch on sample %d: %g : %g\n", first, (double)a[first], (double)b[first]);
+    return bad;
+}
+template int compareDWT<float>(const float*, const float*, int, const char*);
+template int compareDWT<int>(const int*, const int*, int, const char*);
+
+/* Transform result of a DWT back (in the opposite direction) and compare it
+   with the original samples */
+template<typename T>
+int roundTripDWTCPU(const T *result, const T *orig, int pixWidth, int pixHeight, int stages, bool forward)
+{
+    const int samplesNum = pixWidth * pixHeight;
+    T *in = (T *)malloc(samplesNum * sizeof(T));
+    T *out = (T *)malloc(samplesNum * sizeof(T));
+
+    memcpy(in, result, samplesNum * sizeof(T));
+    if(forward)
+        rdwtCPU(in, out, pixWidth, pixHeight, stages);
+    else
+        fdwtCPU(in, out, pixWidth, pixHeight, stages);
+    int bad = compareDWT(out, orig, samplesNum, "round trip");
+
+    free(in);
+    free(out);
+    return bad;
+}
+template int roundTripDWTCPU<float>(const float*, const float*, int, int, int, bool);
+template int roundTripDWTCPU<int>(const int*, const int*, int, int, int, bool);
+
+static void samplesToChar(unsigned char * dst, float * src, int samplesNum)
+{
+    int i;
+
+    for(i = 0; i < samplesNum; i++) {
+        float r = (src[i]+0.5f) * 255;
+        if (r > 255) r = 255;
+        if (r < 0)   r = 0;
+        dst[i] = (unsigned char)r;
+    }
+}
+
+static void samplesToChar(unsigned char * dst, int * src, int samplesNum)
+{
+    int i;
+
+    for(i = 0; i < samplesNum; i++) {
+        int r = src[i]+128;
+        if (r > 255) r = 255;
+        if (r < 0)   r = 0;
+        dst[i] = (unsigned char)r;
+    }
+}
+
+/* Write samples as chars into filename+suffix */
+static int writeSamples(unsigned char *result, int pixWidth, int pixHeight,
+                        const char * filename, const char * suffix)
+{
+    int samplesNum = pixWidth*pixHeight;
+    char outfile[strlen(filename)+strlen(suffix)+1];
+    strcpy(outfile, filename);
+    strcpy(outfile+strlen(filename), suffix);
+    int i = open(outfile, O_CREAT|O_WRONLY, 0644);
+    if (i == -1) {
+        error(0,errno,"cannot access %s", outfile);
+        return -1;
+    }
+    printf("\nWriting to %s (%d x %d)\n", outfile, pixWidth, pixHeight);
+    ssize_t x ;
+    x = write(i, result, samplesNum);
+    close(i);
+    if(x == 0) return 1;
+    return 0;
+}
+
+///* Write output linear orderd*/
+template<typename T>
+int writeLinearCPU(T *component, int pixWidth, int pixHeight,
+                   const char * filename, const char * suffix)
+{
+    int samplesNum = pixWidth*pixHeight;
+    unsigned char * result = (unsigned char *)malloc(samplesNum);
+
+    /* T to char */
+    samplesToChar(result, component, samplesNum);
+
+    /* Write component */
+    int ret = writeSamples(result, pixWidth, pixHeight, filename, suffix);
+    free(result);
+    return ret;
+}
+template int writeLinearCPU<float>(float *component, int pixWidth, int pixHeight, const char * filename, const char * suffix);
+template int writeLinearCPU<int>(int *component, int pixWidth, int pixHeight, const char * filename, const char * suffix);
+
+/* Write output visual ordered */
+template<typename T>
+int writeNStage2DDWTCPU(T *component, int pixWidth, int pixHeight,
+                        int stages, const char * filename, const char * suffix)
+{
+    struct band {
+        int dimX;
+        int dimY;
+    };
+    struct dimensions {
+        struct band LL;
+        struct band HL;
+        struct band LH;
+        struct band HH;
+    };
+
+    unsigned char * result;
+    T *src, *dst;
+    int i,s;
+    int size;
+    int offset;
+    int yOffset;
+    int samplesNum = pixWidth*pixHeight;
+    struct dimensions * bandDims;
+
+    bandDims = (struct dimensions *)malloc(stages * sizeof(struct dimensions));
+
+    bandDims[0].LL.dimX = DIVANDRND(pixWidth,2);
+    bandDims[0].LL.dimY = DIVANDRND(pixHeight,2);
+    bandDims[0].HL.dimX = pixWidth - bandDims[0].LL.dimX;
+    bandDims[0].HL.dimY = bandDims[0].LL.dimY;
+    bandDims[0].LH.dimX = bandDims[0].LL.dimX;
+    bandDims[0].LH.dimY = pixHeight - bandDims[0].LL.dimY;
+    bandDims[0].HH.dimX = bandDims[0].HL.dimX;
+    bandDims[0].HH.dimY = bandDims[0].LH.dimY;
+
+    for (i = 1; i < stages; i++) {
+        bandDims[i].LL.dimX = DIVANDRND(bandDims[i-1].LL.dimX,2);
+        bandDims[i].LL.dimY = DIVANDRND(bandDims[i-1].LL.dimY,2);
+        bandDims[i].HL.dimX = bandDims[i-1].LL.dimX - bandDims[i].LL.dimX;
+        bandDims[i].HL.dimY = bandDims[i].LL.dimY;
+        bandDims[i].LH.dimX = bandDims[i].LL.dimX;
+        bandDims[i].LH.dimY = bandDims[i-1].LL.dimY - bandDims[i].LL.dimY;
+        bandDims[i].HH.dimX = bandDims[i].HL.dimX;
+        bandDims[i].HH.dimY = bandDims[i].LH.dimY;
+    }
+
+    size = samplesNum*sizeof(T);
+    src = component;
+    dst = (T*)malloc(size);
+    memset(dst, 0, size);
+    result = (unsigned char *)malloc(samplesNum);
+
+    // LL Band
+    size = bandDims[stages-1].LL.dimX * sizeof(T);
+    for (i = 0; i < bandDims[stages-1].LL.dimY; i++) {
+        memcpy(dst+i*pixWidth, src+i*bandDims[stages-1].LL.dimX, size);
+    }
+
+    for (s = stages - 1; s >= 0; s--) {
+        // HL Band
+        size = bandDims[s].HL.dimX * sizeof(T);
+        offset = bandDims[s].LL.dimX * bandDims[s].LL.dimY;
+        for (i = 0; i < bandDims[s].HL.dimY; i++) {
+            memcpy(dst+i*pixWidth+bandDims[s].LL.dimX,
+                src+offset+i*bandDims[s].HL.dimX,
+                size);
+        }
+
+        // LH band
+        size = bandDims[s].LH.dimX * sizeof(T);
+        offset += bandDims[s].HL.dimX * bandDims[s].HL.dimY;
+        yOffset = bandDims[s].LL.dimY;
+        for (i = 0; i < bandDims[s].LH.dimY; i++) {
+            memcpy(dst+(yOffset+i)*pixWidth,
+                src+offset+i*bandDims[s].LH.dimX,
+                size);
+        }
+
+        //HH band
+        size = bandDims[s].HH.dimX * sizeof(T);
+        offset += bandDims[s].LH.dimX * bandDims[s].LH.dimY;
+        yOffset = bandDims[s].HL.dimY;
+        for (i = 0; i < bandDims[s].HH.dimY; i++) {
+            memcpy(dst+(yOffset+i)*pixWidth+bandDims[s].LH.dimX,
+                src+offset+i*bandDims[s].HH.dimX,
+                size);
+        }
+    }
+
+    /* Write component */
+    samplesToChar(result, dst, samplesNum);
+    int ret = writeSamples(result, pixWidth, pixHeight, filename, suffix);
+
+    free(dst);
+    free(result);
+    free(bandDims);
+    return ret;
+}
+template int writeNStage2DDWTCPU<float>(float *component, int pixWidth, int pixHeight, int stages, const char * filename, const char * suffix);
+template int writeNStage2DDWTCPU<int>(int *component, int pixWidth, int pixHeight, int stages, const char * filename, const char * suffix);
@@ -0,0 +1,449 @@
+///
+/// @file    dwt.cpp
+/// @brief   CPU (OpenMP) implementation of forward and reverse 5/3 and 9/7
+///          DWT, following the lifting schemas of the CUDA kernels in
+///          dwt_cuda/ (see dwt.h for order of operations and edge handling).
+///
+
+#include <cstring>
+#include <algorithm>
+#include <omp.h>
+#include "dwt.h"
+
+
+namespace dwt_cpu {
+
+
+  // 9/7 lifting schema coefficients (the same as in dwt_cuda/common.h)
+  const float f97Predict1 = -1.586134342;   ///< forward 9/7 predict 1
+  const float f97Update1 = -0.05298011854;  ///< forward 9/7 update 1
+  const float f97Predict2 = 0.8829110762;   ///< forward 9/7 predict 2
+  const float f97Update2 = 0.4435068522;    ///< forward 9/7 update 2
+  const float scale97Mul = 1.23017410491400f;
+  const float scale97Div = 1.0 / scale97Mul;
+
+
+  /// Rows of vertical neighbors per step of the vertical sliding window.
+  enum { WIN_STEP = 8 };
+
+  /// Widest stripe of columns (in samples) handled by one vertical window.
+  enum { MAX_STRIPE = 256 };
+
+
+  /// Kinds of lifting steps.
+  enum StepOp {
+    FORWARD53_PREDICT,   ///< c -= (p + n) / 2
+    FORWARD53_UPDATE,    ///< c += (p + n + 2) / 4
+    REVERSE53_UPDATE,    ///< c -= (p + n + 2) / 4
+    REVERSE53_PREDICT,   ///< c += (p + n) / 2
+    ADD_SCALED_SUM,      ///< c += coef * (p + n)
+    SCALE                ///< even samples *= coef, odd ones *= coef2
+  };
+
+
+  /// One step of lifting schema.
+  struct Step {
+    StepOp op;    ///< what to do
+    int parity;   ///< 0 to modify even samples, 1 to modify odd ones
+    float coef;   ///< coefficient for ADD_SCALED_SUM, even scale for SCALE
+    float coef2;  ///< odd scale for SCALE
+  };
+
+
+  static const Step forward53[] = {
+    {FORWARD53_PREDICT, 1, 0.0f, 0.0f},
+    {FORWARD53_UPDATE, 0, 0.0f, 0.0f}
+  };
+
+  static const Step reverse53[] = {
+    {REVERSE53_UPDATE, 0, 0.0f, 0.0f},
+    {REVERSE53_PREDICT, 1, 0.0f, 0.0f}
+  };
+
+  static const Step forward97[] = {
+    {ADD_SCALED_SUM, 1, f97Predict1, 0.0f},
+    {ADD_SCALED_SUM, 0, f97Update1, 0.0f},
+    {ADD_SCALED_SUM, 1, f97Predict2, 0.0f},
+    {ADD_SCALED_SUM, 0, f97Update2, 0.0f},
+    {SCALE, 0, scale97Div, scale97Mul}
+  };
+
+  static const Step reverse97[] = {
+    {SCALE, 0, scale97Mul, scale97Div},
+    {ADD_SCALED_SUM, 0, -f97Update2, 0.0f},
+    {ADD_SCALED_SUM, 1, -f97Predict2, 0.0f},
+    {ADD_SCALED_SUM, 0, -f97Update1, 0.0f},
+    {ADD_SCALED_SUM, 1, -f97Predict1, 0.0f}
+  };
+
+  enum {
+    FORWARD53_STEPS = sizeof(forward53) / sizeof(Step),
+    REVERSE53_STEPS = sizeof(reverse53) / sizeof(Step),
+    FORWARD97_STEPS = sizeof(forward97) / sizeof(Step),
+    REVERSE97_STEPS = sizeof(reverse97) / sizeof(Step)
+  };
+
+
+  /// Applies one lifting step to count samples, each with its two neighbors
+  /// at the same index of p and n. Samples are independent, so the loops
+  /// are vectorized.
+  static inline void liftLine(int * __restrict c, const int * __restrict p,
+                              const int * __restrict n, const int count,
+                              const Step & step) {
+    switch(step.op) {
+      case FORWARD53_PREDICT:
+        #pragma omp simd
+        for(int i = 0; i < count; i++) c[i] -= (p[i] + n[i]) / 2;
+        break;
+      case FORWARD53_UPDATE:
+        #pragma omp simd
+        for(int i = 0; i < count; i++) c[i] += (p[i] + n[i] + 2) / 4;
+        break;
+      case REVERSE53_UPDATE:
+        #pragma omp simd
+        for(int i = 0; i < count; i++) c[i] -= (p[i] + n[i] + 2) / 4;
+        break;
+      case REVERSE53_PREDICT:
+        #pragma omp simd
+        for(int i = 0; i < count; i++) c[i] += (p[i] + n[i]) / 2;
+        break;
+      default:
+        break;
+    }
+  }
+
+  static inline void liftLine(float * __restrict c, const float * __restrict p,
+                              const float * __restrict n, const int count,
+                              const Step & step) {
+    const float coef = step.coef;
+    #pragma omp simd
+    for(int i = 0; i < count; i++) c[i] += coef * (p[i] + n[i]);
+  }
+
+
+  /// Multiplies count samples by given scale.
+  static inline void scaleLine(float * __restrict c, const int count,
+                               const float scale) {
+    #pragma omp simd
+    for(int i = 0; i < count; i++) c[i] *= scale;
+  }
+
+  static inline void scaleLine(int *, int, float) {}
+
+
+  /// Rows of one column-transformed image: even rows are stored from 'even'
+  /// and odd ones from 'odd', both with given stride. The natural image is
+  /// {img, img + sizeX, 2 * sizeX}, low and high bands of vertically
+  /// deinterleaved image are {LL, LH, sizeX of LL} and {HL, HH, sizeX of HL}.
+  template <typename T>
+  struct RowView {
+    T * even;
+    T * odd;
+    int stride;
+
+    T * row(const int r) const {
+      return ((r & 1) ? odd : even) + (r >> 1) * stride;
+    }
+  };
+
+  template <typename T>
+  static RowView<T> rowView(T * even, T * odd, const int stride) {
+    RowView<T> view = {even, odd, stride};
+    return view;
+  }
+
+
+  /// Index of the symmetric neighbor of row r + 1 (or r - 1) of sizeY rows.
+  static inline int mirror(const int r, const int sizeY) {
+    if(r < 0) return -r;
+    if(r >= sizeY) return 2 * sizeY - 2 - r;
+    return r;
+  }
+
+
+  /// Vertical lifting of columns [x0, x1) of given rows. All steps run over
+  /// the column stripe together, each some rows behind the previous one,
+  /// so that the stripe is swept through the cache once.
+  template <typename T>
+  static void verticalStripe(const RowView<T> & view, const int x0,
+                             const int x1, const int sizeY,
+                             const Step * const steps, const int numSteps) {
+    const int count = x1 - x0;
+
+    // done[s] - rows [0, done[s]) are finished by steps before s
+    // next[s] - first row not yet processed by step s
+    int done[8];
+    int next[8];
+    for(int s = 0; s < numSteps; s++) {
+      done[s] = 0;
+      next[s] = (steps[s].op == SCALE) ? 0 : steps[s].parity;
+    }
+    done[numSteps] = 0;
+
+    while(done[numSteps] < sizeY) {
+      done[0] = std::min(done[0] + WIN_STEP, sizeY);
+      for(int s = 0; s < numSteps; s++) {
+        const Step & step = steps[s];
+
+        // rows of step s may be processed only if both neighbors are
+        // complete and no previous step still needs them
+        const int limit = (done[s] == sizeY) ? sizeY : done[s] - 1;
+        if(step.op == SCALE) {
+          for(int r = next[s]; r < limit; r++) {
+            scaleLine(view.row(r) + x0, count, (r & 1) ? step.coef2 : step.coef);
+          }
+          next[s] = done[s + 1] = std::max(next[s], limit);
+          continue;
+        }
+        int r = next[s];
+        for(; r < limit; r += 2) {
+          T * const p = view.row(mirror(r - 1, sizeY)) + x0;
+          T * const n = view.row(mirror(r + 1, sizeY)) + x0;
+          liftLine(view.row(r) + x0, p, n, count, step);
+        }
+        next[s] = r;
+        done[s + 1] = std::min(done[s], std::min(r, sizeY));
+      }
+    }
+  }
+
+
+  /// Vertical lifting of whole width of given rows, stripes of columns
+  /// spread among threads. Columns of single sample are left as they are.
+  template <typename T>
+  static void verticalPass(const RowView<T> & view, const int sizeX,
+                           const int sizeY, const Step * const steps,
+                           const int numSteps) {
+    if(sizeY < 2 || sizeX < 1) {
+      return;
+    }
+    const int threads = omp_get_max_threads();
+    int stripe = (sizeX + 2 * threads - 1) / (2 * threads);
+    stripe = std::min<int>(MAX_STRIPE, std::max(16, (stripe + 15) & ~15));
+    const int stripes = (sizeX + stripe - 1) / stripe;
+
+    #pragma omp parallel for schedule(dynamic, 1) if(stripes > 1)
+    for(int i = 0; i < stripes; i++) {
+      const int x0 = i * stripe;
+      const int x1 = std::min(x0 + stripe, sizeX);
+      verticalStripe(view, x0, x1, sizeY, steps, numSteps);
+    }
+  }
+
+
+  /// Horizontal lifting of one deinterleaved line: nl low (even) samples
+  /// and nh high (odd) ones. Boundary samples use mirrored neighbors.
+  template <typename T>
+  static void liftHorizontal(T * const low, T * const high, const int nl,
+                             const int nh, const Step * const steps,
+                             const int numSteps) {
+    if(nh == 0) {
+      return;  // single sample
+    }
+    for(int s = 0; s < numSteps; s++) {
+      const Step & step = steps[s];
+      if(step.op == SCALE) {
+        scaleLine(low, nl, step.coef);
+        scaleLine(high, nh, step.coef2);
+      } else if(step.parity) {
+        // odd sample k between even samples k and k + 1
+        const int count = std::min(nh, nl - 1);
+        liftLine(high, low, low + 1, count, step);
+        if(count < nh) {
+          liftLine(high + count, low + count, low + count, 1, step);
+        }
+      } else {
+        // even sample k between odd samples k - 1 and k
+        liftLine(low, high, high, 1, step);
+        liftLine(low + 1, high, high + 1, nh - 1, step);
+        if(nl > nh) {
+          liftLine(low + nh, high + nh - 1, high + nh - 1, 1, step);
+        }
+      }
+    }
+  }
+
+
+  /// Forward horizontal lifting of rows of 'src', each deinterleaved into
+  /// matching rows of low and high band views.
+  template <typename T>
+  static void forwardHorizontalPass(const RowView<T> & src,
+                                    const RowView<T> & low,
+                                    const RowView<T> & high,
+                                    const int sizeX, const int sizeY,
+                                    const Step * const steps,
+                                    const int numSteps) {
+    const int nl = (sizeX + 1) / 2;
+    const int nh = sizeX / 2;
+
+    #pragma omp parallel for schedule(static)
+    for(int r = 0; r < sizeY; r++) {
+      const T * const in = src.row(r);
+      T * const l = low.row(r);
+      T * const h = high.row(r);
+      for(int k = 0; k < nh; k++) {
+        l[k] = in[2 * k];
+        h[k] = in[2 * k + 1];
+      }
+      if(nl > nh) {
+        l[nh] = in[2 * nh];
+      }
+      liftHorizontal(l, h, nl, nh, steps, numSteps);
+    }
+  }
+
+
+  /// Reverse horizontal lifting of rows of low and high band views (in
+  /// place), interleaved into matching rows of 'dest'.
+  template <typename T>
+  static void reverseHorizontalPass(const RowView<T> & low,
+                                    const RowView<T> & high,
+                                    const RowView<T> & dest,
+                                    const int sizeX, const int sizeY,
+                                    const Step * const steps,
+                                    const int numSteps) {
+    const int nl = (sizeX + 1) / 2;
+    const int nh = sizeX / 2;
+
+    #pragma omp parallel for schedule(static)
+    for(int r = 0; r < sizeY; r++) {
+      T * const l = low.row(r);
+      T * const h = high.row(r);
+      T * const out = dest.row(r);
+      liftHorizontal(l, h, nl, nh, steps, numSteps);
+      for(int k = 0; k < nh; k++) {
+        out[2 * k] = l[k];
+        out[2 * k + 1] = h[k];
+      }
+      if(nl > nh) {
+        out[2 * nh] = l[nh];
+      }
+    }
+  }
+
+
+  /// Views of low and high bands of one level stored in 'out'.
+  template <typename T>
+  static void bandViews(T * const out, const int sizeX, const int sizeY,
+                        RowView<T> & low, RowView<T> & high) {
+    const int nlx = (sizeX + 1) / 2;
+    const int nhx = sizeX / 2;
+    const int nly = (sizeY + 1) / 2;
+    T * const ll = out;
+    T * const hl = ll + nlx * nly;
+    T * const lh = out + sizeX * nly;
+    T * const hh = lh + nlx * (sizeY - nly);
+    low = rowView(ll, lh, nlx);
+    high = rowView(hl, hh, nhx);
+  }
+
+
+  /// Copies LL band (sizeX x sizeY samples) between buffers.
+  template <typename T>
+  static void copyLL(T * const dest, const T * const src, const int sizeX,
+                     const int sizeY) {
+    memcpy(dest, src, sizeof(T) * sizeX * sizeY);
+  }
+
+
+  /// One level of forward DWT with vertical lifting first (5/3).
+  template <typename T>
+  static void forwardVH(T * const in, T * const out, const int sizeX,
+                        const int sizeY, const Step * const steps,
+                        const int numSteps) {
+    RowView<T> low, high;
+    bandViews(out, sizeX, sizeY, low, high);
+    const RowView<T> image = rowView(in, in + sizeX, 2 * sizeX);
+    verticalPass(image, sizeX, sizeY, steps, numSteps);
+    forwardHorizontalPass(image, low, high, sizeX, sizeY, steps, numSteps);
+  }
+
+
+  /// One level of forward DWT with horizontal lifting first (9/7).
+  template <typename T>
+  static void forwardHV(T * const in, T * const out, const int sizeX,
+                        const int sizeY, const Step * const steps,
+                        const int numSteps) {
+    RowView<T> low, high;
+    bandViews(out, sizeX, sizeY, low, high);
+    const RowView<T> image = rowView(in, in + sizeX, 2 * sizeX);
+    forwardHorizontalPass(image, low, high, sizeX, sizeY, steps, numSteps);
+    verticalPass(low, (sizeX + 1) / 2, sizeY, steps, numSteps);
+    verticalPass(high, sizeX / 2, sizeY, steps, numSteps);
+  }
+
+
+  /// One level of reverse DWT (horizontal lifting first).
+  template <typename T>
+  static void reverseHV(T * const in, T * const out, const int sizeX,
+                        const int sizeY, const Step * const steps,
+                        const int numSteps) {
+    RowView<T> low, high;
+    bandViews(in, sizeX, sizeY, low, high);
+    const RowView<T> image = rowView(out, out + sizeX, 2 * sizeX);
+    reverseHorizontalPass(low, high, image, sizeX, sizeY, steps, numSteps);
+    verticalPass(image, sizeX, sizeY, steps, numSteps);
+  }
+
+
+  void fdwt53(int * in, int * out, int sizeX, int sizeY, int levels) {
+    forwardVH(in, out, sizeX, sizeY, forward53, FORWARD53_STEPS);
+
+    // if this was not the last level, continue recursively with other levels
+    if(levels > 1) {
+      // copy output's LL band back into input buffer
+      const int llSizeX = (sizeX + 1) / 2;
+      const int llSizeY = (sizeY + 1) / 2;
+      copyLL(in, out, llSizeX, llSizeY);
+
+      // run remaining levels of FDWT
+      fdwt53(in, out, llSizeX, llSizeY, levels - 1);
+    }
+  }
+
+
+  void rdwt53(int * in, int * out, int sizeX, int sizeY, int levels) {
+    if(levels > 1) {
+      // reverse transform deeper levels first
+      const int llSizeX = (sizeX + 1) / 2;
+      const int llSizeY = (sizeY + 1) / 2;
+      rdwt53(in, out, llSizeX, llSizeY, levels - 1);
+
+      // copy reverse transformed LL band from output back into the input
+      copyLL(in, out, llSizeX, llSizeY);
+    }
+    reverseHV(in, out, sizeX, sizeY, reverse53, REVERSE53_STEPS);
+  }
+
+
+  void fdwt97(float * in, float * out, int sizeX, int sizeY, int levels) {
+    forwardHV(in, out, sizeX, sizeY, forward97, FORWARD97_STEPS);
+
+    // if this was not the last level, continue recursively with other levels
+    if(levels > 1) {
+      // copy output's LL band back into input buffer
+      const int llSizeX = (sizeX + 1) / 2;
+      const int llSizeY = (sizeY + 1) / 2;
+      copyLL(in, out, llSizeX, llSizeY);
+
+      // run remaining levels of FDWT
+      fdwt97(in, out, llSizeX, llSizeY, levels - 1);
+    }
+  }
+
+
+  void rdwt97(float * in, float * out, int sizeX, int sizeY, int levels) {
+    if(levels > 1) {
+      // reverse transform deeper levels first
+      const int llSizeX = (sizeX + 1) / 2;
+      const int llSizeY = (sizeY + 1) / 2;
+      rdwt97(in, out, llSizeX, llSizeY, levels - 1);
+
+      // copy reverse transformed LL band from output back into the input
+      copyLL(in, out, llSizeX, llSizeY);
+    }
+    reverseHV(in, out, sizeX, sizeY, reverse97, REVERSE97_STEPS);
+  }
+
+
+} // namespace dwt_cpu
@@ -0,0 +1,76 @@
+///
+/// @file    dwt.h
+/// @brief   Entry points for the CPU (OpenMP) implementation of 9/7 and 5/3
+///          DWT, a host memory counterpart of dwt_cuda/dwt.h.
+///
+///
+/// Buffers are in host memory, everything else follows the common rules of
+/// dwt_cuda/dwt.h: no padding of lines, bands stored one after another with
+/// the deepest level first (LL, HL, LH, HH), inputs overwritten, input and
+/// output not overlapping.
+///
+/// Results follow the order of operations of the CUDA kernels, so that the
+/// integer 5/3 transforms are bit-exact with them:
+/// - forward 5/3: vertical lifting, then horizontal lifting
+/// - forward 9/7: horizontal lifting and scaling, then vertical
+/// - reverse 5/3 and 9/7: horizontal, then vertical
+/// Image edges are extended by whole-sample symmetric mirroring, lines of a
+/// single sample are left as they are.
+///
+/// Vertical lifting runs over stripes of columns, a few rows behind each
+/// other for the successive lifting steps (the CUDA sliding window), so each
+/// stripe is read and written once with all steps vectorized across it.
+/// Horizontal lifting runs a line at a time on its deinterleaved halves, in
+/// place in the band rows. Stripes and lines are spread over OpenMP threads.
+///
+
+#ifndef DWT_CPU_H
+#define	DWT_CPU_H
+
+
+namespace dwt_cpu {
+
+
+  /// Forward 5/3 2D DWT. See common rules (above) for more details.
+  /// @param in      Expected to be normalized into range [-128, 127].
+  ///                Will not be preserved (will be overwritten).
+  /// @param out     output buffer
+  /// @param sizeX   width of input image (in pixels)
+  /// @param sizeY   height of input image (in pixels)
+  /// @param levels  number of recursive DWT levels
+  void fdwt53(int * in, int * out, int sizeX, int sizeY, int levels);
+
+
+  /// Reverse 5/3 2D DWT. See common rules (above) for more details.
+  /// @param in      Input DWT coefficients. Will be overwritten.
+  /// @param out     output buffer - will contain original image
+  /// @param sizeX   width of input image (in pixels)
+  /// @param sizeY   height of input image (in pixels)
+  /// @param levels  number of recursive DWT levels
+  void rdwt53(int * in, int * out, int sizeX, int sizeY, int levels);
+
+
+  /// Forward 9/7 2D DWT. See common rules (above) for more details.
+  /// @param in      Should be normalized (in range [-0.5, 0.5]).
+  ///                Will not be preserved (will be overwritten).
+  /// @param out     output buffer
+  /// @param sizeX   width of input image (in pixels)
+  /// @param sizeY   height of input image (in pixels)
+  /// @param levels  number of recursive DWT levels
+  void fdwt97(float * in, float * out, int sizeX, int sizeY, int levels);
+
+
+  /// Reverse 9/7 2D DWT. See common rules (above) for more details.
+  /// @param in      Input DWT coefficients. Will be overwritten.
+  /// @param out     output buffer - will contain original image
+  /// @param sizeX   width of input image (in pixels)
+  /// @param sizeY   height of input image (in pixels)
+  /// @param levels  number of recursive DWT levels
+  void rdwt97(float * in, float * out, int sizeX, int sizeY, int levels);
+
+
+} // namespace dwt_cpu
+
+
+
+#endif	// DWT_CPU_H
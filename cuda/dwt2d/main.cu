@@ -47,6 +47,8 @@ struct dwt {
     int pixHeight;
     int components;
     int dwtLvls;
+    int cpu;     //run on the CPU (OpenMP) instead of the GPU
+    int verify;  //check the result against the CPU transform
 };
 
 int getImg(char * srcFilename, unsigned char *srcImg, int inputSize)
@@ -90,12 +92,126 @@ void usage() {
   -r, --reverse\t\t\treverse transform\n\
   -9, --97\t\t\t9/7 transform\n\
   -5, --53\t\t\t5/3 transform\n\
-  -w  --write-visual\t\twrite output in visual (tiled) fashion instead of the linear\n");
+  -w  --write-visual\t\twrite output in visual (tiled) fashion instead of the linear\n\
+  -C, --cpu\t\t\trun the transform on the CPU (OpenMP) instead of the GPU\n\
+  -v, --verify\t\t\tcheck the result: a CPU round trip with -C, else the CPU transform\n");
 }
 
+/* DWT of all components on the CPU, from and to host memory */
+template <typename T>
+void processDWTCPU(struct dwt *d, int forward, int writeVisual)
+{
+    int samplesNum = d->pixWidth*d->pixHeight;
+    int componentSize = samplesNum*sizeof(T);
+    int comps = (d->components == 3) ? 3 : 1;
+    T *c[3], *c_out[3], *backup;
+    int k, bad = 0;
+
+    if (d->components != 3 && d->components != 1)
+        return;
+
+    backup = (T *)malloc(componentSize);
+    for (k = 0; k < comps; k++) {
+        c[k] = (T *)malloc(componentSize);
+        c_out[k] = (T *)malloc(componentSize);
+        memset(c_out[k], 0, componentSize);
+    }
+
+    /* Load components */
+    if (comps == 3)
+        rgbToComponentsCPU(c[0], c[1], c[2], d->srcImg, d->pixWidth, d->pixHeight);
+    else
+        bwToComponentCPU(c[0], d->srcImg, d->pixWidth, d->pixHeight);
+
+    /* Compute DWT */
+    for (k = 0; k < comps; k++)
+        nStage2dDWTCPU(c[k], c_out[k], backup, d->pixWidth, d->pixHeight, d->dwtLvls, forward);
+
+    /* Transform back and compare with reloaded components */
+    if (d->verify) {
+        if (comps == 3)
+            rgbToComponentsCPU(c[0], c[1], c[2], d->srcImg, d->pixWidth, d->pixHeight);
+        else
+            bwToComponentCPU(c[0], d->srcImg, d->pixWidth, d->pixHeight);
+        for (k = 0; k < comps; k++)
+            bad += roundTripDWTCPU(c_out[k], c[k], d->pixWidth, d->pixHeight, d->dwtLvls, forward);
+        printf("\nVerification %s\n", bad ? "FAILED" : "PASSED");
+    }
+
+    /* Store DWT to file */
+    if (comps == 3) {
+#ifdef OUTPUT
+        if (writeVisual) {
+            writeNStage2DDWTCPU(c_out[0], d->pixWidth, d->pixHeight, d->dwtLvls, d->outFilename, ".r");
+            writeNStage2DDWTCPU(c_out[1], d->pixWidth, d->pixHeight, d->dwtLvls, d->outFilename, ".g");
+            writeNStage2DDWTCPU(c_out[2], d->pixWidth, d->pixHeight, d->dwtLvls, d->outFilename, ".b");
+        } else {
+            writeLinearCPU(c_out[0], d->pixWidth, d->pixHeight, d->outFilename, ".r");
+            writeLinearCPU(c_out[1], d->pixWidth, d->pixHeight, d->outFilename, ".g");
+            writeLinearCPU(c_out[2], d->pixWidth, d->pixHeight, d->outFilename, ".b");
+        }
+#endif
+    } else {
+        if (writeVisual) {
+            writeNStage2DDWTCPU(c_out[0], d->pixWidth, d->pixHeight, d->dwtLvls, d->outFilename, ".out");
+        } else {
+            writeLinearCPU(c_out[0], d->pixWidth, d->pixHeight, d->outFilename, ".lin.out");
+        }
+    }
+
+    for (k = 0; k < comps; k++) {
+        free(c[k]);
+        free(c_out[k]);
+    }
+    free(backup);
+}
+
+#ifndef DWT_CPU_ONLY
+/* Compare DWT of components on the GPU with the CPU transform of the same
+   components */
+template <typename T>
+void verifyDWT(struct dwt *d, T **c_out, int comps, int forward)
+{
+    int samplesNum = d->pixWidth*d->pixHeight;
+    int componentSize = samplesNum*sizeof(T);
+    T *c[3], *ref, *gpu, *backup;
+    int k, bad = 0;
+
+    for (k = 0; k < comps; k++)
+        c[k] = (T *)malloc(componentSize);
+    ref = (T *)malloc(componentSize);
+    gpu = (T *)malloc(componentSize);
+    backup = (T *)malloc(componentSize);
+
+    if (comps == 3)
+        rgbToComponentsCPU(c[0], c[1], c[2], d->srcImg, d->pixWidth, d->pixHeight);
+    else
+        bwToComponentCPU(c[0], d->srcImg, d->pixWidth, d->pixHeight);
+
+    for (k = 0; k < comps; k++) {
+        nStage2dDWTCPU(c[k], ref, backup, d->pixWidth, d->pixHeight, d->dwtLvls, forward);
+        cudaMemcpy(gpu, c_out[k], componentSize, cudaMemcpyDeviceToHost);
+        cudaCheckError("Memcopy device to host");
+        bad += compareDWT(gpu, ref, samplesNum, "GPU : CPU");
+    }
+    printf("\nVerification %s\n", bad ? "FAILED" : "PASSED");
+
+    for (k = 0; k < comps; k++)
+        free(c[k]);
+    free(ref);
+    free(gpu);
+    free(backup);
+}
+#endif
+
 template <typename T>
 void processDWT(struct dwt *d, int forward, int writeVisual)
 {
+    if (d->cpu) {
+        processDWTCPU<T>(d, forward, writeVisual);
+        return;
+    }
+#ifndef DWT_CPU_ONLY
     int componentSize = d->pixWidth*d->pixHeight*sizeof(T);
     
     T *c_r_out, *backup ;
@@ -147,6 +263,11 @@ void processDWT(struct dwt *d, int forward, int writeVisual)
         nStage2dDWT(c_r, c_r_out, backup, d->pixWidth, d->pixHeight, d->dwtLvls, forward);
         nStage2dDWT(c_g, c_g_out, backup, d->pixWidth, d->pixHeight, d->dwtLvls, forward);
         nStage2dDWT(c_b, c_b_out, backup, d->pixWidth, d->pixHeight, d->dwtLvls, forward);
+
+        if (d->verify) {
+            T *c_out[3] = {c_r_out, c_g_out, c_b_out};
+            verifyDWT(d, c_out, 3, forward);
+        }
      
         // -------test----------
         // T *h_r_out=(T*)malloc(componentSize);
@@ -198,6 +319,9 @@ void processDWT(struct dwt *d, int forward, int writeVisual)
         // Compute DWT 
         nStage2dDWT(c_r, c_r_out, backup, d->pixWidth, d->pixHeight, d->dwtLvls, forward);
 
+        if (d->verify)
+            verifyDWT(d, &c_r_out, 1, forward);
+
         // Store DWT to file 
 // #ifdef OUTPUT        
         if (writeVisual) {
@@ -214,6 +338,7 @@ void processDWT(struct dwt *d, int forward, int writeVisual)
     cudaCheckError("Cuda free device");
     cudaFree(backup);
     cudaCheckError("Cuda free device");
+#endif
 }
 
 int main(int argc, char **argv) 
@@ -231,6 +356,8 @@ int main(int argc, char **argv)
         {"97",          no_argument,       0, '9'}, //9/7 transform
         {"53",          no_argument,       0, '5' }, //5/3transform
         {"write-visual",no_argument,       0, 'w' }, //write output (subbands) in visual (tiled) order instead of linear
+        {"cpu",         no_argument,       0, 'C' }, //run on the CPU (OpenMP)
+        {"verify",      no_argument,       0, 'v' }, //check the result
         {"help",        no_argument,       0, 'h'}  
     };
     
@@ -239,13 +366,21 @@ int main(int argc, char **argv)
     int compCount   = 3; //number of components; 3 for RGB or YUV, 4 for RGBA
     int bitDepth    = 8; 
     int dwtLvls     = 3; //default numuber of DWT levels
+#ifndef DWT_CPU_ONLY
     int device      = 0;
+#endif
     int forward     = 1; //forward transform
     int dwt97       = 1; //1=dwt9/7, 0=dwt5/3 transform
     int writeVisual = 0; //write output (subbands) in visual (tiled) order instead of linear
+#ifdef DWT_CPU_ONLY
+    int cpu         = 1; //no GPU in this build
+#else
+    int cpu         = 0; //1=CPU (OpenMP), 0=GPU transform
+#endif
+    int verify      = 0; //check the result
     char * pos;
 
-    while ((ch = getopt_long(argc, argv, "d:c:b:l:D:fr95wh", longopts, &optindex)) != -1) {
+    while ((ch = getopt_long(argc, argv, "d:c:b:l:D:fr95wCvh", longopts, &optindex)) != -1) {
         switch (ch) {
         case 'd':
             pixWidth = atoi(optarg);
@@ -265,8 +400,10 @@ int main(int argc, char **argv)
         case 'l':
             dwtLvls = atoi(optarg);
             break;
-        case 'D':
+        case 'D': //ignored in the CPU only build
+#ifndef DWT_CPU_ONLY
             device = atoi(optarg);
+#endif
             break;
         case 'f':
             forward = 1;
@@ -283,6 +420,12 @@ int main(int argc, char **argv)
         case 'w':
             writeVisual = 1;
             break;
+        case 'C':
+            cpu = 1;
+            break;
+        case 'v':
+            verify = 1;
+            break;
         case 'h':
             usage();
             return 0;
@@ -312,29 +455,33 @@ int main(int argc, char **argv)
         writeVisual = 0; //do not write visual when RDWT
     }
 
+#ifndef DWT_CPU_ONLY
     // device init
-    int devCount;
-    cudaGetDeviceCount(&devCount);
-    cudaCheckError("Get device count");
-    if (devCount == 0) {
-        printf("No CUDA enabled device\n");
-        return -1;
-    } 
-    if (device < 0 || device > devCount -1) {
-        printf("Selected device %d is out of bound. Devices on your system are in range %d - %d\n", 
-               device, 0, devCount -1);
-        return -1;
+    if (!cpu) {
+        int devCount;
+        cudaGetDeviceCount(&devCount);
+        cudaCheckError("Get device count");
+        if (devCount == 0) {
+            printf("No CUDA enabled device\n");
+            return -1;
+        } 
+        if (device < 0 || device > devCount -1) {
+            printf("Selected device %d is out of bound. Devices on your system are in range %d - %d\n", 
+                   device, 0, devCount -1);
+            return -1;
+        }
+        cudaDeviceProp devProp;                                          
+        cudaGetDeviceProperties(&devProp, device);  
+        cudaCheckError("Get device properties");
+        if (devProp.major < 1) {                                         
+            printf("Device %d does not support CUDA\n", device);
+            return -1;
+        }                                                                   
+        printf("Using device %d: %s\n", device, devProp.name);
+        cudaSetDevice(device);
+        cudaCheckError("Set selected device");
     }
-    cudaDeviceProp devProp;                                          
-    cudaGetDeviceProperties(&devProp, device);  
-    cudaCheckError("Get device properties");
-    if (devProp.major < 1) {                                         
-        printf("Device %d does not support CUDA\n", device);
-        return -1;
-    }                                                                   
-    printf("Using device %d: %s\n", device, devProp.name);
-    cudaSetDevice(device);
-    cudaCheckError("Set selected device");
+#endif
 
     struct dwt *d;
     d = (struct dwt *)malloc(sizeof(struct dwt));
@@ -343,12 +490,14 @@ int main(int argc, char **argv)
     d->pixHeight = pixHeight;
     d->components = compCount;
     d->dwtLvls  = dwtLvls;
+    d->cpu      = cpu;
+    d->verify   = verify;
 
     // file names
-    d->srcFilename = (char *)malloc(strlen(argv[0]));
+    d->srcFilename = (char *)malloc(strlen(argv[0])+1);
     strcpy(d->srcFilename, argv[0]);
     if (argc == 1) { // only one filename supplyed
-        d->outFilename = (char *)malloc(strlen(d->srcFilename)+4);
+        d->outFilename = (char *)malloc(strlen(d->srcFilename)+5);
         strcpy(d->outFilename, d->srcFilename);
         strcpy(d->outFilename+strlen(d->srcFilename), ".dwt");
     } else {
@@ -363,13 +512,19 @@ int main(int argc, char **argv)
     printf(" DWT levels:\t\t%d\n", dwtLvls);
     printf(" Forward transform:\t%d\n", forward);
     printf(" 9/7 transform:\t\t%d\n", dwt97);
+    printf(" CPU transform:\t\t%d\n", cpu);
     
     //data sizes
     int inputSize = pixWidth*pixHeight*compCount; //<amount of data (in bytes) to proccess
 
     //load img source image
-    cudaMallocHost((void **)&d->srcImg, inputSize);
-    cudaCheckError("Alloc host memory");
+#ifndef DWT_CPU_ONLY
+    if (!cpu) {
+        cudaMallocHost((void **)&d->srcImg, inputSize);
+        cudaCheckError("Alloc host memory");
+    } else
+#endif
+    d->srcImg = (unsigned char *)malloc(inputSize);
     if (getImg(d->srcFilename, d->srcImg, inputSize) == -1) 
         return -1;
 
@@ -391,8 +546,13 @@ int main(int argc, char **argv)
     //writeComponent(g_wave_cuda, 512000, ".g");
     //writeComponent(g_cuda, componentSize, ".g");
     //writeComponent(b_wave_cuda, componentSize, ".b");
-    cudaFreeHost(d->srcImg);
-    cudaCheckError("Cuda free host");
+#ifndef DWT_CPU_ONLY
+    if (!cpu) {
+        cudaFreeHost(d->srcImg);
+        cudaCheckError("Cuda free host");
+    } else
+#endif
+    free(d->srcImg);
 
     return 0;
 }
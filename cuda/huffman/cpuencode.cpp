@@ -100,3 +100,165 @@ void cpu_vlc_encode(unsigned int* indata, unsigned int num_elements,
   *outsize = totalBytes;
 }
 #endif
+
+//////////////////////////////////////////////////////////////////////
+/// OPENMP CODER
+/// The input is cut into chunks of OMP_CHUNK_WORDS words. A first pass sums the codeword lengths of
+/// every chunk, an exclusive scan of the sums gives the bit offset of every chunk, and a second pass
+/// packs every chunk at its offset through a 64-bit accumulator, emitting 32-bit words MSB first as
+/// the serial coder does. The words a chunk shares with its neighbours are kept aside by the chunk
+/// and OR-ed into the stream at the end, so the packing needs no synchronization.
+/// Output is byte-identical to cpu_vlc_encode for codewords of up to 32 bits.
+///////////////////////////////////////////////////////////////////////
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifndef OMP_CHUNK_WORDS
+#define OMP_CHUNK_WORDS (1<<16)		// input words per chunk
+#endif
+
+typedef struct {
+	unsigned long long start;		// first bit of the chunk in the stream
+	unsigned long long bits;
+	unsigned long long head_word;	// word shared with the previous chunk
+	unsigned long long tail_word;	// word shared with the next chunk
+	unsigned int head, tail;
+	int has_head, has_tail;
+} vlc_chunk;
+
+// 4 sub-histograms per thread, so that runs of one symbol do not serialize on one counter
+extern "C"
+void cpu_histogram(const unsigned char* data, unsigned long long size, unsigned int* freq) {
+	memset(freq, 0, NUM_SYMBOLS*sizeof(unsigned int));
+
+	#pragma omp parallel
+	{
+		unsigned int local[4][NUM_SYMBOLS];
+		long long nquads = size/4;
+		memset(local, 0, sizeof(local));
+
+		#pragma omp for schedule(static) nowait
+		for (long long i=0; i<nquads; i++) {
+			local[0][data[4*i]]++;
+			local[1][data[4*i+1]]++;
+			local[2][data[4*i+2]]++;
+			local[3][data[4*i+3]]++;
+		}
+		#pragma omp single nowait
+		for (unsigned long long i=nquads*4; i<size; i++) local[0][data[i]]++;
+
+		#pragma omp critical
+		for (int s=0; s<NUM_SYMBOLS; s++) freq[s] += local[0][s] + local[1][s] + local[2][s] + local[3][s];
+	}
+}
+
+extern "C"
+void cpu_vlc_encode_omp(unsigned int* indata, unsigned int num_elements, 
+					unsigned int* outdata, unsigned int *outsize, 
+					unsigned int *codewords, unsigned int* codewordlens) {
+	unsigned long long cw64[NUM_SYMBOLS];		// codewords cut to their length
+	unsigned char len8[NUM_SYMBOLS];
+	unsigned int nchunks = (num_elements + OMP_CHUNK_WORDS - 1)/OMP_CHUNK_WORDS;
+	unsigned long long total = 0;
+
+	for (unsigned int s=0; s<NUM_SYMBOLS; s++) {
+		len8[s] = (unsigned char)codewordlens[s];
+		cw64[s] = codewords[s] & ((1ULL<<codewordlens[s]) - 1);
+	}
+
+	*outdata = 0x00000000U;
+	if (nchunks == 0) { *outsize = 0; return; }
+	vlc_chunk *chunks = (vlc_chunk*) calloc(nchunks, sizeof(vlc_chunk));
+
+	// codeword and length of every pair of symbols (the upper or lower half of an input word),
+	// so that a word is appended in two steps instead of four
+	unsigned long long *pair_cw = (unsigned long long*) malloc(NUM_SYMBOLS*NUM_SYMBOLS*sizeof(unsigned long long));
+	unsigned char *pair_len = (unsigned char*) malloc(NUM_SYMBOLS*NUM_SYMBOLS);
+	#pragma omp parallel for schedule(static)
+	for (unsigned int p=0; p<NUM_SYMBOLS*NUM_SYMBOLS; p++) {
+		unsigned int s0 = p>>8, s1 = p&0xFF;
+		pair_cw[p] = (cw64[s0]<<len8[s1]) | cw64[s1];
+		pair_len[p] = len8[s0] + len8[s1];
+	}
+
+	// bits of every chunk
+	#pragma omp parallel for schedule(static)
+	for (unsigned int c=0; c<nchunks; c++) {
+		unsigned int k0 = c*OMP_CHUNK_WORDS;
+		unsigned int k1 = min(k0 + OMP_CHUNK_WORDS, num_elements);
+		unsigned long long bits = 0;
+		for (unsigned int k=k0; k<k1; k++) {
+			unsigned int val32 = indata[k];
+			bits += pair_len[val32>>16] + pair_len[val32&0xFFFF];
+		}
+		chunks[c].bits = bits;
+	}
+
+	// bit offset of every chunk
+	for (unsigned int c=0; c<nchunks; c++) {
+		chunks[c].start = total;
+		total += chunks[c].bits;
+	}
+
+	// pack every chunk at its offset
+	#pragma omp parallel for schedule(static)
+	for (unsigned int c=0; c<nchunks; c++) {
+		vlc_chunk *ch = &chunks[c];
+		unsigned int k0 = c*OMP_CHUNK_WORDS;
+		unsigned int k1 = min(k0 + OMP_CHUNK_WORDS, num_elements);
+		unsigned long long acc = 0;						// the low nacc bits are pending, MSB first
+		unsigned int nacc = ch->start % 32;				// bits of the previous chunk in the first word, left as 0
+		unsigned long long w = ch->start / 32;
+		unsigned long long first = (nacc != 0) ? w : ~0ULL;
+
+		for (unsigned int k=k0; k<k1; k++) {
+			unsigned int val32 = indata[k];
+			for (unsigned int i=0; i<2; i++) {
+				unsigned int pair = (i == 0) ? val32>>16 : val32&0xFFFF;
+				unsigned int len = pair_len[pair];
+				if (len <= 32) {							// nacc stays below 64
+					acc = (acc<<len) | pair_cw[pair];
+					nacc += len;
+				}
+				else {										// codewords longer than 16 bits on average, one at a time
+					acc = (acc<<len8[pair>>8]) | cw64[pair>>8];
+					nacc += len8[pair>>8];
+					if (nacc >= 32) {
+						nacc -= 32;
+						unsigned int word = (unsigned int)(acc>>nacc);
+						if (w == first) { ch->head_word = w; ch->head = word; ch->has_head = 1; }
+						else outdata[w] = word;
+						w++;
+					}
+					acc = (acc<<len8[pair&0xFF]) | cw64[pair&0xFF];
+					nacc += len8[pair&0xFF];
+				}
+				if (nacc >= 32) {
+					nacc -= 32;
+					unsigned int word = (unsigned int)(acc>>nacc);
+					if (w == first) { ch->head_word = w; ch->head = word; ch->has_head = 1; }
+					else outdata[w] = word;
+					w++;
+				}
+			}
+		}
+		if (nacc > 0) { ch->tail_word = w; ch->tail = (unsigned int)(acc<<(32-nacc)); ch->has_tail = 1; }
+	}
+
+	// words shared between chunks
+	for (unsigned int c=0; c<nchunks; c++) {
+		if (chunks[c].has_head) outdata[chunks[c].head_word] = 0;
+		if (chunks[c].has_tail) outdata[chunks[c].tail_word] = 0;
+	}
+	for (unsigned int c=0; c<nchunks; c++) {
+		if (chunks[c].has_head) outdata[chunks[c].head_word] |= chunks[c].head;
+		if (chunks[c].has_tail) outdata[chunks[c].tail_word] |= chunks[c].tail;
+	}
+	free(chunks);
+	free(pair_cw);
+	free(pair_len);
+
+	*outsize = (unsigned int)((total/32)*4 + ((total%32) + 7)/8); //return aligned to 8-bits
+}
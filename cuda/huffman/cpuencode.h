@@ -5,6 +5,16 @@ extern "C"
 void cpu_vlc_encode(unsigned int* indata, unsigned int num_elements, 
 					unsigned int* outdata, unsigned int *outsize, 
 					unsigned int *codewords, unsigned int* codewordlens);  
+
+// OpenMP version of cpu_vlc_encode, same output
+extern "C"
+void cpu_vlc_encode_omp(unsigned int* indata, unsigned int num_elements, 
+					unsigned int* outdata, unsigned int *outsize, 
+					unsigned int *codewords, unsigned int* codewordlens);  
+
+// byte histogram of data into freq[NUM_SYMBOLS]
+extern "C"
+void cpu_histogram(const unsigned char* data, unsigned long long size, unsigned int* freq);
 #endif
 
 
@@ -5,6 +5,7 @@
 #include <iterator>
 #include <algorithm>
 #include <math.h>
+#include <string.h>
 #include "stdio.h"
 
 using namespace std;
@@ -94,3 +95,28 @@ void GenerateCodes(const INode* node, const HuffCode& prefix, HuffCodeMap& outCo
 }
 
 
+
+// Codeword (right aligned) and length of every symbol of the tree built from frequencies.
+// Symbols that do not occur get length 0.
+void GenerateCodeTable(unsigned int (&frequencies)[UniqueSymbols], unsigned int *codewords, unsigned int *codewordlens)
+{
+    memset(codewords, 0, UniqueSymbols*sizeof(unsigned int));
+    memset(codewordlens, 0, UniqueSymbols*sizeof(unsigned int));
+    if (count(frequencies, frequencies + UniqueSymbols, 0U) == UniqueSymbols)
+        return;                                     // no data, no tree
+
+    INode* root = BuildTree(frequencies);
+
+    HuffCodeMap codes;
+    GenerateCodes(root, HuffCode(), codes);
+    delete root;
+
+    for (HuffCodeMap::const_iterator it = codes.begin(); it != codes.end(); ++it)
+    {
+        unsigned int count = distance(it->second.begin(), it->second.end());
+        for (unsigned int i = 0; i < count; i++)
+            if (it->second[i])
+                codewords[(unsigned int)(it->first)] |= 1U << (count - i - 1);
+        codewordlens[(unsigned int)(it->first)] = count;
+    }
+}
@@ -31,20 +31,7 @@ inline void loadData(char *file_name, uint *sourceData, uint *codewords, uint *c
       {
         unsigned int freqs[UniqueSymbols] = {0};
         runHisto(file_name,freqs,mem_size,sourceData);
-        INode* root = BuildTree(freqs);
-
-        HuffCodeMap codes;
-        GenerateCodes(root, HuffCode(), codes);
-        delete root;
-
-        for (HuffCodeMap::const_iterator it = codes.begin(); it != codes.end(); ++it)
-          {
-            unsigned int count = distance(it->second.begin(),it->second.end());
-            for(int i = 0; i < count; i++)
-              if(it->second[i]) 
-                codewords[(unsigned int)(it->first)]+=(uint)pow(2.0f,(int)count - i - 1);
-            codewordlens[(unsigned int)(it->first)]=count;
-          }
+        GenerateCodeTable(freqs, codewords, codewordlens);
 
         H = 0.0;
         for (unsigned int i=0; i<256; i++)
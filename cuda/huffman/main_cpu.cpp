@@ -0,0 +1,127 @@
+/*
+ * PAVLE - CPU driver. Runs the serial encoder (cpu_vlc_encode) and the OpenMP encoder
+ * (cpu_vlc_encode_omp) on the same input and code table, checks that their outputs are
+ * identical and reports the throughput of both. Builds without CUDA.
+ *
+ * usage: pavle_omp [-t threads] [-r repetitions] [file ...]
+ *        without files, generated inputs of 1 MB to 256 MB are encoded
+ */
+
+#include "stdafx.h"
+#include <omp.h>
+#include <sys/time.h>
+#include "parameters.h"
+#include "huffTree.h"
+#include "cpuencode.h"
+
+static double wtime() {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec*1e-6;
+}
+
+// bytes with a skewed (1/(s+1)) symbol distribution, a stand-in for real data of about 6 bits entropy
+static void generate(unsigned char *data, unsigned long long size) {
+	unsigned int cdf[NUM_SYMBOLS];
+	double sum = 0, acc = 0;
+	for (int s=0; s<NUM_SYMBOLS; s++) sum += 1.0/(s+1);
+	for (int s=0; s<NUM_SYMBOLS; s++) { acc += 1.0/(s+1)/sum; cdf[s] = (unsigned int)(acc*4294967295.0); }
+	cdf[NUM_SYMBOLS-1] = 0xFFFFFFFFU;
+
+	#pragma omp parallel for schedule(static)
+	for (long long b=0; b<(long long)(size>>16)+1; b++) {
+		unsigned long long x = 0x9E3779B97F4A7C15ULL*(b+1);		// xorshift64 per 64 KB block
+		unsigned long long i1 = min((unsigned long long)(b+1)<<16, size);
+		for (unsigned long long i=(unsigned long long)b<<16; i<i1; i++) {
+			x ^= x<<13; x ^= x>>7; x ^= x<<17;
+			unsigned int r = (unsigned int)(x>>32);
+			int lo = 0, hi = NUM_SYMBOLS-1;
+			while (lo < hi) { int mid = (lo+hi)/2; if (cdf[mid] < r) lo = mid+1; else hi = mid; }
+			data[i] = (unsigned char)lo;
+		}
+	}
+}
+
+static void runTest(const char *name, unsigned char *data, unsigned long long mem_size, int reps) {
+	unsigned int num_elements = (unsigned int)(mem_size/4);
+	unsigned int freqs[UniqueSymbols];
+	unsigned int codewords[NUM_SYMBOLS], codewordlens[NUM_SYMBOLS];
+	unsigned int refbytesize = 0, ompbytesize = 0;
+	double t, t_hist = 1e30, t_ref = 1e30, t_omp = 1e30, H = 0.0;
+
+	// the serial coder may clear one word past the end of its output
+	unsigned int *crefData = (unsigned int*) calloc(num_elements + 2, sizeof(unsigned int));
+	unsigned int *ompData  = (unsigned int*) calloc(num_elements + 2, sizeof(unsigned int));
+
+	for (int r=0; r<reps; r++) {
+		t = wtime();
+		cpu_histogram(data, mem_size, freqs);
+		t = wtime() - t; t_hist = min(t, t_hist);
+	}
+	GenerateCodeTable(freqs, codewords, codewordlens);
+	for (unsigned int i=0; i<NUM_SYMBOLS; i++)
+		if (freqs[i] > 0) {
+			double p = (double)freqs[i] / (double)mem_size;
+			H -= p * log(p) / log(2.0);
+		}
+
+	for (int r=0; r<reps; r++) {
+		t = wtime();
+		cpu_vlc_encode((unsigned int*)data, num_elements, crefData, &refbytesize, codewords, codewordlens);
+		t = wtime() - t; t_ref = min(t, t_ref);
+
+		memset(ompData, 0xFF, (num_elements + 2)*sizeof(unsigned int));	// the parallel coder must not rely on a cleared buffer
+		t = wtime();
+		cpu_vlc_encode_omp((unsigned int*)data, num_elements, ompData, &ompbytesize, codewords, codewordlens);
+		t = wtime() - t; t_omp = min(t, t_omp);
+	}
+
+	unsigned int num_ints = refbytesize/4 + ((refbytesize%4 == 0) ? 0 : 1);
+	bool match = refbytesize == ompbytesize && memcmp(crefData, ompData, num_ints*sizeof(unsigned int)) == 0;
+
+	printf("%-24s %9.1f MB  H %5.3f  -> %9.1f MB | hist %6.2f GB/s | serial %6.3f s %6.2f GB/s | OpenMP %6.3f s %6.2f GB/s (%5.2fx) | %s\n",
+		name, mem_size/1e6, H, refbytesize/1e6, mem_size/t_hist/1e9,
+		t_ref, mem_size/t_ref/1e9, t_omp, mem_size/t_omp/1e9, t_ref/t_omp, match ? "PASS" : "FAIL");
+
+	free(crefData);
+	free(ompData);
+}
+
+int main(int argc, char* argv[]) {
+	int reps = 3;
+	int i = 1;
+
+	for (; i < argc && argv[i][0] == '-'; i += 2) {
+		if (i+1 >= argc) { fprintf(stderr, "usage: %s [-t threads] [-r repetitions] [file ...]\n", argv[0]); return 1; }
+		if (argv[i][1] == 't') omp_set_num_threads(atoi(argv[i+1]));
+		else if (argv[i][1] == 'r') reps = max(atoi(argv[i+1]), 1);
+	}
+	printf("%d threads, best of %d\n", omp_get_max_threads(), reps);
+
+	if (i < argc) {
+		for (; i < argc; i++) {
+			FILE *f = fopen(argv[i], "rb");
+			if (!f) { perror(argv[i]); return 1; }
+			fseek(f, 0, SEEK_END);
+			unsigned long long mem_size = ftell(f);
+			fseek(f, 0, SEEK_SET);
+			unsigned char *data = (unsigned char*) malloc(mem_size + 4);
+			if (fread(data, 1, mem_size, f) != mem_size) { fputs("Cannot read input file\n", stderr); return 1; }
+			fclose(f);
+			runTest(argv[i], data, mem_size, reps);
+			free(data);
+		}
+	}
+	else {
+		for (unsigned long long mb = 1; mb <= 256; mb *= 4) {
+			unsigned long long mem_size = mb << 20;
+			unsigned char *data = (unsigned char*) malloc(mem_size);
+			char name[32];
+			generate(data, mem_size);
+			snprintf(name, sizeof(name), "generated");
+			runTest(name, data, mem_size, reps);
+			free(data);
+		}
+	}
+	return 0;
+}
@@ -126,6 +126,18 @@ void runVLCTest(char *file_name, uint num_block_threads, uint num_blocks) {
     unsigned int num_ints = refbytesize/4 + ((refbytesize%4 ==0)?0:1);
     //////////////////* END CPU *///////////////////////////////////
 
+    //////////////////* CPU ENCODER (OpenMP) *///////////////////////////////////
+    uint	*ompData    =	(uint*) malloc(mem_size);
+    unsigned int ompbytesize;
+    timer = get_time();
+    cpu_vlc_encode_omp((unsigned int*)sourceData, num_elements, (unsigned int*)ompData, &ompbytesize, codewords, codewordlens);
+    msec = (float)((get_time() - timer)/1000.0);
+    printf("CPU Encoding time (OpenMP): %f (ms)\n", msec);
+    if (ompbytesize != refbytesize) printf("FAIL! OpenMP encoded to %d [B]\n", ompbytesize);
+    else compare_vectors((unsigned int*)crefData, (unsigned int*)ompData, num_ints);
+    free(ompData);
+    //////////////////* END CPU (OpenMP) *///////////////////////////////////
+
     //////////////////* SM64HUFF KERNEL *///////////////////////////////////
     grid_size.x		= num_blocks;
     block_size.x	= num_block_threads;
@@ -10,4 +10,10 @@ void bucketSort(float *d_input, float *d_output, int listsize,
 				int *sizes, int *nullElements, float minimum, float maximum,
 				unsigned int *origOffsets);  
 
+// pivot points dividing a histosize bin histogram of the list over [min, max]
+// into divisions of about equal size (pivotpoints.cpp); consumes the histogram
+void calcPivotPoints(float *histogram, int histosize, int listsize, 
+					 int divisions, float min, float max, float *pivotPoints, 
+					 float histo_width);
+
 #endif
\ No newline at end of file
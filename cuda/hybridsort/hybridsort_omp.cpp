@@ -0,0 +1,395 @@
+////////////////////////////////////////////////////////////////////////////////
+// OpenMP CPU build of the hybrid sort. The steps follow the CUDA version:
+//  - histogram1024:  1024 bin histogram of the list, one per thread
+//  - calcPivotPoints: DIVISIONS - 1 pivots splitting the list evenly
+//  - bucketcount:    per thread bucket counts of a static part of the list
+//  - bucketsort:     scatter into buckets padded to BUCKET_ALIGN floats
+//  - mergesort:      per bucket, a sorting network over float4s followed by
+//                    bitonic float4 merges, as mergeSortFirst/mergeSortPass
+// Buckets are sorted independently (dynamically scheduled over the threads)
+// and their sorted elements packed into the result, as mergepack does.
+////////////////////////////////////////////////////////////////////////////////
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include <algorithm>
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define OMPSORT_SSE
+#endif
+#include "bucketsort.cuh"
+#include "hybridsort_omp.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Defines
+////////////////////////////////////////////////////////////////////////////////
+#define BIN_COUNT		1024
+// bucket offsets and sizes are padded to this many floats (one cache line)
+#define BUCKET_ALIGN	16
+// slices of the bucket lookup table (see bucketOf)
+#define PIVOT_LUT		(4 * DIVISIONS)
+
+////////////////////////////////////////////////////////////////////////////////
+// Globals
+////////////////////////////////////////////////////////////////////////////////
+static int sortThreads = 0;
+static int maxListsize = -1;
+static float *buckets = NULL;				// the list scattered into buckets
+static float *scratch = NULL;				// per thread merge buffer
+static size_t scratchSize = 0;				// floats of scratch per thread
+static unsigned int *threadHisto = NULL;	// BIN_COUNT per thread
+static unsigned int *threadOffsets = NULL;	// DIVISIONS per thread
+static unsigned int *padOffsets = NULL;		// padded start of each bucket
+static unsigned int *origOffsets = NULL;	// start of each bucket in the result
+static float *pivotPoints = NULL;
+static float *historesult = NULL;
+static unsigned short *pivotLut = NULL;		// PIVOT_LUT + 1 first buckets
+
+static float *allocFloats(size_t n)
+{
+#ifdef OMPSORT_SSE
+	return (float *)_mm_malloc(n * sizeof(float), 64);
+#else
+	return (float *)malloc(n * sizeof(float));
+#endif
+}
+
+static void freeFloats(float *p)
+{
+#ifdef OMPSORT_SSE
+	_mm_free(p);
+#else
+	free(p);
+#endif
+}
+
+static inline unsigned int padded(unsigned int n)
+{
+	return (n + BUCKET_ALIGN - 1) & ~(BUCKET_ALIGN - 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Initialize the OpenMP sort
+////////////////////////////////////////////////////////////////////////////////
+void init_ompsort(int listsize)
+{
+	finish_ompsort();
+	sortThreads = omp_get_max_threads();
+	maxListsize = listsize;
+	buckets = allocFloats((size_t)listsize + DIVISIONS * BUCKET_ALIGN);
+	threadHisto = (unsigned int *)malloc(sortThreads * BIN_COUNT * sizeof(int));
+	threadOffsets = (unsigned int *)malloc(sortThreads * DIVISIONS * sizeof(int));
+	padOffsets = (unsigned int *)malloc((DIVISIONS + 1) * sizeof(int));
+	origOffsets = (unsigned int *)malloc((DIVISIONS + 1) * sizeof(int));
+	// calcPivotPoints can write one past the last division
+	pivotPoints = (float *)malloc((DIVISIONS + 1) * sizeof(float));
+	historesult = (float *)malloc(BIN_COUNT * sizeof(float));
+	pivotLut = (unsigned short *)malloc((PIVOT_LUT + 1) * sizeof(short));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Uninitialize the OpenMP sort
+////////////////////////////////////////////////////////////////////////////////
+void finish_ompsort()
+{
+	if(maxListsize < 0) return;
+	freeFloats(buckets);
+	if(scratch) freeFloats(scratch);
+	free(threadHisto);
+	free(threadOffsets);
+	free(padOffsets);
+	free(origOffsets);
+	free(pivotPoints);
+	free(historesult);
+	free(pivotLut);
+	scratch = NULL;
+	scratchSize = 0;
+	maxListsize = -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Bucket of an element: the number of pivots not above it, as found by the
+// binary search of bucketcount. On the CPU the ten dependent loads of that
+// search dominate the count and scatter passes, so the search starts from a
+// table giving, for each of PIVOT_LUT equal slices of [minimum, maximum], the
+// bucket of the slice's lower edge. Slices holding many pivots (skewed lists)
+// are searched by bisection; otherwise, as after rounding at slice edges, the
+// bucket is reached by stepping over the pivots.
+////////////////////////////////////////////////////////////////////////////////
+static inline int bucketOf(const float *pivots, const unsigned short *lut,
+						   float minimum, float lutScale, float elem)
+{
+	int slice = std::min(std::max((int)((elem - minimum) * lutScale), 0), PIVOT_LUT - 1);
+	int idx = lut[slice];
+	int last = lut[slice + 1];
+	if(last - idx > 8) idx = (int)(std::upper_bound(pivots + idx, pivots + last, elem) - pivots);
+	while(idx > 0 && elem < pivots[idx-1]) idx--;
+	while(idx < DIVISIONS - 1 && !(elem < pivots[idx])) idx++;
+	return idx;
+}
+
+#ifdef OMPSORT_SSE
+////////////////////////////////////////////////////////////////////////////////
+// float4 sorting networks. Every compare-exchange takes min(a, b) and
+// max(b, a) so that of two equal elements (-0 and 0) each one survives.
+////////////////////////////////////////////////////////////////////////////////
+static inline void cmpswap(__m128 &a, __m128 &b)
+{
+	__m128 lo = _mm_min_ps(a, b);
+	b = _mm_max_ps(b, a);
+	a = lo;
+}
+
+static inline __m128 reverse(__m128 a)
+{
+	return _mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 1, 2, 3));
+}
+
+// sorts the bitonic float4s l and h, each on its own
+static inline void bitonicSort2(__m128 &l, __m128 &h)
+{
+	__m128 t1 = _mm_movelh_ps(l, h);		// l0 l1 h0 h1
+	__m128 t2 = _mm_movehl_ps(h, l);		// l2 l3 h2 h3
+	cmpswap(t1, t2);
+	__m128 u = _mm_shuffle_ps(t1, t2, _MM_SHUFFLE(2, 0, 2, 0));
+	__m128 v = _mm_shuffle_ps(t1, t2, _MM_SHUFFLE(3, 1, 3, 1));
+	cmpswap(u, v);
+	__m128 lo = _mm_unpacklo_ps(u, v);
+	__m128 hi = _mm_unpackhi_ps(u, v);
+	l = _mm_movelh_ps(lo, hi);
+	h = _mm_movehl_ps(hi, lo);
+}
+
+// sorted float4s a and b become the lowest (a) and highest (b) four of
+// them, sorted: getLowest/getHighest and sortElem of mergeSortPass
+static inline void merge4(__m128 &a, __m128 &b)
+{
+	b = reverse(b);
+	cmpswap(a, b);
+	bitonicSort2(a, b);
+}
+
+// sorts the 16 floats in r0-r3: 4 columns of 4 by a sorting network,
+// transposed to 4 sorted float4s, merged to 8s, merged to 16
+static inline void sort16(__m128 &r0, __m128 &r1, __m128 &r2, __m128 &r3)
+{
+	cmpswap(r0, r1); cmpswap(r2, r3);
+	cmpswap(r0, r2); cmpswap(r1, r3);
+	cmpswap(r1, r2);
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	merge4(r0, r1);
+	merge4(r2, r3);
+
+	__m128 b0 = reverse(r3);
+	__m128 b1 = reverse(r2);
+	cmpswap(r0, b0);
+	cmpswap(r1, b1);
+	cmpswap(r0, r1);
+	bitonicSort2(r0, r1);
+	cmpswap(b0, b1);
+	bitonicSort2(b0, b1);
+	r2 = b0;
+	r3 = b1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Merges the sorted runs a (na float4s) and b (nb float4s) into out
+////////////////////////////////////////////////////////////////////////////////
+static void mergeRuns(const float *a, int na, const float *b, int nb, float *out)
+{
+	const float *aend = a + 4 * na;
+	const float *bend = b + 4 * nb;
+	__m128 lo = _mm_load_ps(a);
+	__m128 hi = _mm_load_ps(b);
+	a += 4;
+	b += 4;
+	while(a < aend && b < bend){
+		merge4(lo, hi);
+		_mm_store_ps(out, lo);
+		out += 4;
+		// continue with the run whose next float4 starts lower
+		bool takeA = *a <= *b;
+		lo = _mm_load_ps(takeA ? a : b);
+		a += takeA ? 4 : 0;
+		b += takeA ? 0 : 4;
+	}
+	for(; a < aend; a += 4){
+		merge4(lo, hi);
+		_mm_store_ps(out, lo);
+		out += 4;
+		lo = _mm_load_ps(a);
+	}
+	for(; b < bend; b += 4){
+		merge4(lo, hi);
+		_mm_store_ps(out, lo);
+		out += 4;
+		lo = _mm_load_ps(b);
+	}
+	merge4(lo, hi);
+	_mm_store_ps(out, lo);
+	_mm_store_ps(out + 4, hi);
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// Sorts the count elements of a bucket, padded to BUCKET_ALIGN with +inf,
+// using tmp (as large as the padded bucket); returns where they ended up
+////////////////////////////////////////////////////////////////////////////////
+static float *sortBucket(float *data, unsigned int count, float *tmp)
+{
+#ifdef OMPSORT_SSE
+	unsigned int size = padded(count);
+	for(unsigned int i = count; i < size; i++) data[i] = INFINITY;
+	int nv = size / 4;
+
+	for(int i = 0; i < nv; i += 4){
+		__m128 r0 = _mm_load_ps(data + 4*i);
+		__m128 r1 = _mm_load_ps(data + 4*i + 4);
+		__m128 r2 = _mm_load_ps(data + 4*i + 8);
+		__m128 r3 = _mm_load_ps(data + 4*i + 12);
+		sort16(r0, r1, r2, r3);
+		_mm_store_ps(tmp + 4*i, r0);
+		_mm_store_ps(tmp + 4*i + 4, r1);
+		_mm_store_ps(tmp + 4*i + 8, r2);
+		_mm_store_ps(tmp + 4*i + 12, r3);
+	}
+
+	float *src = tmp, *dst = data;
+	for(int width = 4; width < nv; width *= 2){
+		for(int start = 0; start < nv; start += 2 * width){
+			int na = std::min(width, nv - start);
+			int nb = std::min(width, nv - start - na);
+			if(nb == 0) memcpy(dst + 4*start, src + 4*start, 4 * na * sizeof(float));
+			else mergeRuns(src + 4*start, na, src + 4*(start + na), nb, dst + 4*start);
+		}
+		std::swap(src, dst);
+	}
+	return src;
+#else
+	std::sort(data, data + count);
+	return data;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The OpenMP sort
+////////////////////////////////////////////////////////////////////////////////
+void ompSort(float *origList, float minimum, float maximum,
+			 float *resultList, int numElements)
+{
+	if(numElements <= 0) return;
+	if(!(minimum < maximum)){
+		memcpy(resultList, origList, numElements * sizeof(float));
+		return;
+	}
+	if(numElements > maxListsize || omp_get_max_threads() != sortThreads)
+		init_ompsort(std::max(numElements, maxListsize));
+
+	const int n = numElements;
+	const int nthreads = sortThreads;
+	const float scale = BIN_COUNT / (maximum - minimum);
+	const float lutScale = PIVOT_LUT / (maximum - minimum);
+	unsigned int maxBucket = 0;
+
+	#pragma omp parallel num_threads(nthreads)
+	{
+		const int t = omp_get_thread_num();
+		// the same static part of the list for the count and the scatter
+		const int begin = (int)((long long)n * t / nthreads);
+		const int end = (int)((long long)n * (t + 1) / nthreads);
+
+		////////////////////////////////////////////////////////////////////////
+		// First pass - Create 1024 bin histogram
+		////////////////////////////////////////////////////////////////////////
+		unsigned int *histo = threadHisto + t * BIN_COUNT;
+		memset(histo, 0, BIN_COUNT * sizeof(int));
+		for(int i = begin; i < end; i++){
+			int bin = (int)((origList[i] - minimum) * scale);
+			histo[std::min(std::max(bin, 0), BIN_COUNT - 1)]++;
+		}
+		#pragma omp barrier
+
+		////////////////////////////////////////////////////////////////////////
+		// Calculate pivot points (CPU algorithm)
+		////////////////////////////////////////////////////////////////////////
+		#pragma omp single
+		{
+			for(int i = 0; i < BIN_COUNT; i++){
+				unsigned int sum = 0;
+				for(int s = 0; s < nthreads; s++) sum += threadHisto[s * BIN_COUNT + i];
+				historesult[i] = (float)sum;
+			}
+			calcPivotPoints(historesult, BIN_COUNT, n, DIVISIONS,
+					minimum, maximum, pivotPoints,
+					(maximum - minimum)/(float)BIN_COUNT);
+			// rounding may leave a pivot below its predecessor, which would
+			// break the binary search
+			for(int i = 1; i < DIVISIONS; i++)
+				pivotPoints[i] = std::max(pivotPoints[i], pivotPoints[i-1]);
+			for(int k = 0; k < PIVOT_LUT; k++){
+				float edge = minimum + k / lutScale;
+				pivotLut[k] = (unsigned short)(std::upper_bound(pivotPoints,
+						pivotPoints + DIVISIONS - 1, edge) - pivotPoints);
+			}
+			pivotLut[PIVOT_LUT] = DIVISIONS - 1;
+		}
+
+		////////////////////////////////////////////////////////////////////////
+		// Count the bucket sizes in new divisions
+		////////////////////////////////////////////////////////////////////////
+		unsigned int *offsets = threadOffsets + t * DIVISIONS;
+		memset(offsets, 0, DIVISIONS * sizeof(int));
+		for(int i = begin; i < end; i++)
+			offsets[bucketOf(pivotPoints, pivotLut, minimum, lutScale, origList[i])]++;
+		#pragma omp barrier
+
+		////////////////////////////////////////////////////////////////////////
+		// Prefix scan offsets, padding each division to BUCKET_ALIGN
+		////////////////////////////////////////////////////////////////////////
+		#pragma omp single
+		{
+			origOffsets[0] = 0;
+			padOffsets[0] = 0;
+			for(int i = 0; i < DIVISIONS; i++){
+				unsigned int at = padOffsets[i];
+				for(int s = 0; s < nthreads; s++){
+					unsigned int x = threadOffsets[s * DIVISIONS + i];
+					threadOffsets[s * DIVISIONS + i] = at;
+					at += x;
+				}
+				unsigned int size = at - padOffsets[i];
+				origOffsets[i+1] = origOffsets[i] + size;
+				padOffsets[i+1] = padOffsets[i] + padded(size);
+				maxBucket = std::max(maxBucket, padded(size));
+			}
+			if(maxBucket > scratchSize){
+				if(scratch) freeFloats(scratch);
+				scratchSize = maxBucket;
+				scratch = allocFloats(scratchSize * nthreads);
+			}
+		}
+
+		////////////////////////////////////////////////////////////////////////
+		// Scatter into the buckets
+		////////////////////////////////////////////////////////////////////////
+		for(int i = begin; i < end; i++){
+			float elem = origList[i];
+			buckets[offsets[bucketOf(pivotPoints, pivotLut, minimum, lutScale, elem)]++] = elem;
+		}
+		#pragma omp barrier
+
+		////////////////////////////////////////////////////////////////////////
+		// Sort each bucket and pack it into the result
+		////////////////////////////////////////////////////////////////////////
+		float *tmp = scratch + t * scratchSize;
+		#pragma omp for schedule(dynamic, 1)
+		for(int i = 0; i < DIVISIONS; i++){
+			unsigned int count = origOffsets[i+1] - origOffsets[i];
+			if(count == 0) continue;
+			float *sorted = sortBucket(buckets + padOffsets[i], count, tmp);
+			memcpy(resultList + origOffsets[i], sorted, count * sizeof(float));
+		}
+	}
+}
@@ -0,0 +1,20 @@
+#ifndef __HYBRIDSORT_OMP
+#define __HYBRIDSORT_OMP
+
+////////////////////////////////////////////////////////////////////////////////
+// OpenMP CPU build of the hybrid sort: the 1024 bin histogram, the pivot
+// points of calcPivotPoints, a scatter into DIVISIONS buckets and a SIMD
+// merge sort of each bucket, as in bucketsort.cu and mergesort.cu. Sorts
+// ascending in the order of compare() in main.cu; the input must not hold NaNs.
+////////////////////////////////////////////////////////////////////////////////
+
+// buffers for lists of up to listsize elements, with the current number of threads
+void init_ompsort(int listsize);
+void finish_ompsort();
+
+// sorts numElements floats of origList into resultList; minimum and maximum are
+// the smallest and the largest of them
+void ompSort(float *origList, float minimum, float maximum,
+			 float *resultList, int numElements);
+
+#endif
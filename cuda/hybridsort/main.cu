@@ -13,6 +13,7 @@
 #include <iostream>
 #include "bucketsort.cuh"
 #include "mergesort.cuh"
+#include "hybridsort_omp.h"
 using namespace std; 
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -137,6 +138,25 @@ main( int argc, char** argv)
 		}
 	if(count == 0) cout << "PASSED.\n";
 	else cout << "FAILED.\n";
+	cout << "Sorting on CPU (OpenMP)..." << flush; 
+	float *omp_odata = (float *)malloc(mem_size);
+	init_ompsort(numElements); 
+	ompSort(cpu_idata, datamin, datamax, omp_odata, numElements); 
+	finish_ompsort(); 
+	cout << "done.\n";
+	cout << "Checking result..." << flush; 
+	count = 0; 
+	for(int i = 0; i < numElements; i++)
+		if(cpu_odata[i] != omp_odata[i])
+		{
+			printf("Sort missmatch on element %d: \n", i); 
+			printf("CPU = %f : OpenMP = %f\n", cpu_odata[i], omp_odata[i]); 
+			count++; 
+			break; 
+		}
+	if(count == 0) cout << "PASSED.\n";
+	else cout << "FAILED.\n";
+	free(omp_odata); 
 #endif
 	// Timer report
 	printf("GPU iterations: %d\n", TEST); 
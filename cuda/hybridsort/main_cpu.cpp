@@ -0,0 +1,145 @@
+/*
+ * hybridsort - CPU driver. Sorts the same list with qsort (as the VERIFY build
+ * of hybridsort), std::sort and the OpenMP hybrid sort (ompSort), checks that
+ * the three results are identical and reports keys per second. Builds without
+ * CUDA.
+ *
+ * usage: hybridsort_omp [-t threads] [-r repetitions] [-m max_M] [-d u|s] [r | file]
+ *        r (default): random lists of 1M to max_M (256) M floats, uniform in
+ *        [0, 1] (-d u, as hybridsort r) or skewed towards 0 (-d s)
+ *        file: the floats of a text file, as hybridsort reads them
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+#include <omp.h>
+#include <sys/time.h>
+#include <algorithm>
+#include "hybridsort_omp.h"
+
+static double wtime() {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec*1e-6;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Compare method for CPU sort (as in main.cu)
+////////////////////////////////////////////////////////////////////////////////
+inline int compare(const void *a, const void *b) {
+	if(*((float *)a) < *((float *)b)) return -1;
+	else if(*((float *)a) > *((float *)b)) return 1;
+	else return 0;
+}
+
+// floats in [0, 1], uniform or (skewed) cubed, from an xorshift64 per 64K block
+static void generate(float *data, int n, bool skewed) {
+	#pragma omp parallel for schedule(static)
+	for (int b = 0; b < (n >> 16) + 1; b++) {
+		unsigned long long x = 0x9E3779B97F4A7C15ULL*(b+1);
+		int i1 = std::min((b+1) << 16, n);
+		for (int i = b << 16; i < i1; i++) {
+			x ^= x<<13; x ^= x>>7; x ^= x<<17;
+			float u = (float)(x >> 40) / (float)(1 << 24);
+			data[i] = skewed ? u*u*u : u;
+		}
+	}
+}
+
+static int firstMismatch(const float *a, const float *b, int n) {
+	for (int i = 0; i < n; i++)
+		if (a[i] != b[i]) return i;
+	return -1;
+}
+
+static void runTest(const char *name, float *data, int n, int reps) {
+	float *ref = (float *)malloc(n * sizeof(float));
+	float *out = (float *)malloc(n * sizeof(float));
+	float datamin = FLT_MAX, datamax = -FLT_MAX;
+	double t, t_qsort = 1e30, t_std = 1e30, t_omp = 1e30;
+
+	for (int i = 0; i < n; i++) {
+		datamin = std::min(data[i], datamin);
+		datamax = std::max(data[i], datamax);
+	}
+
+	for (int r = 0; r < reps; r++) {
+		memcpy(ref, data, n * sizeof(float));
+		t = wtime();
+		qsort(ref, n, sizeof(float), compare);
+		t = wtime() - t; t_qsort = std::min(t, t_qsort);
+	}
+	for (int r = 0; r < reps; r++) {
+		memcpy(out, data, n * sizeof(float));
+		t = wtime();
+		std::sort(out, out + n);
+		t = wtime() - t; t_std = std::min(t, t_std);
+	}
+	int bad_std = firstMismatch(ref, out, n);
+
+	init_ompsort(n);
+	for (int r = 0; r < reps; r++) {
+		memset(out, 0xFF, n * sizeof(float));
+		t = wtime();
+		ompSort(data, datamin, datamax, out, n);
+		t = wtime() - t; t_omp = std::min(t, t_omp);
+	}
+	finish_ompsort();
+	int bad_omp = firstMismatch(ref, out, n);
+
+	printf("%-10s %10d | qsort %7.2f Mkeys/s | std::sort %7.2f Mkeys/s | OpenMP %8.2f Mkeys/s (%5.2fx qsort, %5.2fx std::sort) | %s\n",
+		name, n, n/t_qsort/1e6, n/t_std/1e6, n/t_omp/1e6, t_qsort/t_omp, t_std/t_omp,
+		(bad_std < 0 && bad_omp < 0) ? "PASS" : "FAIL");
+	if (bad_std >= 0) printf("std::sort mismatch on element %d: qsort = %f : std::sort = %f\n", bad_std, ref[bad_std], out[bad_std]);
+	if (bad_omp >= 0) printf("OpenMP mismatch on element %d: qsort = %f : OpenMP = %f\n", bad_omp, ref[bad_omp], out[bad_omp]);
+
+	free(ref);
+	free(out);
+}
+
+int main(int argc, char **argv) {
+	int reps = 3;
+	int max_m = 256;
+	bool skewed = false;
+	int i = 1;
+
+	for (; i < argc && argv[i][0] == '-'; i += 2) {
+		if (i+1 >= argc) {
+			fprintf(stderr, "usage: %s [-t threads] [-r repetitions] [-m max_M] [-d u|s] [r | file]\n", argv[0]);
+			return 1;
+		}
+		if (argv[i][1] == 't') omp_set_num_threads(atoi(argv[i+1]));
+		else if (argv[i][1] == 'r') reps = std::max(atoi(argv[i+1]), 1);
+		else if (argv[i][1] == 'm') max_m = std::max(atoi(argv[i+1]), 1);
+		else if (argv[i][1] == 'd') skewed = argv[i+1][0] == 's';
+	}
+	printf("%d threads, best of %d\n", omp_get_max_threads(), reps);
+
+	if (i < argc && strcmp(argv[i], "r") != 0) {
+		FILE *fp = fopen(argv[i], "r");
+		if (fp == NULL) { perror(argv[i]); return 1; }
+		int count = 0;
+		float c;
+		while (fscanf(fp, "%f", &c) != EOF) count++;
+		float *data = (float *)malloc(std::max(count, 1) * sizeof(float));
+		rewind(fp);
+		for (int k = 0; k < count; k++)
+			if (fscanf(fp, "%f", &data[k]) != 1) { fputs("Error reading file\n", stderr); return 1; }
+		fclose(fp);
+		runTest(argv[i], data, count, reps);
+		free(data);
+	}
+	else {
+		for (int m = 1; m <= max_m; m *= 4) {
+			int n = m << 20;
+			float *data = (float *)malloc(n * sizeof(float));
+			generate(data, n, skewed);
+			runTest(skewed ? "skewed" : "uniform", data, n, reps);
+			free(data);
+		}
+	}
+	return 0;
+}
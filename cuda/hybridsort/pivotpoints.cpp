@@ -0,0 +1,46 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include "bucketsort.cuh"
+
+////////////////////////////////////////////////////////////////////////////////
+// Given a histogram of the list, figure out suitable pivotpoints that divide
+// the list into approximately listsize/divisions elements each
+// (shared by the CUDA bucketsort and the OpenMP sort)
+////////////////////////////////////////////////////////////////////////////////
+void calcPivotPoints(float *histogram, int histosize, int listsize,
+					 int divisions, float min, float max, float *pivotPoints, float histo_width)
+{
+	float elemsPerSlice = listsize/(float)divisions;
+	float startsAt = min;
+	float endsAt = min + histo_width;
+	float we_need = elemsPerSlice;
+	int p_idx = 0;
+	for(int i=0; i<histosize; i++)
+	{
+		if(i == histosize - 1){
+			if(!(p_idx < divisions)){
+				pivotPoints[p_idx++] = startsAt + (we_need/histogram[i]) * histo_width;
+			}
+			break;
+		}
+		while(histogram[i] > we_need){
+			if(!(p_idx < divisions)){
+				printf("i=%d, p_idx = %d, divisions = %d\n", i, p_idx, divisions);
+				exit(0);
+			}
+			pivotPoints[p_idx++] = startsAt + (we_need/histogram[i]) * histo_width;
+			startsAt += (we_need/histogram[i]) * histo_width;
+			histogram[i] -= we_need;
+			we_need = elemsPerSlice;
+		}
+		// grab what we can from what remains of it
+		we_need -= histogram[i];
+
+		startsAt = endsAt;
+		endsAt += histo_width;
+	}
+	while(p_idx < divisions){
+		pivotPoints[p_idx] = pivotPoints[p_idx-1];
+		p_idx++;
+	}
+}
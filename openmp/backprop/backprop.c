@@ -11,6 +11,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "backprop.h"
+#include "../../common/omp_rt.h"
 #include <math.h>
 #define OPEN
 
@@ -232,31 +233,60 @@ int n_in, n_hidden, n_out;
 }
 
 
-void bpnn_layerforward(l1, l2, conn, n1, n2)
-float *l1, *l2, **conn;
-int n1, n2;
+/*** Arguments of the omp_rt_for bodies of bpnn_layerforward and
+     bpnn_adjust_weights ***/
+
+typedef struct {
+  float *l1, *l2, **conn;
+  int n1;
+} BPNN_FORWARD;
+
+typedef struct {
+  float *delta, *ly, **w, **oldw;
+  int nly;
+} BPNN_ADJUST;
+
+/*** Units begin to end-1 of the second layer. The thresholding unit
+     l1[0] is 1, its term is conn[0][j]: l1[0] is written by the master
+     thread only and not read here. ***/
+
+static void bpnn_layerforward_units(int begin, int end, void *arg)
 {
+  BPNN_FORWARD *f = (BPNN_FORWARD *) arg;
   float sum;
   int j, k;
 
-  /*** Set up thresholding unit ***/
-  l1[0] = 1.0;
-#ifdef OPEN
-  omp_set_num_threads(NUM_THREAD);
-  #pragma omp parallel for shared(conn, n1, n2, l1) private(k, j) reduction(+: sum) schedule(static)
-#endif 
-  /*** For each unit in second layer ***/
-  for (j = 1; j <= n2; j++) {
+  for (j = begin; j < end; j++) {
 
     /*** Compute weighted sum of its inputs ***/
-    sum = 0.0;
-    for (k = 0; k <= n1; k++) {	
-      sum += conn[k][j] * l1[k]; 
+    sum = f->conn[0][j];
+    for (k = 1; k <= f->n1; k++) {	
+      sum += f->conn[k][j] * f->l1[k]; 
     }
-    l2[j] = squash(sum);
+    f->l2[j] = squash(sum);
   }
 }
 
+/*** Inside a parallel region, every thread of the team calls it ***/
+
+void bpnn_layerforward(l1, l2, conn, n1, n2)
+float *l1, *l2, **conn;
+int n1, n2;
+{
+  BPNN_FORWARD f;
+
+  /*** Set up thresholding unit ***/
+  #pragma omp master
+  l1[0] = 1.0;
+
+  f.l1 = l1;
+  f.l2 = l2;
+  f.conn = conn;
+  f.n1 = n1;
+  /*** For each unit in second layer ***/
+  omp_rt_for(1, n2 + 1, OMP_RT_STATIC, 0, bpnn_layerforward_units, &f);
+}
+
 //extern "C"
 void bpnn_output_error(delta, target, output, nj, err)  
 float *delta, *target, *output, *err;
@@ -302,29 +332,40 @@ int nh, no;
 }
 
 
-void bpnn_adjust_weights(delta, ndelta, ly, nly, w, oldw)
-float *delta, *ly, **w, **oldw;
+/*** Units begin to end-1 of the layer of delta; ly[0] is 1 and not
+     read, as in bpnn_layerforward_units ***/
+
+static void bpnn_adjust_units(int begin, int end, void *arg)
 {
+  BPNN_ADJUST *a = (BPNN_ADJUST *) arg;
   float new_dw;
   int k, j;
+
+  for (j = begin; j < end; j++) {
+    for (k = 0; k <= a->nly; k++) {
+      new_dw = ((ETA * a->delta[j] * (k ? a->ly[k] : 1.0)) + (MOMENTUM * a->oldw[k][j]));
+	  a->w[k][j] += new_dw;
+	  a->oldw[k][j] = new_dw;
+    }
+  }
+}
+
+void bpnn_adjust_weights(delta, ndelta, ly, nly, w, oldw)
+float *delta, *ly, **w, **oldw;
+{
+  BPNN_ADJUST a;
+
+  #pragma omp master
   ly[0] = 1.0;
   //eta = 0.3;
   //momentum = 0.3;
 
-#ifdef OPEN
-  omp_set_num_threads(NUM_THREAD);
-  #pragma omp parallel for  \
-      shared(oldw, w, delta) \
-	  private(j, k, new_dw) \
-	  firstprivate(ndelta, nly) 
-#endif 
-  for (j = 1; j <= ndelta; j++) {
-    for (k = 0; k <= nly; k++) {
-      new_dw = ((ETA * delta[j] * ly[k]) + (MOMENTUM * oldw[k][j]));
-	  w[k][j] += new_dw;
-	  oldw[k][j] = new_dw;
-    }
-  }
+  a.delta = delta;
+  a.ly = ly;
+  a.w = w;
+  a.oldw = oldw;
+  a.nly = nly;
+  omp_rt_for(1, ndelta + 1, OMP_RT_STATIC, 0, bpnn_adjust_units, &a);
 }
 
 
@@ -357,6 +398,9 @@ float *eo, *eh;
   hid = net->hidden_n;
   out = net->output_n;
 
+  /*** One parallel region for the whole step ***/
+  #pragma omp parallel if (omp_rt_persistent())
+  {
   /*** Feed forward input activations. ***/
   bpnn_layerforward(net->input_units, net->hidden_units,
       net->input_weights, in, hid);
@@ -364,18 +408,22 @@ float *eo, *eh;
       net->hidden_weights, hid, out);
 
   /*** Compute error on output and hidden units. ***/
+  #pragma omp single
+  {
   bpnn_output_error(net->output_delta, net->target, net->output_units,
       out, &out_err);
   bpnn_hidden_error(net->hidden_delta, hid, net->output_delta, out,
       net->hidden_weights, net->hidden_units, &hid_err);
   *eo = out_err;
   *eh = hid_err;
+  }
 
   /*** Adjust input and hidden weights. ***/
   bpnn_adjust_weights(net->output_delta, out, net->hidden_units, hid,
       net->hidden_weights, net->hidden_prev_weights);
   bpnn_adjust_weights(net->hidden_delta, hid, net->input_units, in,
       net->input_weights, net->input_prev_weights);
+  }
 
 }
 
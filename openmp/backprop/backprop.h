@@ -1,12 +1,15 @@
 #ifndef _BACKPROP_H_
 #define _BACKPROP_H_
 
+#include <stddef.h>
+
 #define BIGRND 0x7fffffff
 
 
 #define ETA 0.3       //eta value
 #define MOMENTUM 0.3  //momentum value
 #define NUM_THREAD 8 //OpenMP threads
+#define BATCH_ALIGN 16 //row padding of the batch layouts, in floats (one cache line)
 
 
 typedef struct {
@@ -32,6 +35,57 @@ typedef struct {
 } BPNN;
 
 
+/*** Mini-batch network (backprop_batch.c): weights stored transposed,
+     w[j][k] = conn[k][j], in rows of stride floats. Units, deltas and
+     patterns are stored batch_n rows of the stride of their layer. ***/
+
+typedef struct {
+  int input_n;                  /* number of input units */
+  int hidden_n;                 /* number of hidden units */
+  int output_n;                 /* number of output units */
+  int batch_n;                  /* patterns per training step */
+
+  int input_stride;             /* row strides, in floats */
+  int hidden_stride;
+  int output_stride;
+
+  float *input_weights;        /* hidden_n+1 rows of input_n+1 weights */
+  float *hidden_weights;       /* output_n+1 rows of hidden_n+1 weights */
+  float *input_prev_weights;   /* previous changes, same layout */
+  float *hidden_prev_weights;
+
+  float *hidden_units;         /* batch_n rows of hidden units */
+  float *output_units;         /* batch_n rows of output units */
+  float *hidden_delta;         /* batch_n rows of hidden unit errors */
+  float *output_delta;         /* batch_n rows of output unit errors */
+} BPNN_BATCH;
+
+
+/*** Network of n_layers fully connected layers (backprop_net.c), layer 0
+     being the input. All weights are in one arena, weights[l] pointing to
+     the weights into layer l in the layout of BPNN_BATCH. ***/
+
+typedef struct {
+  int n_layers;                 /* number of layers, input and output included */
+  int *units;                   /* units of every layer */
+  int *stride;                  /* row stride of every layer, in floats */
+
+  size_t weights_n;             /* floats in the weight arena */
+  float *arena;                 /* weight arena, NULL if mapped from a file */
+  float **weights;              /* weights into layer l, 1 <= l < n_layers */
+  float *prev_arena;            /* previous weight changes, allocated by training */
+  float **prev_weights;
+
+  int batch_n;                  /* patterns the units and errors have room for */
+  float *units_arena;
+  float **layer_units;          /* batch_n rows of units of layer l */
+  float **layer_delta;          /* batch_n rows of errors of layer l */
+
+  void *map;                    /* model file mapping, if loaded */
+  size_t map_bytes;
+} BPNN_NET;
+
+
 /*** User-level functions ***/
 
 void bpnn_initialize();
@@ -45,5 +99,25 @@ void bpnn_feedforward();
 void bpnn_save();
 BPNN *bpnn_read();
 
+int bpnn_batch_stride(int n);
+float *alloc_batch_dbl(int m, size_t stride);
+BPNN_BATCH *bpnn_batch_create(BPNN *net, int batch_n);
+void bpnn_batch_store(BPNN_BATCH *bnet, BPNN *net);
+void bpnn_batch_free(BPNN_BATCH *net);
+void bpnn_batch_train(BPNN_BATCH *net, float *inputs, float *targets, int nb,
+                      float *eo, float *eh);
+void bpnn_train_batch_kernel(BPNN *net, int batch, int epochs, int patterns);
+
+BPNN_NET *bpnn_net_create(int n_layers, int *units);
+void bpnn_net_free(BPNN_NET *net);
+void bpnn_net_reserve(BPNN_NET *net, int batch_n);
+void bpnn_net_forward(BPNN_NET *net, float *inputs, int nb);
+void bpnn_net_train(BPNN_NET *net, float *inputs, float *targets, int nb,
+                    float *eo, float *eh);
+int bpnn_net_save(BPNN_NET *net, char *filename);
+BPNN_NET *bpnn_net_load(char *filename);
+void bpnn_net_kernel(int n_layers, int *units, char *load_file, char *save_file,
+                     int batch, int epochs, int patterns, int infer);
+
 
 #endif
@@ -0,0 +1,327 @@
+/*
+ ******************************************************************
+ * Mini-batch training
+ *
+ * The per-pattern path (bpnn_train) streams every weight and its
+ * momentum term through memory once per pattern. Here a step trains
+ * on a batch of patterns at once: forward, error and weight update
+ * are matrix-matrix products over the batch, so each weight is read
+ * once per forward pass and read/written once per update, for the
+ * whole batch.
+ *
+ * Weights are stored transposed in one contiguous buffer per layer:
+ * row j holds the weights of all units of the lower layer into unit
+ * j of the upper layer (w[j][k] = conn[k][j]), so the dot products
+ * of the forward pass and the rows of the update are contiguous.
+ * The rows are padded to BATCH_ALIGN floats. The kernels work on
+ * column blocks of BATCH_BLOCK weights, which are split among the
+ * threads, so the block of the batch they reuse stays in cache.
+ *
+ * The update uses the mean gradient of the batch:
+ *   dw = ETA * (1/nb) sum_b delta[b][j] * ly[b][k] + MOMENTUM * olddw
+ * which with a batch of one is the update of bpnn_adjust_weights.
+ ******************************************************************
+ */
+
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "backprop.h"
+#include <math.h>
+
+#define ABS(x)          (((x) > 0.0) ? (x) : (-(x)))
+
+/*** Weights per column block of the kernels ***/
+#define BATCH_BLOCK 512
+
+/*** Defined K&R style in backprop.c, so declared without a prototype ***/
+extern float squash();
+
+
+int bpnn_batch_stride(int n)
+{
+  return ((n + 1) + BATCH_ALIGN - 1) / BATCH_ALIGN * BATCH_ALIGN;
+}
+
+
+/*** Allocate a zeroed m x stride array of floats, aligned to a cache line ***/
+
+float *alloc_batch_dbl(int m, size_t stride)
+{
+  void *new;
+
+  if (posix_memalign(&new, BATCH_ALIGN * sizeof(float), (size_t) m * stride * sizeof(float))) {
+    printf("ALLOC_BATCH_DBL: Couldn't allocate array of floats\n");
+    return (NULL);
+  }
+  memset(new, 0, (size_t) m * stride * sizeof(float));
+  return ((float *) new);
+}
+
+
+/*** Creates a batch network with the weights of net, for batches
+     of at most batch_n patterns.
+***/
+
+BPNN_BATCH *bpnn_batch_create(BPNN *net, int batch_n)
+{
+  BPNN_BATCH *newnet;
+  int in, hid, out, j, k;
+
+  newnet = (BPNN_BATCH *) malloc (sizeof (BPNN_BATCH));
+  if (newnet == NULL) {
+    printf("BPNN_BATCH_CREATE: Couldn't allocate neural network\n");
+    return (NULL);
+  }
+
+  in = net->input_n;
+  hid = net->hidden_n;
+  out = net->output_n;
+
+  newnet->input_n = in;
+  newnet->hidden_n = hid;
+  newnet->output_n = out;
+  newnet->batch_n = batch_n;
+  newnet->input_stride = bpnn_batch_stride(in);
+  newnet->hidden_stride = bpnn_batch_stride(hid);
+  newnet->output_stride = bpnn_batch_stride(out);
+
+  newnet->input_weights = alloc_batch_dbl(hid + 1, newnet->input_stride);
+  newnet->input_prev_weights = alloc_batch_dbl(hid + 1, newnet->input_stride);
+  newnet->hidden_weights = alloc_batch_dbl(out + 1, newnet->hidden_stride);
+  newnet->hidden_prev_weights = alloc_batch_dbl(out + 1, newnet->hidden_stride);
+
+  newnet->hidden_units = alloc_batch_dbl(batch_n, newnet->hidden_stride);
+  newnet->output_units = alloc_batch_dbl(batch_n, newnet->output_stride);
+  newnet->hidden_delta = alloc_batch_dbl(batch_n, newnet->hidden_stride);
+  newnet->output_delta = alloc_batch_dbl(batch_n, newnet->output_stride);
+
+  for (j = 0; j <= hid; j++) {
+    for (k = 0; k <= in; k++) {
+      newnet->input_weights[j * newnet->input_stride + k] = net->input_weights[k][j];
+      newnet->input_prev_weights[j * newnet->input_stride + k] = net->input_prev_weights[k][j];
+    }
+  }
+  for (j = 0; j <= out; j++) {
+    for (k = 0; k <= hid; k++) {
+      newnet->hidden_weights[j * newnet->hidden_stride + k] = net->hidden_weights[k][j];
+      newnet->hidden_prev_weights[j * newnet->hidden_stride + k] = net->hidden_prev_weights[k][j];
+    }
+  }
+
+  return (newnet);
+}
+
+
+/*** Copies the weights back into a per-pattern network ***/
+
+void bpnn_batch_store(BPNN_BATCH *bnet, BPNN *net)
+{
+  int j, k;
+
+  for (j = 0; j <= bnet->hidden_n; j++) {
+    for (k = 0; k <= bnet->input_n; k++) {
+      net->input_weights[k][j] = bnet->input_weights[j * bnet->input_stride + k];
+      net->input_prev_weights[k][j] = bnet->input_prev_weights[j * bnet->input_stride + k];
+    }
+  }
+  for (j = 0; j <= bnet->output_n; j++) {
+    for (k = 0; k <= bnet->hidden_n; k++) {
+      net->hidden_weights[k][j] = bnet->hidden_weights[j * bnet->hidden_stride + k];
+      net->hidden_prev_weights[k][j] = bnet->hidden_prev_weights[j * bnet->hidden_stride + k];
+    }
+  }
+}
+
+
+void bpnn_batch_free(BPNN_BATCH *net)
+{
+  free(net->input_weights);
+  free(net->input_prev_weights);
+  free(net->hidden_weights);
+  free(net->hidden_prev_weights);
+  free(net->hidden_units);
+  free(net->output_units);
+  free(net->hidden_delta);
+  free(net->output_delta);
+  free(net);
+}
+
+
+/*** l2[b][j] = squash(sum_k l1[b][k] * w[j][k]) for the nb patterns
+     of the batch, l1[b][0] being the thresholding unit. The rows of
+     l1 and w have the same stride s1. Every thread sums its column
+     blocks into its own nb x n2 partial sums.
+***/
+
+void bpnn_batch_layerforward(float *l1, int s1, float *l2, int s2,
+                             float *w, int n1, int n2, int nb)
+{
+  float *sum;
+  int nblocks, b;
+
+  for (b = 0; b < nb; b++) {
+    l1[b * s1] = 1.0;
+  }
+
+  sum = (float *) calloc(nb * (n2 + 1), sizeof(float));
+  nblocks = (n1 + BATCH_BLOCK) / BATCH_BLOCK;
+
+  omp_set_num_threads(NUM_THREAD);
+  #pragma omp parallel
+  {
+    float *part;
+    int blk, k0, k1, b, j, k, i;
+
+    part = (float *) calloc(nb * (n2 + 1), sizeof(float));
+
+    #pragma omp for schedule(static)
+    for (blk = 0; blk < nblocks; blk++) {
+      k0 = blk * BATCH_BLOCK;
+      k1 = k0 + BATCH_BLOCK < n1 + 1 ? k0 + BATCH_BLOCK : n1 + 1;
+      for (j = 1; j <= n2; j++) {
+        float *wj = &w[j * s1];
+        for (b = 0; b < nb; b++) {
+          float *x = &l1[b * s1];
+          float s = 0.0;
+          #pragma omp simd reduction(+: s)
+          for (k = k0; k < k1; k++) {
+            s += wj[k] * x[k];
+          }
+          part[b * (n2 + 1) + j] += s;
+        }
+      }
+    }
+
+    #pragma omp critical
+    for (i = 0; i < nb * (n2 + 1); i++) {
+      sum[i] += part[i];
+    }
+
+    free(part);
+  }
+
+  for (b = 0; b < nb; b++) {
+    int j;
+    for (j = 1; j <= n2; j++) {
+      l2[b * s2 + j] = squash(sum[b * (n2 + 1) + j]);
+    }
+  }
+
+  free(sum);
+}
+
+
+/*** w[j][k] += ETA/nb sum_b delta[b][j] * ly[b][k] + MOMENTUM * oldw[j][k],
+     one row segment of a column block at a time, so every weight and
+     momentum term is read and written once per batch. The rows of ly,
+     w and oldw have the same stride sl.
+***/
+
+void bpnn_batch_adjust_weights(float *delta, int sd, int ndelta,
+                               float *ly, int sl, int nly,
+                               float *w, float *oldw, int nb)
+{
+  int nblocks, b;
+  float scale;
+
+  for (b = 0; b < nb; b++) {
+    ly[b * sl] = 1.0;
+  }
+
+  scale = ETA / nb;
+  nblocks = (nly + BATCH_BLOCK) / BATCH_BLOCK;
+
+  omp_set_num_threads(NUM_THREAD);
+  #pragma omp parallel
+  {
+    float grad[BATCH_BLOCK];
+    int blk, k0, k1, b, j, k;
+
+    #pragma omp for schedule(static)
+    for (blk = 0; blk < nblocks; blk++) {
+      k0 = blk * BATCH_BLOCK;
+      k1 = k0 + BATCH_BLOCK < nly + 1 ? k0 + BATCH_BLOCK : nly + 1;
+      for (j = 1; j <= ndelta; j++) {
+        float *wj = &w[j * sl];
+        float *oldwj = &oldw[j * sl];
+
+        memset(grad, 0, (k1 - k0) * sizeof(float));
+        for (b = 0; b < nb; b++) {
+          float d = scale * delta[b * sd + j];
+          float *x = &ly[b * sl + k0];
+          #pragma omp simd
+          for (k = 0; k < k1 - k0; k++) {
+            grad[k] += d * x[k];
+          }
+        }
+
+        #pragma omp simd
+        for (k = k0; k < k1; k++) {
+          float new_dw = grad[k - k0] + MOMENTUM * oldwj[k];
+          wj[k] += new_dw;
+          oldwj[k] = new_dw;
+        }
+      }
+    }
+  }
+}
+
+
+/*** Trains one step on nb patterns (nb <= batch_n). inputs holds nb
+     rows of input_stride floats with the pattern in 1..input_n, targets
+     nb rows of output_stride floats with the target in 1..output_n.
+***/
+
+void bpnn_batch_train(BPNN_BATCH *net, float *inputs, float *targets, int nb,
+                      float *eo, float *eh)
+{
+  int in, hid, out, si, sh, so, b, j, k;
+  float out_err, hid_err;
+
+  in = net->input_n;
+  hid = net->hidden_n;
+  out = net->output_n;
+  si = net->input_stride;
+  sh = net->hidden_stride;
+  so = net->output_stride;
+
+  /*** Feed forward input activations. ***/
+  bpnn_batch_layerforward(inputs, si, net->hidden_units, sh,
+      net->input_weights, in, hid, nb);
+  bpnn_batch_layerforward(net->hidden_units, sh, net->output_units, so,
+      net->hidden_weights, hid, out, nb);
+
+  /*** Compute error on output and hidden units. ***/
+  out_err = 0.0;
+  hid_err = 0.0;
+  for (b = 0; b < nb; b++) {
+    float *o = &net->output_units[b * so];
+    float *t = &targets[b * so];
+    float *d_o = &net->output_delta[b * so];
+    float *h = &net->hidden_units[b * sh];
+    float *d_h = &net->hidden_delta[b * sh];
+
+    for (j = 1; j <= out; j++) {
+      d_o[j] = o[j] * (1.0 - o[j]) * (t[j] - o[j]);
+      out_err += ABS(d_o[j]);
+    }
+    for (j = 1; j <= hid; j++) {
+      float sum = 0.0;
+      for (k = 1; k <= out; k++) {
+        sum += d_o[k] * net->hidden_weights[k * sh + j];
+      }
+      d_h[j] = h[j] * (1.0 - h[j]) * sum;
+      hid_err += ABS(d_h[j]);
+    }
+  }
+  *eo = out_err;
+  *eh = hid_err;
+
+  /*** Adjust input and hidden weights. ***/
+  bpnn_batch_adjust_weights(net->output_delta, so, out, net->hidden_units, sh, hid,
+      net->hidden_weights, net->hidden_prev_weights, nb);
+  bpnn_batch_adjust_weights(net->hidden_delta, sh, hid, inputs, si, in,
+      net->input_weights, net->input_prev_weights, nb);
+}
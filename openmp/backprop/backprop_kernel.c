@@ -5,6 +5,7 @@
 #include <sys/time.h>
 
 #include "backprop.h"
+#include "../../common/omp_rt.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -41,19 +42,177 @@ main( int argc, char** argv)
 
 void bpnn_train_kernel(BPNN *net, float *eo, float *eh)
 {
-  int in, hid, out;
-  float out_err, hid_err;
-  
-  in = net->input_n;
-  hid = net->hidden_n;
-  out = net->output_n;   
-   
   printf("Performing CPU computation\n");
-  bpnn_layerforward(net->input_units, net->hidden_units,net->input_weights, in, hid);
-  bpnn_layerforward(net->hidden_units, net->output_units, net->hidden_weights, hid, out);
-  bpnn_output_error(net->output_delta, net->target, net->output_units, out, &out_err);
-  bpnn_hidden_error(net->hidden_delta, hid, net->output_delta, out, net->hidden_weights, net->hidden_units, &hid_err);  
-  bpnn_adjust_weights(net->output_delta, out, net->hidden_units, hid, net->hidden_weights, net->hidden_prev_weights);
-  bpnn_adjust_weights(net->hidden_delta, hid, net->input_units, in, net->input_weights, net->input_prev_weights);
+  /*** the step of bpnn_train, in one parallel region ***/
+  bpnn_train(net, eo, eh);
+  omp_rt_report("training step");
+
+}
+
+
+/*** Trains on patterns random patterns, first one epoch one pattern
+     at a time (bpnn_train), then epochs epochs in mini-batches of batch
+     patterns (bpnn_batch_train), both from the weights of net, and
+     reports the samples per second of both. ***/
+
+void bpnn_train_batch_kernel(BPNN *net, int batch, int epochs, int patterns)
+{
+  BPNN_BATCH *bnet;
+  float *inputs, *targets;
+  int in, out, si, so, p, e, k, nb;
+  float out_err, hid_err, eo, eh;
+  double t0, t_pattern, t_batch;
+
+  in = net->input_n;
+  out = net->output_n;
+
+  bnet = bpnn_batch_create(net, batch);
+  si = bnet->input_stride;
+  so = bnet->output_stride;
+
+  inputs = alloc_batch_dbl(patterns, si);
+  targets = alloc_batch_dbl(patterns, so);
+  for (p = 0; p < patterns; p++) {
+    for (k = 1; k <= in; k++) {
+      inputs[p * si + k] = (float) rand()/RAND_MAX;
+    }
+    for (k = 1; k <= out; k++) {
+      targets[p * so + k] = net->target[k];
+    }
+  }
+
+  printf("Performing CPU computation: %d patterns, %d epochs, batch %d\n", patterns, epochs, batch);
+
+  omp_rt_stats_reset();
+  t0 = gettime();
+  for (p = 0; p < patterns; p++) {
+    memcpy(&net->input_units[1], &inputs[p * si + 1], in * sizeof(float));
+    memcpy(&net->target[1], &targets[p * so + 1], out * sizeof(float));
+    bpnn_train(net, &out_err, &hid_err);
+  }
+  t_pattern = gettime() - t0;
+  printf("Per-pattern: 1 epoch, %d samples in %f s, %.1f samples/s\n",
+         patterns, t_pattern, patterns / t_pattern);
+  omp_rt_report("per-pattern");
+
+  t0 = gettime();
+  for (e = 0; e < epochs; e++) {
+    eo = 0.0;
+    eh = 0.0;
+    for (p = 0; p < patterns; p += batch) {
+      nb = patterns - p < batch ? patterns - p : batch;
+      bpnn_batch_train(bnet, &inputs[p * si], &targets[p * so], nb, &out_err, &hid_err);
+      eo += out_err;
+      eh += hid_err;
+    }
+    printf("Epoch %d: output error %f, hidden error %f\n", e, eo / patterns, eh / patterns);
+  }
+  t_batch = gettime() - t0;
+  printf("Mini-batch: %d epochs, %d samples in %f s, %.1f samples/s (%.2fx per-pattern)\n",
+         epochs, epochs * patterns, t_batch, epochs * patterns / t_batch,
+         (epochs * patterns / t_batch) / (patterns / t_pattern));
+
+  free(inputs);
+  free(targets);
+  bpnn_batch_free(bnet);
+}
+
+
+/*** Runs a network of n_layers layers of units: created with random
+     weights, or loaded from load_file (units may then be NULL), trained
+     for epochs epochs in batches of batch patterns, saved to save_file,
+     then benchmarked on infer patterns of batch inference
+     (bpnn_net_forward). ***/
+
+void bpnn_net_kernel(int n_layers, int *units, char *load_file, char *save_file,
+                     int batch, int epochs, int patterns, int infer)
+{
+  BPNN_NET *net;
+  float *inputs, *targets, *o;
+  int in, out, si, so, p, e, k, l, nb;
+  float out_err, hid_err, eo, eh;
+  double t0, t, checksum;
+
+  t0 = gettime();
+  net = load_file != NULL ? bpnn_net_load(load_file) : bpnn_net_create(n_layers, units);
+  t = gettime() - t0;
+  if (net == NULL) {
+    exit(1);
+  }
+  if (units != NULL && load_file != NULL
+      && (n_layers != net->n_layers || memcmp(units, net->units, n_layers * sizeof(int)) != 0)) {
+    printf("'%s' does not hold a network of the given layers\n", load_file);
+    exit(1);
+  }
+
+  printf("Network ");
+  for (l = 0; l < net->n_layers; l++) {
+    printf(l == 0 ? "%d" : "-%d", net->units[l]);
+  }
+  printf(": %lu weights (%.1f MB), %s in %f s\n", (unsigned long) net->weights_n,
+         net->weights_n * sizeof(float) / 1e6, load_file != NULL ? "loaded" : "created", t);
+
+  /*** Same patterns whether the network was created or loaded ***/
+  srand(7);
+  in = net->units[0];
+  out = net->units[net->n_layers - 1];
+  si = net->stride[0];
+  so = net->stride[net->n_layers - 1];
+  inputs = alloc_batch_dbl(patterns, si);
+  targets = alloc_batch_dbl(patterns, so);
+  for (p = 0; p < patterns; p++) {
+    for (k = 1; k <= in; k++) {
+      inputs[p * si + k] = (float) rand()/RAND_MAX;
+    }
+    for (k = 1; k <= out; k++) {
+      targets[p * so + k] = 0.1;
+    }
+  }
+  if (epochs > 0) {
+    printf("Performing CPU computation: %d patterns, %d epochs, batch %d\n", patterns, epochs, batch);
+    t0 = gettime();
+    for (e = 0; e < epochs; e++) {
+      eo = 0.0;
+      eh = 0.0;
+      for (p = 0; p < patterns; p += batch) {
+        nb = patterns - p < batch ? patterns - p : batch;
+        bpnn_net_train(net, &inputs[p * si], &targets[p * so], nb, &out_err, &hid_err);
+        eo += out_err;
+        eh += hid_err;
+      }
+      printf("Epoch %d: output error %f, hidden error %f\n", e, eo / patterns, eh / patterns);
+    }
+    t = gettime() - t0;
+    printf("Training: %d samples in %f s, %.1f samples/s\n",
+           epochs * patterns, t, epochs * patterns / t);
+  }
+
+  if (save_file != NULL) {
+    t0 = gettime();
+    if (bpnn_net_save(net, save_file) == 0) {
+      printf("Saved '%s' in %f s\n", save_file, gettime() - t0);
+    }
+  }
+
+  if (infer > 0) {
+    checksum = 0.0;
+    t0 = gettime();
+    for (e = 0; e < infer; e += nb) {
+      p = e % patterns;
+      nb = patterns - p < batch ? patterns - p : batch;
+      nb = infer - e < nb ? infer - e : nb;
+      bpnn_net_forward(net, &inputs[p * si], nb);
+      o = net->layer_units[net->n_layers - 1];
+      for (k = 0; k < nb; k++) {
+        checksum += o[k * so + 1];
+      }
+    }
+    t = gettime() - t0;
+    printf("Inference: %d samples in %f s, %.1f samples/s, %.2f GFLOP/s, mean output %.9g\n",
+           infer, t, infer / t, 2.0 * net->weights_n * infer / t / 1e9, checksum / infer);
+  }
 
+  free(inputs);
+  free(targets);
+  bpnn_net_free(net);
 }
@@ -0,0 +1,411 @@
+/*
+ ******************************************************************
+ * Multi-layer network
+ *
+ * A BPNN_NET has any number of fully connected layers of any width.
+ * The weights of all layers live in one weight arena, laid out as in
+ * backprop_batch.c: the weights into layer l are units[l]+1 rows (row
+ * 0 unused) of stride[l-1] floats, row j holding the weights from all
+ * units of layer l-1 into unit j. Training and inference run on the
+ * arena with the mini-batch kernels of backprop_batch.c.
+ *
+ * Model file (native byte order, version 1):
+ *   header:  char magic[8] "BPNNMDL", int version, float_bytes,
+ *            n_layers, align, long long weights_offset, weights_n
+ *   units:   int units[n_layers]
+ *   weights: the weight arena, weights_n floats at weights_offset
+ *            (a multiple of align floats)
+ * bpnn_net_load maps the file and uses the weights in place, so a
+ * restart costs no parsing or copying. The mapping is private: a
+ * loaded network can be trained without changing the file.
+ ******************************************************************
+ */
+
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "backprop.h"
+#include <math.h>
+
+#define ABS(x)          (((x) > 0.0) ? (x) : (-(x)))
+
+#define NET_MAGIC "BPNNMDL"
+#define NET_VERSION 1
+
+typedef struct {
+  char magic[8];
+  int version;
+  int float_bytes;
+  int n_layers;
+  int align;
+  long long weights_offset;    /* bytes */
+  long long weights_n;         /* floats */
+} BPNN_NET_HEADER;
+
+extern void bpnn_batch_layerforward(float *l1, int s1, float *l2, int s2,
+                                    float *w, int n1, int n2, int nb);
+extern void bpnn_batch_adjust_weights(float *delta, int sd, int ndelta,
+                                      float *ly, int sl, int nly,
+                                      float *w, float *oldw, int nb);
+
+
+/*** Sets up everything but the weights for n_layers layers of units ***/
+
+static BPNN_NET *bpnn_net_internal_create(int n_layers, int *units)
+{
+  BPNN_NET *newnet;
+  size_t n;
+  int l;
+
+  if (n_layers < 2) {
+    printf("BPNN_NET_CREATE: A network needs at least 2 layers\n");
+    return (NULL);
+  }
+  for (l = 0; l < n_layers; l++) {
+    if (units[l] <= 0) {
+      printf("BPNN_NET_CREATE: Layer %d has %d units\n", l, units[l]);
+      return (NULL);
+    }
+  }
+
+  newnet = (BPNN_NET *) calloc (1, sizeof (BPNN_NET));
+  if (newnet == NULL) {
+    printf("BPNN_NET_CREATE: Couldn't allocate neural network\n");
+    return (NULL);
+  }
+
+  newnet->n_layers = n_layers;
+  newnet->units = (int *) malloc(n_layers * sizeof(int));
+  newnet->stride = (int *) malloc(n_layers * sizeof(int));
+  newnet->weights = (float **) calloc(n_layers, sizeof(float *));
+  newnet->prev_weights = (float **) calloc(n_layers, sizeof(float *));
+  newnet->layer_units = (float **) calloc(n_layers, sizeof(float *));
+  newnet->layer_delta = (float **) calloc(n_layers, sizeof(float *));
+
+  n = 0;
+  for (l = 0; l < n_layers; l++) {
+    newnet->units[l] = units[l];
+    newnet->stride[l] = bpnn_batch_stride(units[l]);
+    if (l > 0) {
+      n += (size_t) (units[l] + 1) * newnet->stride[l - 1];
+    }
+  }
+  newnet->weights_n = n;
+
+  return (newnet);
+}
+
+
+/*** Points the per-layer weights into an arena ***/
+
+static void bpnn_net_split(BPNN_NET *net, float *arena, float **w)
+{
+  size_t offset;
+  int l;
+
+  offset = 0;
+  w[0] = NULL;
+  for (l = 1; l < net->n_layers; l++) {
+    w[l] = arena + offset;
+    offset += (size_t) (net->units[l] + 1) * net->stride[l - 1];
+  }
+}
+
+
+/*** Creates a network with random weights. The weights are drawn in
+     the order of bpnn_randomize_weights, so units {n, 16, 1} gives the
+     weights of bpnn_create(n, 16, 1) for the same seed.
+***/
+
+BPNN_NET *bpnn_net_create(int n_layers, int *units)
+{
+  BPNN_NET *newnet;
+  int l, j, k;
+
+  newnet = bpnn_net_internal_create(n_layers, units);
+  if (newnet == NULL) {
+    return (NULL);
+  }
+
+  newnet->arena = alloc_batch_dbl(1, newnet->weights_n);
+  if (newnet->arena == NULL) {
+    bpnn_net_free(newnet);
+    return (NULL);
+  }
+  bpnn_net_split(newnet, newnet->arena, newnet->weights);
+
+  for (l = 1; l < n_layers; l++) {
+    float *w = newnet->weights[l];
+    int s = newnet->stride[l - 1];
+    for (k = 0; k <= units[l - 1]; k++) {
+      for (j = 0; j <= units[l]; j++) {
+        w[j * s + k] = (float) rand()/RAND_MAX;
+      }
+    }
+  }
+
+  return (newnet);
+}
+
+
+void bpnn_net_free(BPNN_NET *net)
+{
+  if (net->map != NULL) {
+    munmap(net->map, net->map_bytes);
+  } else {
+    free(net->arena);
+  }
+  free(net->prev_arena);
+  free(net->units_arena);
+  free(net->units);
+  free(net->stride);
+  free(net->weights);
+  free(net->prev_weights);
+  free(net->layer_units);
+  free(net->layer_delta);
+  free(net);
+}
+
+
+/*** Allocates the units and errors of every layer but the input one
+     for batches of up to batch_n patterns.
+***/
+
+void bpnn_net_reserve(BPNN_NET *net, int batch_n)
+{
+  size_t n, offset;
+  int l;
+
+  if (batch_n <= net->batch_n) {
+    return;
+  }
+
+  n = 0;
+  for (l = 1; l < net->n_layers; l++) {
+    n += 2 * (size_t) batch_n * net->stride[l];
+  }
+
+  free(net->units_arena);
+  net->units_arena = alloc_batch_dbl(1, n);
+  net->batch_n = batch_n;
+
+  offset = 0;
+  for (l = 1; l < net->n_layers; l++) {
+    net->layer_units[l] = net->units_arena + offset;
+    offset += (size_t) batch_n * net->stride[l];
+    net->layer_delta[l] = net->units_arena + offset;
+    offset += (size_t) batch_n * net->stride[l];
+  }
+}
+
+
+/*** Feeds nb patterns (rows of stride[0] floats, the pattern in
+     1..units[0]) forward. The outputs are in net->layer_units[n_layers-1].
+***/
+
+void bpnn_net_forward(BPNN_NET *net, float *inputs, int nb)
+{
+  int l;
+  float *below;
+
+  bpnn_net_reserve(net, nb);
+
+  below = inputs;
+  for (l = 1; l < net->n_layers; l++) {
+    bpnn_batch_layerforward(below, net->stride[l - 1], net->layer_units[l], net->stride[l],
+        net->weights[l], net->units[l - 1], net->units[l], nb);
+    below = net->layer_units[l];
+  }
+}
+
+
+/*** Trains one step on nb patterns. targets holds nb rows of the
+     stride of the output layer. eo gets the output error, eh the error
+     of all hidden layers.
+***/
+
+void bpnn_net_train(BPNN_NET *net, float *inputs, float *targets, int nb,
+                    float *eo, float *eh)
+{
+  int top, l, b;
+  float out_err, hid_err;
+
+  top = net->n_layers - 1;
+
+  if (net->prev_arena == NULL) {
+    net->prev_arena = alloc_batch_dbl(1, net->weights_n);
+    bpnn_net_split(net, net->prev_arena, net->prev_weights);
+  }
+
+  /*** Feed forward input activations. ***/
+  bpnn_net_forward(net, inputs, nb);
+
+  /*** Compute error on output units. ***/
+  out_err = 0.0;
+  for (b = 0; b < nb; b++) {
+    int s = net->stride[top], j;
+    float *o = &net->layer_units[top][b * s];
+    float *t = &targets[b * s];
+    float *d = &net->layer_delta[top][b * s];
+    for (j = 1; j <= net->units[top]; j++) {
+      d[j] = o[j] * (1.0 - o[j]) * (t[j] - o[j]);
+      out_err += ABS(d[j]);
+    }
+  }
+
+  /*** Propagate it down through the hidden layers, a row of the
+       weights above at a time. ***/
+  hid_err = 0.0;
+  for (l = top - 1; l >= 1; l--) {
+    int s = net->stride[l], s1 = net->stride[l + 1];
+    int n = net->units[l], n1 = net->units[l + 1];
+    float *w = net->weights[l + 1];
+
+    omp_set_num_threads(NUM_THREAD);
+    #pragma omp parallel for reduction(+: hid_err) schedule(static)
+    for (b = 0; b < nb; b++) {
+      float *h = &net->layer_units[l][b * s];
+      float *dh = &net->layer_delta[l][b * s];
+      float *d1 = &net->layer_delta[l + 1][b * s1];
+      int j, k;
+
+      memset(dh, 0, (n + 1) * sizeof(float));
+      for (k = 1; k <= n1; k++) {
+        float d = d1[k];
+        float *wk = &w[k * s];
+        #pragma omp simd
+        for (j = 1; j <= n; j++) {
+          dh[j] += d * wk[j];
+        }
+      }
+      for (j = 1; j <= n; j++) {
+        dh[j] = h[j] * (1.0 - h[j]) * dh[j];
+        hid_err += ABS(dh[j]);
+      }
+    }
+  }
+  *eo = out_err;
+  *eh = hid_err;
+
+  /*** Adjust the weights, top layer first. ***/
+  for (l = top; l >= 1; l--) {
+    float *below = l == 1 ? inputs : net->layer_units[l - 1];
+    bpnn_batch_adjust_weights(net->layer_delta[l], net->stride[l], net->units[l],
+        below, net->stride[l - 1], net->units[l - 1],
+        net->weights[l], net->prev_weights[l], nb);
+  }
+}
+
+
+/*** Writes the network to a model file, returns 0 on success ***/
+
+int bpnn_net_save(BPNN_NET *net, char *filename)
+{
+  BPNN_NET_HEADER header;
+  FILE *pFile;
+  long long units_end;
+  char pad[BATCH_ALIGN * sizeof(float)];
+  int ok;
+
+  pFile = fopen(filename, "wb");
+  if (pFile == NULL) {
+    printf("BPNN_NET_SAVE: Cannot create '%s'\n", filename);
+    return (-1);
+  }
+
+  memset(&header, 0, sizeof(header));
+  memset(pad, 0, sizeof(pad));
+  units_end = sizeof(header) + net->n_layers * sizeof(int);
+
+  strcpy(header.magic, NET_MAGIC);
+  header.version = NET_VERSION;
+  header.float_bytes = sizeof(float);
+  header.n_layers = net->n_layers;
+  header.align = BATCH_ALIGN;
+  header.weights_offset = (units_end + sizeof(pad) - 1) / sizeof(pad) * sizeof(pad);
+  header.weights_n = net->weights_n;
+
+  ok = fwrite(&header, sizeof(header), 1, pFile) == 1
+    && fwrite(net->units, sizeof(int), net->n_layers, pFile) == (size_t) net->n_layers
+    && fwrite(pad, 1, header.weights_offset - units_end, pFile) == (size_t) (header.weights_offset - units_end)
+    && fwrite(net->weights[1], sizeof(float), net->weights_n, pFile) == net->weights_n;
+  ok = (fclose(pFile) == 0) && ok;
+
+  if (!ok) {
+    printf("BPNN_NET_SAVE: Couldn't write '%s'\n", filename);
+    return (-1);
+  }
+  return (0);
+}
+
+
+/*** Maps a model file written by bpnn_net_save, NULL if it is not one ***/
+
+BPNN_NET *bpnn_net_load(char *filename)
+{
+  BPNN_NET_HEADER header;
+  BPNN_NET *new;
+  struct stat st;
+  int fd, l, *units;
+  void *map;
+
+  if ((fd = open(filename, O_RDONLY)) == -1) {
+    printf("BPNN_NET_LOAD: Cannot open '%s'\n", filename);
+    return (NULL);
+  }
+
+  if (fstat(fd, &st) != 0 || st.st_size < (off_t) sizeof(header)) {
+    printf("BPNN_NET_LOAD: '%s' is not a model file\n", filename);
+    close(fd);
+    return (NULL);
+  }
+
+  map = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    printf("BPNN_NET_LOAD: Cannot map '%s'\n", filename);
+    return (NULL);
+  }
+
+  memcpy(&header, map, sizeof(header));
+  if (memcmp(header.magic, NET_MAGIC, sizeof NET_MAGIC) != 0 || header.version != NET_VERSION
+      || header.float_bytes != sizeof(float) || header.n_layers < 2
+      || header.weights_offset < 0 || header.weights_n < 0
+      || header.weights_offset % (BATCH_ALIGN * sizeof(float)) != 0
+      || sizeof(header) + header.n_layers * sizeof(int) > (size_t) header.weights_offset
+      || header.weights_offset + header.weights_n * (long long) sizeof(float) > st.st_size) {
+    printf("BPNN_NET_LOAD: '%s' is not a version %d model file\n", filename, NET_VERSION);
+    munmap(map, st.st_size);
+    return (NULL);
+  }
+
+  units = (int *) ((char *) map + sizeof(header));
+  for (l = 0; l < header.n_layers; l++) {
+    if (units[l] <= 0) {
+      printf("BPNN_NET_LOAD: '%s' has a layer of %d units\n", filename, units[l]);
+      munmap(map, st.st_size);
+      return (NULL);
+    }
+  }
+
+  new = bpnn_net_internal_create(header.n_layers, units);
+  if (new == NULL || (long long) new->weights_n != header.weights_n) {
+    printf("BPNN_NET_LOAD: '%s' has inconsistent layer sizes\n", filename);
+    if (new != NULL) {
+      bpnn_net_free(new);
+    }
+    munmap(map, st.st_size);
+    return (NULL);
+  }
+
+  new->map = map;
+  new->map_bytes = st.st_size;
+  bpnn_net_split(new, (float *) ((char *) map + header.weights_offset), new->weights);
+
+  return (new);
+}
@@ -1,13 +1,17 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <string.h>
 #include "backprop.h"
 #include "omp.h"
+#include "../../common/omp_rt.h"
 
-extern char *strcpy();
 extern void exit();
 
 int layer_size = 0;
+int batch_size = 0;      /* mini-batch training when > 0 */
+int num_epochs = 1;
+int num_patterns = 0;
 
 backprop_face()
 {
@@ -17,23 +21,96 @@ backprop_face()
   net = bpnn_create(layer_size, 16, 1); // (16, 1 can not be changed)
   printf("Input layer size : %d\n", layer_size);
   load(net);
-  //entering the training kernel, only one iteration
   printf("Starting training kernel\n");
-  bpnn_train_kernel(net, &out_err, &hid_err);
+  if (batch_size > 0) {
+    bpnn_train_batch_kernel(net, batch_size, num_epochs, num_patterns);
+  } else {
+    //entering the training kernel, only one iteration
+    bpnn_train_kernel(net, &out_err, &hid_err);
+  }
   bpnn_free(net);
   printf("Training done\n");
 }
 
+/*** backprop -layers <units,units,...> [-batch n] [-epochs n]
+       [-patterns n] [-infer n] [-save file] [-load file]
+     -layers may be left out with -load ***/
+
+int net_setup(argc, argv)
+int argc;
+char *argv[];
+{
+  int units[64], n_layers, batch, epochs, patterns, infer, i;
+  char *load_file, *save_file, *s;
+
+  n_layers = 0;
+  batch = 64;
+  epochs = 0;
+  patterns = 256;
+  infer = 0;
+  load_file = NULL;
+  save_file = NULL;
+
+  for (i = 1; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "-layers") == 0) {
+      for (s = argv[i + 1]; *s != '\0' && n_layers < 64; s++) {
+        units[n_layers++] = (int) strtol(s, &s, 10);
+        if (*s != ',') break;
+      }
+    } else if (strcmp(argv[i], "-batch") == 0) {
+      batch = atoi(argv[i + 1]);
+    } else if (strcmp(argv[i], "-epochs") == 0) {
+      epochs = atoi(argv[i + 1]);
+    } else if (strcmp(argv[i], "-patterns") == 0) {
+      patterns = atoi(argv[i + 1]);
+    } else if (strcmp(argv[i], "-infer") == 0) {
+      infer = atoi(argv[i + 1]);
+    } else if (strcmp(argv[i], "-save") == 0) {
+      save_file = argv[i + 1];
+    } else if (strcmp(argv[i], "-load") == 0) {
+      load_file = argv[i + 1];
+    } else {
+      break;
+    }
+  }
+
+  if (i != argc || (n_layers < 2 && load_file == NULL) || batch < 1 || patterns < 1) {
+    fprintf(stderr, "usage: backprop -layers <units,units,...> [-batch n] [-epochs n] [-patterns n] [-infer n] [-save file] [-load file]\n");
+    exit(0);
+  }
+
+  bpnn_initialize(7);
+  bpnn_net_kernel(n_layers, n_layers > 0 ? units : NULL, load_file, save_file,
+                  batch, epochs, patterns, infer);
+
+  exit(0);
+}
+
 int setup(argc, argv)
 int argc;
 char *argv[];
 {
-  if(argc!=2){
-  fprintf(stderr, "usage: backprop <num of input elements>\n");
+  omp_rt_init(NUM_THREAD);
+
+  if(argc>1 && argv[1][0]=='-'){
+  net_setup(argc, argv);
+  }
+
+  if(argc!=2 && argc!=5){
+  fprintf(stderr, "usage: backprop <num of input elements> [<batch size> <epochs> <patterns>]\n");
   exit(0);
   }
 
   layer_size = atoi(argv[1]);
+  if (argc == 5) {
+    batch_size = atoi(argv[2]);
+    num_epochs = atoi(argv[3]);
+    num_patterns = atoi(argv[4]);
+    if (num_epochs < 1 || num_patterns < 1) {
+      fprintf(stderr, "backprop: epochs and patterns must be > 0\n");
+      exit(0);
+    }
+  }
   
   int seed;
 
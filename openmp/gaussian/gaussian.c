@@ -0,0 +1,501 @@
+/*-----------------------------------------------------------
+ ** gaussian.c -- The program is to solve a linear system Ax = b
+ **   by using Gaussian Elimination. The algorithm on page 101
+ **   ("Foundations of Parallel Programming") is used.
+ **   ForwardSub() is the sequential version: the loops of the
+ **   Fan1/Fan2 kernels of the CUDA version (cuda/gaussian).
+ **   ForwardSubBlocked() is the OpenMP version: right-looking
+ **   blocked elimination of panels of BLOCK_SIZE columns, the
+ **   updates of the trailing columns run as OpenMP tasks.
+ **
+ ** Written by Andreas Kura, 02/15/95
+ ** Modified by Chong-wei Xu, 04/20/95
+ ** Modified by Chris Gregg for CUDA, 07/20/2009
+ **-----------------------------------------------------------
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+
+/* columns of a panel, and of a strip of trailing columns per task */
+#ifndef BLOCK_SIZE
+#define BLOCK_SIZE 64
+#endif
+
+int Size;
+float *a, *b, *finalVec;
+float *m;
+
+FILE *fp;
+
+int block_size = BLOCK_SIZE;
+
+void InitProblemOnce(char *filename);
+void InitPerRun();
+void ForwardSub();
+void ForwardSubBlocked();
+void BackSub();
+void InitMat(float *ary, int nrow, int ncol);
+void InitAry(float *ary, int ary_size);
+void PrintMat(float *ary, int nrow, int ncolumn);
+void PrintAry(float *ary, int ary_size);
+
+// create both matrix and right hand side, Ke Wang 2013/08/12 11:51:06
+void
+create_matrix(float *m, int size){
+  int i,j;
+  float lamda = -0.01;
+  float coe[2*size-1];
+  float coe_i =0.0;
+
+  for (i=0; i < size; i++)
+    {
+      coe_i = 10*exp(lamda*i);
+      j=size-1+i;
+      coe[j]=coe_i;
+      j=size-1-i;
+      coe[j]=coe_i;
+    }
+
+
+  for (i=0; i < size; i++) {
+      for (j=0; j < size; j++) {
+	m[i*size+j]=coe[size-1-i+j];
+      }
+  }
+
+
+}
+
+double gettime() {
+	struct timeval t;
+	gettimeofday(&t, NULL);
+	return t.tv_sec + t.tv_usec * 1e-6;
+}
+
+/* floating point operations of ForwardSub (divisions included) */
+double ForwardSubFlops(int n)
+{
+	double flops = 0;
+	int t;
+	for (t=0; t<n-1; t++)
+		flops += (n-1-t) * (1.0 + 2.0*(n-t) + 2.0);
+	return flops;
+}
+
+/* largest difference of x and y, relative to the largest magnitude in x */
+double MaxRelDiff(float *x, float *y, int n)
+{
+	double diff = 0, norm = 0;
+	int i;
+	for (i=0; i<n; i++) {
+		if (fabs(x[i] - y[i]) > diff) diff = fabs(x[i] - y[i]);
+		if (fabs(x[i]) > norm) norm = fabs(x[i]);
+	}
+	return norm > 0 ? diff / norm : diff;
+}
+
+int main(int argc, char *argv[])
+{
+    int verbose = 1;
+    int verify = 0;
+    int i, j;
+    char flag;
+    if (argc < 2) {
+        printf("Usage: gaussian -f filename / -s size [-q] [-v] [-n threads] [-b block]\n\n");
+        printf("-q (quiet) suppresses printing the matrix and result values.\n");
+        printf("-f (filename) path of input file\n");
+        printf("-s (size) size of matrix. Create matrix and rhs in this program \n");
+        printf("-v (verify) check the result against the sequential elimination\n");
+        printf("-n (threads) number of OpenMP threads\n");
+        printf("-b (block) columns per panel of the blocked elimination, default %d\n", BLOCK_SIZE);
+        printf("The first line of the file contains the dimension of the matrix, n.");
+        printf("The second line of the file is a newline.\n");
+        printf("The next n lines contain n tab separated values for the matrix.");
+        printf("The next line of the file is a newline.\n");
+        printf("The next line of the file is a 1xn vector with tab separated values.\n");
+        printf("The next line of the file is a newline. (optional)\n");
+        printf("The final line of the file is the pre-computed solution. (optional)\n");
+        printf("Example: matrix4.txt:\n");
+        printf("4\n");
+        printf("\n");
+        printf("-0.6	-0.5	0.7	0.3\n");
+        printf("-0.3	-0.9	0.3	0.7\n");
+        printf("-0.4	-0.5	-0.3	-0.8\n");
+        printf("0.0	-0.1	0.2	0.9\n");
+        printf("\n");
+        printf("-0.85	-0.68	0.24	-0.53\n");
+        printf("\n");
+        printf("0.7	0.0	-0.4	-0.5\n");
+        exit(0);
+    }
+
+    for(i=1;i<argc;i++) {
+      if (argv[i][0]=='-') {// flag
+        flag = argv[i][1];
+          switch (flag) {
+            case 's': // size
+              i++;
+              Size = atoi(argv[i]);
+	      printf("Create matrix internally in parse, size = %d \n", Size);
+
+	      a = (float *) malloc(Size * Size * sizeof(float));
+	      create_matrix(a, Size);
+
+	      b = (float *) malloc(Size * sizeof(float));
+	      for (j =0; j< Size; j++)
+	    	b[j]=1.0;
+
+	      m = (float *) malloc(Size * Size * sizeof(float));
+              break;
+            case 'f': // file
+              i++;
+	      printf("Read file from %s \n", argv[i]);
+	      InitProblemOnce(argv[i]);
+              break;
+            case 'q': // quiet
+	      verbose = 0;
+              break;
+            case 'v': // verify
+	      verify = 1;
+              break;
+            case 'n': // threads
+              i++;
+	      omp_set_num_threads(atoi(argv[i]));
+              break;
+            case 'b': // block size
+              i++;
+	      block_size = atoi(argv[i]);
+	      if (block_size < 1) block_size = BLOCK_SIZE;
+              break;
+	  }
+      }
+    }
+    if (Size < 1) {
+        printf("No matrix, use -f filename or -s size\n");
+        exit(1);
+    }
+    printf("%d threads, block size %d\n", omp_get_max_threads(), block_size);
+
+    /* keep the input for the sequential elimination */
+    float *a0 = NULL, *b0 = NULL;
+    if (verify) {
+        a0 = (float *) malloc(Size * Size * sizeof(float));
+        b0 = (float *) malloc(Size * sizeof(float));
+        memcpy(a0, a, Size * Size * sizeof(float));
+        memcpy(b0, b, Size * sizeof(float));
+    }
+
+    InitPerRun();
+    //begin timing
+    double time_start = gettime();
+
+    ForwardSubBlocked();
+
+    //end timing
+    double time_total = gettime() - time_start;
+
+    if (verbose) {
+        printf("Matrix m is: \n");
+        PrintMat(m, Size, Size);
+
+        printf("Matrix a is: \n");
+        PrintMat(a, Size, Size);
+
+        printf("Array b is: \n");
+        PrintAry(b, Size);
+    }
+    BackSub();
+    if (verbose) {
+        printf("The final solution is: \n");
+        PrintAry(finalVec,Size);
+    }
+    printf("\nTime for ForwardSub (blocked, OpenMP)\t%f sec\t%.2f GFLOP/s\n",
+           time_total, ForwardSubFlops(Size) / time_total * 1e-9);
+
+    if (verify) {
+        /* the same problem through the sequential path */
+        float *a1 = a, *b1 = b, *m1 = m, *x1 = finalVec;
+        a = a0; b = b0;
+        m = (float *) malloc(Size * Size * sizeof(float));
+        InitPerRun();
+        time_start = gettime();
+        ForwardSub();
+        double time_serial = gettime() - time_start;
+        BackSub();
+        printf("Time for ForwardSub (sequential)\t%f sec\t%.2f GFLOP/s\n",
+               time_serial, ForwardSubFlops(Size) / time_serial * 1e-9);
+
+        double da = MaxRelDiff(a, a1, Size * Size);
+        double dm = MaxRelDiff(m, m1, Size * Size);
+        double db = MaxRelDiff(b, b1, Size);
+        double dx = MaxRelDiff(finalVec, x1, Size);
+        printf("Max relative difference to sequential: a %g, m %g, b %g, solution %g\n",
+               da, dm, db, dx);
+        printf("Verification %s\n",
+               (da <= 1e-5 && dm <= 1e-5 && db <= 1e-5 && dx <= 1e-4) ? "PASSED" : "FAILED");
+
+        free(a1); free(b1); free(m1); free(x1);
+    }
+
+    free(m);
+    free(a);
+    free(b);
+    free(finalVec);
+}
+
+/*------------------------------------------------------
+ ** InitProblemOnce -- Initialize all of matrices and
+ ** vectors by opening a data file specified by the user.
+ **
+ ** We used dynamic array *a, *b, and *m to allocate
+ ** the memory storages.
+ **------------------------------------------------------
+ */
+void InitProblemOnce(char *filename)
+{
+	fp = fopen(filename, "r");
+	if (fp == NULL) {
+		perror(filename);
+		exit(1);
+	}
+
+	if (fscanf(fp, "%d", &Size) != 1) Size = 0;
+
+	a = (float *) malloc(Size * Size * sizeof(float));
+
+	InitMat(a, Size, Size);
+	b = (float *) malloc(Size * sizeof(float));
+
+	InitAry(b, Size);
+
+	m = (float *) malloc(Size * Size * sizeof(float));
+	fclose(fp);
+}
+
+/*------------------------------------------------------
+ ** InitPerRun() -- Initialize the contents of the
+ ** multipier matrix **m
+ **------------------------------------------------------
+ */
+void InitPerRun()
+{
+	int i;
+	for (i=0; i<Size*Size; i++)
+			*(m+i) = 0.0;
+}
+
+/*------------------------------------------------------
+ ** ForwardSub() -- Forward substitution of Gaussian
+ ** elimination, sequentially: Fan1 (multipliers of
+ ** column t) and Fan2 (update of rows below t) per t.
+ **------------------------------------------------------
+ */
+void ForwardSub()
+{
+	int t, i, j;
+
+	for (t=0; t<(Size-1); t++) {
+		for (i=t+1; i<Size; i++)
+			m[Size*i+t] = a[Size*i+t] / a[Size*t+t];
+		for (i=t+1; i<Size; i++) {
+			for (j=t; j<Size; j++)
+				a[Size*i+j] -= m[Size*i+t] * a[Size*t+j];
+			b[i] -= m[Size*i+t] * b[t];
+		}
+	}
+}
+
+/*-------------------------------------------------------
+ ** FactorPanel() -- Fan1 and Fan2 of columns c0 to c1-1,
+ ** restricted to those columns
+ **-------------------------------------------------------
+ */
+static void FactorPanel(int c0, int c1)
+{
+	int t, i, j;
+
+	for (t=c0; t<c1; t++) {
+		const float *at = a + Size*t;
+		for (i=t+1; i<Size; i++) {
+			float *ai = a + Size*i;
+			float mi = ai[t] / at[t];
+			m[Size*i+t] = mi;
+			for (j=t; j<c1; j++)
+				ai[j] -= mi * at[j];
+		}
+	}
+}
+
+/*-------------------------------------------------------
+ ** UpdateStrip() -- Fan2 of panel columns c0 to c1-1 on
+ ** columns j0 to j1-1: the rows of the panel, then the
+ ** rows below it four at a time, so a row of the panel
+ ** is loaded once for four rows. Every element takes
+ ** the updates in the order of ForwardSub().
+ **-------------------------------------------------------
+ */
+static void UpdateStrip(int c0, int c1, int j0, int j1)
+{
+	int t, i, j;
+
+	for (t=c0; t<c1; t++) {
+		const float *at = a + Size*t;
+		for (i=t+1; i<c1; i++) {
+			float *ai = a + Size*i;
+			float mi = m[Size*i+t];
+			for (j=j0; j<j1; j++)
+				ai[j] -= mi * at[j];
+		}
+	}
+
+	for (i=c1; i+4<=Size; i+=4) {
+		float *a0 = a + Size*i, *a1 = a0 + Size, *a2 = a1 + Size, *a3 = a2 + Size;
+		const float *m0 = m + Size*i, *m1 = m0 + Size, *m2 = m1 + Size, *m3 = m2 + Size;
+		for (t=c0; t<c1; t++) {
+			const float *at = a + Size*t;
+			float u0 = m0[t], u1 = m1[t], u2 = m2[t], u3 = m3[t];
+			#pragma omp simd
+			for (j=j0; j<j1; j++) {
+				float u = at[j];
+				a0[j] -= u0 * u;
+				a1[j] -= u1 * u;
+				a2[j] -= u2 * u;
+				a3[j] -= u3 * u;
+			}
+		}
+	}
+	for (; i<Size; i++) {
+		float *ai = a + Size*i;
+		for (t=c0; t<c1; t++) {
+			const float *at = a + Size*t;
+			float mi = m[Size*i+t];
+			#pragma omp simd
+			for (j=j0; j<j1; j++)
+				ai[j] -= mi * at[j];
+		}
+	}
+}
+
+/*------------------------------------------------------
+ ** ForwardSubBlocked() -- Forward substitution of
+ ** Gaussian elimination, right-looking and blocked.
+ ** Panel k is factored once the strip of its columns
+ ** has taken the updates of panel k-1, the strips to
+ ** the right are then updated by one task each (task
+ ** dependences on the strips), so panels factor while
+ ** updates of earlier panels still run.
+ **------------------------------------------------------
+ */
+void ForwardSubBlocked()
+{
+	int nb = block_size;
+	int blocks = (Size + nb - 1) / nb;
+	char *strip = (char *) malloc(blocks);
+	int i, t;
+
+	#pragma omp parallel
+	#pragma omp single
+	{
+		int k, s;
+		for (k=0; k<blocks; k++) {
+			int c0 = k*nb;
+			int c1 = c0 + nb < Size ? c0 + nb : Size;
+
+			#pragma omp task depend(inout: strip[k]) firstprivate(c0, c1)
+			FactorPanel(c0, c1);
+
+			for (s=k+1; s<blocks; s++) {
+				int j0 = s*nb;
+				int j1 = j0 + nb < Size ? j0 + nb : Size;
+				#pragma omp task depend(in: strip[k]) depend(inout: strip[s]) firstprivate(c0, c1, j0, j1)
+				UpdateStrip(c0, c1, j0, j1);
+			}
+		}
+	}
+	free(strip);
+
+	/* Fan2 of b, a row at a time: the same updates in the same order */
+	for (i=1; i<Size; i++)
+		for (t=0; t<i; t++)
+			b[i] -= m[Size*i+t] * b[t];
+}
+
+/*------------------------------------------------------
+ ** BackSub() -- Backward substitution
+ **------------------------------------------------------
+ */
+
+void BackSub()
+{
+	// create a new vector to hold the final answer
+	finalVec = (float *) malloc(Size * sizeof(float));
+	// solve "bottom up"
+	int i,j;
+	for(i=0;i<Size;i++){
+		finalVec[Size-i-1]=b[Size-i-1];
+		for(j=0;j<i;j++)
+		{
+			finalVec[Size-i-1]-=*(a+Size*(Size-i-1)+(Size-j-1)) * finalVec[Size-j-1];
+		}
+		finalVec[Size-i-1]=finalVec[Size-i-1]/ *(a+Size*(Size-i-1)+(Size-i-1));
+	}
+}
+
+void InitMat(float *ary, int nrow, int ncol)
+{
+	int i, j;
+
+	for (i=0; i<nrow; i++) {
+		for (j=0; j<ncol; j++) {
+			if (fscanf(fp, "%f",  ary+Size*i+j) != 1) ary[Size*i+j] = 0;
+		}
+	}
+}
+
+/*------------------------------------------------------
+ ** PrintMat() -- Print the contents of the matrix
+ **------------------------------------------------------
+ */
+void PrintMat(float *ary, int nrow, int ncol)
+{
+	int i, j;
+
+	for (i=0; i<nrow; i++) {
+		for (j=0; j<ncol; j++) {
+			printf("%8.2f ", *(ary+Size*i+j));
+		}
+		printf("\n");
+	}
+	printf("\n");
+}
+
+/*------------------------------------------------------
+ ** InitAry() -- Initialize the array (vector) by reading
+ ** data from the data file
+ **------------------------------------------------------
+ */
+void InitAry(float *ary, int ary_size)
+{
+	int i;
+
+	for (i=0; i<ary_size; i++) {
+		if (fscanf(fp, "%f",  &ary[i]) != 1) ary[i] = 0;
+	}
+}
+
+/*------------------------------------------------------
+ ** PrintAry() -- Print the contents of the array (vector)
+ **------------------------------------------------------
+ */
+void PrintAry(float *ary, int ary_size)
+{
+	int i;
+	for (i=0; i<ary_size; i++) {
+		printf("%.2f ", ary[i]);
+	}
+	printf("\n\n");
+}
@@ -139,6 +139,50 @@ fp* get_frame(	avi_t* cell_file,
 
 } 
 
+// Same as get_frame (uncropped), but decodes into caller-provided buffers so that they can be reused
+// from frame to frame: image_buf holds width*height chars, result width*height fp values
+void get_frame_into(	avi_t* cell_file, 
+							int frame_num, 
+							int scaled,
+							int converted,
+							char* image_buf,
+							fp* result) {
+
+	// variable
+	int dummy;
+	int width = AVI_video_width(cell_file);
+	int height = AVI_video_height(cell_file);
+	int status;
+	int i, j;
+	fp scale = scaled ? 1.0 / 255.0 : 1.0;
+	fp temp;
+
+	// read in the frame from the AVI
+	AVI_set_video_position(cell_file, frame_num);
+	status = AVI_read_frame(cell_file, image_buf, &dummy);
+	if(status == -1) {
+		AVI_print_error((char*) "Error with AVI_read_frame");
+		exit(-1);
+	}
+
+	// flip (the image is read in upside-down), scale and store row-major or column-major (converted) in one pass
+	for(i = 0; i <height; i++){				// rows
+		for(j = 0; j <width; j++){			// colums
+			temp = (fp) image_buf[((height - 1 - i) * width) + j] * scale;
+			if(temp<0){
+				temp = temp + 256;
+			}
+			if(converted==1){
+				result[j*height+i] = temp;
+			}
+			else{
+				result[i*width+j] = temp;
+			}
+		}
+	}
+
+}
+
 // #ifdef __cplusplus
 // }
 // #endif
@@ -26,6 +26,13 @@ fp* get_frame(	avi_t* cell_file,
 						int scaled,
 						int converted) ;
 
+void get_frame_into(	avi_t* cell_file, 
+							int frame_num, 
+							int scaled,
+							int converted,
+							char* image_buf,
+							fp* result) ;
+
 #ifdef __cplusplus
 }
 #endif
@@ -8,6 +8,9 @@
 #define ENDO_POINTS 20
 #define EPI_POINTS 31
 #define ALL_POINTS 51
+#define SUMS_BLOCK 16																// rows per thread block in the horizontal pass of the integral images
+#define FFT_OPS 2																	// cost of one FFT butterfly per element and stage, relative to a multiply-add
+#define DECODE_DEPTH 3																// frame buffers in the decoder ring, frames decoded ahead of tracking
 
 //===============================================================================================================================================================================================================
 //===============================================================================================================================================================================================================
@@ -198,6 +201,30 @@ typedef struct public_struct{
 	int mask_conv_ioffset;
 	int mask_conv_joffset;
 
+	//======================================================================================================================================================
+	//	SHARED FRAME SUMS
+	//======================================================================================================================================================
+
+	int sums;																		// 0 - cumulative sums of padded copies per point, 1 - integral images shared by all points
+	int sum_rows;
+	int sum_cols;
+	int sum_elem;
+	int sum_mem;
+	double* d_frame_sum;
+	double* d_frame_sqr_sum;
+
+	//======================================================================================================================================================
+	//	FFT CONVOLUTION
+	//======================================================================================================================================================
+
+	int conv_fft;																	// 0 - direct convolution, 1 - convolution through FFT
+	int fft_rows;
+	int fft_cols;
+	int fft_scratch_elem;															// doubles of scratch per thread
+	double* d_fft_w_rows;
+	double* d_fft_w_cols;
+	double* d_fft_scratch;
+
 }public_struct;
 
 //===============================================================================================================================================================================================================
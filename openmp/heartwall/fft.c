@@ -0,0 +1,223 @@
+//===============================================================================================================================================================================================================
+//===============================================================================================================================================================================================================
+//	FFT FUNCTIONS
+//===============================================================================================================================================================================================================
+//===============================================================================================================================================================================================================
+
+//======================================================================================================================================================
+//	SIZE
+//======================================================================================================================================================
+
+// smallest power of 2 that fits n
+
+int fft_size(int n){
+
+	int size = 1;
+
+	while(size < n){
+		size = size * 2;
+	}
+
+	return size;
+
+}
+
+//======================================================================================================================================================
+//	TWIDDLE FACTORS
+//======================================================================================================================================================
+
+// exp(-2*pi*i*k/n) for k < n/2, interleaved re/im, shared by all transforms of length n
+
+void fft_twiddle(	double* w,
+						int n){
+
+	int k;
+
+	for(k=0; k<n/2; k++){
+		w[2*k]   =  cos(2*M_PI*k/n);
+		w[2*k+1] = -sin(2*M_PI*k/n);
+	}
+
+}
+
+//======================================================================================================================================================
+//	1D TRANSFORM
+//======================================================================================================================================================
+
+// in-place iterative radix-2 transform of n interleaved complex values, inverse is unscaled
+
+void fft_1d(	double* x,
+				int n,
+				double* w,
+				int inverse){
+
+	int i, j, k;
+	int len, half, step;
+	double tr, ti, ur, ui, wr, wi;
+
+	// bit reversal permutation
+	for(i=1, j=0; i<n; i++){
+		k = n >> 1;
+		while(j & k){
+			j = j ^ k;
+			k = k >> 1;
+		}
+		j = j ^ k;
+		if(i < j){
+			tr = x[2*i];   x[2*i]   = x[2*j];   x[2*j]   = tr;
+			ti = x[2*i+1]; x[2*i+1] = x[2*j+1]; x[2*j+1] = ti;
+		}
+	}
+
+	// butterflies
+	for(len=2; len<=n; len=len*2){
+		half = len/2;
+		step = n/len;
+		for(i=0; i<n; i=i+len){
+			for(k=0; k<half; k++){
+				wr = w[2*k*step];
+				wi = inverse ? -w[2*k*step+1] : w[2*k*step+1];
+				ur = x[2*(i+k)];
+				ui = x[2*(i+k)+1];
+				tr = x[2*(i+k+half)]*wr - x[2*(i+k+half)+1]*wi;
+				ti = x[2*(i+k+half)]*wi + x[2*(i+k+half)+1]*wr;
+				x[2*(i+k)]        = ur + tr;
+				x[2*(i+k)+1]      = ui + ti;
+				x[2*(i+k+half)]   = ur - tr;
+				x[2*(i+k+half)+1] = ui - ti;
+			}
+		}
+	}
+
+}
+
+//======================================================================================================================================================
+//	2D TRANSFORM
+//======================================================================================================================================================
+
+// column-major rows x cols complex array, rows are gathered into line (2*cols doubles) before transforming
+
+void fft_2d(	double* x,
+				int rows,
+				int cols,
+				double* w_rows,
+				double* w_cols,
+				double* line,
+				int inverse){
+
+	int row, col;
+
+	// columns are contiguous
+	for(col=0; col<cols; col++){
+		fft_1d(&x[2*col*rows], rows, w_rows, inverse);
+	}
+
+	// rows are strided
+	for(row=0; row<rows; row++){
+		for(col=0; col<cols; col++){
+			line[2*col]   = x[2*(col*rows+row)];
+			line[2*col+1] = x[2*(col*rows+row)+1];
+		}
+		fft_1d(line, cols, w_cols, inverse);
+		for(col=0; col<cols; col++){
+			x[2*(col*rows+row)]   = line[2*col];
+			x[2*(col*rows+row)+1] = line[2*col+1];
+		}
+	}
+
+}
+
+//======================================================================================================================================================
+//	FULL CONVOLUTION
+//======================================================================================================================================================
+
+// full 2D convolution of two real column-major inputs, a goes into the real and b into the imaginary part of a single
+// complex transform and the product spectrum is separated using the symmetry of real transforms:
+// A(k)B(k) = (Z(k)^2 - conj(Z(-k))^2) / 4i. Scratch x holds 2*fft_rows*fft_cols doubles, line 2*fft_cols doubles.
+
+void fft_conv(	fp* a,
+					int a_rows,
+					int a_cols,
+					fp* b,
+					int b_rows,
+					int b_cols,
+					fp* out,
+					int out_rows,
+					int out_cols,
+					int fft_rows,
+					int fft_cols,
+					double* w_rows,
+					double* w_cols,
+					double* x,
+					double* line){
+
+	int row, col;
+	int nrow, ncol;
+	int k, nk;
+	double zr, zi, nr, ni;
+	double pr, pi, qr, qi;
+	double scale;
+
+	//====================================================================================================
+	//	PACK
+	//====================================================================================================
+
+	memset(x, 0, sizeof(double) * 2 * fft_rows * fft_cols);
+	for(col=0; col<a_cols; col++){
+		for(row=0; row<a_rows; row++){
+			x[2*(col*fft_rows+row)] = a[col*a_rows+row];
+		}
+	}
+	for(col=0; col<b_cols; col++){
+		for(row=0; row<b_rows; row++){
+			x[2*(col*fft_rows+row)+1] = b[col*b_rows+row];
+		}
+	}
+
+	//====================================================================================================
+	//	FORWARD, PRODUCT OF SPECTRA, INVERSE
+	//====================================================================================================
+
+	fft_2d(x, fft_rows, fft_cols, w_rows, w_cols, line, 0);
+
+	for(col=0; col<fft_cols; col++){
+		ncol = (fft_cols - col) % fft_cols;
+		for(row=0; row<fft_rows; row++){
+			nrow = (fft_rows - row) % fft_rows;
+			k = col*fft_rows+row;
+			nk = ncol*fft_rows+nrow;
+			if(nk < k){
+				continue;															// pair already done
+			}
+
+			zr = x[2*k];  zi = x[2*k+1];
+			nr = x[2*nk]; ni = x[2*nk+1];
+
+			// (Z(k)^2 - conj(Z(-k))^2) / 4i
+			pr = (zr*zr - zi*zi) - (nr*nr - ni*ni);
+			pi = 2*zr*zi + 2*nr*ni;
+			// (Z(-k)^2 - conj(Z(k))^2) / 4i
+			qr = (nr*nr - ni*ni) - (zr*zr - zi*zi);
+			qi = 2*nr*ni + 2*zr*zi;
+
+			x[2*k]    =  pi/4;
+			x[2*k+1]  = -pr/4;
+			x[2*nk]   =  qi/4;
+			x[2*nk+1] = -qr/4;
+		}
+	}
+
+	fft_2d(x, fft_rows, fft_cols, w_rows, w_cols, line, 1);
+
+	//====================================================================================================
+	//	UNPACK
+	//====================================================================================================
+
+	scale = 1.0 / ((double)fft_rows * fft_cols);
+	for(col=0; col<out_cols; col++){
+		for(row=0; row<out_rows; row++){
+			out[col*out_rows+row] = x[2*(col*fft_rows+row)] * scale;
+		}
+	}
+
+}
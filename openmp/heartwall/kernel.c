@@ -62,6 +62,11 @@ void kernel(public_struct public,
 	int ori_pointer;
 	int loc_pointer;
 	int ei_mod;
+	int sum_row1, sum_row2;
+	int sum_col1, sum_col2;
+	double local_sum1;
+	double local_sum2;
+	double* fft_scratch;
 
 	//======================================================================================================================================================
 	//	GENERATE TEMPLATE
@@ -187,317 +192,406 @@ void kernel(public_struct public,
 		//	1) CONVOLVE INPUT 2 WITH ROTATED INPUT 1					SAVE IN d_conv
 		//====================================================================================================
 
-		// work
-		for(col=1; col<=public.conv_cols; col++){
-
-			// column setup
-			j = col + public.joffset;
-			jp1 = j + 1;
-			if(public.in2_cols < jp1){
-				ja1 = jp1 - public.in2_cols;
-			}
-			else{
-				ja1 = 1;
-			}
-			if(public.in_mod_cols < j){
-				ja2 = public.in_mod_cols;
-			}
-			else{
-				ja2 = j;
-			}
+		// direct convolution
+		if(public.conv_fft == 0){
 
-			for(row=1; row<=public.conv_rows; row++){
+			// work
+			for(col=1; col<=public.conv_cols; col++){
 
-				// row range setup
-				i = row + public.ioffset;
-				ip1 = i + 1;
-				
-				if(public.in2_rows < ip1){
-					ia1 = ip1 - public.in2_rows;
+				// column setup
+				j = col + public.joffset;
+				jp1 = j + 1;
+				if(public.in2_cols < jp1){
+					ja1 = jp1 - public.in2_cols;
 				}
 				else{
-					ia1 = 1;
+					ja1 = 1;
 				}
-				if(public.in_mod_rows < i){
-					ia2 = public.in_mod_rows;
+				if(public.in_mod_cols < j){
+					ja2 = public.in_mod_cols;
 				}
 				else{
-					ia2 = i;
+					ja2 = j;
 				}
 
-				s = 0;
+				for(row=1; row<=public.conv_rows; row++){
 
-				// getting data
-				for(ja=ja1; ja<=ja2; ja++){
-					jb = jp1 - ja;
-					for(ia=ia1; ia<=ia2; ia++){
-						ib = ip1 - ia;
-						s = s + private.d_in_mod[public.in_mod_rows*(ja-1)+ia-1] * private.d_in2[public.in2_rows*(jb-1)+ib-1];
+					// row range setup
+					i = row + public.ioffset;
+					ip1 = i + 1;
+				
+					if(public.in2_rows < ip1){
+						ia1 = ip1 - public.in2_rows;
+					}
+					else{
+						ia1 = 1;
+					}
+					if(public.in_mod_rows < i){
+						ia2 = public.in_mod_rows;
+					}
+					else{
+						ia2 = i;
 					}
-				}
-
-				private.d_conv[(col-1)*public.conv_rows+(row-1)] = s;
 
-		}
-	}
-		//====================================================================================================
-		//	LOCAL SUM 1
-		//====================================================================================================
+					s = 0;
 
-		//==================================================
-		//	1) PADD ARRAY										SAVE IN d_in2_pad
-		//==================================================
+					// getting data
+					for(ja=ja1; ja<=ja2; ja++){
+						jb = jp1 - ja;
+						for(ia=ia1; ia<=ia2; ia++){
+							ib = ip1 - ia;
+							s = s + private.d_in_mod[public.in_mod_rows*(ja-1)+ia-1] * private.d_in2[public.in2_rows*(jb-1)+ib-1];
+						}
+					}
 
-		// work
-		for(col=0; col<public.in2_pad_cols; col++){
-			for(row=0; row<public.in2_pad_rows; row++){
+					private.d_conv[(col-1)*public.conv_rows+(row-1)] = s;
 
-			// execution
-			if(	row > (public.in2_pad_add_rows-1) &&														// do if has numbers in original array
-				row < (public.in2_pad_add_rows+public.in2_rows) && 
-				col > (public.in2_pad_add_cols-1) && 
-				col < (public.in2_pad_add_cols+public.in2_cols)){
-				ori_row = row - public.in2_pad_add_rows;
-				ori_col = col - public.in2_pad_add_cols;
-				private.d_in2_pad[col*public.in2_pad_rows+row] = private.d_in2[ori_col*public.in2_rows+ori_row];
-			}
-			else{																			// do if otherwise
-				private.d_in2_pad[col*public.in2_pad_rows+row] = 0;
 			}
+		}
 
-			}
 		}
+		// convolution through FFT, this thread's slice of the scratch
+		else{
+
+			fft_scratch = &public.d_fft_scratch[omp_get_thread_num()*public.fft_scratch_elem];
+
+			fft_conv(	private.d_in_mod,
+							public.in_mod_rows,
+							public.in_mod_cols,
+							private.d_in2,
+							public.in2_rows,
+							public.in2_cols,
+							private.d_conv,
+							public.conv_rows,
+							public.conv_cols,
+							public.fft_rows,
+							public.fft_cols,
+							public.d_fft_w_rows,
+							public.d_fft_w_cols,
+							fft_scratch,
+							&fft_scratch[2*public.fft_rows*public.fft_cols]);
 
-		//==================================================
-		//	1) GET VERTICAL CUMULATIVE SUM						SAVE IN d_in2_pad
-		//==================================================
+		}
 
-		for(ei_new = 0; ei_new < public.in2_pad_cols; ei_new++){
+		//====================================================================================================
+		//	LOCAL SUMS FROM CUMULATIVE SUMS OF PADDED COPIES OF INPUT 2 (PER POINT)
+		//====================================================================================================
 
-			// figure out column position
-			pos_ori = ei_new*public.in2_pad_rows;
+		if(public.sums == 0){
 
-			// loop through all rows
-			sum = 0;
-			for(position = pos_ori; position < pos_ori+public.in2_pad_rows; position = position + 1){
-				private.d_in2_pad[position] = private.d_in2_pad[position] + sum;
-				sum = private.d_in2_pad[position];
-			}
+			//====================================================================================================
+			//	LOCAL SUM 1
+			//====================================================================================================
 
-		}
+			//==================================================
+			//	1) PADD ARRAY										SAVE IN d_in2_pad
+			//==================================================
 
-		//==================================================
-		//	1) MAKE 1st SELECTION FROM VERTICAL CUMULATIVE SUM
-		//	2) MAKE 2nd SELECTION FROM VERTICAL CUMULATIVE SUM
-		//	3) SUBTRACT THE TWO SELECTIONS						SAVE IN d_in2_sub
-		//==================================================
+			// work
+			for(col=0; col<public.in2_pad_cols; col++){
+				for(row=0; row<public.in2_pad_rows; row++){
 
-		// work
-		for(col=0; col<public.in2_sub_cols; col++){
-			for(row=0; row<public.in2_sub_rows; row++){
+				// execution
+				if(	row > (public.in2_pad_add_rows-1) &&														// do if has numbers in original array
+					row < (public.in2_pad_add_rows+public.in2_rows) && 
+					col > (public.in2_pad_add_cols-1) && 
+					col < (public.in2_pad_add_cols+public.in2_cols)){
+					ori_row = row - public.in2_pad_add_rows;
+					ori_col = col - public.in2_pad_add_cols;
+					private.d_in2_pad[col*public.in2_pad_rows+row] = private.d_in2[ori_col*public.in2_rows+ori_row];
+				}
+				else{																			// do if otherwise
+					private.d_in2_pad[col*public.in2_pad_rows+row] = 0;
+				}
 
-			// figure out corresponding location in old matrix and copy values to new matrix
-			ori_row = row + public.in2_pad_cumv_sel_rowlow - 1;
-			ori_col = col + public.in2_pad_cumv_sel_collow - 1;
-			temp = private.d_in2_pad[ori_col*public.in2_pad_rows+ori_row];
+				}
+			}
 
-			// figure out corresponding location in old matrix and copy values to new matrix
-			ori_row = row + public.in2_pad_cumv_sel2_rowlow - 1;
-			ori_col = col + public.in2_pad_cumv_sel2_collow - 1;
-			temp2 = private.d_in2_pad[ori_col*public.in2_pad_rows+ori_row];
+			//==================================================
+			//	1) GET VERTICAL CUMULATIVE SUM						SAVE IN d_in2_pad
+			//==================================================
 
-			// subtraction
-			private.d_in2_sub[col*public.in2_sub_rows+row] = temp - temp2;
+			for(ei_new = 0; ei_new < public.in2_pad_cols; ei_new++){
+
+				// figure out column position
+				pos_ori = ei_new*public.in2_pad_rows;
+
+				// loop through all rows
+				sum = 0;
+				for(position = pos_ori; position < pos_ori+public.in2_pad_rows; position = position + 1){
+					private.d_in2_pad[position] = private.d_in2_pad[position] + sum;
+					sum = private.d_in2_pad[position];
+				}
 
 			}
-		}
 
-		//==================================================
-		//	1) GET HORIZONTAL CUMULATIVE SUM						SAVE IN d_in2_sub
-		//==================================================
+			//==================================================
+			//	1) MAKE 1st SELECTION FROM VERTICAL CUMULATIVE SUM
+			//	2) MAKE 2nd SELECTION FROM VERTICAL CUMULATIVE SUM
+			//	3) SUBTRACT THE TWO SELECTIONS						SAVE IN d_in2_sub
+			//==================================================
 
-		for(ei_new = 0; ei_new < public.in2_sub_rows; ei_new++){
+			// work
+			for(col=0; col<public.in2_sub_cols; col++){
+				for(row=0; row<public.in2_sub_rows; row++){
 
-			// figure out row position
-			pos_ori = ei_new;
+				// figure out corresponding location in old matrix and copy values to new matrix
+				ori_row = row + public.in2_pad_cumv_sel_rowlow - 1;
+				ori_col = col + public.in2_pad_cumv_sel_collow - 1;
+				temp = private.d_in2_pad[ori_col*public.in2_pad_rows+ori_row];
 
-			// loop through all rows
-			sum = 0;
-			for(position = pos_ori; position < pos_ori+public.in2_sub_elem; position = position + public.in2_sub_rows){
-				private.d_in2_sub[position] = private.d_in2_sub[position] + sum;
-				sum = private.d_in2_sub[position];
+				// figure out corresponding location in old matrix and copy values to new matrix
+				ori_row = row + public.in2_pad_cumv_sel2_rowlow - 1;
+				ori_col = col + public.in2_pad_cumv_sel2_collow - 1;
+				temp2 = private.d_in2_pad[ori_col*public.in2_pad_rows+ori_row];
+
+				// subtraction
+				private.d_in2_sub[col*public.in2_sub_rows+row] = temp - temp2;
+
+				}
 			}
 
-		}
+			//==================================================
+			//	1) GET HORIZONTAL CUMULATIVE SUM						SAVE IN d_in2_sub
+			//==================================================
 
-		//==================================================
-		//	1) MAKE 1st SELECTION FROM HORIZONTAL CUMULATIVE SUM
-		//	2) MAKE 2nd SELECTION FROM HORIZONTAL CUMULATIVE SUM
-		//	3) SUBTRACT THE TWO SELECTIONS TO GET LOCAL SUM 1
-		//	4) GET CUMULATIVE SUM 1 SQUARED						SAVE IN d_in2_sub2_sqr
-		//	5) GET NUMERATOR									SAVE IN d_conv
-		//==================================================
+			for(ei_new = 0; ei_new < public.in2_sub_rows; ei_new++){
 
-		// work
-		for(col=0; col<public.in2_sub2_sqr_cols; col++){
-			for(row=0; row<public.in2_sub2_sqr_rows; row++){
+				// figure out row position
+				pos_ori = ei_new;
 
-			// figure out corresponding location in old matrix and copy values to new matrix
-			ori_row = row + public.in2_sub_cumh_sel_rowlow - 1;
-			ori_col = col + public.in2_sub_cumh_sel_collow - 1;
-			temp = private.d_in2_sub[ori_col*public.in2_sub_rows+ori_row];
+				// loop through all rows
+				sum = 0;
+				for(position = pos_ori; position < pos_ori+public.in2_sub_elem; position = position + public.in2_sub_rows){
+					private.d_in2_sub[position] = private.d_in2_sub[position] + sum;
+					sum = private.d_in2_sub[position];
+				}
 
-			// figure out corresponding location in old matrix and copy values to new matrix
-			ori_row = row + public.in2_sub_cumh_sel2_rowlow - 1;
-			ori_col = col + public.in2_sub_cumh_sel2_collow - 1;
-			temp2 = private.d_in2_sub[ori_col*public.in2_sub_rows+ori_row];
+			}
+
+			//==================================================
+			//	1) MAKE 1st SELECTION FROM HORIZONTAL CUMULATIVE SUM
+			//	2) MAKE 2nd SELECTION FROM HORIZONTAL CUMULATIVE SUM
+			//	3) SUBTRACT THE TWO SELECTIONS TO GET LOCAL SUM 1
+			//	4) GET CUMULATIVE SUM 1 SQUARED						SAVE IN d_in2_sub2_sqr
+			//	5) GET NUMERATOR									SAVE IN d_conv
+			//==================================================
+
+			// work
+			for(col=0; col<public.in2_sub2_sqr_cols; col++){
+				for(row=0; row<public.in2_sub2_sqr_rows; row++){
+
+				// figure out corresponding location in old matrix and copy values to new matrix
+				ori_row = row + public.in2_sub_cumh_sel_rowlow - 1;
+				ori_col = col + public.in2_sub_cumh_sel_collow - 1;
+				temp = private.d_in2_sub[ori_col*public.in2_sub_rows+ori_row];
+
+				// figure out corresponding location in old matrix and copy values to new matrix
+				ori_row = row + public.in2_sub_cumh_sel2_rowlow - 1;
+				ori_col = col + public.in2_sub_cumh_sel2_collow - 1;
+				temp2 = private.d_in2_sub[ori_col*public.in2_sub_rows+ori_row];
 			
-			// subtraction
-			temp2 = temp - temp2;
+				// subtraction
+				temp2 = temp - temp2;
 
-			// squaring
-			private.d_in2_sub2_sqr[col*public.in2_sub2_sqr_rows+row] = temp2 * temp2; 
+				// squaring
+				private.d_in2_sub2_sqr[col*public.in2_sub2_sqr_rows+row] = temp2 * temp2; 
 
-			// numerator
-			private.d_conv[col*public.in2_sub2_sqr_rows+row] = private.d_conv[col*public.in2_sub2_sqr_rows+row] - temp2 * in_final_sum / public.in_mod_elem;
+				// numerator
+				private.d_conv[col*public.in2_sub2_sqr_rows+row] = private.d_conv[col*public.in2_sub2_sqr_rows+row] - temp2 * in_final_sum / public.in_mod_elem;
 
+				}
 			}
-		}
 
-		//====================================================================================================
-		//	LOCAL SUM 2
-		//====================================================================================================
+			//====================================================================================================
+			//	LOCAL SUM 2
+			//====================================================================================================
+
+			//==================================================
+			//	1) PAD ARRAY										SAVE IN d_in2_pad
+			//==================================================
+
+			// work
+			for(col=0; col<public.in2_pad_cols; col++){
+				for(row=0; row<public.in2_pad_rows; row++){
+
+				// execution
+				if(	row > (public.in2_pad_add_rows-1) &&													// do if has numbers in original array
+					row < (public.in2_pad_add_rows+public.in2_rows) && 
+					col > (public.in2_pad_add_cols-1) && 
+					col < (public.in2_pad_add_cols+public.in2_cols)){
+					ori_row = row - public.in2_pad_add_rows;
+					ori_col = col - public.in2_pad_add_cols;
+					private.d_in2_pad[col*public.in2_pad_rows+row] = private.d_in2_sqr[ori_col*public.in2_rows+ori_row];
+				}
+				else{																							// do if otherwise
+					private.d_in2_pad[col*public.in2_pad_rows+row] = 0;
+				}
 
-		//==================================================
-		//	1) PAD ARRAY										SAVE IN d_in2_pad
-		//==================================================
+				}
+			}
 
-		// work
-		for(col=0; col<public.in2_pad_cols; col++){
-			for(row=0; row<public.in2_pad_rows; row++){
+			//==================================================
+			//	2) GET VERTICAL CUMULATIVE SUM						SAVE IN d_in2_pad
+			//==================================================
 
-			// execution
-			if(	row > (public.in2_pad_add_rows-1) &&													// do if has numbers in original array
-				row < (public.in2_pad_add_rows+public.in2_rows) && 
-				col > (public.in2_pad_add_cols-1) && 
-				col < (public.in2_pad_add_cols+public.in2_cols)){
-				ori_row = row - public.in2_pad_add_rows;
-				ori_col = col - public.in2_pad_add_cols;
-				private.d_in2_pad[col*public.in2_pad_rows+row] = private.d_in2_sqr[ori_col*public.in2_rows+ori_row];
-			}
-			else{																							// do if otherwise
-				private.d_in2_pad[col*public.in2_pad_rows+row] = 0;
-			}
+			//work
+			for(ei_new = 0; ei_new < public.in2_pad_cols; ei_new++){
+
+				// figure out column position
+				pos_ori = ei_new*public.in2_pad_rows;
+
+				// loop through all rows
+				sum = 0;
+				for(position = pos_ori; position < pos_ori+public.in2_pad_rows; position = position + 1){
+					private.d_in2_pad[position] = private.d_in2_pad[position] + sum;
+					sum = private.d_in2_pad[position];
+				}
 
 			}
-		}
 
-		//==================================================
-		//	2) GET VERTICAL CUMULATIVE SUM						SAVE IN d_in2_pad
-		//==================================================
+			//==================================================
+			//	1) MAKE 1st SELECTION FROM VERTICAL CUMULATIVE SUM
+			//	2) MAKE 2nd SELECTION FROM VERTICAL CUMULATIVE SUM
+			//	3) SUBTRACT THE TWO SELECTIONS						SAVE IN d_in2_sub
+			//==================================================
 
-		//work
-		for(ei_new = 0; ei_new < public.in2_pad_cols; ei_new++){
+			// work
+			for(col=0; col<public.in2_sub_cols; col++){
+				for(row=0; row<public.in2_sub_rows; row++){
 
-			// figure out column position
-			pos_ori = ei_new*public.in2_pad_rows;
+				// figure out corresponding location in old matrix and copy values to new matrix
+				ori_row = row + public.in2_pad_cumv_sel_rowlow - 1;
+				ori_col = col + public.in2_pad_cumv_sel_collow - 1;
+				temp = private.d_in2_pad[ori_col*public.in2_pad_rows+ori_row];
 
-			// loop through all rows
-			sum = 0;
-			for(position = pos_ori; position < pos_ori+public.in2_pad_rows; position = position + 1){
-				private.d_in2_pad[position] = private.d_in2_pad[position] + sum;
-				sum = private.d_in2_pad[position];
-			}
+				// figure out corresponding location in old matrix and copy values to new matrix
+				ori_row = row + public.in2_pad_cumv_sel2_rowlow - 1;
+				ori_col = col + public.in2_pad_cumv_sel2_collow - 1;
+				temp2 = private.d_in2_pad[ori_col*public.in2_pad_rows+ori_row];
 
-		}
+				// subtract
+				private.d_in2_sub[col*public.in2_sub_rows+row] = temp - temp2;
 
-		//==================================================
-		//	1) MAKE 1st SELECTION FROM VERTICAL CUMULATIVE SUM
-		//	2) MAKE 2nd SELECTION FROM VERTICAL CUMULATIVE SUM
-		//	3) SUBTRACT THE TWO SELECTIONS						SAVE IN d_in2_sub
-		//==================================================
+				}
+			}
 
-		// work
-		for(col=0; col<public.in2_sub_cols; col++){
-			for(row=0; row<public.in2_sub_rows; row++){
+			//==================================================
+			//	1) GET HORIZONTAL CUMULATIVE SUM						SAVE IN d_in2_sub
+			//==================================================
 
-			// figure out corresponding location in old matrix and copy values to new matrix
-			ori_row = row + public.in2_pad_cumv_sel_rowlow - 1;
-			ori_col = col + public.in2_pad_cumv_sel_collow - 1;
-			temp = private.d_in2_pad[ori_col*public.in2_pad_rows+ori_row];
+			for(ei_new = 0; ei_new < public.in2_sub_rows; ei_new++){
 
-			// figure out corresponding location in old matrix and copy values to new matrix
-			ori_row = row + public.in2_pad_cumv_sel2_rowlow - 1;
-			ori_col = col + public.in2_pad_cumv_sel2_collow - 1;
-			temp2 = private.d_in2_pad[ori_col*public.in2_pad_rows+ori_row];
+				// figure out row position
+				pos_ori = ei_new;
 
-			// subtract
-			private.d_in2_sub[col*public.in2_sub_rows+row] = temp - temp2;
+				// loop through all rows
+				sum = 0;
+				for(position = pos_ori; position < pos_ori+public.in2_sub_elem; position = position + public.in2_sub_rows){
+					private.d_in2_sub[position] = private.d_in2_sub[position] + sum;
+					sum = private.d_in2_sub[position];
+				}
 
 			}
-		}
-
-		//==================================================
-		//	1) GET HORIZONTAL CUMULATIVE SUM						SAVE IN d_in2_sub
-		//==================================================
 
-		for(ei_new = 0; ei_new < public.in2_sub_rows; ei_new++){
+			//==================================================
+			//	1) MAKE 1st SELECTION FROM HORIZONTAL CUMULATIVE SUM
+			//	2) MAKE 2nd SELECTION FROM HORIZONTAL CUMULATIVE SUM
+			//	3) SUBTRACT THE TWO SELECTIONS TO GET LOCAL SUM 2
+			//	4) GET DIFFERENTIAL LOCAL SUM
+			//	5) GET DENOMINATOR A
+			//	6) GET DENOMINATOR
+			//	7) DIVIDE NUMBERATOR BY DENOMINATOR TO GET CORRELATION	SAVE IN d_conv
+			//==================================================
+
+			// work
+			for(col=0; col<public.conv_cols; col++){
+				for(row=0; row<public.conv_rows; row++){
+
+				// figure out corresponding location in old matrix and copy values to new matrix
+				ori_row = row + public.in2_sub_cumh_sel_rowlow - 1;
+				ori_col = col + public.in2_sub_cumh_sel_collow - 1;
+				temp = private.d_in2_sub[ori_col*public.in2_sub_rows+ori_row];
+
+				// figure out corresponding location in old matrix and copy values to new matrix
+				ori_row = row + public.in2_sub_cumh_sel2_rowlow - 1;
+				ori_col = col + public.in2_sub_cumh_sel2_collow - 1;
+				temp2 = private.d_in2_sub[ori_col*public.in2_sub_rows+ori_row];
+
+				// subtract
+				temp2 = temp - temp2;
+
+				// diff_local_sums
+				temp2 = temp2 - (private.d_in2_sub2_sqr[col*public.conv_rows+row] / public.in_mod_elem);
+
+				// denominator A
+				if(temp2 < 0){
+					temp2 = 0;
+				}
+				temp2 = sqrt(temp2);
 
-			// figure out row position
-			pos_ori = ei_new;
+				// denominator
+				temp2 = denomT * temp2;
+			
+				// correlation
+				private.d_conv[col*public.conv_rows+row] = private.d_conv[col*public.conv_rows+row] / temp2;
 
-			// loop through all rows
-			sum = 0;
-			for(position = pos_ori; position < pos_ori+public.in2_sub_elem; position = position + public.in2_sub_rows){
-				private.d_in2_sub[position] = private.d_in2_sub[position] + sum;
-				sum = private.d_in2_sub[position];
+				}
 			}
 
 		}
 
+		//====================================================================================================
+		//	LOCAL SUMS FROM INTEGRAL IMAGES OF THE FRAME (SHARED BY ALL POINTS)
+		//====================================================================================================
+
 		//==================================================
-		//	1) MAKE 1st SELECTION FROM HORIZONTAL CUMULATIVE SUM
-		//	2) MAKE 2nd SELECTION FROM HORIZONTAL CUMULATIVE SUM
-		//	3) SUBTRACT THE TWO SELECTIONS TO GET LOCAL SUM 2
-		//	4) GET DIFFERENTIAL LOCAL SUM
-		//	5) GET DENOMINATOR A
-		//	6) GET DENOMINATOR
-		//	7) DIVIDE NUMBERATOR BY DENOMINATOR TO GET CORRELATION	SAVE IN d_conv
+		//	1) GET LOCAL SUM 1 AND LOCAL SUM 2 (INPUT 2 UNDER TEMPLATE AT EVERY CONVOLUTION OFFSET)
+		//	2) GET NUMERATOR
+		//	3) GET DIFFERENTIAL LOCAL SUM, DENOMINATOR A, DENOMINATOR
+		//	4) DIVIDE NUMERATOR BY DENOMINATOR TO GET CORRELATION	SAVE IN d_conv
 		//==================================================
 
-		// work
-		for(col=0; col<public.conv_cols; col++){
-			for(row=0; row<public.conv_rows; row++){
+		else{
 
-			// figure out corresponding location in old matrix and copy values to new matrix
-			ori_row = row + public.in2_sub_cumh_sel_rowlow - 1;
-			ori_col = col + public.in2_sub_cumh_sel_collow - 1;
-			temp = private.d_in2_sub[ori_col*public.in2_sub_rows+ori_row];
+			// work
+			for(col=0; col<public.conv_cols; col++){
 
-			// figure out corresponding location in old matrix and copy values to new matrix
-			ori_row = row + public.in2_sub_cumh_sel2_rowlow - 1;
-			ori_col = col + public.in2_sub_cumh_sel2_collow - 1;
-			temp2 = private.d_in2_sub[ori_col*public.in2_sub_rows+ori_row];
+				// frame columns of input 2 covered by template at this offset
+				sum_col1 = in2_collow - 1 + (col > public.in_mod_cols-1 ? col - (public.in_mod_cols-1) : 0);
+				sum_col2 = in2_collow - 1 + (col < public.in2_cols-1 ? col : public.in2_cols-1);
 
-			// subtract
-			temp2 = temp - temp2;
+				for(row=0; row<public.conv_rows; row++){
 
-			// diff_local_sums
-			temp2 = temp2 - (private.d_in2_sub2_sqr[col*public.conv_rows+row] / public.in_mod_elem);
+				// frame rows of input 2 covered by template at this offset
+				sum_row1 = in2_rowlow - 1 + (row > public.in_mod_rows-1 ? row - (public.in_mod_rows-1) : 0);
+				sum_row2 = in2_rowlow - 1 + (row < public.in2_rows-1 ? row : public.in2_rows-1);
 
-			// denominator A
-			if(temp2 < 0){
-				temp2 = 0;
-			}
-			temp2 = sqrt(temp2);
+				// local sums
+				local_sum1 = local_sum(public.d_frame_sum, public.sum_rows, sum_row1, sum_row2, sum_col1, sum_col2);
+				local_sum2 = local_sum(public.d_frame_sqr_sum, public.sum_rows, sum_row1, sum_row2, sum_col1, sum_col2);
 
-			// denominator
-			temp2 = denomT * temp2;
-			
-			// correlation
-			private.d_conv[col*public.conv_rows+row] = private.d_conv[col*public.conv_rows+row] / temp2;
+				// numerator
+				temp = private.d_conv[col*public.conv_rows+row] - local_sum1 * in_final_sum / public.in_mod_elem;
 
+				// diff_local_sums
+				temp2 = local_sum2 - local_sum1 * local_sum1 / public.in_mod_elem;
+
+				// denominator A
+				if(temp2 < 0){
+					temp2 = 0;
+				}
+				temp2 = sqrt(temp2);
+
+				// denominator
+				temp2 = denomT * temp2;
+
+				// correlation
+				private.d_conv[col*public.conv_rows+row] = temp / temp2;
+
+				}
 			}
+
 		}
 
 		//====================================================================================================
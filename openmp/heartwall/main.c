@@ -14,7 +14,10 @@
 #include <omp.h>
 
 #include "define.c"
+#include "fft.c"
+#include "sums.c"
 #include "kernel.c"
+#include "pipeline.c"
 
 
 //===============================================================================================================================================================================================================200
@@ -104,6 +107,20 @@ int main(int argc, char *argv []){
 	int i;
 	int frames_processed;
 
+	// frame pipeline
+	frame_ring ring;
+	int decode_depth;
+
+	// per-frame timing
+	double time_start;
+	double time_total;
+	double time0;
+	double time_frame = 0;
+	double time_sums = 0;
+	double time_kernel = 0;
+	double direct_ops;
+	double fft_ops;
+
 	// parameters
 	public_struct public;
 	private_struct private[ALL_POINTS];
@@ -114,8 +131,8 @@ int main(int argc, char *argv []){
 
  	
 	
-	if(argc!=4){
-		printf("ERROR: usage: heartwall <inputfile> <num of frames> <num of threads>\n");
+	if(argc<4 || argc>6){
+		printf("ERROR: usage: heartwall <inputfile> <num of frames> <num of threads> [<kernel: 0 - per-point sums, direct convolution, 1 - shared frame sums, direct/FFT convolution (default)>] [<num of frames decoded ahead (default %d)>]\n", DECODE_DEPTH);
 		exit(1);
 	}
 	
@@ -154,6 +171,20 @@ int main(int argc, char *argv []){
 	}
 	
 	printf("num of threads: %d\n", omp_num_threads);
+
+	public.sums = 1;
+	if(argc >= 5){
+		public.sums = atoi(argv[4]) != 0;
+	}
+
+	decode_depth = DECODE_DEPTH;
+	if(argc >= 6){
+		decode_depth = atoi(argv[5]);
+	}
+	if(decode_depth <= 0){
+		printf("num of frames decoded ahead must be a positive integer");
+		return 0;
+	}
 	
 	//======================================================================================================================================================
 	//	INPUTS
@@ -515,6 +546,43 @@ int main(int argc, char *argv []){
 		private[i].d_mask_conv = (fp *)malloc(public.mask_conv_mem);
 	}
 
+	//======================================================================================================================================================
+	//	SHARED FRAME SUMS
+	//======================================================================================================================================================
+
+	public.sum_rows = public.frame_rows + 1;
+	public.sum_cols = public.frame_cols + 1;
+	public.sum_elem = public.sum_rows * public.sum_cols;
+	public.sum_mem = sizeof(double) * public.sum_elem;
+
+	if(public.sums == 1){
+		public.d_frame_sum = (double *)malloc(public.sum_mem);
+		public.d_frame_sqr_sum = (double *)malloc(public.sum_mem);
+	}
+
+	//======================================================================================================================================================
+	//	FFT CONVOLUTION
+	//======================================================================================================================================================
+
+	public.fft_rows = fft_size(public.conv_rows);
+	public.fft_cols = fft_size(public.conv_cols);
+	public.fft_scratch_elem = 2*public.fft_rows*public.fft_cols + 2*public.fft_cols;
+
+	// pick the cheaper convolution for this template size, multiply-adds of the direct sum against two complex transforms
+	direct_ops = (double)public.in_mod_elem * public.in2_elem;
+	fft_ops = 2 * FFT_OPS * (double)public.fft_rows * public.fft_cols * log2((double)public.fft_rows * public.fft_cols);
+	public.conv_fft = public.sums == 1 && fft_ops < direct_ops;
+
+	if(public.conv_fft == 1){
+		public.d_fft_w_rows = (double *)malloc(sizeof(double) * public.fft_rows);
+		public.d_fft_w_cols = (double *)malloc(sizeof(double) * public.fft_cols);
+		fft_twiddle(public.d_fft_w_rows, public.fft_rows);
+		fft_twiddle(public.d_fft_w_cols, public.fft_cols);
+		public.d_fft_scratch = (double *)malloc(sizeof(double) * public.fft_scratch_elem * omp_num_threads);
+	}
+
+	printf("kernel: %s frame sums, %s convolution\n", public.sums == 1 ? "shared" : "per-point", public.conv_fft == 1 ? "FFT" : "direct");
+
 	//======================================================================================================================================================
 	//	PRINT FRAME PROGRESS START
 	//======================================================================================================================================================
@@ -522,6 +590,18 @@ int main(int argc, char *argv []){
 	printf("frame progress: ");
 	fflush(NULL);
 
+	//======================================================================================================================================================
+	//	START DECODER
+	//======================================================================================================================================================
+
+	time_start = omp_get_wtime();
+
+	ring_start(	&ring,
+					public.d_frames,
+					frames_processed,
+					decode_depth,
+					public.frame_mem);
+
 	//======================================================================================================================================================
 	//	KERNEL
 	//======================================================================================================================================================
@@ -532,18 +612,34 @@ int main(int argc, char *argv []){
 	//	GETTING FRAME
 	//====================================================================================================
 
-		// Extract a cropped version of the first frame from the video file
-		public.d_frame = get_frame(public.d_frames,				// pointer to video file
-													public.frame_no,				// number of frame that needs to be returned
-													0,										// cropped?
-													0,										// scaled?
-													1);									// converted
+		time0 = omp_get_wtime();
+
+		// wait for the decoder thread to have the frame ready
+		public.d_frame = ring_acquire(	&ring,
+														public.frame_no);
+
+		time_frame = time_frame + omp_get_wtime() - time0;
 
 	//====================================================================================================
-	//	PROCESSING
+	//	SHARED FRAME SUMS
 	//====================================================================================================
 
 		omp_set_num_threads(omp_num_threads);
+
+		time0 = omp_get_wtime();
+
+		if(public.sums == 1){
+			frame_sums(public);
+		}
+
+		time_sums = time_sums + omp_get_wtime() - time0;
+
+	//====================================================================================================
+	//	PROCESSING
+	//====================================================================================================
+
+		time0 = omp_get_wtime();
+
 		
 
 		#pragma omp parallel for
@@ -552,12 +648,14 @@ int main(int argc, char *argv []){
 						private[i]);
 		}
 
+		time_kernel = time_kernel + omp_get_wtime() - time0;
+
 	//====================================================================================================
-	//	FREE MEMORY FOR FRAME
+	//	RELEASE FRAME
 	//====================================================================================================
 
-		// free frame after each loop iteration, since AVI library allocates memory for every frame fetched
-		free(public.d_frame);
+		// hand the buffer back to the decoder for frame frame_no+decode_depth
+		ring_release(&ring);
 
 	//====================================================================================================
 	//	PRINT FRAME PROGRESS
@@ -575,6 +673,24 @@ int main(int argc, char *argv []){
 	printf("\n");
 	fflush(NULL);
 
+	ring_stop(&ring);
+
+	time_total = omp_get_wtime() - time_start;
+
+	//======================================================================================================================================================
+	//	PER-FRAME LATENCY, THROUGHPUT
+	//======================================================================================================================================================
+
+	if(frames_processed > 0){
+		printf("average latency per frame (%d frames decoded ahead):\n", decode_depth);
+		printf("%.6f ms : DECODE FRAME (DECODER THREAD)\n", ring.time_decode / frames_processed * 1000);
+		printf("%.6f ms : WAIT FOR FRAME\n", time_frame / frames_processed * 1000);
+		printf("%.6f ms : SHARED FRAME SUMS\n", time_sums / frames_processed * 1000);
+		printf("%.6f ms : TRACK POINTS\n", time_kernel / frames_processed * 1000);
+		printf("%.6f ms : TOTAL\n", time_total / frames_processed * 1000);
+		printf("%.3f frames/s\n", frames_processed / time_total);
+	}
+
 	//======================================================================================================================================================
 	//	DEALLOCATION
 	//======================================================================================================================================================
@@ -613,6 +729,17 @@ int main(int argc, char *argv []){
 	free(public.d_tEpiColLoc);
 	free(public.d_epiT);
 
+	if(public.sums == 1){
+		free(public.d_frame_sum);
+		free(public.d_frame_sqr_sum);
+	}
+
+	if(public.conv_fft == 1){
+		free(public.d_fft_w_rows);
+		free(public.d_fft_w_cols);
+		free(public.d_fft_scratch);
+	}
+
 	//====================================================================================================
 	//	POINTERS
 	//====================================================================================================
@@ -0,0 +1,152 @@
+//===============================================================================================================================================================================================================
+//===============================================================================================================================================================================================================
+//	FRAME PIPELINE
+//===============================================================================================================================================================================================================
+//===============================================================================================================================================================================================================
+
+// A decoder thread reads frames from the AVI file into a ring of reusable frame buffers, running up to depth frames ahead of
+// the tracker. Frame n lives in buffer n % depth until the tracker releases it.
+
+#include <pthread.h>
+
+typedef struct frame_ring{
+
+	avi_t* d_frames;
+	int frames;																		// frames to decode
+	int depth;																		// buffers in the ring
+	fp** d_frame;
+	char* d_image_buf;																// raw frame, used by the decoder only
+
+	int decoded;																	// frames decoded so far
+	int consumed;																	// frames released by the tracker so far
+	double time_decode;																// decoder busy time
+
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	pthread_t thread;
+
+} frame_ring;
+
+//======================================================================================================================================================
+//	DECODER THREAD
+//======================================================================================================================================================
+
+void* ring_decode(void* arg){
+
+	frame_ring* ring = (frame_ring*)arg;
+	int frame_no;
+	double time0;
+
+	for(frame_no=0; frame_no<ring->frames; frame_no++){
+
+		// wait for a free buffer
+		pthread_mutex_lock(&ring->lock);
+		while(frame_no - ring->consumed >= ring->depth){
+			pthread_cond_wait(&ring->cond, &ring->lock);
+		}
+		pthread_mutex_unlock(&ring->lock);
+
+		time0 = omp_get_wtime();
+
+		get_frame_into(	ring->d_frames,											// pointer to video file
+								frame_no,													// number of frame that needs to be returned
+								0,																// scaled?
+								1,																// converted
+								ring->d_image_buf,
+								ring->d_frame[frame_no % ring->depth]);
+
+		ring->time_decode = ring->time_decode + omp_get_wtime() - time0;
+
+		// publish
+		pthread_mutex_lock(&ring->lock);
+		ring->decoded = frame_no + 1;
+		pthread_cond_broadcast(&ring->cond);
+		pthread_mutex_unlock(&ring->lock);
+
+	}
+
+	return NULL;
+
+}
+
+//======================================================================================================================================================
+//	START
+//======================================================================================================================================================
+
+void ring_start(	frame_ring* ring,
+						avi_t* d_frames,
+						int frames,
+						int depth,
+						int frame_mem){
+
+	int i;
+
+	ring->d_frames = d_frames;
+	ring->frames = frames;
+	ring->depth = depth;
+	ring->decoded = 0;
+	ring->consumed = 0;
+	ring->time_decode = 0;
+
+	ring->d_frame = (fp**)malloc(sizeof(fp*) * depth);
+	for(i=0; i<depth; i++){
+		ring->d_frame[i] = (fp*)malloc(frame_mem);
+	}
+	ring->d_image_buf = (char*)malloc(AVI_video_width(d_frames) * AVI_video_height(d_frames));
+
+	pthread_mutex_init(&ring->lock, NULL);
+	pthread_cond_init(&ring->cond, NULL);
+	pthread_create(&ring->thread, NULL, ring_decode, ring);
+
+}
+
+//======================================================================================================================================================
+//	ACQUIRE / RELEASE
+//======================================================================================================================================================
+
+// blocks until frame frame_no is decoded
+
+fp* ring_acquire(	frame_ring* ring,
+						int frame_no){
+
+	pthread_mutex_lock(&ring->lock);
+	while(ring->decoded <= frame_no){
+		pthread_cond_wait(&ring->cond, &ring->lock);
+	}
+	pthread_mutex_unlock(&ring->lock);
+
+	return ring->d_frame[frame_no % ring->depth];
+
+}
+
+// hands the oldest acquired buffer back to the decoder
+
+void ring_release(frame_ring* ring){
+
+	pthread_mutex_lock(&ring->lock);
+	ring->consumed = ring->consumed + 1;
+	pthread_cond_broadcast(&ring->cond);
+	pthread_mutex_unlock(&ring->lock);
+
+}
+
+//======================================================================================================================================================
+//	STOP
+//======================================================================================================================================================
+
+void ring_stop(frame_ring* ring){
+
+	int i;
+
+	pthread_join(ring->thread, NULL);
+
+	for(i=0; i<ring->depth; i++){
+		free(ring->d_frame[i]);
+	}
+	free(ring->d_frame);
+	free(ring->d_image_buf);
+
+	pthread_mutex_destroy(&ring->lock);
+	pthread_cond_destroy(&ring->cond);
+
+}
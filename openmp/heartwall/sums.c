@@ -0,0 +1,90 @@
+//===============================================================================================================================================================================================================
+//===============================================================================================================================================================================================================
+//	FRAME SUMS FUNCTION
+//===============================================================================================================================================================================================================
+//===============================================================================================================================================================================================================
+
+// integral images of the frame and of the frame squared, shared by all points. Column-major (frame_rows+1) x (frame_cols+1)
+// with a zero first row/col, so sum of frame[r1..r2][c1..c2] = S(r2+1,c2+1) - S(r1,c2+1) - S(r2+1,c1) + S(r1,c1). Kept in
+// double so that sums of squares stay exact for 8-bit frames.
+
+void frame_sums(public_struct public){
+
+	//======================================================================================================================================================
+	//	VARIABLES
+	//======================================================================================================================================================
+
+	int row;
+	int col;
+	int row_block;
+	int row_end;
+	int sum_rows;
+	double sum;
+	double sum_sqr;
+	double temp;
+
+	sum_rows = public.frame_rows + 1;
+
+	//======================================================================================================================================================
+	//	VERTICAL CUMULATIVE SUM (EVERY COLUMN INDEPENDENTLY)
+	//======================================================================================================================================================
+
+	for(row=0; row<sum_rows; row++){
+		public.d_frame_sum[row] = 0;
+		public.d_frame_sqr_sum[row] = 0;
+	}
+
+	#pragma omp parallel for private(row, sum, sum_sqr, temp)
+	for(col=0; col<public.frame_cols; col++){
+
+		sum = 0;
+		sum_sqr = 0;
+		public.d_frame_sum[(col+1)*sum_rows] = 0;
+		public.d_frame_sqr_sum[(col+1)*sum_rows] = 0;
+
+		for(row=0; row<public.frame_rows; row++){
+			temp = public.d_frame[col*public.frame_rows+row];
+			sum = sum + temp;
+			sum_sqr = sum_sqr + temp*temp;
+			public.d_frame_sum[(col+1)*sum_rows+row+1] = sum;
+			public.d_frame_sqr_sum[(col+1)*sum_rows+row+1] = sum_sqr;
+		}
+
+	}
+
+	//======================================================================================================================================================
+	//	HORIZONTAL CUMULATIVE SUM (EVERY ROW INDEPENDENTLY, IN BLOCKS OF ROWS WALKED COLUMN BY COLUMN)
+	//======================================================================================================================================================
+
+	#pragma omp parallel for private(row, col, row_end)
+	for(row_block=1; row_block<sum_rows; row_block=row_block+SUMS_BLOCK){
+		row_end = row_block + SUMS_BLOCK < sum_rows ? row_block + SUMS_BLOCK : sum_rows;
+		for(col=2; col<=public.frame_cols; col++){
+			for(row=row_block; row<row_end; row++){
+				public.d_frame_sum[col*sum_rows+row] = public.d_frame_sum[col*sum_rows+row] + public.d_frame_sum[(col-1)*sum_rows+row];
+				public.d_frame_sqr_sum[col*sum_rows+row] = public.d_frame_sqr_sum[col*sum_rows+row] + public.d_frame_sqr_sum[(col-1)*sum_rows+row];
+			}
+		}
+	}
+
+}
+
+//===============================================================================================================================================================================================================
+//===============================================================================================================================================================================================================
+//	LOCAL SUM FUNCTION
+//===============================================================================================================================================================================================================
+//===============================================================================================================================================================================================================
+
+// sum of the frame (or frame squared) over rows r1..r2 and cols c1..c2 (0-based, inclusive)
+
+static inline double local_sum(	double* S,
+											int sum_rows,
+											int r1,
+											int r2,
+											int c1,
+											int c2){
+
+	return	S[(c2+1)*sum_rows+r2+1] - S[(c2+1)*sum_rows+r1]
+			- S[c1*sum_rows+r2+1] + S[c1*sum_rows+r1];
+
+}
@@ -2,6 +2,12 @@
 #include <stdlib.h>
 #include <omp.h>
 #include <sys/time.h>
+#include <string.h>
+#include <math.h>
+#include "../../common/omp_rt.h"
+#ifdef __F16C__
+#include <immintrin.h>
+#endif
 
 // Returns the current system time in microseconds 
 long long get_time()
@@ -47,28 +53,20 @@ const FLOAT amb_temp = 80.0;
 
 int num_omp_threads;
 
-/* Single iteration of the transient solver in the grid model.
- * advances the solution of the discretized difference equations 
- * by one time step
+/* Blocks chunk_begin to chunk_end-1 of a single iteration of the
+ * transient solver in the grid model
  */
-void single_iteration(FLOAT *result, FLOAT *temp, FLOAT *power, int row, int col,
-					  FLOAT Cap_1, FLOAT Rx_1, FLOAT Ry_1, FLOAT Rz_1, 
-					  FLOAT step)
+void iteration_blocks(FLOAT *result, FLOAT *temp, FLOAT *power, int row, int col,
+					  FLOAT Cap_1, FLOAT Rx_1, FLOAT Ry_1, FLOAT Rz_1,
+					  int chunk_begin, int chunk_end)
 {
     FLOAT delta;
     int r, c;
     int chunk;
-    int num_chunk = row*col / (BLOCK_SIZE_R * BLOCK_SIZE_C);
     int chunks_in_row = col/BLOCK_SIZE_C;
     int chunks_in_col = row/BLOCK_SIZE_R;
 
-#ifdef OPEN
-    #ifndef __MIC__
-	omp_set_num_threads(num_omp_threads);
-    #endif
-    #pragma omp parallel for shared(power, temp, result) private(chunk, r, c, delta) firstprivate(row, col, num_chunk, chunks_in_row) schedule(static)
-#endif
-    for ( chunk = 0; chunk < num_chunk; ++chunk )
+    for ( chunk = chunk_begin; chunk < chunk_end; ++chunk )
     {
         int r_start = BLOCK_SIZE_R*(chunk/chunks_in_col);
         int c_start = BLOCK_SIZE_C*(chunk%chunks_in_row); 
@@ -149,8 +147,310 @@ void single_iteration(FLOAT *result, FLOAT *temp, FLOAT *power, int row, int col
 }
 
 #ifdef OMP_OFFLOAD
+/* Single iteration of the transient solver in the grid model.
+ * advances the solution of the discretized difference equations 
+ * by one time step
+ */
+void single_iteration(FLOAT *result, FLOAT *temp, FLOAT *power, int row, int col,
+					  FLOAT Cap_1, FLOAT Rx_1, FLOAT Ry_1, FLOAT Rz_1, 
+					  FLOAT step)
+{
+    int chunk;
+    int num_chunk = row*col / (BLOCK_SIZE_R * BLOCK_SIZE_C);
+
+    #pragma omp parallel for schedule(static)
+    for ( chunk = 0; chunk < num_chunk; ++chunk )
+        iteration_blocks(result, temp, power, row, col, Cap_1, Rx_1, Ry_1, Rz_1, chunk, chunk + 1);
+}
+
 #pragma offload_attribute(pop)
+#else
+/* Grids and coefficients of a single iteration, for iteration_body */
+struct iteration_args
+{
+    FLOAT *result, *temp, *power;
+    int row, col;
+    FLOAT Cap_1, Rx_1, Ry_1, Rz_1;
+};
+
+/* omp_rt_for body: blocks begin to end-1 of a single iteration */
+void iteration_body(int begin, int end, void *arg)
+{
+    iteration_args *it = (iteration_args *) arg;
+    iteration_blocks(it->result, it->temp, it->power, it->row, it->col,
+                     it->Cap_1, it->Rx_1, it->Ry_1, it->Rz_1, begin, end);
+}
+#endif
+
+/* Storage of the temperature and power grids for the reduced precision
+ * solver. It computes in fp32, but the grids it streams through memory
+ * are kept in 16 bits, IEEE half precision or bfloat16, or as fp32.
+ * Temperatures are stored as offsets from a reference temperature ref
+ * (T = v + ref), so that the narrow range they span around it gets all
+ * the bits of the mantissa; in offsets the update is the same with
+ * amb_temp - ref for the ambient temperature.
+ */
+#define STORE_F32   0
+#define STORE_F16   1
+#define STORE_BF16  2
+
+/* IEEE half precision, rounded to nearest even. The special cases are
+   blended in with masks rather than branches so that loops over rows
+   vectorize. */
+static inline unsigned short float_to_half(float f)
+{
+    union { float f; unsigned int u; } v, d;
+    unsigned int sign, x, o, s, inf, m;
+    v.f = f;
+    sign = v.u & 0x80000000u;
+    x = v.u ^ sign;
+    /* normal: rebias the exponent and round off the 13 dropped bits */
+    o = (x + ((unsigned int)(15 - 127) << 23) + 0xfffu + ((x >> 13) & 1)) >> 13;
+    /* subnormal: adding 0.5 makes the fp32 adder round at the right bit */
+    d.u = x;
+    d.f += 0.5f;
+    s = d.u - 0x3f000000u;
+    m = 0u - (unsigned int)(x < 0x38800000u);
+    o = (s & m) | (o & ~m);
+    /* overflow to infinity, NaN stays NaN */
+    inf = 0x7c00u | ((unsigned int)(x > 0x7f800000u) << 9);
+    m = 0u - (unsigned int)(x >= 0x47800000u);
+    o = (inf & m) | (o & ~m);
+    return (unsigned short)(o | (sign >> 16));
+}
+
+static inline float half_to_float(unsigned short h)
+{
+    union { unsigned int u; float f; } o, s;
+    unsigned int exp, m;
+    o.u = (unsigned int)(h & 0x7fffu) << 13;
+    exp = o.u & 0x0f800000u;
+    o.u += (unsigned int)(127 - 15) << 23;
+    /* infinity and NaN */
+    o.u += (unsigned int)(exp == 0x0f800000u) * ((unsigned int)(128 - 16) << 23);
+    /* subnormal: renormalize through the fp32 subtracter */
+    s.u = o.u + (1u << 23);
+    s.f -= 6.103515625e-05f;
+    m = 0u - (unsigned int)(exp == 0);
+    o.u = (s.u & m) | (o.u & ~m);
+    o.u |= (unsigned int)(h & 0x8000u) << 16;
+    return o.f;
+}
+
+/* bfloat16, rounded to nearest even (no NaN handling: the grids hold
+   finite values) */
+static inline unsigned short float_to_bfloat(float f)
+{
+    union { float f; unsigned int u; } v;
+    v.f = f;
+    return (unsigned short)((v.u + 0x7fffu + ((v.u >> 16) & 1)) >> 16);
+}
+
+static inline float bfloat_to_float(unsigned short h)
+{
+    union { unsigned int u; float f; } v;
+    v.u = (unsigned int)h << 16;
+    return v.f;
+}
+
+/* converts n values of a 16-bit grid row to fp32; built with F16C
+   (-mf16c) the half precision rows go through the conversion
+   instructions, which round the same way */
+static void unpack_row(float *o, const unsigned short *h, int n, int storage)
+{
+    int i = 0, x;
+    if (storage == STORE_BF16) {
+#pragma omp simd
+        for (x = 0; x < n; x++)
+            o[x] = bfloat_to_float(h[x]);
+    } else {
+#ifdef __F16C__
+        for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps(o + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(h + i))));
 #endif
+#pragma omp simd
+        for (x = i; x < n; x++)
+            o[x] = half_to_float(h[x]);
+    }
+}
+
+/* converts n fp32 values to a 16-bit grid row */
+static void pack_row(unsigned short *h, const float *v, int n, int storage)
+{
+    int i = 0, x;
+    if (storage == STORE_BF16) {
+#pragma omp simd
+        for (x = 0; x < n; x++)
+            h[x] = float_to_bfloat(v[x]);
+    } else {
+#ifdef __F16C__
+        for (; i + 8 <= n; i += 8)
+            _mm_storeu_si128((__m128i*)(h + i),
+                    _mm256_cvtps_ph(_mm256_loadu_ps(v + i), _MM_FROUND_TO_NEAREST_INT));
+#endif
+#pragma omp simd
+        for (x = i; x < n; x++)
+            h[x] = float_to_half(v[x]);
+    }
+}
+
+/* stores the n values of v, less ref, in a grid of the given storage */
+void store_grid(void *g, const FLOAT *v, long n, FLOAT ref, int storage)
+{
+    long i;
+    if (storage == STORE_F32) {
+        FLOAT *f = (FLOAT *) g;
+        for (i = 0; i < n; i++)
+            f[i] = v[i] - ref;
+        return;
+    }
+    FLOAT row[BLOCK_SIZE_C];
+    for (i = 0; i < n; i += BLOCK_SIZE_C) {
+        int m = (n - i < BLOCK_SIZE_C) ? (int) (n - i) : BLOCK_SIZE_C;
+        for (int x = 0; x < m; x++)
+            row[x] = v[i + x] - ref;
+        pack_row((unsigned short *) g + i, row, m, storage);
+    }
+}
+
+/* the inverse of store_grid */
+void load_grid(FLOAT *v, const void *g, long n, FLOAT ref, int storage)
+{
+    long i;
+    if (storage == STORE_F32) {
+        const FLOAT *f = (const FLOAT *) g;
+        for (i = 0; i < n; i++)
+            v[i] = f[i] + ref;
+        return;
+    }
+    for (i = 0; i < n; i += BLOCK_SIZE_C) {
+        int m = (n - i < BLOCK_SIZE_C) ? (int) (n - i) : BLOCK_SIZE_C;
+        unpack_row(v + i, (const unsigned short *) g + i, m, storage);
+        for (int x = 0; x < m; x++)
+            v[i + x] += ref;
+    }
+}
+
+/* Row r of a grid in fp32: the row itself for an fp32 grid, else the
+ * row unpacked into buf
+ */
+static const FLOAT *grid_row(const void *g, int r, int col, int storage, FLOAT *buf)
+{
+    if (storage == STORE_F32)
+        return (const FLOAT *) g + (long) r * col;
+    unpack_row(buf, (const unsigned short *) g + (long) r * col, col, storage);
+    return buf;
+}
+
+/* Updates row o of the grid from its row c, the rows n and s above and
+ * below it (c itself past the edge of the grid) and its power p. A
+ * neighbor past the edge is replaced by the cell itself, which gives
+ * the edge and corner equations of single_iteration.
+ */
+static void row_iteration(FLOAT *o, const FLOAT *c, const FLOAT *n, const FLOAT *s,
+                          const FLOAT *p, int col, FLOAT Cap_1, FLOAT Rx_1, FLOAT Ry_1,
+                          FLOAT Rz_1, FLOAT amb)
+{
+    int x;
+
+    /* first and last cell of the row */
+    FLOAT e = (col > 1) ? c[1] : c[0];
+    o[0] = c[0] + Cap_1 * (p[0] +
+        (n[0] + s[0] - 2.f*c[0]) * Ry_1 +
+        (e - c[0]) * Rx_1 +
+        (amb - c[0]) * Rz_1);
+    if (col > 1) {
+        x = col - 1;
+        o[x] = c[x] + Cap_1 * (p[x] +
+            (n[x] + s[x] - 2.f*c[x]) * Ry_1 +
+            (c[x-1] - c[x]) * Rx_1 +
+            (amb - c[x]) * Rz_1);
+    }
+
+#pragma omp simd
+    for (x = 1; x < col - 1; x++) {
+        o[x] = c[x] + Cap_1 * (p[x] +
+            (n[x] + s[x] - 2.f*c[x]) * Ry_1 +
+            (c[x+1] + c[x-1] - 2.f*c[x]) * Rx_1 +
+            (amb - c[x]) * Rz_1);
+    }
+}
+
+/* Transient solver on grids in the given storage, with temperatures
+ * as offsets from ref. Every thread owns a band of rows and streams
+ * through it, keeping the rows above, at and below the one being
+ * computed unpacked in a ring of three rows, so every cell is converted
+ * once per iteration on the way in and once on the way out. As with
+ * compute_tran_temp the result ends up in result for an odd number of
+ * iterations, in temp for an even one.
+ */
+void compute_tran_temp_stored(void *result, int num_iterations, void *temp, const void *power,
+                              int row, int col, int storage, FLOAT ref)
+{
+	FLOAT grid_height = chip_height / row;
+	FLOAT grid_width = chip_width / col;
+
+	FLOAT Cap = FACTOR_CHIP * SPEC_HEAT_SI * t_chip * grid_width * grid_height;
+	FLOAT Rx = grid_width / (2.0 * K_SI * t_chip * grid_height);
+	FLOAT Ry = grid_height / (2.0 * K_SI * t_chip * grid_width);
+	FLOAT Rz = t_chip / (K_SI * grid_height * grid_width);
+
+	FLOAT max_slope = MAX_PD / (FACTOR_CHIP * t_chip * SPEC_HEAT_SI);
+    FLOAT step = PRECISION / max_slope / 1000.0;
+
+    FLOAT Rx_1=1.f/Rx;
+    FLOAT Ry_1=1.f/Ry;
+    FLOAT Rz_1=1.f/Rz;
+    FLOAT Cap_1 = step/Cap;
+    FLOAT amb = amb_temp - ref;
+
+    size_t esize = (storage == STORE_F32) ? sizeof(FLOAT) : sizeof(unsigned short);
+
+    #pragma omp parallel
+    {
+        int nt = omp_get_num_threads();
+        int id = omp_get_thread_num();
+        int r0 = (int) ((long) row * id / nt);
+        int r1 = (int) ((long) row * (id + 1) / nt);
+        FLOAT *buf = (FLOAT *) malloc(5 * (size_t) col * sizeof(FLOAT));
+        FLOAT *ring[3] = { buf, buf + col, buf + 2 * col };
+        FLOAT *pbuf = buf + 3 * col;
+        FLOAT *obuf = buf + 4 * col;
+        const char *t = (const char *) temp;
+        char *res = (char *) result;
+
+        for (int i = 0; i < num_iterations; i++)
+        {
+            const FLOAT *rows[3];
+
+            if (r0 > 0)
+                rows[(r0 + 2) % 3] = grid_row(t, r0 - 1, col, storage, ring[(r0 + 2) % 3]);
+            if (r0 < r1)
+                rows[r0 % 3] = grid_row(t, r0, col, storage, ring[r0 % 3]);
+            for (int r = r0; r < r1; r++) {
+                const FLOAT *c = rows[r % 3];
+                const FLOAT *n = (r > 0) ? rows[(r + 2) % 3] : c;
+                const FLOAT *s = c;
+                if (r < row - 1)
+                    s = rows[(r + 1) % 3] = grid_row(t, r + 1, col, storage, ring[(r + 1) % 3]);
+                const FLOAT *p = grid_row(power, r, col, storage, pbuf);
+                FLOAT *o = (storage == STORE_F32) ? (FLOAT *) (res + (long) r * col * esize) : obuf;
+
+                row_iteration(o, c, n, s, p, col, Cap_1, Rx_1, Ry_1, Rz_1, amb);
+                if (storage != STORE_F32)
+                    pack_row((unsigned short *) (res + (long) r * col * esize), obuf, col, storage);
+            }
+
+            /* the rows next to a band are read by the neighboring threads */
+            #pragma omp barrier
+            char *tmp = (char *) t;
+            t = res;
+            res = tmp;
+        }
+
+        free(buf);
+    }
+}
 
 /* Transient solver driver routine: simply converts the heat 
  * transfer differential equations to difference equations 
@@ -188,7 +488,6 @@ void compute_tran_temp(FLOAT *result, int num_iterations, FLOAT *temp, FLOAT *po
         map(temp[0:array_size]) \
         map(to: power[0:array_size], row, col, Cap_1, Rx_1, Ry_1, Rz_1, step, num_iterations) \
         map( result[0:array_size])
-#endif
         {
             FLOAT* r = result;
             FLOAT* t = temp;
@@ -203,12 +502,26 @@ void compute_tran_temp(FLOAT *result, int num_iterations, FLOAT *temp, FLOAT *po
                 r = tmp;
             }	
         }
+#else
+    /* an iteration is an omp_rt_for over the blocks, see omp_rt.h */
+    int num_chunk = row*col / (BLOCK_SIZE_R * BLOCK_SIZE_C);
+    iteration_args it = { result, temp, power, row, col, Cap_1, Rx_1, Ry_1, Rz_1 };
+
+    #pragma omp parallel if (omp_rt_persistent()) firstprivate(it)
+    for (int i = 0; i < num_iterations; i++)
+    {
+        omp_rt_for(0, num_chunk, OMP_RT_STATIC, 0, iteration_body, &it);
+        FLOAT* tmp = it.temp;
+        it.temp = it.result;
+        it.result = tmp;
+    }
+#endif
 	#ifdef VERBOSE
 	fprintf(stdout, "iteration %d\n", i++);
 	#endif
 }
 
-void fatal(char *s)
+void fatal(const char *s)
 {
 	fprintf(stderr, "error: %s\n", s);
 	exit(1);
@@ -259,9 +572,21 @@ void read_input(FLOAT *vect, int grid_rows, int grid_cols, char *file)
 	fclose(fp);	
 }
 
+FLOAT accuracy(FLOAT *arr1, FLOAT *arr2, int len)
+{
+    FLOAT err = 0.0;
+    int i;
+    for(i = 0; i < len; i++)
+    {
+        err += (arr1[i]-arr2[i]) * (arr1[i]-arr2[i]);
+    }
+
+    return (FLOAT)sqrt(err/len);
+}
+
 void usage(int argc, char **argv)
 {
-	fprintf(stderr, "Usage: %s <grid_rows> <grid_cols> <sim_time> <no. of threads><temp_file> <power_file>\n", argv[0]);
+	fprintf(stderr, "Usage: %s <grid_rows> <grid_cols> <sim_time> <no. of threads><temp_file> <power_file> <output_file> [storage]\n", argv[0]);
 	fprintf(stderr, "\t<grid_rows>  - number of rows in the grid (positive integer)\n");
 	fprintf(stderr, "\t<grid_cols>  - number of columns in the grid (positive integer)\n");
 	fprintf(stderr, "\t<sim_time>   - number of iterations\n");
@@ -269,9 +594,90 @@ void usage(int argc, char **argv)
 	fprintf(stderr, "\t<temp_file>  - name of the file containing the initial temperature values of each cell\n");
 	fprintf(stderr, "\t<power_file> - name of the file containing the dissipated power values of each cell\n");
         fprintf(stderr, "\t<output_file> - name of the output file\n");
+        fprintf(stderr, "\t[storage]    - grid storage: f32 (default), delta (fp32 offsets from ambient), f16 or bf16\n");
 	exit(1);
 }
 
+/* Runs the solver on grids in the named storage, then the fp32 solver
+ * for reference, and reports the accuracy of the result against it
+ */
+int run_stored(const char *sname, int sim_time, FLOAT *temp, FLOAT *power, FLOAT *result,
+               int grid_rows, int grid_cols, char *ofile)
+{
+    int size = grid_rows * grid_cols;
+    int storage, i;
+
+    if (!strcmp(sname, "delta"))
+        storage = STORE_F32;
+    else if (!strcmp(sname, "f16"))
+        storage = STORE_F16;
+    else if (!strcmp(sname, "bf16"))
+        storage = STORE_BF16;
+    else
+        fatal("unknown storage");
+
+    /* reference temperature: ambient for fp32 offsets, the middle of
+       the initial temperatures for 16-bit grids */
+    FLOAT ref = amb_temp;
+    if (storage != STORE_F32) {
+        FLOAT lo = temp[0], hi = temp[0];
+        for (i = 1; i < size; i++) {
+            if (temp[i] < lo) lo = temp[i];
+            if (temp[i] > hi) hi = temp[i];
+        }
+        ref = 0.5f * (lo + hi);
+    }
+
+    size_t esize = (storage == STORE_F32) ? sizeof(FLOAT) : sizeof(unsigned short);
+    void *s_temp = malloc(size * esize);
+    void *s_power = malloc(size * esize);
+    void *s_result = calloc(size, esize);
+    FLOAT *answer = (FLOAT *) malloc(size * sizeof(FLOAT));
+    if (!s_temp || !s_power || !s_result || !answer)
+        fatal("unable to allocate memory");
+
+    store_grid(s_temp, temp, size, ref, storage);
+    store_grid(s_power, power, size, 0.0, storage);
+
+	printf("Start computing the transient temperature (%s storage, reference %g)\n", sname, ref);
+
+    long long start_time = get_time();
+    compute_tran_temp_stored(s_result, sim_time, s_temp, s_power, grid_rows, grid_cols, storage, ref);
+    long long end_time = get_time();
+    float time = ((float) (end_time - start_time)) / (1000*1000);
+
+    load_grid(answer, (1&sim_time) ? s_result : s_temp, size, ref, storage);
+
+    omp_rt_stats_reset();
+    start_time = get_time();
+    compute_tran_temp(result, sim_time, temp, power, grid_rows, grid_cols);
+    end_time = get_time();
+    float time_f32 = ((float) (end_time - start_time)) / (1000*1000);
+    FLOAT *full = (1&sim_time) ? result : temp;
+
+    FLOAT maxerr = 0.0;
+    for (i = 0; i < size; i++)
+        if (fabsf(answer[i] - full[i]) > maxerr)
+            maxerr = fabsf(answer[i] - full[i]);
+
+    printf("Ending simulation\n");
+    printf("Total time: %.3f seconds\n", time);
+    printf("fp32 time: %.3f seconds, speedup %.2fx\n", time_f32, time_f32 / time);
+    printf("Accuracy: %e (max error %e)\n", accuracy(answer, full, size), maxerr);
+    omp_rt_report("fp32 iterations");
+
+    writeoutput(answer, grid_rows, grid_cols, ofile);
+
+    free(s_temp);
+    free(s_power);
+    free(s_result);
+    free(answer);
+    free(temp);
+    free(power);
+    free(result);
+    return 0;
+}
+
 int main(int argc, char **argv)
 {
 	int grid_rows, grid_cols, sim_time, i;
@@ -279,7 +685,7 @@ int main(int argc, char **argv)
 	char *tfile, *pfile, *ofile;
 	
 	/* check validity of inputs	*/
-	if (argc != 8)
+	if (argc != 8 && argc != 9)
 		usage(argc, argv);
 	if ((grid_rows = atoi(argv[1])) <= 0 ||
 		(grid_cols = atoi(argv[2])) <= 0 ||
@@ -303,6 +709,11 @@ int main(int argc, char **argv)
 	read_input(temp, grid_rows, grid_cols, tfile);
 	read_input(power, grid_rows, grid_cols, pfile);
 
+    omp_rt_init(num_omp_threads);
+
+    if (argc == 9 && strcmp(argv[8], "f32"))
+        return run_stored(argv[8], sim_time, temp, power, result, grid_rows, grid_cols, ofile);
+
 	printf("Start computing the transient temperature\n");
 	
     long long start_time = get_time();
@@ -313,6 +724,7 @@ int main(int argc, char **argv)
 
     printf("Ending simulation\n");
     printf("Total time: %.3f seconds\n", ((float) (end_time - start_time)) / (1000*1000));
+    omp_rt_report("iterations");
 
     writeoutput((1&sim_time) ? result : temp, grid_rows, grid_cols, ofile);
 
@@ -5,6 +5,10 @@
 #include <math.h> 
 #include <sys/time.h>
 #include <string.h>
+#include <omp.h>
+#ifdef __F16C__
+#include <immintrin.h>
+#endif
 
 #define STR_SIZE (256)
 #define MAX_PD	(3.0e6)
@@ -131,10 +135,386 @@ float accuracy(float *arr1, float *arr2, int len)
 
 
 }
-void computeTempOMP(float *pIn, float* tIn, float *tOut, 
+/* Storage of the temperature and power grids. The solver always
+   computes in fp32, but the grids it streams through memory can be
+   kept in 16 bits, either IEEE half precision or bfloat16, which
+   halves the traffic of a pass. Temperatures are then stored as
+   offsets from a reference temperature ref (T = v + ref), so that the
+   narrow range they span around it gets all the bits of the mantissa.
+   The coefficients of a cell sum to 1 - ct, so in offsets the update
+   is the same stencil with ct * (amb_temp - ref) for the ambient term,
+   and with ref = amb_temp an fp32 grid of offsets from ambient needs
+   no ambient term at all. */
+
+#define STORE_F32   0
+#define STORE_F16   1
+#define STORE_BF16  2
+
+/* cells converted at a time by store_grid and load_grid */
+#define STORE_CHUNK 256
+
+/* IEEE half precision, rounded to nearest even. The special cases are
+   blended in with masks rather than branches so that loops over rows
+   vectorize. */
+static inline unsigned short float_to_half(float f)
+{
+    union { float f; unsigned int u; } v, d;
+    unsigned int sign, x, o, s, inf, m;
+    v.f = f;
+    sign = v.u & 0x80000000u;
+    x = v.u ^ sign;
+    /* normal: rebias the exponent and round off the 13 dropped bits */
+    o = (x + ((unsigned int)(15 - 127) << 23) + 0xfffu + ((x >> 13) & 1)) >> 13;
+    /* subnormal: adding 0.5 makes the fp32 adder round at the right bit */
+    d.u = x;
+    d.f += 0.5f;
+    s = d.u - 0x3f000000u;
+    m = 0u - (unsigned int)(x < 0x38800000u);
+    o = (s & m) | (o & ~m);
+    /* overflow to infinity, NaN stays NaN */
+    inf = 0x7c00u | ((unsigned int)(x > 0x7f800000u) << 9);
+    m = 0u - (unsigned int)(x >= 0x47800000u);
+    o = (inf & m) | (o & ~m);
+    return (unsigned short)(o | (sign >> 16));
+}
+
+static inline float half_to_float(unsigned short h)
+{
+    union { unsigned int u; float f; } o, s;
+    unsigned int exp, m;
+    o.u = (unsigned int)(h & 0x7fffu) << 13;
+    exp = o.u & 0x0f800000u;
+    o.u += (unsigned int)(127 - 15) << 23;
+    /* infinity and NaN */
+    o.u += (unsigned int)(exp == 0x0f800000u) * ((unsigned int)(128 - 16) << 23);
+    /* subnormal: renormalize through the fp32 subtracter */
+    s.u = o.u + (1u << 23);
+    s.f -= 6.103515625e-05f;
+    m = 0u - (unsigned int)(exp == 0);
+    o.u = (s.u & m) | (o.u & ~m);
+    o.u |= (unsigned int)(h & 0x8000u) << 16;
+    return o.f;
+}
+
+/* bfloat16, rounded to nearest even (no NaN handling: the grids hold
+   finite values) */
+static inline unsigned short float_to_bfloat(float f)
+{
+    union { float f; unsigned int u; } v;
+    v.f = f;
+    return (unsigned short)((v.u + 0x7fffu + ((v.u >> 16) & 1)) >> 16);
+}
+
+static inline float bfloat_to_float(unsigned short h)
+{
+    union { unsigned int u; float f; } v;
+    v.u = (unsigned int)h << 16;
+    return v.f;
+}
+
+/* converts n values of a 16-bit grid row to fp32; built with F16C
+   (-mf16c) the half precision rows go through the conversion
+   instructions, which round the same way */
+static void unpack_row(float *o, const unsigned short *h, int n, int storage)
+{
+    int i = 0, x;
+    if (storage == STORE_BF16) {
+#pragma omp simd
+        for (x = 0; x < n; x++)
+            o[x] = bfloat_to_float(h[x]);
+    } else {
+#ifdef __F16C__
+        for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps(o + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(h + i))));
+#endif
+#pragma omp simd
+        for (x = i; x < n; x++)
+            o[x] = half_to_float(h[x]);
+    }
+}
+
+/* converts n fp32 values to a 16-bit grid row */
+static void pack_row(unsigned short *h, const float *v, int n, int storage)
+{
+    int i = 0, x;
+    if (storage == STORE_BF16) {
+#pragma omp simd
+        for (x = 0; x < n; x++)
+            h[x] = float_to_bfloat(v[x]);
+    } else {
+#ifdef __F16C__
+        for (; i + 8 <= n; i += 8)
+            _mm_storeu_si128((__m128i*)(h + i),
+                    _mm256_cvtps_ph(_mm256_loadu_ps(v + i), _MM_FROUND_TO_NEAREST_INT));
+#endif
+#pragma omp simd
+        for (x = i; x < n; x++)
+            h[x] = float_to_half(v[x]);
+    }
+}
+
+/* stores the n values of v, less ref, in a grid of the given storage */
+void store_grid(void *g, const float *v, long n, float ref, int storage)
+{
+    long i;
+    if (storage == STORE_F32) {
+        float *f = (float*)g;
+        for (i = 0; i < n; i++)
+            f[i] = v[i] - ref;
+        return;
+    }
+    float row[STORE_CHUNK];
+    for (i = 0; i < n; i += STORE_CHUNK) {
+        int m = (n - i < STORE_CHUNK) ? (int)(n - i) : STORE_CHUNK;
+        int x;
+        for (x = 0; x < m; x++)
+            row[x] = v[i + x] - ref;
+        pack_row((unsigned short*)g + i, row, m, storage);
+    }
+}
+
+/* the inverse of store_grid */
+void load_grid(float *v, const void *g, long n, float ref, int storage)
+{
+    long i;
+    if (storage == STORE_F32) {
+        const float *f = (const float*)g;
+        for (i = 0; i < n; i++)
+            v[i] = f[i] + ref;
+        return;
+    }
+    for (i = 0; i < n; i += STORE_CHUNK) {
+        int m = (n - i < STORE_CHUNK) ? (int)(n - i) : STORE_CHUNK;
+        int x;
+        unpack_row(v + i, (const unsigned short*)g + i, m, storage);
+        for (x = 0; x < m; x++)
+            v[i + x] += ref;
+    }
+}
+
+/* 2.5D blocking: every thread takes tiles of BLOCK_X x BLOCK_Y cells
+   of the x-y plane and streams them along z, so the planes below, at
+   and above the one being computed stay in cache while the tile moves
+   up. The boundary conditions (a missing neighbor is replaced by the
+   cell itself) are resolved once per row for y and z, and by separate
+   code for the first and last cell of a row, so the interior of a row
+   is a straight vectorizable loop.
+   With a temporal blocking depth above 1, a tile does that many time
+   steps at once: the tile grown by depth - 1 cells on each side is
+   computed into a per-thread scratch block, which shrinks by a cell per
+   step, and only the last step writes the grid. The cells of the halo
+   are computed by several threads, but the grid is read and written
+   once per depth steps.
+   A 16-bit grid is converted to fp32 once per pass. With one step a
+   tile streams along z through a ring of unpacked planes; with more a
+   tile first unpacks the cells its first step reads, and the power of
+   the cells it computes, into scratch blocks, does all its steps in
+   fp32 and packs only the tile into the output grid. The rounding to
+   16 bits thus happens once per depth steps.
+   The terms are summed in the order of the previous kernel, so the
+   result does not depend on the blocking. As with computeTempCPU the
+   result of the last iteration ends up in tOut for an odd number of
+   iterations, in tIn for an even one. */
+
+#define BLOCK_X 256
+#define BLOCK_Y 16
+
+/* cell (x, y, z) of a view is p[(x - ox) + (y - oy) * sx + z * sxy] */
+typedef struct {
+    float *p;
+    int ox, oy;
+    int sx, sxy;
+} grid_view;
+
+typedef struct {
+    float cc, cw, ce, cs, cn, cb, ct;
+    float sdc;      /* dt / Cap */
+    float amb;      /* ct * amb_temp */
+} stencil_coef;
+
+/* address of cell (0, y, z) of a view, so that rows are indexed by x */
+static inline float *view_row(grid_view v, int y, int z)
+{
+    return v.p + (long)(y - v.oy) * v.sx + (long)z * v.sxy - v.ox;
+}
+
+/* computes cells [x0, x1) of row o from the row c of the cells, the
+   rows n, s, b and t around it (c itself past the end of the grid) and
+   the power p, all indexed by x */
+static inline void stencil_cells(float *o, const float *c, const float *n, const float *s,
+        const float *b, const float *t, const float *p, int x0, int x1, int nx,
+        const stencil_coef *k)
+{
+    float cc = k->cc, cw = k->cw, ce = k->ce, cs = k->cs, cn = k->cn, cb = k->cb, ct = k->ct;
+    float sdc = k->sdc, amb = k->amb;
+    int xa = (x0 > 1) ? x0 : 1;
+    int xb = (x1 < nx - 1) ? x1 : nx - 1;
+    int x;
+
+    /* first and last cell of the row */
+    if (x0 == 0) {
+        float e = (nx > 1) ? c[1] : c[0];
+        o[0] = cc * c[0] + cw * c[0] + ce * e
+            + cs * s[0] + cn * n[0] + cb * b[0] + ct * t[0] + sdc * p[0] + amb;
+    }
+    if (x1 == nx && nx > 1) {
+        x = nx - 1;
+        o[x] = cc * c[x] + cw * c[x - 1] + ce * c[x]
+            + cs * s[x] + cn * n[x] + cb * b[x] + ct * t[x] + sdc * p[x] + amb;
+    }
+
+    /* interior */
+#pragma omp simd
+    for (x = xa; x < xb; x++) {
+        o[x] = cc * c[x] + cw * c[x - 1] + ce * c[x + 1]
+            + cs * s[x] + cn * n[x] + cb * b[x] + ct * t[x] + sdc * p[x] + amb;
+    }
+}
+
+/* computes cells [x0, x1) of row (y, z) of out from in and power pw */
+static void stencil_row(grid_view in, grid_view out, grid_view pw,
+        int x0, int x1, int y, int z, int nx, int ny, int nz,
+        const stencil_coef *k)
+{
+    const float *c = view_row(in, y, z);
+    const float *n = (y == 0)      ? c : view_row(in, y - 1, z);
+    const float *s = (y == ny - 1) ? c : view_row(in, y + 1, z);
+    const float *b = (z == 0)      ? c : view_row(in, y, z - 1);
+    const float *t = (z == nz - 1) ? c : view_row(in, y, z + 1);
+
+    stencil_cells(view_row(out, y, z), c, n, s, b, t, view_row(pw, y, z), x0, x1, nx, k);
+}
+
+/* view of scratch block over region [gx0, gx1) x [gy0, gy1) x [0, nz) */
+static grid_view scratch_view(float *p, int gx0, int gx1, int gy0, int gy1)
+{
+    grid_view v = { p, gx0, gy0, gx1 - gx0, (gx1 - gx0) * (gy1 - gy0) };
+    return v;
+}
+
+/* advances tile [x0, x1) x [y0, y1) by depth steps, from grid tIn to
+   grid tOut, with power pIn, all three in the given storage */
+static void stencil_tile(const void *tIn, void *tOut, const void *pIn, float *scratch[3],
+        int storage, int x0, int x1, int y0, int y1, int depth, int nx, int ny, int nz,
+        const stencil_coef *k)
+{
+    int halo = depth - 1;
+    /* scratch blocks cover the tile grown by the halo, and by one more
+       cell for the first step's neighbors when the grid is unpacked */
+    int margin = (storage == STORE_F32) ? halo : depth;
+    int gx0 = (x0 - margin > 0) ? x0 - margin : 0;
+    int gy0 = (y0 - margin > 0) ? y0 - margin : 0;
+    int gx1 = (x1 + margin < nx) ? x1 + margin : nx;
+    int gy1 = (y1 + margin < ny) ? y1 + margin : ny;
+    grid_view in = { (float*)tIn, 0, 0, nx, nx * ny };
+    grid_view out = { (float*)tOut, 0, 0, nx, nx * ny };
+    grid_view pw = { (float*)pIn, 0, 0, nx, nx * ny };
+    int step, y, z;
+
+    if (storage != STORE_F32) {
+        int hx0 = (x0 - halo > 0) ? x0 - halo : 0;
+        int hy0 = (y0 - halo > 0) ? y0 - halo : 0;
+        int hx1 = (x1 + halo < nx) ? x1 + halo : nx;
+        int hy1 = (y1 + halo < ny) ? y1 + halo : ny;
+
+        /* the first step reads scratch[1] */
+        in = scratch_view(scratch[1], gx0, gx1, gy0, gy1);
+        pw = scratch_view(scratch[2], gx0, gx1, gy0, gy1);
+        for (z = 0; z < nz; z++) {
+            for (y = gy0; y < gy1; y++)
+                unpack_row(view_row(in, y, z) + gx0,
+                        (const unsigned short*)tIn + (long)y * nx + (long)z * nx * ny + gx0,
+                        gx1 - gx0, storage);
+            for (y = hy0; y < hy1; y++)
+                unpack_row(view_row(pw, y, z) + hx0,
+                        (const unsigned short*)pIn + (long)y * nx + (long)z * nx * ny + hx0,
+                        hx1 - hx0, storage);
+        }
+    }
+
+    for (step = 1; step <= depth; step++) {
+        /* region of this step: the tile grown by depth - step cells */
+        int g = depth - step;
+        int rx0 = (x0 - g > 0) ? x0 - g : 0;
+        int ry0 = (y0 - g > 0) ? y0 - g : 0;
+        int rx1 = (x1 + g < nx) ? x1 + g : nx;
+        int ry1 = (y1 + g < ny) ? y1 + g : ny;
+        grid_view src = in, dst = out;
+
+        if (step > 1)
+            src = scratch_view(scratch[step % 2], gx0, gx1, gy0, gy1);
+        if (step < depth || storage != STORE_F32)
+            dst = scratch_view(scratch[(step + 1) % 2], gx0, gx1, gy0, gy1);
+
+        for (z = 0; z < nz; z++)
+            for (y = ry0; y < ry1; y++)
+                stencil_row(src, dst, pw, rx0, rx1, y, z, nx, ny, nz, k);
+    }
+
+    if (storage != STORE_F32) {
+        grid_view last = scratch_view(scratch[(depth + 1) % 2], gx0, gx1, gy0, gy1);
+        for (z = 0; z < nz; z++)
+            for (y = y0; y < y1; y++)
+                pack_row((unsigned short*)tOut + (long)y * nx + (long)z * nx * ny + x0,
+                        view_row(last, y, z) + x0, x1 - x0, storage);
+    }
+}
+
+/* advances tile [x0, x1) x [y0, y1) of a 16-bit grid by one step,
+   streaming it along z: the cells of planes z - 1, z and z + 1 that
+   the step reads are kept unpacked in a ring of three planes of
+   scratch, so every cell is converted once, and each row is computed
+   into a row of scratch and packed into the output grid */
+static void stencil_tile_stream(const unsigned short *tIn, unsigned short *tOut,
+        const unsigned short *pIn, float *scratch, int storage,
+        int x0, int x1, int y0, int y1, int nx, int ny, int nz,
+        const stencil_coef *k)
+{
+    int gx0 = (x0 > 0) ? x0 - 1 : 0;
+    int gy0 = (y0 > 0) ? y0 - 1 : 0;
+    int gx1 = (x1 < nx) ? x1 + 1 : nx;
+    int gy1 = (y1 < ny) ? y1 + 1 : ny;
+    long plane = (long)(gx1 - gx0) * (gy1 - gy0);
+    float *ring[3] = { scratch, scratch + plane, scratch + 2 * plane };
+    /* rows of the output and of the power, indexed by x */
+    float *o = scratch + 3 * plane - x0;
+    float *p = o + (x1 - x0);
+    int y, z;
+
+    for (z = 0; z < nz; z++) {
+        int zl = (z == 0) ? 0 : z + 1;
+        int zh = (z + 1 < nz) ? z + 1 : nz - 1;
+        int zi;
+
+        /* the planes not yet in the ring: 0 and 1 at first, then z + 1 */
+        for (zi = zl; zi <= zh; zi++)
+            for (y = gy0; y < gy1; y++)
+                unpack_row(ring[zi % 3] + (long)(y - gy0) * (gx1 - gx0),
+                        tIn + (long)y * nx + (long)zi * nx * ny + gx0, gx1 - gx0, storage);
+
+        grid_view cur = scratch_view(ring[z % 3], gx0, gx1, gy0, gy1);
+        grid_view below = (z == 0) ? cur : scratch_view(ring[(z + 2) % 3], gx0, gx1, gy0, gy1);
+        grid_view above = (z == nz - 1) ? cur : scratch_view(ring[(z + 1) % 3], gx0, gx1, gy0, gy1);
+
+        for (y = y0; y < y1; y++) {
+            long row = (long)y * nx + (long)z * nx * ny;
+            const float *c = view_row(cur, y, 0);
+            const float *n = (y == 0)      ? c : view_row(cur, y - 1, 0);
+            const float *s = (y == ny - 1) ? c : view_row(cur, y + 1, 0);
+
+            unpack_row(p + x0, pIn + row + x0, x1 - x0, storage);
+            stencil_cells(o, c, n, s, view_row(below, y, 0), view_row(above, y, 0), p,
+                    x0, x1, nx, k);
+            pack_row(tOut + row + x0, o + x0, x1 - x0, storage);
+        }
+    }
+}
+
+/* grids are in the given storage, temperatures as offsets from ref */
+void computeTempOMP(void *pIn, void* tIn, void *tOut, 
         int nx, int ny, int nz, float Cap, 
         float Rx, float Ry, float Rz, 
-        float dt, int numiter) 
+        float dt, int numiter, int depth, int storage, float ref) 
 {  
 
     float ce, cw, cn, cs, ct, cb, cc;
@@ -146,49 +526,77 @@ void computeTempOMP(float *pIn, float* tIn, float *tOut,
 
     cc = 1.0 - (2.0*ce + 2.0*cn + 3.0*ct);
 
+    stencil_coef k;
+    k.cc = cc; k.cw = cw; k.ce = ce; k.cs = cs; k.cn = cn; k.cb = cb; k.ct = ct;
+    k.sdc = dt/Cap;
+    k.amb = ct*(amb_temp - ref);
+
+    if (depth < 1) depth = 1;
+    if (depth > numiter && numiter > 0) depth = numiter;
+
+    /* passes of at most depth steps, spread evenly, and one more pass if
+       needed so that the number of passes has the parity of numiter,
+       which puts the result in the same buffer as one step per pass */
+    int passes = (numiter + depth - 1) / depth;
+    if (passes % 2 != numiter % 2) passes++;
+
+    int tiles_x = (nx + BLOCK_X - 1) / BLOCK_X;
+    int tiles_y = (ny + BLOCK_Y - 1) / BLOCK_Y;
+    int tiles = tiles_x * tiles_y;
+    long scratch_size = (long)(BLOCK_X + 2 * depth) * (BLOCK_Y + 2 * depth) * nz;
+    int nscratch = (storage != STORE_F32) ? 3 : (depth > 1) ? 2 : 0;
+    /* a pass of one step streams 16-bit tiles through a ring of planes */
+    long ring_size = 3L * (BLOCK_X + 2) * (BLOCK_Y + 2) + 2 * BLOCK_X;
+    if (storage != STORE_F32 && depth == 1)
+        nscratch = 1;
+    if (storage != STORE_F32 && scratch_size < ring_size)
+        scratch_size = ring_size;
 
 #pragma omp parallel
     {
-        int count = 0;
-        float *tIn_t = tIn;
-        float *tOut_t = tOut;
+        void *in = tIn, *out = tOut;
+        float *scratch[3] = { NULL, NULL, NULL };
+        int pass, i;
 
 #pragma omp master
-        printf("%d threads running\n", omp_get_num_threads());
-
-        do {
-            int z; 
-#pragma omp for 
-            for (z = 0; z < nz; z++) {
-                int y;
-                for (y = 0; y < ny; y++) {
-                    int x;
-                    for (x = 0; x < nx; x++) {
-                        int c, w, e, n, s, b, t;
-                        c =  x + y * nx + z * nx * ny;
-                        w = (x == 0)    ? c : c - 1;
-                        e = (x == nx-1) ? c : c + 1;
-                        n = (y == 0)    ? c : c - nx;
-                        s = (y == ny-1) ? c : c + nx;
-                        b = (z == 0)    ? c : c - nx * ny;
-                        t = (z == nz-1) ? c : c + nx * ny;
-                        tOut_t[c] = cc * tIn_t[c] + cw * tIn_t[w] + ce * tIn_t[e]
-                            + cs * tIn_t[s] + cn * tIn_t[n] + cb * tIn_t[b] + ct * tIn_t[t]+(dt/Cap) * pIn[c] + ct*amb_temp;
-                    }
-                }
+        printf("%d threads running, %d tiles of %dx%d, depth %d\n",
+                omp_get_num_threads(), tiles, BLOCK_X, BLOCK_Y, depth);
+
+        for (i = 0; i < nscratch; i++)
+            scratch[i] = (float*)malloc(scratch_size * sizeof(float));
+
+        for (pass = 0; pass < passes; pass++) {
+            int steps = numiter / passes + (pass < numiter % passes);
+
+            int tile;
+#pragma omp for schedule(static)
+            for (tile = 0; tile < tiles; tile++) {
+                int x0 = (tile % tiles_x) * BLOCK_X;
+                int y0 = (tile / tiles_x) * BLOCK_Y;
+                int x1 = (x0 + BLOCK_X < nx) ? x0 + BLOCK_X : nx;
+                int y1 = (y0 + BLOCK_Y < ny) ? y0 + BLOCK_Y : ny;
+                if (storage != STORE_F32 && steps == 1)
+                    stencil_tile_stream((const unsigned short*)in, (unsigned short*)out,
+                            (const unsigned short*)pIn, scratch[0], storage,
+                            x0, x1, y0, y1, nx, ny, nz, &k);
+                else
+                    stencil_tile(in, out, pIn, scratch, storage, x0, x1, y0, y1, steps, nx, ny, nz, &k);
             }
-            float *t = tIn_t;
-            tIn_t = tOut_t;
-            tOut_t = t; 
-            count++;
-        } while (count < numiter);
+
+            void *t = in;
+            in = out;
+            out = t;
+        }
+
+        for (i = 0; i < nscratch; i++)
+            free(scratch[i]);
     } 
     return; 
 } 
 
 void usage(int argc, char **argv)
 {
-    fprintf(stderr, "Usage: %s <rows/cols> <layers> <iterations> <powerFile> <tempFile> <outputFile>\n", argv[0]);
+    fprintf(stderr, "Usage: %s <rows/cols> <layers> <iterations> <powerFile> <tempFile> <outputFile> [depth] [storage]\n", argv[0]);
     fprintf(stderr, "\t<rows/cols>  - number of rows/cols in the grid (positive integer)\n");
     fprintf(stderr, "\t<layers>  - number of layers in the grid (positive integer)\n");
 
@@ -196,6 +604,8 @@ void usage(int argc, char **argv)
     fprintf(stderr, "\t<powerFile>  - name of the file containing the initial power values of each cell\n");
     fprintf(stderr, "\t<tempFile>  - name of the file containing the initial temperature values of each cell\n");
     fprintf(stderr, "\t<outputFile - output file\n");
+    fprintf(stderr, "\t[depth]  - time steps per pass over a tile (temporal blocking, default 1)\n");
+    fprintf(stderr, "\t[storage]  - grid storage: f32 (default), delta (fp32 offsets from ambient), f16 or bf16\n");
     exit(1);
 }
 
@@ -203,7 +613,7 @@ void usage(int argc, char **argv)
 
 int main(int argc, char** argv)
 {
-    if (argc != 7)
+    if (argc < 7 || argc > 9)
     {
         usage(argc,argv);
     }
@@ -218,6 +628,17 @@ int main(int argc, char** argv)
     int numCols = atoi(argv[1]);
     int numRows = atoi(argv[1]);
     int layers = atoi(argv[2]);
+    int depth = (argc >= 8) ? atoi(argv[7]) : 1;
+    char *sname = (argc == 9) ? argv[8] : "f32";
+    int storage;
+    if (!strcmp(sname, "f32") || !strcmp(sname, "delta"))
+        storage = STORE_F32;
+    else if (!strcmp(sname, "f16"))
+        storage = STORE_F16;
+    else if (!strcmp(sname, "bf16"))
+        storage = STORE_BF16;
+    else
+        usage(argc, argv);
 
     /* calculating parameters*/
 
@@ -252,18 +673,67 @@ int main(int argc, char** argv)
 
     memcpy(tempCopy,tempIn, size * sizeof(float));
 
+    /* reference temperature: ambient for fp32 offsets, the middle of
+       the initial temperatures for 16-bit grids */
+    float ref = 0.0;
+    if (!strcmp(sname, "delta"))
+        ref = amb_temp;
+    else if (storage != STORE_F32) {
+        float lo = tempIn[0], hi = tempIn[0];
+        int i;
+        for (i = 1; i < size; i++) {
+            if (tempIn[i] < lo) lo = tempIn[i];
+            if (tempIn[i] > hi) hi = tempIn[i];
+        }
+        ref = 0.5f * (lo + hi);
+    }
+    size_t esize = (storage == STORE_F32) ? sizeof(float) : sizeof(unsigned short);
+    void *gPower = malloc(size * esize);
+    void *gIn = malloc(size * esize);
+    void *gOut = calloc(size, esize);
+
     struct timeval start, stop;
-    float time;
+    float time, timeCPU, timeConv;
+    gettimeofday(&start,NULL);
+    store_grid(gPower, powerIn, size, 0.0, storage);
+    store_grid(gIn, tempIn, size, ref, storage);
+    gettimeofday(&stop,NULL);
+    timeConv = (stop.tv_usec-start.tv_usec)*1.0e-6 + stop.tv_sec - start.tv_sec;
     gettimeofday(&start,NULL);
-    computeTempOMP(powerIn, tempIn, tempOut, numCols, numRows, layers, Cap, Rx, Ry, Rz, dt,iterations);
+    computeTempOMP(gPower, gIn, gOut, numCols, numRows, layers, Cap, Rx, Ry, Rz, dt,iterations,depth,storage,ref);
     gettimeofday(&stop,NULL);
     time = (stop.tv_usec-start.tv_usec)*1.0e-6 + stop.tv_sec - start.tv_sec;
+    gettimeofday(&start,NULL);
     computeTempCPU(powerIn, tempCopy, answer, numCols, numRows, layers, Cap, Rx, Ry, Rz, dt,iterations);
+    gettimeofday(&stop,NULL);
+    timeCPU = (stop.tv_usec-start.tv_usec)*1.0e-6 + stop.tv_sec - start.tv_sec;
 
-    float acc = accuracy(tempOut,answer,numRows*numCols*layers);
+    /* the last iteration is in the output buffer for an odd number of
+       iterations and in the input buffer for an even one */
+    float *result = tempOut;
+    float *resultCPU = (iterations % 2) ? answer : tempCopy;
+    gettimeofday(&start,NULL);
+    load_grid(result, (iterations % 2) ? gOut : gIn, size, ref, storage);
+    gettimeofday(&stop,NULL);
+    timeConv += (stop.tv_usec-start.tv_usec)*1.0e-6 + stop.tv_sec - start.tv_sec;
+
+    /* 16 flops per cell update; the bandwidth counts the minimum traffic
+       of reading temperature and power and writing temperature once */
+    double updates = (double)size * iterations;
+    float acc = accuracy(result,resultCPU,numRows*numCols*layers);
+    float maxerr = 0.0;
+    int i;
+    for (i = 0; i < size; i++)
+        if (fabsf(result[i] - resultCPU[i]) > maxerr)
+            maxerr = fabsf(result[i] - resultCPU[i]);
+    printf("Storage: %s, reference %g, conversion %.3f (s)\n", sname, ref, timeConv);
     printf("Time: %.3f (s)\n",time);
-    printf("Accuracy: %e\n",acc);
-    writeoutput(tempOut,numRows, numCols, layers, ofile);
+    printf("OMP: %.3f GFLOP/s, %.2f GB/s effective\n", 16.0 * updates / time / 1e9, 3.0 * esize * updates / time / 1e9);
+    printf("CPU: %.3f (s), %.3f GFLOP/s, %.2f GB/s effective\n", timeCPU, 16.0 * updates / timeCPU / 1e9, 12.0 * updates / timeCPU / 1e9);
+    printf("Speedup: %.2fx\n", timeCPU / time);
+    printf("Accuracy: %e (max error %e)\n",acc,maxerr);
+    writeoutput(result,numRows, numCols, layers, ofile);
+    free(gIn); free(gOut); free(gPower);
     free(tempIn);
     free(tempOut); free(powerIn);
     return 0;
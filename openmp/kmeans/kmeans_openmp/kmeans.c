@@ -76,6 +76,7 @@
 #include <sys/types.h>
 #include <fcntl.h>
 #include <omp.h>
+#include "../../../common/omp_rt.h"
 #include "getopt.h"
 
 #include "kmeans.h"
@@ -204,6 +205,7 @@ int main(int argc, char **argv) {
 
 	memcpy(attributes[0], buf, numObjects*numAttributes*sizeof(float));
 
+	omp_rt_init(num_omp_threads);
 	timing = omp_get_wtime();
     for (i=0; i<nloops; i++) {
         
@@ -234,6 +236,7 @@ int main(int argc, char **argv) {
     }
 */
 	printf("Time for process: %f\n", timing);
+	omp_rt_report("assignment");
 
     free(attributes);
     free(cluster_centres[0]);
@@ -65,6 +65,7 @@
 #include <math.h>
 #include "kmeans.h"
 #include <omp.h>
+#include "../../../common/omp_rt.h"
 
 #define RANDOM_MAX 2147483647
 
@@ -75,6 +76,21 @@
 extern double wtime(void);
 extern int num_omp_threads;
 
+/* floats between the membership changes of two threads (a cache line) */
+#define DELTA_STRIDE 16
+
+/* arguments of assign_points() */
+typedef struct {
+    float  **feature;                   /* [npoints][nfeatures] */
+    float  **clusters;                  /* [nclusters][nfeatures] */
+    int      nfeatures;
+    int      nclusters;
+    int     *membership;                /* [npoints] */
+    int    **partial_new_centers_len;   /* [nthreads][nclusters] */
+    float ***partial_new_centers;       /* [nthreads][nclusters][nfeatures] */
+    float   *partial_delta;             /* [nthreads * DELTA_STRIDE] */
+} assign_args;
+
 int find_nearest_point(float  *pt,          /* [nfeatures] */
                        int     nfeatures,
                        float **pts,         /* [npts][nfeatures] */
@@ -112,6 +128,37 @@ float euclid_dist_2(float *pt1,
 }
 
 
+/*----< assign_points() >----------------------------------------------------*/
+/* omp_rt_for body: assigns points begin to end-1 to their nearest cluster
+   and adds them to the partial new centers of the calling thread */
+static void assign_points(int begin, int end, void *arg)
+{
+    assign_args *a = (assign_args *) arg;
+    int tid = omp_get_thread_num();
+    int i, j, index;
+    float delta = 0.0;
+
+    for (i=begin; i<end; i++) {
+	/* find the index of nestest cluster centers */
+	index = find_nearest_point(a->feature[i],
+		     a->nfeatures,
+		     a->clusters,
+		     a->nclusters);
+	/* if membership changes, increase delta by 1 */
+	if (a->membership[i] != index) delta += 1.0;
+
+	/* assign the membership to object i */
+	a->membership[i] = index;
+
+	/* update new cluster centers : sum of all objects located
+	   within */
+	a->partial_new_centers_len[tid][index]++;
+	for (j=0; j<a->nfeatures; j++)
+	   a->partial_new_centers[tid][index][j] += a->feature[i][j];
+    }
+    a->partial_delta[tid * DELTA_STRIDE] += delta;
+}
+
 /*----< kmeans_clustering() >---------------------------------------------*/
 float** kmeans_clustering(float **feature,    /* in: [npoints][nfeatures] */
                           int     nfeatures,
@@ -126,6 +173,8 @@ float** kmeans_clustering(float **feature,    /* in: [npoints][nfeatures] */
 	float  **new_centers;				/* [nclusters][nfeatures] */
 	float  **clusters;					/* out: [nclusters][nfeatures] */
     float    delta;
+    int      more;
+    assign_args args;
         
     double   timing;
 
@@ -176,38 +225,28 @@ float** kmeans_clustering(float **feature,    /* in: [npoints][nfeatures] */
         for (j=0; j<nclusters; j++)
             partial_new_centers[i][j] = (float*)calloc(nfeatures, sizeof(float));
 	}
+    args.feature = feature;
+    args.clusters = clusters;
+    args.nfeatures = nfeatures;
+    args.nclusters = nclusters;
+    args.membership = membership;
+    args.partial_new_centers_len = partial_new_centers_len;
+    args.partial_new_centers = partial_new_centers;
+    args.partial_delta = (float*) calloc(nthreads * DELTA_STRIDE, sizeof(float));
+
 	printf("num of threads = %d\n", num_omp_threads);
+    /* the assignment of the points is an omp_rt_for, see omp_rt.h */
+    #pragma omp parallel if (omp_rt_persistent()) private(i, j, k)
     do {
-        delta = 0.0;
-		omp_set_num_threads(num_omp_threads);
-		#pragma omp parallel \
-                shared(feature,clusters,membership,partial_new_centers,partial_new_centers_len)
+        omp_rt_for(0, npoints, OMP_RT_STATIC, 0, assign_points, &args);
+
+        #pragma omp single
         {
-            int tid = omp_get_thread_num();				
-            #pragma omp for \
-                        private(i,j,index) \
-                        firstprivate(npoints,nclusters,nfeatures) \
-                        schedule(static) \
-                        reduction(+:delta)
-            for (i=0; i<npoints; i++) {
-	        /* find the index of nestest cluster centers */					
-	        index = find_nearest_point(feature[i],
-		             nfeatures,
-		             clusters,
-		             nclusters);				
-	        /* if membership changes, increase delta by 1 */
-	        if (membership[i] != index) delta += 1.0;
-
-	        /* assign the membership to object i */
-	        membership[i] = index;
-				
-	        /* update new cluster centers : sum of all objects located
-		       within */
-	        partial_new_centers_len[tid][index]++;				
-	        for (j=0; j<nfeatures; j++)
-		       partial_new_centers[tid][index][j] += feature[i][j];
-            }
-        } /* end of #pragma omp parallel */
+        delta = 0.0;
+        for (j=0; j<nthreads; j++) {
+            delta += args.partial_delta[j * DELTA_STRIDE];
+            args.partial_delta[j * DELTA_STRIDE] = 0.0;
+        }
 
         /* let the main thread perform the array reduction */
         for (i=0; i<nclusters; i++) {
@@ -230,10 +269,13 @@ float** kmeans_clustering(float **feature,    /* in: [npoints][nfeatures] */
 			}
 			new_centers_len[i] = 0;   /* set back to 0 */
 		}
-        
-    } while (delta > threshold && loop++ < 500);
+
+        more = delta > threshold && loop++ < 500;
+        } /* end of #pragma omp single */
+    } while (more);
 
     
+    free(args.partial_delta);
     free(new_centers[0]);
     free(new_centers);
     free(new_centers_len);
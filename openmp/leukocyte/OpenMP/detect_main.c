@@ -21,6 +21,7 @@ int main(int argc, char ** argv) {
 		omp_num_threads = atoi(argv[2]);
 		}
 	printf("Num of threads: %d\n", omp_num_threads);
+	scratch_init(omp_num_threads);
 	// Open video file
 	char *video_file_name;
 	video_file_name = argv[3];
@@ -41,9 +42,12 @@ int main(int argc, char ** argv) {
 	printf("Detecting cells in frame 0\n");
 	
 	// Get gradient matrices in x and y directions
+	long long gradient_start_time = get_time();
 	MAT *grad_x = gradient_x(image_chopped);
 	MAT *grad_y = gradient_y(image_chopped);
 	
+	long long gradient_end_time = get_time();
+	
 	m_free(image_chopped);
 	
 	// Get GICOV matrix corresponding to image gradients
@@ -68,6 +72,7 @@ int main(int argc, char ** argv) {
 	long long dilate_end_time = get_time();
 	
 	// Find possible matches for cell centers based on GICOV and record the rows/columns in which they are found
+	long long select_start_time = get_time();
 	pair_counter = 0;
 	crow = (int *) malloc(max_gicov->m * max_gicov->n * sizeof(int));
 	ccol = (int *) malloc(max_gicov->m * max_gicov->n * sizeof(int));
@@ -219,6 +224,8 @@ int main(int argc, char ** argv) {
 		}
 	}
 
+	long long select_end_time = get_time();
+
 	// Free memory
 	free(V);
 	free(ccol);
@@ -243,8 +250,10 @@ int main(int argc, char ** argv) {
 	// Report the breakdown of the detection runtime
 	printf("Detection runtime\n");
 	printf("-----------------\n");
+	printf("        Gradients: %.5f seconds\n", ((float) (gradient_end_time - gradient_start_time)) / (1000*1000));
 	printf("GICOV computation: %.5f seconds\n", ((float) (GICOV_end_time - GICOV_start_time)) / (1000*1000));
 	printf("   GICOV dilation: %.5f seconds\n", ((float) (dilate_end_time - dilate_start_time)) / (1000*1000));
+	printf(" Cells and snakes: %.5f seconds\n", ((float) (select_end_time - select_start_time)) / (1000*1000));
 	printf("            Total: %.5f seconds\n", ((float) (get_time() - program_start_time)) / (1000*1000));
 	
 	// Now that the cells have been detected in the first frame,
@@ -256,6 +265,8 @@ int main(int argc, char ** argv) {
 	ellipsetrack(cell_file, QAX_CENTERS, QAY_CENTERS, k_count, radius, num_snaxels, num_frames);
 	printf("           Total: %.5f seconds\n", ((float) (get_time() - tracking_start_time)) / (float) (1000*1000*num_frames));
 	
+	scratch_finalize();
+	
 	// Report total program execution time
     printf("\nTotal application run time: %.5f seconds\n", ((float) (get_time() - program_start_time)) / (1000*1000));
 
@@ -11,6 +11,8 @@
 #define MAX_RAD RADIUS * 2
 // The number of different sample ellipses to try
 #define NCIRCLES 7
+// Pixels of a row whose GICOV scores are computed together
+#define GICOV_BLOCK 64
 
 
 extern MAT * m_inverse(MAT * A, MAT * out);
@@ -32,7 +34,7 @@ MAT * get_frame(avi_t *cell_file, int frame_num, int cropped, int scaled) {
 	int dummy;
 	int width = AVI_video_width(cell_file);
 	int height = AVI_video_height(cell_file);
-	unsigned char *image_buf = (unsigned char *) malloc(width * height);
+	unsigned char *image_buf = (unsigned char *) scratch_alloc(width * height);
 
 	// There are 600 frames in this file (i.e. frame_num = 600 causes an error)
 	AVI_set_video_position(cell_file, frame_num);
@@ -52,7 +54,7 @@ MAT * get_frame(avi_t *cell_file, int frame_num, int cropped, int scaled) {
 		image_chopped = chop_flip_image(image_buf, height, width, 0, height - 1, 0, width - 1, scaled);
 	}
 	
-	free(image_buf);
+	scratch_free(image_buf);
 	
 	return image_chopped;
 }
@@ -60,7 +62,7 @@ MAT * get_frame(avi_t *cell_file, int frame_num, int cropped, int scaled) {
 
 // Flips the specified image and crops it to the specified dimensions
 MAT * chop_flip_image(unsigned char *image, int height, int width, int top, int bottom, int left, int right, int scaled) {
-	MAT * result = m_get(bottom - top + 1, right - left + 1);
+	MAT * result = scratch_m_get(bottom - top + 1, right - left + 1);
 	int i, j;
 	if (scaled) {
 		double scale = 1.0 / 255.0;
@@ -81,8 +83,13 @@ MAT * chop_flip_image(unsigned char *image, int height, int width, int top, int
 
 // Given x- and y-gradients of a video frame, computes the GICOV
 //  score for each sample ellipse at every pixel in the frame
+// Each row is processed in blocks of GICOV_BLOCK pixels: the sample point offsets are
+//  precomputed, so for every sample point the gradients of a whole block are contiguous
+//  runs of two gradient rows and every step below vectorizes across the pixels of the
+//  block. Each pixel still accumulates its samples in the same order as a pixel-by-pixel
+//  evaluation, so the scores are identical.
 MAT * ellipsematching(MAT * grad_x, MAT * grad_y) {
-	int i, n, k;
+	int i, j, n, k;
 	// Compute the sine and cosine of the angle to each point in each sample circle
 	//  (which are the same across all sample circles)
 	double sin_angle[NPOINTS], cos_angle[NPOINTS], theta[NPOINTS];
@@ -110,46 +117,51 @@ MAT * ellipsematching(MAT * grad_x, MAT * grad_y) {
 	
 	// Split the work among multiple threads, if OPEN is defined
 	#ifdef OPEN
-	#pragma omp parallel for num_threads(omp_num_threads)
+	#pragma omp parallel for num_threads(omp_num_threads) private(i, k, n)
 	#endif
-	// Scan from left to right, top to bottom, computing GICOV values
-	for (i = MaxR; i < width - MaxR; i++) {
-		double Grad[NPOINTS];
-		int j, k, n, x, y;
+	// Scan from top to bottom, computing GICOV values of a block of pixels of the row at a time
+	for (j = MaxR; j < height - MaxR; j++) {
+		double Grad[NPOINTS][GICOV_BLOCK];
+		double sum[GICOV_BLOCK], mean[GICOV_BLOCK], var[GICOV_BLOCK], max_GICOV[GICOV_BLOCK];
+		int b, len;
 		
-		for (j = MaxR; j < height - MaxR; j++) {
-			// Initialize the maximal GICOV score to 0
-			double max_GICOV = 0;	
+		for (i = MaxR; i < width - MaxR; i += GICOV_BLOCK) {
+			len = width - MaxR - i < GICOV_BLOCK ? width - MaxR - i : GICOV_BLOCK;
+			
+			// Initialize the maximal GICOV scores to 0
+			for (b = 0; b < len; b++) max_GICOV[b] = 0;
 			
 			// Iterate across each stencil
 			for (k = 0; k < NCIRCLES; k++) {
-				// Iterate across each sample point in the current stencil
-				for (n = 0; n < NPOINTS; n++)	{
-					// Determine the x- and y-coordinates of the current sample point
-					y = j + tY[k][n];
-					x = i + tX[k][n];
-					
-					// Compute the combined gradient value at the current sample point
-					Grad[n] = m_get_val(grad_x, y, x) * cos_angle[n] + m_get_val(grad_y, y, x) * sin_angle[n];
+				// Combined gradient values at the current sample point of all pixels of the block
+				for (n = 0; n < NPOINTS; n++) {
+					const double * gx = &grad_x->me[j + tY[k][n]][i + tX[k][n]];
+					const double * gy = &grad_y->me[j + tY[k][n]][i + tX[k][n]];
+					for (b = 0; b < len; b++)
+						Grad[n][b] = gx[b] * cos_angle[n] + gy[b] * sin_angle[n];
 				}
 				
 				// Compute the mean gradient value across all sample points
-				double sum = 0.0;
-				for (n = 0; n < NPOINTS; n++) sum += Grad[n];
-				double mean = sum / (double)NPOINTS;
+				for (b = 0; b < len; b++) sum[b] = 0.0;
+				for (n = 0; n < NPOINTS; n++)
+					for (b = 0; b < len; b++) sum[b] += Grad[n][b];
+				for (b = 0; b < len; b++) mean[b] = sum[b] / (double)NPOINTS;
 				
 				// Compute the variance of the gradient values
-				double var = 0.0;				
-				for (n = 0; n < NPOINTS; n++)	{
-					sum = Grad[n] - mean;
-					var += sum * sum;
-				}				
-				var = var / (double) (NPOINTS - 1);
+				for (b = 0; b < len; b++) var[b] = 0.0;
+				for (n = 0; n < NPOINTS; n++)
+					for (b = 0; b < len; b++) {
+						double d = Grad[n][b] - mean[b];
+						var[b] += d * d;
+					}
 				
 				// Keep track of the maximal GICOV value seen so far
-				if (mean * mean / var > max_GICOV) {
-					m_set_val(gicov, j, i, mean / sqrt(var));
-					max_GICOV = mean * mean / var;
+				for (b = 0; b < len; b++) {
+					double v = var[b] / (double) (NPOINTS - 1);
+					if (mean[b] * mean[b] / v > max_GICOV[b]) {
+						gicov->me[j][i + b] = mean[b] / sqrt(v);
+						max_GICOV[b] = mean[b] * mean[b] / v;
+					}
 				}
 			}
 		}
@@ -179,38 +191,92 @@ MAT * structuring_element(int radius) {
 
 // Performs an image dilation on the specified matrix
 //  using the specified structuring element
+// Every row of the structuring element is split into runs of non-zero elements. The image
+//  is dilated by each horizontal run length with the van Herk/Gil-Werman running max, a
+//  constant 3 comparisons per pixel whatever the length, and the result is the max over the
+//  runs of these row maxima shifted by the run's position. Pixels outside the image count
+//  as 0, which is also the initial maximum of the brute-force definition.
 MAT * dilate_f(MAT * img_in, MAT * strel) {
-	MAT * dilated = m_get(img_in->m, img_in->n);
+	int m = img_in->m, n = img_in->n;
+	MAT * dilated = m_get(m, n);
 	
 	// Find the center of the structuring element
-	int el_center_i = strel->m / 2, el_center_j = strel->n / 2, i;
+	int el_center_i = strel->m / 2, el_center_j = strel->n / 2;
+	int el_i, el_j, i, r, len;
 	
-	// Split the work among multiple threads, if OPEN is defined
-	#ifdef OPEN
-	#pragma omp parallel for num_threads(omp_num_threads)
-	#endif
-	// Iterate across the input matrix
-	for (i = 0; i < img_in->m; i++) {
-		int j, el_i, el_j, x, y;
-		for (j = 0; j < img_in->n; j++) {
-			double max = 0.0, temp;
-			// Iterate across the structuring element
-			for (el_i = 0; el_i < strel->m; el_i++) {
-				for (el_j = 0; el_j < strel->n; el_j++) {
-					y = i - el_center_i + el_i;
-					x = j - el_center_j + el_j;
-					// Make sure we have not gone off the edge of the matrix
-					if (y >=0 && x >= 0 && y < img_in->m && x < img_in->n && m_get_val(strel, el_i, el_j) != 0) {
-						// Determine if this is maximal value seen so far
-						temp = m_get_val(img_in, y, x);
-						if (temp > max)	max = temp;
-					}
-				}
+	// Runs of the structuring element: row, first column, length
+	int * run_i = malloc(strel->m * strel->n * sizeof(int));
+	int * run_j = malloc(strel->m * strel->n * sizeof(int));
+	int * run_len = malloc(strel->m * strel->n * sizeof(int));
+	int nruns = 0, run;
+	for (el_i = 0; el_i < strel->m; el_i++) {
+		for (el_j = 0; el_j < strel->n; el_j++) {
+			if (m_get_val(strel, el_i, el_j) != 0 && (el_j == 0 || m_get_val(strel, el_i, el_j - 1) == 0)) {
+				run_i[nruns] = el_i;
+				run_j[nruns] = el_j;
+				run_len[nruns] = 0;
+				nruns++;
 			}
-			// Store the maximum value found
-			m_set_val(dilated, i, j, max);
+			if (m_get_val(strel, el_i, el_j) != 0) run_len[nruns - 1]++;
 		}
 	}
+	
+	// Rows padded with zeros by pad on both sides, wide enough for every run position
+	int pad = strel->n, width = n + 2 * pad;
+	double * windowed = malloc((size_t) m * width * sizeof(double));
+	
+	for (len = 1; len <= strel->n; len++) {
+		for (run = 0; run < nruns; run++)
+			if (run_len[run] == len) break;
+		if (run == nruns) continue;
+		
+		// windowed[r][t] = max of padded row r over [t, t + len - 1]
+		#ifdef OPEN
+		#pragma omp parallel for num_threads(omp_num_threads)
+		#endif
+		for (r = 0; r < m; r++) {
+			double * g = malloc(width * sizeof(double));
+			double * h = malloc(width * sizeof(double));
+			double * w = &windowed[(size_t) r * width];
+			int t;
+			
+			// prefix max (g) and suffix max (h) within blocks of len
+			for (t = 0; t < width; t++) {
+				double p = (t >= pad && t < pad + n) ? img_in->me[r][t - pad] : 0.0;
+				g[t] = (t % len == 0 || p > g[t - 1]) ? p : g[t - 1];
+				h[t] = p;
+			}
+			for (t = width - 2; t >= 0; t--)
+				if (t % len != len - 1 && h[t + 1] > h[t]) h[t] = h[t + 1];
+			for (t = 0; t + len - 1 < width; t++)
+				w[t] = h[t] > g[t + len - 1] ? h[t] : g[t + len - 1];
+			
+			free(g);
+			free(h);
+		}
+		
+		// Combine the shifted row maxima of every run of this length
+		#ifdef OPEN
+		#pragma omp parallel for num_threads(omp_num_threads) private(run, r)
+		#endif
+		for (i = 0; i < m; i++) {
+			int j;
+			double * out = dilated->me[i];
+			for (run = 0; run < nruns; run++) {
+				if (run_len[run] != len) continue;
+				r = i - el_center_i + run_i[run];
+				if (r < 0 || r >= m) continue;
+				const double * w = &windowed[(size_t) r * width + pad - el_center_j + run_j[run]];
+				for (j = 0; j < n; j++)
+					if (w[j] > out[j]) out[j] = w[j];
+			}
+		}
+	}
+	
+	free(windowed);
+	free(run_len);
+	free(run_j);
+	free(run_i);
 
 	return dilated;
 }
@@ -372,12 +438,12 @@ VEC * getsampling(MAT * m, int ns)
 	int N = m->n > m->m ? m-> n:m->m, M = ns;
 	int * aindex, * bindex, * cindex, * dindex;
 	int i, j;
-	VEC * retval = v_get(N*M);
+	VEC * retval = scratch_v_get(N*M);
 
-	aindex = malloc(N*sizeof(int));
-	bindex = malloc(N*sizeof(int));
-	cindex = malloc(N*sizeof(int));
-	dindex = malloc(N*sizeof(int));
+	aindex = scratch_alloc(N*sizeof(int));
+	bindex = scratch_alloc(N*sizeof(int));
+	cindex = scratch_alloc(N*sizeof(int));
+	dindex = scratch_alloc(N*sizeof(int));
 
 	for(i = 1; i < N; i++)
 		aindex[i] = i-1;
@@ -411,10 +477,10 @@ VEC * getsampling(MAT * m, int ns)
 		}
 	}
 
-	free(dindex);
-	free(cindex);
-	free(bindex);
-	free(aindex);
+	scratch_free(dindex);
+	scratch_free(cindex);
+	scratch_free(bindex);
+	scratch_free(aindex);
 
 	return retval;
 }
@@ -424,12 +490,12 @@ VEC * getfdriv(MAT * m, int ns)
 	int N = m->n > m->m ? m-> n:m->m, M = ns;
 	int * aindex, * bindex, * cindex, * dindex;
 	int i, j;
-	VEC * retval = v_get(N*M);
+	VEC * retval = scratch_v_get(N*M);
 
-	aindex = malloc(N*sizeof(int));
-	bindex = malloc(N*sizeof(int));
-	cindex = malloc(N*sizeof(int));
-	dindex = malloc(N*sizeof(int));
+	aindex = scratch_alloc(N*sizeof(int));
+	bindex = scratch_alloc(N*sizeof(int));
+	cindex = scratch_alloc(N*sizeof(int));
+	dindex = scratch_alloc(N*sizeof(int));
 
 	for(i = 1; i < N; i++)
 		aindex[i] = i-1;
@@ -463,10 +529,10 @@ VEC * getfdriv(MAT * m, int ns)
 		}
 	}
 
-	free(dindex);
-	free(cindex);
-	free(bindex);
-	free(aindex);
+	scratch_free(dindex);
+	scratch_free(cindex);
+	scratch_free(bindex);
+	scratch_free(aindex);
 
 	return retval;
 }
@@ -476,7 +542,7 @@ MAT * linear_interp2(MAT * m, VEC * X, VEC * Y)
 {
 	//Kind of assumes X and Y have same len!
 
-	MAT * retval = m_get(1, X->dim);
+	MAT * retval = scratch_m_get(1, X->dim);
 	double x_coord, y_coord, new_val, a, b;
 	int l, k, i;
 
@@ -510,32 +576,35 @@ void splineenergyform01(MAT * Cx, MAT * Cy, MAT * Ix, MAT * Iy, int ns, double d
 	MAT * Ix1_mat, * Ix2_mat, * Iy1_mat, * Iy2_mat;
 	int i,j, N, * aindex, * bindex, * cindex, * dindex;
 
+	// All temporaries come from this thread's scratch pool and are given back at the end
+	scratch_mark mark = scratch_begin();
+
 	X = getsampling(Cx, ns);
 	Y = getsampling(Cy, ns);
 	Xs = getfdriv(Cx, ns);
 	Ys = getfdriv(Cy, ns);
 
-	Nx = v_get(Ys->dim);
+	Nx = scratch_v_get(Ys->dim);
 	for(i = 0; i < Nx->dim; i++)
 		v_set_val(Nx, i, v_get_val(Ys, i) / sqrt(v_get_val(Xs, i)*v_get_val(Xs, i) + v_get_val(Ys, i)*v_get_val(Ys, i)));
 
-	Ny = v_get(Xs->dim);
+	Ny = scratch_v_get(Xs->dim);
 	for(i = 0; i < Ny->dim; i++)
 		v_set_val(Ny, i, -1.0 * v_get_val(Xs, i) / sqrt(v_get_val(Xs, i)*v_get_val(Xs, i) + v_get_val(Ys, i)*v_get_val(Ys, i)));
 	
-	X1 = v_get(Nx->dim);
+	X1 = scratch_v_get(Nx->dim);
 	for(i = 0; i < X1->dim; i++)
 		v_set_val(X1, i, v_get_val(X, i) + delta*v_get_val(Nx, i));
 
-	Y1 = v_get(Ny->dim);
+	Y1 = scratch_v_get(Ny->dim);
 	for(i = 0; i < Y1->dim; i++)
 		v_set_val(Y1, i, v_get_val(Y, i) + delta*v_get_val(Ny, i));
 
-	X2 = v_get(Nx->dim);
+	X2 = scratch_v_get(Nx->dim);
 	for(i = 0; i < X2->dim; i++)
 		v_set_val(X2, i, v_get_val(X, i) - delta*v_get_val(Nx, i));
 
-	Y2 = v_get(Ny->dim);
+	Y2 = scratch_v_get(Ny->dim);
 	for(i = 0; i < Y2->dim; i++)
 		v_set_val(Y2, i, v_get_val(Y, i) + delta*v_get_val(Ny, i));
 
@@ -544,10 +613,10 @@ void splineenergyform01(MAT * Cx, MAT * Cy, MAT * Ix, MAT * Iy, int ns, double d
 	Ix2_mat = linear_interp2(Ix, X2, Y2);
 	Iy2_mat = linear_interp2(Iy, X2, Y2);
 
-	Ix1 = v_get(Ix1_mat->n);
-	Iy1 = v_get(Iy1_mat->n);
-	Ix2 = v_get(Ix2_mat->n);
-	Iy2 = v_get(Iy2_mat->n);
+	Ix1 = scratch_v_get(Ix1_mat->n);
+	Iy1 = scratch_v_get(Iy1_mat->n);
+	Ix2 = scratch_v_get(Ix2_mat->n);
+	Iy2 = scratch_v_get(Iy2_mat->n);
 
 	Ix1 = get_row(Ix1_mat, 0, Ix1);
 	Iy1 = get_row(Iy1_mat, 0, Iy1);
@@ -558,10 +627,10 @@ void splineenergyform01(MAT * Cx, MAT * Cy, MAT * Ix, MAT * Iy, int ns, double d
 
 	//VEC * retval = v_get(N*ns);
 
-	aindex = malloc(N*sizeof(int));
-	bindex = malloc(N*sizeof(int));
-	cindex = malloc(N*sizeof(int));
-	dindex = malloc(N*sizeof(int));
+	aindex = scratch_alloc(N*sizeof(int));
+	bindex = scratch_alloc(N*sizeof(int));
+	cindex = scratch_alloc(N*sizeof(int));
+	dindex = scratch_alloc(N*sizeof(int));
 
 	for(i = 1; i < N; i++)
 		aindex[i] = i-1;
@@ -579,20 +648,20 @@ void splineenergyform01(MAT * Cx, MAT * Cy, MAT * Ix, MAT * Iy, int ns, double d
 	dindex[N-2] = 0;
 	dindex[N-1] = 1;
 
-	XY = v_get(Xs->dim);
+	XY = scratch_v_get(Xs->dim);
 	for(i = 0; i < Xs->dim; i++)
 		v_set_val(XY, i, v_get_val(Xs, i) * v_get_val(Ys, i));
 
-	XX = v_get(Xs->dim);
+	XX = scratch_v_get(Xs->dim);
 	for(i = 0; i < Xs->dim; i++)
 		v_set_val(XX, i, v_get_val(Xs, i) * v_get_val(Xs, i));
 
-	YY = v_get(Ys->dim);
+	YY = scratch_v_get(Ys->dim);
 	for(i = 0; i < Xs->dim; i++)
 		v_set_val(YY, i, v_get_val(Ys, i) * v_get_val(Ys, i));
 
-	dCx = v_get(Cx->m);
-	dCy = v_get(Cy->m);
+	dCx = scratch_v_get(Cx->m);
+	dCy = scratch_v_get(Cy->m);
 
 	//get control points for splines
 	for(i = 0; i < Cx->m; i++)
@@ -696,13 +765,5 @@ void splineenergyform01(MAT * Cx, MAT * Cy, MAT * Ix, MAT * Iy, int ns, double d
 			m_set_val(Cy, 0, i, m_get_val(Cy, 1, i) + dt*v_get_val(dCy, i));
 	}
 
-	v_free(dCy); v_free(dCx); v_free(YY); v_free(XX); v_free(XY);
-
-	free(dindex); free(cindex); free(bindex); free(aindex); 
-
-	v_free(Iy2); v_free(Ix2); v_free(Iy1); v_free(Ix1); 
-
-	m_free(Iy2_mat); m_free(Ix2_mat); m_free(Iy1_mat); m_free(Ix1_mat); 
-
-	v_free(Y2); v_free(X2); v_free(Y1); v_free(X1); v_free(Ny); v_free(Nx); v_free(Ys); v_free(Xs); v_free(Y); v_free(X); 
+	scratch_end(mark);
 }
@@ -14,7 +14,7 @@ inline int double_eq(double f1, double f2)
 MAT * gradient_x(MAT * input)
 {
 	int i, j;
-	MAT * result = m_get(input->m, input->n);
+	MAT * result = scratch_m_get(input->m, input->n);
 
 	for(i = 0; i < result->m; i++)
 	{
@@ -36,7 +36,7 @@ MAT * gradient_x(MAT * input)
 MAT * gradient_y(MAT * input)
 {
 	int i, j;
-	MAT * result = m_get(input->m, input->n);
+	MAT * result = scratch_m_get(input->m, input->n);
 	
 	for(i = 0; i < result->n; i++)
 	{
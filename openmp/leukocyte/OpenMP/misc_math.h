@@ -2,6 +2,7 @@
 #define MISC_MATH_H
 
 #include "matrix.h"
+#include "scratch.h"
 
 #define PI 3.14159
 
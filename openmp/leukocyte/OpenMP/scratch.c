@@ -0,0 +1,266 @@
+#include "scratch.h"
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// Alignment of everything handed out by a pool (a cache line)
+#define SCRATCH_ALIGN 64
+// Size of the first block of a pool
+#define SCRATCH_BLOCK_MIN (256 * 1024)
+
+
+struct scratch_block {
+	scratch_block *next;
+	size_t size;
+	char *data;
+};
+
+typedef struct {
+	scratch_block *first;   // chain of blocks
+	scratch_block *block;   // block being bumped (NULL before the first allocation)
+	size_t used;            // bytes used in 'block'
+	int depth;              // number of open scopes
+	scratch_mark frame;     // mark saved by scratch_frame_begin
+	long long heap_calls;   // heap calls made on behalf of this thread
+	char pad[SCRATCH_ALIGN];
+} scratch_pool;
+
+
+static scratch_pool *pools = NULL;
+static int num_pools = 0;
+
+
+// Creates one pool for each of the num_threads OpenMP threads
+void scratch_init(int num_threads) {
+	num_pools = num_threads;
+	pools = (scratch_pool *) calloc(num_pools, sizeof(scratch_pool));
+}
+
+
+// Frees all pools
+void scratch_finalize(void) {
+	int i;
+	for (i = 0; i < num_pools; i++) {
+		scratch_block *block = pools[i].first;
+		while (block != NULL) {
+			scratch_block *next = block->next;
+			free(block);
+			block = next;
+		}
+	}
+	free(pools);
+	pools = NULL;
+	num_pools = 0;
+}
+
+
+// Returns the pool of the calling thread
+static scratch_pool *scratch_pool_of_thread(void) {
+	int id = omp_get_thread_num();
+	if (id >= num_pools) {
+		fprintf(stderr, "scratch: no pool for thread %d (%d pools)\n", id, num_pools);
+		exit(-1);
+	}
+	return &pools[id];
+}
+
+
+// Allocates a block with at least 'size' usable bytes aligned to SCRATCH_ALIGN
+static scratch_block *scratch_block_new(scratch_pool *pool, size_t size) {
+	scratch_block *block = (scratch_block *) malloc(sizeof(scratch_block) + size + SCRATCH_ALIGN);
+	if (block == NULL) {
+		fprintf(stderr, "scratch: out of memory\n");
+		exit(-1);
+	}
+	pool->heap_calls++;
+	block->next = NULL;
+	block->size = size;
+	block->data = (char *) (((size_t) (block + 1) + SCRATCH_ALIGN - 1) & ~((size_t) SCRATCH_ALIGN - 1));
+	return block;
+}
+
+
+// Bumps the pool pointer by 'bytes', moving on to the next block
+//  (and chaining a new one at the end) if they do not fit
+static void *scratch_pool_alloc(scratch_pool *pool, size_t bytes) {
+	bytes = (bytes + SCRATCH_ALIGN - 1) & ~((size_t) SCRATCH_ALIGN - 1);
+	while (pool->block == NULL || pool->used + bytes > pool->block->size) {
+		scratch_block *next = (pool->block == NULL) ? pool->first : pool->block->next;
+		if (next == NULL) {
+			size_t size = (pool->block == NULL) ? SCRATCH_BLOCK_MIN : 2 * pool->block->size;
+			if (size < bytes) size = bytes;
+			next = scratch_block_new(pool, size);
+			if (pool->block == NULL) pool->first = next;
+			else pool->block->next = next;
+		}
+		pool->block = next;
+		pool->used = 0;
+	}
+	void *p = pool->block->data + pool->used;
+	pool->used += bytes;
+	return p;
+}
+
+
+// Replaces a chain of blocks by one block of the same total size
+static void scratch_pool_merge(scratch_pool *pool) {
+	if (pool->first == NULL || pool->first->next == NULL) return;
+	size_t size = 0;
+	scratch_block *block = pool->first;
+	while (block != NULL) {
+		scratch_block *next = block->next;
+		size += block->size;
+		free(block);
+		pool->heap_calls++;
+		block = next;
+	}
+	pool->first = scratch_block_new(pool, size);
+	pool->block = NULL;
+	pool->used = 0;
+}
+
+
+// Opens a scope on the calling thread's pool
+scratch_mark scratch_begin(void) {
+	scratch_pool *pool = scratch_pool_of_thread();
+	scratch_mark mark;
+	mark.block = pool->block;
+	mark.used = pool->used;
+	pool->depth++;
+	return mark;
+}
+
+
+// Closes the innermost scope on the calling thread's pool, giving
+//  back everything allocated from the pool since 'mark'
+void scratch_end(scratch_mark mark) {
+	scratch_pool *pool = scratch_pool_of_thread();
+	pool->block = mark.block;
+	pool->used = mark.used;
+	pool->depth--;
+	if (pool->depth == 0) scratch_pool_merge(pool);
+}
+
+
+// Opens a scope on every pool, so that the threads of the following
+//  parallel loops allocate from their pools (must not be called from
+//  within a parallel region)
+void scratch_frame_begin(void) {
+	int i;
+	for (i = 0; i < num_pools; i++) {
+		pools[i].frame.block = pools[i].block;
+		pools[i].frame.used = pools[i].used;
+		pools[i].depth++;
+	}
+}
+
+
+// Closes the scopes opened by scratch_frame_begin, resetting all pools at once
+void scratch_frame_end(void) {
+	int i;
+	for (i = 0; i < num_pools; i++) {
+		pools[i].block = pools[i].frame.block;
+		pools[i].used = pools[i].frame.used;
+		pools[i].depth--;
+		if (pools[i].depth == 0) scratch_pool_merge(&pools[i]);
+	}
+}
+
+
+// Returns 'bytes' bytes of uninitialized memory
+void *scratch_alloc(size_t bytes) {
+	scratch_pool *pool = scratch_pool_of_thread();
+	if (pool->depth > 0) return scratch_pool_alloc(pool, bytes);
+	pool->heap_calls++;
+	return malloc(bytes);
+}
+
+
+// Frees memory from scratch_alloc (nothing to do inside a scope)
+void scratch_free(void *p) {
+	scratch_pool *pool = scratch_pool_of_thread();
+	if (pool->depth > 0) return;
+	pool->heap_calls++;
+	free(p);
+}
+
+
+// Returns a zeroed m x n matrix, with its rows stored contiguously from A->base
+MAT *scratch_m_get(int m, int n) {
+	scratch_pool *pool = scratch_pool_of_thread();
+	if (pool->depth == 0) {
+		pool->heap_calls++;
+		return m_get(m, n);
+	}
+
+	int i;
+	MAT *A = (MAT *) scratch_pool_alloc(pool, sizeof(MAT) + (size_t) m * sizeof(Real *));
+	A->m = A->max_m = m;
+	A->n = A->max_n = n;
+	A->max_size = m * n;
+	A->me = (Real **) (A + 1);
+	A->base = (Real *) scratch_pool_alloc(pool, (size_t) m * n * sizeof(Real));
+	memset(A->base, 0, (size_t) m * n * sizeof(Real));
+	for (i = 0; i < m; i++)
+		A->me[i] = &A->base[i * n];
+	return A;
+}
+
+
+// Frees a matrix from scratch_m_get (nothing to do inside a scope)
+void scratch_m_free(MAT *A) {
+	scratch_pool *pool = scratch_pool_of_thread();
+	if (pool->depth > 0) return;
+	pool->heap_calls++;
+	m_free(A);
+}
+
+
+// Returns a zeroed vector of dimension dim
+VEC *scratch_v_get(int dim) {
+	scratch_pool *pool = scratch_pool_of_thread();
+	if (pool->depth == 0) {
+		pool->heap_calls++;
+		return v_get(dim);
+	}
+
+	VEC *v = (VEC *) scratch_pool_alloc(pool, sizeof(VEC));
+	v->dim = v->max_dim = dim;
+	v->ve = (Real *) scratch_pool_alloc(pool, (size_t) dim * sizeof(Real));
+	memset(v->ve, 0, (size_t) dim * sizeof(Real));
+	return v;
+}
+
+
+// Frees a vector from scratch_v_get (nothing to do inside a scope)
+void scratch_v_free(VEC *v) {
+	scratch_pool *pool = scratch_pool_of_thread();
+	if (pool->depth > 0) return;
+	pool->heap_calls++;
+	v_free(v);
+}
+
+
+// Returns the number of heap calls (allocations and frees) made so far by all pools
+long long scratch_heap_calls(void) {
+	long long calls = 0;
+	int i;
+	for (i = 0; i < num_pools; i++)
+		calls += pools[i].heap_calls;
+	return calls;
+}
+
+
+// Returns the total size of all pools in bytes
+size_t scratch_capacity(void) {
+	size_t size = 0;
+	int i;
+	for (i = 0; i < num_pools; i++) {
+		scratch_block *block = pools[i].first;
+		for (; block != NULL; block = block->next)
+			size += block->size;
+	}
+	return size;
+}
@@ -0,0 +1,45 @@
+#ifndef SCRATCH_H
+#define SCRATCH_H
+
+#include "matrix.h"
+#include <stddef.h>
+
+// Per-thread scratch pools for the matrices, vectors and buffers of the tracking loop
+//
+// Every OpenMP thread (by omp_get_thread_num()) owns a pool. While a scope is open on
+//  the calling thread's pool, scratch_m_get, scratch_v_get and scratch_alloc take memory
+//  from that pool by bumping a pointer, and everything taken since scratch_begin is given
+//  back at once by scratch_end. The matching scratch_*_free calls then do nothing. Outside
+//  of a scope the calls fall back to m_get, v_get, malloc and their free functions, so the
+//  same helpers can still be used by code that frees its own matrices.
+// A pool that runs out of room chains another block, and merges its blocks into one when
+//  its outermost scope closes, so once the pools have grown to the working set no more
+//  heap calls are made. scratch_heap_calls counts every heap call made by this module.
+
+typedef struct scratch_block scratch_block;
+
+// Position in a pool, returned by scratch_begin
+typedef struct {
+	scratch_block *block;
+	size_t used;
+} scratch_mark;
+
+extern void scratch_init(int num_threads);
+extern void scratch_finalize(void);
+
+extern scratch_mark scratch_begin(void);
+extern void scratch_end(scratch_mark mark);
+extern void scratch_frame_begin(void);
+extern void scratch_frame_end(void);
+
+extern void *scratch_alloc(size_t bytes);
+extern void scratch_free(void *p);
+extern MAT *scratch_m_get(int m, int n);
+extern void scratch_m_free(MAT *A);
+extern VEC *scratch_v_get(int dim);
+extern void scratch_v_free(VEC *v);
+
+extern long long scratch_heap_calls(void);
+extern size_t scratch_capacity(void);
+
+#endif
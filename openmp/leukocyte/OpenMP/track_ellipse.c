@@ -1,6 +1,10 @@
 #include "track_ellipse.h"
 
 
+// Over-relaxation factor of the red-black MGVF solver
+#define MGVF_OMEGA 1.4
+
+
 void ellipsetrack(avi_t *video, double *xc0, double *yc0, int Nc, int R, int Np, int Nf) {
 	/*
 	% ELLIPSETRACK tracks cells in the movie specified by 'video', at
@@ -53,10 +57,29 @@ void ellipsetrack(avi_t *video, double *xc0, double *yc0, int Nc, int R, int Np,
 		}
 	}
 	
+	// Allocate arrays so we can compute the MGVF matrices of all cells of a frame in one batch
+	double *xci = (double *) malloc(sizeof(double) * Nc);
+	double *yci = (double *) malloc(sizeof(double) * Nc);
+	double **ri = alloc_2d_double(Nc, Np);
+	double *ycavg = (double *) malloc(sizeof(double) * Nc);
+	int *u1 = (int *) malloc(sizeof(int) * Nc);
+	int *v1 = (int *) malloc(sizeof(int) * Nc);
+	MAT **IE = (MAT **) malloc(sizeof(MAT *) * Nc);
+	int *MGVF_iterations = (int *) malloc(sizeof(int) * Nc);
+	
 	// Keep track of the total time spent on computing
-	//  the MGVF matrix and evolving the snakes
+	//  the MGVF matrix and evolving the snakes, of the
+	//  slowest frame and of the MGVF iterations per cell
 	long long  MGVF_time = 0;
 	long long snake_time = 0;
+	long long frame_time = 0;
+	long long frame_time_max = 0;
+	long long MGVF_iterations_total = 0;
+	int MGVF_iterations_max = 0;
+	
+	// Keep track of the heap calls made while tracking the first frame and the others
+	long long heap_calls_start = scratch_heap_calls();
+	long long heap_calls_first_frame = 0;
 	
 	
 	// Process each frame
@@ -65,6 +88,12 @@ void ellipsetrack(avi_t *video, double *xc0, double *yc0, int Nc, int R, int Np,
 		printf("\rProcessing frame %d / %d", frame_num, Nf);
 		fflush(stdout);
 		
+		long long frame_start_time = get_time();
+		
+		// All matrices of this frame come from the scratch pools
+		//  of the threads and are given back at the end of the frame
+		scratch_frame_begin();
+		
 		// Get the current video frame and its dimensions
 		MAT *I = get_frame(video, frame_num, 0, 1);
 		int Ih = I->m;
@@ -83,87 +112,105 @@ void ellipsetrack(avi_t *video, double *xc0, double *yc0, int Nc, int R, int Np,
 		#ifdef OPEN
 		#pragma omp parallel for num_threads(omp_num_threads) private(i, j)
 		#endif
-		// Track each cell
+		// Extract the subimage near each cell
 		for (cell_num = 0; cell_num < Nc; cell_num++) {
 			// Make copies of the current cell's location
-			double xci = xc[cell_num][frame_num];
-			double yci = yc[cell_num][frame_num];
-			double *ri = (double *) malloc(sizeof(double) * Np);
+			xci[cell_num] = xc[cell_num][frame_num];
+			yci[cell_num] = yc[cell_num][frame_num];
 			for (j = 0; j < Np; j++) {
-				ri[j] = r[cell_num][j][frame_num];
+				ri[cell_num][j] = r[cell_num][j][frame_num];
 			}
 			
 			// Add up the last ten y-values for this cell
 			//  (or fewer if there are not yet ten previous frames)
-			double ycavg = 0.0;
+			ycavg[cell_num] = 0.0;
 			for (i = (frame_num > 10 ? frame_num - 10 : 0); i < frame_num; i++) {
-				ycavg += yc[cell_num][i];
+				ycavg[cell_num] += yc[cell_num][i];
 			}
 			// Compute the average of the last ten y-values
 			//  (this represents the expected y-location of the cell)
-			ycavg = ycavg / (double) (frame_num > 10 ? 10 : frame_num);
+			ycavg[cell_num] = ycavg[cell_num] / (double) (frame_num > 10 ? 10 : frame_num);
 			
 			// Determine the range of the subimage surrounding the current position
-			int u1 = max(xci - 4.0 * R + 0.5, 0 );
-			int u2 = min(xci + 4.0 * R + 0.5, Iw - 1);
-			int v1 = max(yci - 2.0 * R + 1.5, 0 );    
-			int v2 = min(yci + 2.0 * R + 1.5, Ih - 1);
+			int u2, v2;
+			u1[cell_num] = max(xci[cell_num] - 4.0 * R + 0.5, 0 );
+			u2           = min(xci[cell_num] + 4.0 * R + 0.5, Iw - 1);
+			v1[cell_num] = max(yci[cell_num] - 2.0 * R + 1.5, 0 );    
+			v2           = min(yci[cell_num] + 2.0 * R + 1.5, Ih - 1);
 			
 			// Extract the subimage
-			MAT *Isub = m_get(v2 - v1 + 1, u2 - u1 + 1);
-			for (i = v1; i <= v2; i++) {
-				for (j = u1; j <= u2; j++) {
-					m_set_val(Isub, i - v1, j - u1, m_get_val(I, i, j));
+			MAT *Isub = scratch_m_get(v2 - v1[cell_num] + 1, u2 - u1[cell_num] + 1);
+			for (i = v1[cell_num]; i <= v2; i++) {
+				for (j = u1[cell_num]; j <= u2; j++) {
+					m_set_val(Isub, i - v1[cell_num], j - u1[cell_num], m_get_val(I, i, j));
 				}
 			}
 			
 	        // Compute the subimage gradient magnitude			
 			MAT *Ix = gradient_x(Isub);
 			MAT *Iy = gradient_y(Isub);
-			MAT *IE = m_get(Isub->m, Isub->n);
+			IE[cell_num] = scratch_m_get(Isub->m, Isub->n);
 			for (i = 0; i < Isub->m; i++) {
 				for (j = 0; j < Isub->n; j++) {
 					double temp_x = m_get_val(Ix, i, j);
 					double temp_y = m_get_val(Iy, i, j);
-					m_set_val(IE, i, j, sqrt((temp_x * temp_x) + (temp_y * temp_y)));
+					m_set_val(IE[cell_num], i, j, sqrt((temp_x * temp_x) + (temp_y * temp_y)));
 				}
 			}
-			
-			// Compute the motion gradient vector flow (MGVF) edgemaps
-			long long MGVF_start_time = get_time();
-			MAT *IMGVF = MGVF(IE, 1, 1);
-			MGVF_time += get_time() - MGVF_start_time;
-			
+		}
+		
+		// Compute the motion gradient vector flow (MGVF) edgemaps of all cells
+		long long MGVF_start_time = get_time();
+		MAT **IMGVF = MGVF(IE, 1, 1, Nc, MGVF_iterations);
+		MGVF_time += get_time() - MGVF_start_time;
+		
+		for (cell_num = 0; cell_num < Nc; cell_num++) {
+			MGVF_iterations_total += MGVF_iterations[cell_num];
+			if (MGVF_iterations[cell_num] > MGVF_iterations_max) MGVF_iterations_max = MGVF_iterations[cell_num];
+		}
+		
+		long long snake_start_time = get_time();
+		
+		#ifdef OPEN
+		#pragma omp parallel for num_threads(omp_num_threads) private(j)
+		#endif
+		// Determine the new location of each cell
+		for (cell_num = 0; cell_num < Nc; cell_num++) {
 			// Determine the position of the cell in the subimage			
-			xci = xci - (double) u1;
-			yci = yci - (double) (v1 - 1);
-			ycavg = ycavg - (double) (v1 - 1);
+			xci[cell_num] = xci[cell_num] - (double) u1[cell_num];
+			yci[cell_num] = yci[cell_num] - (double) (v1[cell_num] - 1);
+			ycavg[cell_num] = ycavg[cell_num] - (double) (v1[cell_num] - 1);
 			
 			// Evolve the snake
-			long long snake_start_time = get_time();
-			ellipseevolve(IMGVF, &xci, &yci, ri, t, Np, (double) R, ycavg);
-			snake_time += get_time() - snake_start_time;
+			ellipseevolve(IMGVF[cell_num], &(xci[cell_num]), &(yci[cell_num]), ri[cell_num], t, Np, (double) R, ycavg[cell_num]);
 			
 			// Compute the cell's new position in the full image
-			xci = xci + u1;
-			yci = yci + (v1 - 1);
+			xci[cell_num] = xci[cell_num] + u1[cell_num];
+			yci[cell_num] = yci[cell_num] + (v1[cell_num] - 1);
 			
 			// Store the new location of the cell and the snake
-			xc[cell_num][frame_num] = xci;
-			yc[cell_num][frame_num] = yci;
+			xc[cell_num][frame_num] = xci[cell_num];
+			yc[cell_num][frame_num] = yci[cell_num];
 			for (j = 0; j < Np; j++) {
-				r[cell_num][j][frame_num] = ri[j];
-				x[cell_num][j][frame_num] = xc[cell_num][frame_num] + (ri[j] * cos(t[j]));
-				y[cell_num][j][frame_num] = yc[cell_num][frame_num] + (ri[j] * sin(t[j]));
+				r[cell_num][j][frame_num] = ri[cell_num][j];
+				x[cell_num][j][frame_num] = xc[cell_num][frame_num] + (ri[cell_num][j] * cos(t[j]));
+				y[cell_num][j][frame_num] = yc[cell_num][frame_num] + (ri[cell_num][j] * sin(t[j]));
 			}
 			
 			// Output the updated center of each cell
 			//printf("%d,%f,%f\n", cell_num, xci[cell_num], yci[cell_num]);
-			
-			// Free temporary memory
-			m_free(IMGVF);
-			free(ri);
 	    }
+		
+		snake_time += get_time() - snake_start_time;
+		
+		// Give back all matrices of this frame at once
+		scratch_frame_end();
+		if (frame_num == 1) heap_calls_first_frame = scratch_heap_calls() - heap_calls_start;
+		
+		// Keep track of the latency of each frame
+		long long frame_latency = get_time() - frame_start_time;
+		frame_time += frame_latency;
+		if (frame_latency > frame_time_max) frame_time_max = frame_latency;
 
 #ifdef OUTPUT
 		if (frame_num == Nf)
@@ -191,19 +238,34 @@ void ellipsetrack(avi_t *video, double *xc0, double *yc0, int Nc, int R, int Np,
 	free_3d_double(r);
 	free_3d_double(x);
 	free_3d_double(y);
+	free(xci);
+	free(yci);
+	free_2d_double(ri);
+	free(ycavg);
+	free(u1);
+	free(v1);
+	free(IE);
+	free(MGVF_iterations);
 	
 	// Report average processing time per frame
 	printf("\n\nTracking runtime (average per frame):\n");
 	printf("------------------------------------\n");
 	printf("MGVF computation: %.5f seconds\n", ((float) (MGVF_time)) / (float) (1000*1000*Nf));
 	printf(" Snake evolution: %.5f seconds\n", ((float) (snake_time)) / (float) (1000*1000*Nf));
+	printf("   Frame latency: %.5f seconds (slowest frame %.5f seconds)\n",
+	       ((float) (frame_time)) / (float) (1000*1000*Nf), ((float) (frame_time_max)) / (float) (1000*1000));
+	printf(" MGVF iterations: %.1f per cell (at most %d)\n",
+	       Nc > 0 ? (double) MGVF_iterations_total / (double) (Nc * Nf) : 0.0, MGVF_iterations_max);
+	printf("      Heap calls: %lld in the first frame, %lld in the %d later frames (scratch pools %.1f KB)\n",
+	       heap_calls_first_frame, scratch_heap_calls() - heap_calls_start - heap_calls_first_frame, Nf - 1,
+	       (double) scratch_capacity() / 1024.0);
 }
 
 
-MAT *MGVF(MAT *I, double vx, double vy) {
+MAT **MGVF(MAT **I, double vx, double vy, int Nc, int *iterations_out) {
 	/*
 	% MGVF calculate the motion gradient vector flow (MGVF) 
-	%  for the image 'I'
+	%  for the images 'I' of all Nc cells
 	%
 	% Based on the algorithm in:
 	%  Motion gradient vector flow: an external force for tracking rolling 
@@ -214,11 +276,13 @@ MAT *MGVF(MAT *I, double vx, double vy) {
 	%  Pages: 1466 - 1478
 	%
 	% INPUTS
-	%   I...........image
+	%   I...........images (one per cell)
 	%   vx,vy.......velocity vector
+	%   Nc..........number of cells
 	%   
 	% OUTPUT
-	%   IMGVF.......MGVF vector field as image
+	%   IMGVF.......MGVF vector field as image (one per cell)
+	%   iterations_out...iterations needed by each cell
 	%
 	% Matlab code written by: DREW GILLIAM (based on work by GANG DONG /
 	%                                                        NILANJAN RAY)
@@ -227,179 +291,172 @@ MAT *MGVF(MAT *I, double vx, double vy) {
 
 	// Constants
 	double converge = 0.00001;
-	double mu = 0.5;
 	double epsilon = 0.0000000001;
-	double lambda = 8.0 * mu + 1.0;
 	// Smallest positive value expressable in double-precision
 	double eps = pow(2.0, -52.0);
 	// Maximum number of iterations to compute the MGVF matrix
 	int iterations = 500;
 	
-	// Find the maximum and minimum values in I
-	int m = I->m, n = I->n, i, j;
-	double Imax = m_get_val(I, 0, 0);
-	double Imin = m_get_val(I, 0, 0);
-	for (i = 0; i < m; i++) {
-		for (j = 0; j < n; j++) {
-			double temp = m_get_val(I, i, j);
-			if (temp > Imax) Imax = temp;
-			else if (temp < Imin) Imin = temp;
-		}
-	}
+	MAT **IMGVF = (MAT **) scratch_alloc(sizeof(MAT *) * Nc);
 	
-	// Normalize the image I
-	double scale = 1.0 / (Imax - Imin + eps);
-	for (i = 0; i < m; i++) {
-		for (j = 0; j < n; j++) {
-			double old_val = m_get_val(I, i, j);
-			m_set_val(I, i, j, (old_val - Imin) * scale);
-		}
-	}
-
-	// Initialize the output matrix IMGVF with values from I
-	MAT *IMGVF = m_get(m, n);
-	for (i = 0; i < m; i++) {
-		for (j = 0; j < n; j++) {
-			m_set_val(IMGVF, i, j, m_get_val(I, i, j));
-		}
-	}
+	// The cells are independent, the number of iterations differs from cell to cell
+	int cell_num;
+	#ifdef OPEN
+	#pragma omp parallel for num_threads(omp_num_threads) schedule(dynamic)
+	#endif
+	for (cell_num = 0; cell_num < Nc; cell_num++) {
+		MAT *Ic = I[cell_num];
 	
-	// Precompute row and column indices for the
-	//  neighbor difference computation below
-	int *rowU = (int *) malloc(sizeof(int) * m);
-	int *rowD = (int *) malloc(sizeof(int) * m);
-	int *colL = (int *) malloc(sizeof(int) * n);
-	int *colR = (int *) malloc(sizeof(int) * n);
-	rowU[0] = 0;
-	rowD[m - 1] = m - 1;
-	for (i = 1; i < m; i++) {
-		rowU[i] = i - 1;
-		rowD[i - 1] = i;
-	}
-	colL[0] = 0;
-	colR[n - 1] = n - 1;
-	for (j = 1; j < n; j++) {
-		colL[j] = j - 1;
-		colR[j - 1] = j;
-	}
-	
-	// Allocate matrices used in the while loop below
-	MAT *U    = m_get(m, n), *D    = m_get(m, n), *L    = m_get(m, n), *R    = m_get(m, n);
-	MAT *UR   = m_get(m, n), *DR   = m_get(m, n), *UL   = m_get(m, n), *DL   = m_get(m, n);
-	MAT *UHe  = m_get(m, n), *DHe  = m_get(m, n), *LHe  = m_get(m, n), *RHe  = m_get(m, n);
-	MAT *URHe = m_get(m, n), *DRHe = m_get(m, n), *ULHe = m_get(m, n), *DLHe = m_get(m, n);
-
-	
-	// Precompute constants to avoid division in the for loops below
-	double mu_over_lambda = mu / lambda;
-	double one_over_lambda = 1.0 / lambda;
-	
-	// Compute the MGVF
-	int iter = 0;
-	double mean_diff = 1.0;
-	while ((iter < iterations) && (mean_diff > converge)) { 
-	    
-	    // Compute the difference between each pixel and its eight neighbors
+		// Find the maximum and minimum values in I
+		int m = Ic->m, n = Ic->n, i, j;
+		double Imax = m_get_val(Ic, 0, 0);
+		double Imin = m_get_val(Ic, 0, 0);
 		for (i = 0; i < m; i++) {
 			for (j = 0; j < n; j++) {
-				double subtrahend = m_get_val(IMGVF, i, j);
-				m_set_val(U, i, j, m_get_val(IMGVF, rowU[i], j) - subtrahend);
-				m_set_val(D, i, j, m_get_val(IMGVF, rowD[i], j) - subtrahend);
-				m_set_val(L, i, j, m_get_val(IMGVF, i, colL[j]) - subtrahend);
-				m_set_val(R, i, j, m_get_val(IMGVF, i, colR[j]) - subtrahend);
-				m_set_val(UR, i, j, m_get_val(IMGVF, rowU[i], colR[j]) - subtrahend);
-				m_set_val(DR, i, j, m_get_val(IMGVF, rowD[i], colR[j]) - subtrahend);
-				m_set_val(UL, i, j, m_get_val(IMGVF, rowU[i], colL[j]) - subtrahend);
-				m_set_val(DL, i, j, m_get_val(IMGVF, rowD[i], colL[j]) - subtrahend);
+				double temp = m_get_val(Ic, i, j);
+				if (temp > Imax) Imax = temp;
+				else if (temp < Imin) Imin = temp;
 			}
 		}
 		
-	    // Compute the regularized heaviside version of the matrices above
-		heaviside( UHe,  U, -vy,      epsilon);
-		heaviside( DHe,  D,  vy,      epsilon);
-		heaviside( LHe,  L, -vx,      epsilon);
-		heaviside( RHe,  R,  vx,      epsilon);
-		heaviside(URHe, UR,  vx - vy, epsilon);
-		heaviside(DRHe, DR,  vx + vy, epsilon);
-		heaviside(ULHe, UL, -vx - vy, epsilon);
-		heaviside(DLHe, DL,  vy - vx, epsilon);
-		
-		// Update the IMGVF matrix
-		double total_diff = 0.0;
+		// Normalize the image I and initialize the output matrix IMGVF with it,
+		//  the rows of a matrix from scratch_m_get are a flat row-major array
+		double scale = 1.0 / (Imax - Imin + eps);
+		IMGVF[cell_num] = scratch_m_get(m, n);
+		double *IMGVF_flat = IMGVF[cell_num]->base;
+		scratch_mark mark = scratch_begin();
+		double *Iflat = (double *) scratch_alloc(sizeof(double) * m * n);
 		for (i = 0; i < m; i++) {
 			for (j = 0; j < n; j++) {
-				// Store the old value so we can compute the difference later
-				double old_val = m_get_val(IMGVF, i, j);
-				
-				// Compute IMGVF += (mu / lambda)(UHe .*U  + DHe .*D  + LHe .*L  + RHe .*R +
-				//                                URHe.*UR + DRHe.*DR + ULHe.*UL + DLHe.*DL);
-				double vU  = m_get_val(UHe,  i, j) * m_get_val(U,  i, j);
-				double vD  = m_get_val(DHe,  i, j) * m_get_val(D,  i, j);
-				double vL  = m_get_val(LHe,  i, j) * m_get_val(L,  i, j);
-				double vR  = m_get_val(RHe,  i, j) * m_get_val(R,  i, j);
-				double vUR = m_get_val(URHe, i, j) * m_get_val(UR, i, j);
-				double vDR = m_get_val(DRHe, i, j) * m_get_val(DR, i, j);
-				double vUL = m_get_val(ULHe, i, j) * m_get_val(UL, i, j);
-				double vDL = m_get_val(DLHe, i, j) * m_get_val(DL, i, j);				
-				double vHe = old_val + mu_over_lambda * (vU + vD + vL + vR + vUR + vDR + vUL + vDL);
-				
-				// Compute IMGVF -= (1 / lambda)(I .* (IMGVF - I))
-				double vI = m_get_val(I, i, j);
-				double new_val = vHe - (one_over_lambda * vI * (vHe - vI));
-				m_set_val(IMGVF, i, j, new_val);
-				
-				// Keep track of the absolute value of the differences
-				//  between this iteration and the previous one
-				total_diff += fabs(new_val - old_val);
+				double val = (m_get_val(Ic, i, j) - Imin) * scale;
+				Iflat[(i * n) + j] = val;
+				IMGVF_flat[(i * n) + j] = val;
 			}
 		}
 		
-		// Compute the mean absolute difference between this iteration
-		//  and the previous one to check for convergence
-		mean_diff = total_diff / (double) (m * n);
-	    
-		iter++;
+		iterations_out[cell_num] = IMGVF_solve(IMGVF_flat, Iflat, m, n, vx, vy, epsilon, iterations, converge);
+		
+		scratch_end(mark);
 	}
 	
-	// Free memory
-	free(rowU); free(rowD); free(colL); free(colR);
-	m_free(U);    m_free(D);    m_free(L);    m_free(R);
-	m_free(UR);   m_free(DR);   m_free(UL);   m_free(DL);
-	m_free(UHe);  m_free(DHe);  m_free(LHe);  m_free(RHe);
-	m_free(URHe); m_free(DRHe); m_free(ULHe); m_free(DLHe);
-
 	return IMGVF;
 }
 
 
-// Regularized version of the Heaviside step function,
-//  parameterized by a small positive number 'e'
-void heaviside(MAT *H, MAT *z, double v, double e) {
-	int m = z->m, n = z->n, i, j;
+// Computes the MGVF matrix of one m x n image in place: IMGVF holds the
+//  initial matrix on entry and the MGVF matrix on return, both IMGVF and the
+//  normalized image I are flat row-major arrays.  Returns the number of
+//  iterations performed.
+//
+// Each iteration applies the MGVF update
+//  IMGVF += (mu / lambda)(UHe .*U  + DHe .*D  + LHe .*L  + RHe .*R +
+//                         URHe.*UR + DRHe.*DR + ULHe.*UL + DLHe.*DL)
+//  IMGVF -= (1 / lambda)(I .* (IMGVF - I))
+//  pixel by pixel in red-black order, so that a pixel already sees the
+//  values of its neighbors updated earlier in the same iteration (Gauss-Seidel).
+//  The step of each pixel is divided by the derivative of the update with
+//  respect to that pixel (with the heaviside values held fixed), which is
+//  at most one, and over-relaxed by MGVF_OMEGA.  A fixed point of this
+//  iteration is a fixed point of the original explicit one.  The iteration
+//  stops under the same criterion: the mean absolute change of an iteration
+//  is below 'cutoff'.  Should the change ever grow, the rest of the
+//  iterations fall back to plain Gauss-Seidel steps.
+int IMGVF_solve(double *IMGVF, double *I, int m, int n, double vx, double vy, double e, int max_iterations, double cutoff) {
+	double mu = 0.5;
+	double lambda = 8.0 * mu + 1.0;
 	
 	// Precompute constants to avoid division in the for loops below
-	double one_over_pi = 1.0 / PI;
+	double mu_over_lambda = mu / lambda;
+	double one_over_lambda = 1.0 / lambda;
 	double one_over_e = 1.0 / e;
+	double omega = MGVF_OMEGA;
 	
-	// Compute H = (1 / pi) * atan((z * v) / e) + 0.5
-	for (i = 0; i < m; i++) {
-		for (j = 0; j < n; j++) {
-			double z_val = m_get_val(z, i, j) * v;
-			double H_val = one_over_pi * atan(z_val * one_over_e) + 0.5;
-			m_set_val(H, i, j, H_val);
+	int iter = 0, color, i, j;
+	double mean_diff = 1.0;
+	while ((iter < max_iterations) && (mean_diff > cutoff)) {
+		double total_diff = 0.0;
+		
+		for (color = 0; color < 2; color++) {
+			for (i = 0; i < m; i++) {
+				// Offsets of the rows above and below, pixels on the border are their own neighbors
+				int dU = (i > 0) ? -n : 0;
+				int dD = (i < m - 1) ? n : 0;
+				for (j = (i + color) & 1; j < n; j += 2) {
+					int dL = (j > 0) ? -1 : 0;
+					int dR = (j < n - 1) ? 1 : 0;
+					double *p = &IMGVF[(i * n) + j];
+					double old_val = *p;
+					
+					// Compute the difference between the pixel and its eight neighbors
+					double U  = p[dU     ] - old_val;
+					double D  = p[dD     ] - old_val;
+					double L  = p[dL     ] - old_val;
+					double R  = p[dR     ] - old_val;
+					double UR = p[dU + dR] - old_val;
+					double DR = p[dD + dR] - old_val;
+					double UL = p[dU + dL] - old_val;
+					double DL = p[dD + dL] - old_val;
+					
+					// Compute the regularized heaviside values of these differences
+					double UHe  = heaviside((U  *  -vy)      * one_over_e);
+					double DHe  = heaviside((D  *   vy)      * one_over_e);
+					double LHe  = heaviside((L  *  -vx)      * one_over_e);
+					double RHe  = heaviside((R  *   vx)      * one_over_e);
+					double URHe = heaviside((UR * (vx - vy)) * one_over_e);
+					double DRHe = heaviside((DR * (vx + vy)) * one_over_e);
+					double ULHe = heaviside((UL * (-vx - vy)) * one_over_e);
+					double DLHe = heaviside((DL * (vy - vx)) * one_over_e);
+					
+					double vHe = old_val + mu_over_lambda * (UHe  * U  + DHe  * D  + LHe  * L  + RHe  * R +
+					                                         URHe * UR + DRHe * DR + ULHe * UL + DLHe * DL);
+					double vI = I[(i * n) + j];
+					double new_val = vHe - (one_over_lambda * vI * (vHe - vI));
+					
+					// Derivative of the update with respect to old_val, bounded below
+					//  so that the step is never more than lambda times the original
+					double slope = mu_over_lambda * (UHe + DHe + LHe + RHe + URHe + DRHe + ULHe + DLHe) *
+					               (1.0 - one_over_lambda * vI) + one_over_lambda * vI;
+					if (slope < one_over_lambda) slope = one_over_lambda;
+					new_val = old_val + omega * (new_val - old_val) / slope;
+					*p = new_val;
+					
+					// Keep track of the absolute value of the differences
+					//  between this iteration and the previous one
+					total_diff += fabs(new_val - old_val);
+				}
+			}
 		}
+		
+		// Compute the mean absolute difference between this iteration
+		//  and the previous one to check for convergence
+		double new_mean_diff = total_diff / (double) (m * n);
+		if (iter > 0 && new_mean_diff > mean_diff) omega = 1.0;
+		mean_diff = new_mean_diff;
+		
+		iter++;
 	}
 	
+	return iter;
+}
+
+
+// Regularized version of the Heaviside step function:
+//  He(x) = (atan(x) / pi) + 0.5
+double heaviside(double x) {
+	// For large |x| (x = z / e with the tiny e used above, so nearly always)
+	//  atan(x) = sign(x) * pi/2 - 1/x + 1/(3x^3) to double precision
+	if (x > 10000.0 || x < -10000.0) {
+		double q = 1.0 / x;
+		double half_pi = (x > 0.0) ? 1.57079632679489661923 : -1.57079632679489661923;
+		return ((half_pi - (q - q * q * q * (1.0 / 3.0))) * (1.0 / PI)) + 0.5;
+	}
+	return (atan(x) * (1.0 / PI)) + 0.5;
+
 	// A simpler, faster approximation of the Heaviside function
-	/* for (i = 0; i < m; i++) {
-		for (j = 0; j < n; j++) {
-			double z_val = m_get_val(z, i, j) * v;
-			double H_val = 0.5;
-			if (z_val < -0.0001) H_val = 0.0;
-			else if (z_val > 0.0001) H_val = 1.0;
-			m_set_val(H, i, j, H_val);
-		}
-	} */
+	/* double out = 0.0;
+	if (x > -0.0001) out = 0.5;
+	if (x >  0.0001) out = 1.0;
+	return out; */
 }
 
 
@@ -438,10 +495,13 @@ void ellipseevolve(MAT *f, double *xc0, double *yc0, double *r0, double *t, int
 
 	int i, j;
 
+	// All temporaries come from this thread's scratch pool and are given back at the end
+	scratch_mark mark = scratch_begin();
+
 	// Initialize variables
 	double xc = *xc0;
 	double yc = *yc0;
-	double *r = (double *) malloc(sizeof(double) * Np);
+	double *r = (double *) scratch_alloc(sizeof(double) * Np);
 	for (i = 0; i < Np; i++) r[i] = r0[i];
 	
 	// Compute the x- and y-gradients of the MGVF matrix
@@ -460,9 +520,9 @@ void ellipseevolve(MAT *f, double *xc0, double *yc0, double *r0, double *t, int
 		}
 	}
 	
-	double *r_old = (double *) malloc(sizeof(double) * Np);
-	VEC *x = v_get(Np);
-	VEC *y = v_get(Np);
+	double *r_old = (double *) scratch_alloc(sizeof(double) * Np);
+	VEC *x = scratch_v_get(Np);
+	VEC *y = scratch_v_get(Np);
 	
 	
 	// Evolve the snake
@@ -470,6 +530,8 @@ void ellipseevolve(MAT *f, double *xc0, double *yc0, double *r0, double *t, int
 	double snakediff = 1.0;
 	while (iter < iterations && snakediff > converge) {
 		
+		scratch_mark iteration_mark = scratch_begin();
+		
 		// Save the values from the previous iteration
 		double xc_old = xc, yc_old = yc;
 		for (i = 0; i < Np; i++) {
@@ -493,7 +555,10 @@ void ellipseevolve(MAT *f, double *xc0, double *yc0, double *r0, double *t, int
 			if (y_i < min_y) min_y = y_i;
 			else if (y_i > max_y) max_y = y_i;
 		}
-		if (min_x < 0.0 || max_x > (double) fw - 1.0 || min_y < 0 || max_y > (double) fh - 1.0) break;
+		if (min_x < 0.0 || max_x > (double) fw - 1.0 || min_y < 0 || max_y > (double) fh - 1.0) {
+			scratch_end(iteration_mark);
+			break;
+		}
 		
 		
 		// Compute the length of the snake		
@@ -519,7 +584,7 @@ void ellipseevolve(MAT *f, double *xc0, double *yc0, double *r0, double *t, int
 		
 		// Compute the radial potential surface		
 		int m = vf->m, n = vf->n;
-		MAT *vfr = m_get(m, n);
+		MAT *vfr = scratch_m_get(m, n);
 		for (i = 0; i < n; i++) {
 			double vf_val  = m_get_val(vf,  0, i);
 			double vfx_val = m_get_val(vfx, 0, i);
@@ -543,11 +608,8 @@ void ellipseevolve(MAT *f, double *xc0, double *yc0, double *r0, double *t, int
 		// Test for convergence
 		snakediff = fabs(xc - xc_old) + fabs(yc - yc_old) + r_diff;
 		
-		// Free temporary matrices
-		m_free(vf);
-		m_free(vfx);
-		m_free(vfy);
-		m_free(vfr);
+		// Give back the temporary matrices
+		scratch_end(iteration_mark);
 	    
 		iter++;
 	}
@@ -558,10 +620,7 @@ void ellipseevolve(MAT *f, double *xc0, double *yc0, double *r0, double *t, int
 	for (i = 0; i < Np; i++)
 		r0[i] = r[i];
 	
-	// Free memory
-	free(r); free(r_old);
-	v_free( x); v_free( y);
-	m_free(fx); m_free(fy);
+	scratch_end(mark);
 }
 	
 
@@ -5,8 +5,9 @@
 
 
 extern void ellipsetrack(avi_t *video, double *xc0, double *yc0, int num_centers, int R, int Np, int Nf);
-extern MAT *MGVF(MAT *I, double vx, double vy);
-extern void heaviside(MAT *H, MAT *z, double v, double e);
+extern MAT **MGVF(MAT **I, double vx, double vy, int Nc, int *iterations_out);
+extern int IMGVF_solve(double *IMGVF, double *I, int m, int n, double vx, double vy, double e, int max_iterations, double cutoff);
+extern double heaviside(double x);
 extern void ellipseevolve(MAT *f, double *xc0, double *yc0, double *r0, double* t, int Np, double Er, double Ey);
 extern double sum_m(MAT *matrix);
 extern double sum_v(VEC *vector);
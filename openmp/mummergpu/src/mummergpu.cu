@@ -287,6 +287,7 @@ int createMatchContext(Reference* ref,
                        QuerySet* queries,
                        MatchResults* matches,
                        bool on_cpu,
+                       bool suffix_array,
                        int min_match_length,
                        char* stats_file,
                        bool reverse,
@@ -303,6 +304,7 @@ int createMatchContext(Reference* ref,
     ctx->full_ref_len = ref->len;
     
     ctx->on_cpu = on_cpu;
+    ctx->suffix_array = suffix_array;
     ctx->min_match_length = min_match_length;
     ctx->stats_file = stats_file;
     ctx->reverse = reverse;
@@ -2217,6 +2219,36 @@ int streamReferenceAgainstQueries(MatchContext* ctx) {
     return 0;
 }
 
+// Matches all queries against a suffix array of the whole reference on the
+// host, instead of streaming suffix tree pages (-S)
+int matchQueriesToSuffixArray(MatchContext* ctx) {
+    SuffixArrayIndex index;
+
+    char* ttimer = createTimer();
+    startTimer(ttimer);
+    if (createSuffixArray(ctx->full_ref, ctx->full_ref_len, &index))
+        return -1;
+    stopTimer(ttimer);
+    ctx->statistics.t_tree_construction += getTimerValue(ttimer);
+    deleteTimer(ttimer);
+
+    size_t available_mem = getFreeDeviceMemory(true) - BREATHING_ROOM;
+
+    while (getQueryBlock(ctx, available_mem)) {
+        float t_match = matchQueryBlockToSuffixArray(&index,
+                                                     ctx->queries,
+                                                     ctx->min_match_length);
+        ctx->statistics.t_match_kernel += t_match;
+        ctx->statistics.bp_avg_query_length =
+			ctx->queries->texlen / (float)(ctx->queries->count) - 2;
+        destroyQueryBlock(ctx->queries);
+    }
+
+    destroySuffixArray(&index);
+	lseek(ctx->queries->qfile, 0, SEEK_SET);
+    return 0;
+}
+
 
 extern "C"
 int matchQueries(MatchContext* ctx) {
@@ -2235,8 +2267,18 @@ int matchQueries(MatchContext* ctx) {
     
     int ret;
 
-    fprintf(stderr, "Streaming reference pages against all queries\n"); 
-    ret = streamReferenceAgainstQueries(ctx);
+    if (ctx->suffix_array && (ctx->reverse || ctx->forwardreverse)) {
+        fprintf(stderr, "The suffix array only matches forward queries, using the suffix tree\n");
+        ctx->suffix_array = false;
+    }
+
+    if (ctx->suffix_array) {
+        fprintf(stderr, "Matching all queries against a suffix array of the reference\n");
+        ret = matchQueriesToSuffixArray(ctx);
+    } else {
+        fprintf(stderr, "Streaming reference pages against all queries\n"); 
+        ret = streamReferenceAgainstQueries(ctx);
+    }
 
     stopTimer(ttimer);
     ctx->statistics.t_end_to_end += getTimerValue(ttimer);
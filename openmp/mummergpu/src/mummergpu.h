@@ -145,6 +145,7 @@ struct MatchContext {
     MatchResults results;
     
     bool on_cpu;
+    bool suffix_array;
     
     int min_match_length;
     
@@ -161,6 +162,20 @@ struct MatchContext {
 };
 
 
+// Suffix array index of the whole reference, used instead of the suffix tree
+// when matching with -S (see suffix-array.cpp)
+struct SuffixArrayIndex {
+    char* str;              // reference string, 's' + bases + '$'
+    int len;                // bases
+    int* sa;                // suffixes in lexicographic order, the end sorting after T
+    int* isa;               // SA index of every suffix
+    int* lcp;               // lcp[i] = bases shared by the suffixes sa[i-1] and sa[i]
+    int kmer_len;
+    int* kmer_range;        // SA interval [kmer_range[2c], kmer_range[2c+1]) of k-mer c
+    size_t bytes;
+};
+
+
 struct ReferencePage {
     int begin;
     int end;
@@ -183,6 +198,7 @@ int createMatchContext(Reference* ref,
                        QuerySet* queries,
                        MatchResults* matches,
                        bool on_cpu,
+                       bool suffix_array,
                        int min_match_length,
                        char* stats_file,
                        bool reverse,
@@ -199,6 +215,12 @@ int destroyMatchContext(MatchContext* ctx);
 
 int matchQueries(MatchContext* ctx);
 
+int createSuffixArray(char* refstr, size_t reflen, SuffixArrayIndex* index);
+int destroySuffixArray(SuffixArrayIndex* index);
+float matchQueryBlockToSuffixArray(const SuffixArrayIndex* index,
+                                   QuerySet* queries,
+                                   int min_match_length);
+
 void printStringForError(int err);
 
 // Timer management
@@ -2,6 +2,8 @@
 #include <string.h>
 
 #include <fstream>
+#include <vector>
+#include <algorithm>
 
 #define ulong4 uint32_t
 #define int2 int32_t
@@ -16,6 +18,19 @@
 #define OMP
 #define N_THREADS 8
 
+// Forward matching engine: 1 walks the flattened CPU tree built by buildCpuTree,
+// 0 runs kernel_gold on the textures. CPU_ENGINE_COMPARE also runs kernel_gold
+// on a scratch result array and reports both rates and whether they agree.
+#define CPU_ENGINE 1
+#define CPU_ENGINE_COMPARE 0
+
+// Nodes per block of the flattened tree (32 bytes each, so 8 cache lines)
+#define CPU_BLOCK_NODES 16
+// Queries walked at once by each thread
+#define CPU_LANES 8
+// Queries handed to a thread per scheduling step
+#define CPU_QUERY_CHUNK 16
+
 
 static const int maxdim = 4096;
 
@@ -588,6 +603,470 @@ int kernel_gold(int qryid,
 
 
 
+//////////////////////////////////
+/// CPU tree
+//////////////////////////////////
+
+// The textures are laid out for the GPU texture cache: every step of the
+// walk reads a PixelOfChildren and a PixelOfNode from two arrays and decodes
+// 3 byte addresses. The CPU engine flattens the tree once per call into 32
+// byte records holding everything a step needs, with the links turned into
+// array indices. Records are stored in blocks: a block is a breadth-first
+// run of up to CPU_BLOCK_NODES nodes of one subtree, and the subtrees hanging
+// off a block become the next blocks, again in breadth-first order. The top
+// of the tree, which every query goes through, ends up in the first few KB,
+// and a walk down a deep subtree stays inside one block for a couple of levels.
+// Record 0 is the NULL node, so that 0 means "no node" as it does in kernel_gold.
+
+struct CpuNode
+{
+	unsigned int start;
+	unsigned int end;
+	int suffix;
+	int child[4];        // A, C, G, T
+	unsigned int addr;   // texture address, reported in the MatchCoords
+};
+
+// Offset of a texture address in the (unmerged) texture arrays
+inline unsigned int addressOffset(unsigned int addr)
+{
+#if REORDER_TREE
+  return (addr & 0x0000FFFF) + (((addr & 0xFFFF0000)>>16) * MAX_TEXTURE_DIMENSION);
+#else
+  return addr;
+#endif
+}
+
+// Record of a texture address, -1 if the node was not placed
+inline int cpuIndex(const std::vector<int>& index, unsigned int addr)
+{
+  unsigned int offset = addressOffset(addr);
+  return offset < index.size() ? index[offset] : -1;
+}
+
+// Flattens the tree reachable from the root through the A, C, G, T links.
+// Returns false if a suffix link leads out of it.
+bool buildCpuTree(std::vector<CpuNode>& tree,
+                  PixelOfNode* nodes,
+                  PixelOfChildren* childrenarr)
+{
+	// order the nodes block by block
+	std::vector<unsigned int> order(1, 0);
+	std::vector<unsigned int> blocks;
+	std::vector<unsigned int> frontier;
+	unsigned int maxoffset = 0;
+
+	unsigned int root;
+	GOROOT(root);
+	blocks.push_back(root);
+
+	for (size_t b = 0; b < blocks.size(); b++)
+	{
+		int taken = 0;
+		frontier.clear();
+		frontier.push_back(blocks[b]);
+
+		for (size_t f = 0; f < frontier.size(); f++)
+		{
+			unsigned int addr = frontier[f];
+			if (taken == CPU_BLOCK_NODES)
+			{
+				blocks.push_back(addr);
+				continue;
+			}
+
+			order.push_back(addr);
+			maxoffset = max(maxoffset, addressOffset(addr));
+			taken++;
+
+			PixelOfChildren children = GETCHILDREN(addr, false);
+			if (children.leafchar) { continue; }
+
+			unsigned int child;
+			arrayToAddress(children.a, child); if (child) { frontier.push_back(child); }
+			arrayToAddress(children.c, child); if (child) { frontier.push_back(child); }
+			arrayToAddress(children.g, child); if (child) { frontier.push_back(child); }
+			arrayToAddress(children.t, child); if (child) { frontier.push_back(child); }
+		}
+	}
+
+	std::vector<int> index(maxoffset + 1, -1);
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		index[addressOffset(order[i])] = i;
+	}
+
+	// fill in the records
+	tree.resize(order.size());
+	memset(&tree[0], 0, sizeof(CpuNode));
+
+	for (size_t i = 1; i < order.size(); i++)
+	{
+		unsigned int addr = order[i];
+		PixelOfNode node = GETNODE(addr, false);
+		PixelOfChildren children = GETCHILDREN(addr, false);
+		CpuNode& n = tree[i];
+
+		n.start = MK3(node.start);
+		n.end = MK3(node.end);
+		n.addr = addr;
+
+		unsigned int link;
+		arrayToAddress(node.suffix, link);
+		n.suffix = cpuIndex(index, link);
+
+		if (children.leafchar)
+		{
+			// A leaf edge ends with the '$' no query character matches, so
+			// the walk never leaves a leaf and never follows its suffix link
+			n.child[0] = n.child[1] = n.child[2] = n.child[3] = 0;
+			n.suffix = max(n.suffix, 0);
+			continue;
+		}
+
+		if (n.suffix < 0) { return false; }
+
+		arrayToAddress(children.a, link); n.child[0] = cpuIndex(index, link);
+		arrayToAddress(children.c, link); n.child[1] = cpuIndex(index, link);
+		arrayToAddress(children.g, link); n.child[2] = cpuIndex(index, link);
+		arrayToAddress(children.t, link); n.child[3] = cpuIndex(index, link);
+	}
+
+	return true;
+}
+
+inline int childSlot(char c)
+{
+	switch (c)
+	{
+		case 'A': return 0;
+		case 'C': return 1;
+		case 'G': return 2;
+		case 'T': return 3;
+		default:  return -1;
+	};
+}
+
+//////////////////////////////////
+/// cpu_lane_step
+//////////////////////////////////
+
+// kernel_gold on the flattened tree, turned into a state machine so that a
+// thread can walk CPU_LANES queries at once: a lane runs until the next step
+// needs a record that is probably not cached, prefetches it and returns, and
+// the thread moves on to its other lanes while the record is loaded. The
+// steps and the MatchCoords written are the same as kernel_gold's.
+
+enum CpuLaneState
+{
+	LANE_POSITION,   // start matching at qrystart
+	LANE_NODE,       // at node cur, follow the next query character
+	LANE_EDGE,       // walk the edge into cur
+	LANE_RECORD,     // record the match ending on the edge into cur
+	LANE_SUFFIX      // follow the suffix link of prev to the next qrystart
+};
+
+struct CpuLane
+{
+	int qryid;                // -1 if the lane is idle
+	const char* queries;      // shifted to the query
+	MatchCoord* result;
+	int qrystart;
+	int last;
+	int cur;
+	int prev;
+	unsigned int node_start;
+	unsigned int refpos;
+	int mustmatch;
+	int qry_match_len;
+	CpuLaneState state;
+};
+
+void cpu_lane_start(CpuLane& lane,
+					int qryid,
+					MatchResults* results,
+					const char* queries,
+					const int* queryAddrs,
+					const int* queryLengths,
+					const int min_match_len)
+{
+	int qryAddr = queryAddrs[qryid];
+	MatchCoord* match_coords = results->h_match_coords;
+
+	lane.qryid = qryid;
+	lane.queries = queries + qryAddr;
+	lane.result = MATCH_BASE(match_coords, qryid);
+	lane.qrystart = 0;
+	lane.last = queryLengths[qryid] - min_match_len;
+	lane.cur = 0;
+	lane.prev = 0;
+	lane.node_start = 0;
+	lane.refpos = 0;
+	lane.mustmatch = 0;
+	lane.qry_match_len = 0;
+	lane.state = LANE_POSITION;
+}
+
+// Returns false once the lane's query is done
+bool cpu_lane_step(CpuLane& l,
+				   const CpuNode* tree,
+				   const char* ref,
+				   const int min_match_len)
+{
+	const char* queries = l.queries;
+
+	for (;;)
+	{
+		if (l.state == LANE_POSITION)
+		{
+			if (l.qrystart > l.last) { return false; }
+
+			if ((l.cur == 0) || (l.qry_match_len < 1))
+			{
+				// start at root of tree
+				l.cur = 1;
+				l.qry_match_len = 1;
+				l.mustmatch = 0;
+			}
+			l.refpos = 0;
+			l.state = LANE_NODE;
+		}
+
+		if (l.state == LANE_NODE)
+		{
+			char c = GETQCHAR(l.qrystart + l.qry_match_len);
+			if (c == '\0')
+			{
+				l.state = LANE_RECORD;
+			}
+			else
+			{
+				int slot = childSlot(c);
+				l.prev = l.cur;
+				l.cur = (slot < 0) ? 0 : tree[l.prev].child[slot];
+
+				// No edge to follow out of the node
+				if (l.cur == 0)
+				{
+					SET_RESULT(tree[l.prev].addr, l.result, 0, l.qry_match_len, min_match_len, FORWARD);
+
+					l.qry_match_len -= 1;
+					l.mustmatch = 0;
+					l.state = LANE_SUFFIX;
+				}
+				else
+				{
+					__builtin_prefetch(&tree[l.cur]);
+					l.state = LANE_EDGE;
+					return true;
+				}
+			}
+		}
+
+		if (l.state == LANE_EDGE)
+		{
+			l.node_start = tree[l.cur].start;
+			unsigned int node_end = tree[l.cur].end;
+			{
+				int edgelen = node_end - l.node_start + 1;
+				int edge_matchlen = l.node_start + l.mustmatch;
+				int past_node_end = node_end + 1;
+				int dist_to_edge_end = l.mustmatch - edgelen;
+				if (l.mustmatch) {
+					l.refpos = min(edge_matchlen, past_node_end);
+					l.qry_match_len += min(edgelen, l.mustmatch);
+					l.mustmatch = max(dist_to_edge_end, 0);
+				}
+				else {
+					// Try to walk the edge, the first char definitely matches
+					l.qry_match_len++;
+					l.refpos = l.node_start + 1;
+				}
+			}
+
+			char c = GETQCHAR(l.qrystart + l.qry_match_len);
+			l.state = (c == '\0') ? LANE_RECORD : LANE_NODE;
+
+			while (l.refpos <= node_end && c != '\0')
+			{
+				if (ref[l.refpos] != c)
+				{
+					// mismatch on edge
+					l.state = LANE_RECORD;
+					break;
+				}
+
+				l.qry_match_len++;
+				l.refpos++;
+
+				c = GETQCHAR(l.qrystart + l.qry_match_len);
+				if (c == '\0') { l.state = LANE_RECORD; }
+			}
+		}
+
+		if (l.state == LANE_RECORD)
+		{
+			SET_RESULT(tree[l.cur].addr, l.result, l.refpos - l.node_start, l.qry_match_len,
+					   min_match_len, FORWARD);
+
+			l.mustmatch = l.refpos - l.node_start;
+			l.qry_match_len -= l.mustmatch + 1;
+			l.state = LANE_SUFFIX;
+		}
+
+		if (l.state == LANE_SUFFIX)
+		{
+			l.cur = tree[l.prev].suffix;
+			l.qrystart++;
+			l.result += RESULT_SPAN;
+			__builtin_prefetch(&tree[l.cur]);
+			l.state = LANE_POSITION;
+			return true;
+		}
+	}
+}
+
+//////////////////////////////////
+/// forward matching drivers
+//////////////////////////////////
+
+void reportMatchRate(const char* engine, int numQueries, long long bases, double seconds)
+{
+	fprintf(stderr, "%s: %d queries (%lld bp) in %.3f s, %.0f queries/s, %.2f Mbp/s\n",
+			engine, numQueries, bases, seconds,
+			numQueries / seconds, bases / seconds / 1e6);
+}
+
+// Runs kernel_gold for every query, returns the time taken
+double matchKernelGold(MatchResults* results,
+					   char* refstr,
+					   char* queries,
+					   int* queryAddrs,
+					   int* queryLengths,
+					   PixelOfNode* nodeTexture,
+					   PixelOfChildren* childrenTexture,
+					   int numQueries,
+					   int match_length)
+{
+	double start = omp_get_wtime();
+#ifdef OMP
+	#pragma omp parallel for
+#endif
+	for (int i = 0; i < numQueries; ++i)
+	{
+		 kernel_gold(i,
+					 results,
+					 queries,
+					 nodeTexture,
+					 childrenTexture,
+					 refstr,
+					 queryAddrs,
+					 queryLengths,
+					 numQueries,
+					 match_length
+#if TREE_ACCESS_HISTOGRAM
+					 , NULL,
+					 NULL
+#endif
+					 );
+	}
+	return omp_get_wtime() - start;
+}
+
+inline bool longerQuery(const std::pair<int, int>& x, const std::pair<int, int>& y)
+{
+	return x.first > y.first || (x.first == y.first && x.second < y.second);
+}
+
+// Matches every query on the flattened tree. The queries are sorted longest
+// first and the threads take them from the front of that list in chunks of
+// CPU_QUERY_CHUNK whenever one of their lanes runs dry, so the long queries
+// start first and whoever finishes early takes more work instead of a few
+// long queries holding up the end of the loop. Returns the time taken,
+// flattening included, or a negative value if the tree could not be flattened.
+double matchCpuTree(MatchResults* results,
+					char* refstr,
+					char* queries,
+					int* queryAddrs,
+					int* queryLengths,
+					PixelOfNode* nodeTexture,
+					PixelOfChildren* childrenTexture,
+					int numQueries,
+					int match_length)
+{
+	double start = omp_get_wtime();
+
+	std::vector<CpuNode> tree;
+	if (!buildCpuTree(tree, nodeTexture, childrenTexture))
+	{
+		fprintf(stderr, "CPU tree: suffix link out of the tree, falling back to kernel_gold\n");
+		return -1;
+	}
+
+	std::vector<std::pair<int, int> > order(numQueries);
+	for (int i = 0; i < numQueries; ++i)
+	{
+		order[i] = std::make_pair(queryLengths[i], i);
+	}
+	std::sort(order.begin(), order.end(), longerQuery);
+
+	double built = omp_get_wtime();
+	fprintf(stderr, "CPU tree: %d nodes (%.1f MB) flattened and %d queries sorted in %.3f s\n",
+			(int)tree.size() - 1, tree.size() * sizeof(CpuNode) / 1e6, numQueries, built - start);
+
+	int taken = 0;
+
+#ifdef OMP
+	#pragma omp parallel
+#endif
+	{
+		CpuLane lanes[CPU_LANES];
+		int next = 0;
+		int chunk_end = 0;
+		bool more = true;
+
+		for (int k = 0; k < CPU_LANES; ++k)
+		{
+			lanes[k].qryid = -1;
+		}
+
+		for (;;)
+		{
+			bool active = false;
+			for (int k = 0; k < CPU_LANES; ++k)
+			{
+				CpuLane& lane = lanes[k];
+				if (lane.qryid < 0)
+				{
+					if (next == chunk_end && more)
+					{
+#ifdef OMP
+						#pragma omp atomic capture
+#endif
+						{ next = taken; taken += CPU_QUERY_CHUNK; }
+						chunk_end = min(next + CPU_QUERY_CHUNK, numQueries);
+						more = next < numQueries;
+					}
+					if (next >= chunk_end) { continue; }
+
+					cpu_lane_start(lane, order[next++].second, results, queries,
+								   queryAddrs, queryLengths, match_length);
+				}
+
+				if (!cpu_lane_step(lane, &tree[0], refstr, match_length))
+				{
+					lane.qryid = -1;
+				}
+				active = true;
+			}
+			if (!active) { break; }
+		}
+	}
+
+	return omp_get_wtime() - start;
+}
+
+
 inline char rc(char c)
 {
   switch(c)
@@ -827,43 +1306,44 @@ void computeGold(MatchResults* results,
 #ifdef OMP
 	omp_set_num_threads(N_THREADS);
 	fprintf(stderr, "num of omp threads: %d\n", omp_get_num_threads());
-	#pragma omp parallel for 
 #endif
-	  for (int i = 0; i < numQueries; ++i)
-	  {
-		
-		/*
-		int qryid,
-						MatchResults* results, 		
-						char* queries,
-		                PixelOfNode* nodes,
-		                PixelOfChildren* childrenarr,
-		                char* ref,
-		                const int* queryAddrs,
-		                const int* queryLengths,
-		                const int numQueries,
-		                const int min_match_len
-		#if TREE_ACCESS_HISTOGRAM
-						,int* node_hist,
-						int* child_hist
-		#endif
-		*/
-		 kernel_gold(i, 
-					 results, 
-					 queries, 
-					 nodeTexture, 
-					 childrenTexture,
-					 refstr, 
-					 queryAddrs, 
-					 queryLengths,
-					 numQueries, 
-					 match_length
-#if TREE_ACCESS_HISTOGRAM
-					 ,int* node_hist,
-					 int* child_hist
+	long long bases = 0;
+	for (int i = 0; i < numQueries; ++i)
+	{
+		bases += queryLengths[i];
+	}
+
+#if CPU_ENGINE
+	double seconds = matchCpuTree(results, refstr, queries, queryAddrs, queryLengths,
+								  nodeTexture, childrenTexture, numQueries, match_length);
+	if (seconds >= 0)
+	{
+		reportMatchRate("CPU tree", numQueries, bases, seconds);
+	}
+	else
+#endif
+	{
+		double seconds = matchKernelGold(results, refstr, queries, queryAddrs, queryLengths,
+										 nodeTexture, childrenTexture, numQueries, match_length);
+		reportMatchRate("kernel_gold", numQueries, bases, seconds);
+	}
+
+#if CPU_ENGINE && CPU_ENGINE_COMPARE
+	MatchResults check = *results;
+	check.h_match_coords = (MatchCoord*) calloc(results->numCoords, sizeof(MatchCoord));
+	double check_seconds = matchKernelGold(&check, refstr, queries, queryAddrs, queryLengths,
+										   nodeTexture, childrenTexture, numQueries, match_length);
+	reportMatchRate("kernel_gold", numQueries, bases, check_seconds);
+	// no ratio when the CPU tree did not run (seconds < 0) or took no measurable time
+	char speedup[32] = "n/a";
+	if (seconds > 0)
+		snprintf(speedup, sizeof(speedup), "%.2fx", check_seconds / seconds);
+	fprintf(stderr, "CPU tree vs kernel_gold: %s, match coords %s\n",
+			speedup,
+			memcmp(check.h_match_coords, results->h_match_coords,
+				   results->numCoords * sizeof(MatchCoord)) ? "DIFFER" : "identical");
+	free(check.h_match_coords);
 #endif
-					 );
-	  }
    }
 }
 
@@ -22,6 +22,7 @@ bool OPT_forwardcoordinates = false;
 bool OPT_showQueryLength = false;
 bool OPT_maxmatch = false;
 bool OPT_on_cpu = false;
+bool OPT_suffix_array = false;
 bool OPT_stream_queries = false;
 
 void printHelp()
@@ -36,6 +37,7 @@ void printHelp()
 		   "  -d file.dot Output suffix tree in dot format\n"
 		   "  -t file.tex Output suffix tree texture\n"
 		   "  -C             Compute the matches using the CPU instead of the GPU\n"
+		   "  -S             Match against a suffix array of the whole reference on the CPU\n"
 		   "  -s <file>      write timing and memory stats to <file> \n"
            "\n"
            "  -l <matchlen>  minimal match length to report [Default: 20]\n"
@@ -62,7 +64,7 @@ void ParseCommandLine(int argc, char ** argv)
    int ch;
    optarg = NULL;
 
-   while(!errflg && ((ch = getopt (argc, argv, "aCchql:d:t:s:brcLM")) != EOF))
+   while(!errflg && ((ch = getopt (argc, argv, "aCSchql:d:t:s:brcLM")) != EOF))
    {
       switch  (ch)
 	  {
@@ -71,6 +73,7 @@ void ParseCommandLine(int argc, char ** argv)
 		 case 'd': OPT_dotfilename = optarg; break;
 		 case 't': OPT_texfilename = optarg; break;
 		 case 'C': OPT_on_cpu = true; break;
+		 case 'S': OPT_suffix_array = true; OPT_on_cpu = true; break;
 		 case 'l': OPT_match_length = atoi(optarg); break;
          case 'b': OPT_forwardreverse = true; break;
          case 'r': OPT_reverse = true; break;
@@ -137,6 +140,7 @@ int main(int argc, char* argv[])
 								&queries, 
 								0, 
 								OPT_on_cpu, 
+								OPT_suffix_array,
 								OPT_match_length, 
 								OPT_stats_file,
 								OPT_reverse,
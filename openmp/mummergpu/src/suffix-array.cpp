@@ -0,0 +1,580 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include <omp.h>
+
+#define ulong4 uint32_t
+#define uint4 uint32_t
+#define int2 int32_t
+#include "mummergpu.h"
+
+using namespace std;
+
+// buffered alignment output of suffix-tree.cpp
+void flushOutput();
+
+// Suffix array backend (mummergpu -S)
+//
+// Instead of the suffix tree, the reference is indexed by its suffix array,
+// the inverse suffix array, the LCP array and a table of the SA interval of
+// every k-mer. That is 12 bytes per base plus at most 4 for the table, against
+// ~64 for the tree textures, so the whole reference is indexed at once and
+// never split into pages.
+//
+// For every query position the matcher finds the deepest SA interval of
+// suffixes that share a prefix with the query, i.e. the longest match, and
+// widens it on the LCP array down to min_match_length. That gives exactly the
+// leaves printAlignments visits under the print parent in the tree, each with
+// its match length. The suffixes are sorted with the end of the reference
+// after T, the order of the tree's A, C, G, T, $ children, so the left-maximal
+// matches are printed in the same order as with the tree.
+// Where the tree walk follows a suffix link, the next query position starts
+// from the suffix one to the right of the last match (through the inverse
+// suffix array), which still matches all but its first base, and only the
+// bases beyond are matched.
+
+// Order of the characters in the suffix array: A, C, G, T, end of the reference
+#define SA_END   4
+// Anything else ('x' for an ambiguous query base)
+#define SA_OTHER 5
+
+// Bases per bucket of the initial radix pass of the construction
+#define SA_BUCKET_LEN 8
+// Longest k-mer of the k-mer table
+#define SA_MAX_KMER_LEN 12
+
+// Queries handed to a thread per scheduling step
+#define SA_QUERY_CHUNK 16
+// Queries whose output is collected before it is written
+#define SA_QUERY_BATCH 4096
+
+static unsigned char sa_code[256];
+
+static void initCodes()
+{
+    for (int i = 0; i < 256; i++)
+    {
+        sa_code[i] = SA_OTHER;
+    }
+
+    sa_code[(unsigned char) 'A'] = 0;
+    sa_code[(unsigned char) 'C'] = 1;
+    sa_code[(unsigned char) 'G'] = 2;
+    sa_code[(unsigned char) 'T'] = 3;
+    sa_code[(unsigned char) '$'] = SA_END;
+}
+
+static double wallTime()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+// base i of the reference, SA_END past its end
+inline int baseCode(const char* bases, int len, int i)
+{
+    return i < len ? sa_code[(unsigned char) bases[i]] : SA_END;
+}
+
+// group of the suffix at i, the empty suffix past the end sorts last
+inline int groupOf(const int* group, int len, int i)
+{
+    return i < len ? group[i] : len;
+}
+
+struct SortGroup
+{
+    int begin;
+    int end;
+};
+
+//////////////////////////////////
+/// buildSuffixArray
+//////////////////////////////////
+
+// Prefix doubling in the manner of Larsson and Sadakane. The suffixes are
+// radix sorted by their first SA_BUCKET_LEN bases. After that, every group of
+// suffixes that agree on their first h bases is sorted by the group of the
+// suffix h bases further on, which sorts it by its first 2h bases and splits
+// it into smaller groups. The groups are independent and are sorted in
+// parallel. The new group numbers go to a second array and are copied back
+// once the round is done, since other groups still read the old ones. A
+// group number is the SA index of the group's first suffix, so once all
+// groups are single suffixes the group numbers are the inverse suffix array.
+static void buildSuffixArray(const char* bases, int len, int* sa, int* isa)
+{
+    int buckets = 1;
+    for (int i = 0; i < SA_BUCKET_LEN; i++) { buckets *= SA_END + 1; }
+
+    // radix pass on the first bases
+    vector<int> code(len);
+    vector<int> start(buckets + 1, 0);
+
+    int c = 0;
+    for (int i = 0; i < SA_BUCKET_LEN; i++) { c = c * (SA_END + 1) + baseCode(bases, len, i); }
+    for (int i = 0; i < len; i++)
+    {
+        code[i] = c;
+        start[c + 1]++;
+        c = (c % (buckets / (SA_END + 1))) * (SA_END + 1) + baseCode(bases, len, i + SA_BUCKET_LEN);
+    }
+    for (int b = 0; b < buckets; b++) { start[b + 1] += start[b]; }
+
+    vector<SortGroup> groups;
+    for (int b = 0; b < buckets; b++)
+    {
+        if (start[b + 1] - start[b] > 1)
+        {
+            SortGroup g = { start[b], start[b + 1] };
+            groups.push_back(g);
+        }
+    }
+
+    vector<int> fill(start.begin(), start.end() - 1);
+    for (int i = 0; i < len; i++)
+    {
+        isa[i] = start[code[i]];
+        sa[fill[code[i]]++] = i;
+    }
+
+    vector<int>().swap(code);
+    vector<int>().swap(fill);
+
+    // doubling rounds
+    vector<int> next(isa, isa + len);
+    vector<vector<SortGroup> > split(omp_get_max_threads());
+
+    for (int h = SA_BUCKET_LEN; !groups.empty(); h *= 2)
+    {
+        int numGroups = groups.size();
+
+        #pragma omp parallel
+        {
+            vector<pair<int, int> > keys;
+            vector<SortGroup>& mine = split[omp_get_thread_num()];
+
+            #pragma omp for schedule(dynamic, 64)
+            for (int g = 0; g < numGroups; g++)
+            {
+                int begin = groups[g].begin;
+                int end = groups[g].end;
+
+                keys.clear();
+                for (int j = begin; j < end; j++)
+                {
+                    keys.push_back(make_pair(groupOf(isa, len, sa[j] + h), sa[j]));
+                }
+                sort(keys.begin(), keys.end());
+
+                int first = 0;
+                for (int j = 0; j <= end - begin; j++)
+                {
+                    if (j < end - begin) { sa[begin + j] = keys[j].second; }
+
+                    if (j == end - begin || keys[j].first != keys[first].first)
+                    {
+                        for (int k = first; k < j; k++)
+                        {
+                            next[keys[k].second] = begin + first;
+                        }
+                        if (j - first > 1)
+                        {
+                            SortGroup sub = { begin + first, begin + j };
+                            mine.push_back(sub);
+                        }
+                        first = j;
+                    }
+                }
+            }
+
+            #pragma omp for schedule(dynamic, 64)
+            for (int g = 0; g < numGroups; g++)
+            {
+                for (int j = groups[g].begin; j < groups[g].end; j++)
+                {
+                    isa[sa[j]] = next[sa[j]];
+                }
+            }
+        }
+
+        groups.clear();
+        for (size_t t = 0; t < split.size(); t++)
+        {
+            groups.insert(groups.end(), split[t].begin(), split[t].end());
+            split[t].clear();
+        }
+    }
+}
+
+//////////////////////////////////
+/// buildLCPArray
+//////////////////////////////////
+
+// Kasai et al.: going through the suffixes in text order, the common prefix
+// with the previous suffix in SA order shrinks by at most one base from one
+// suffix to the next. Every thread takes a slice of the text and starts its
+// slice from zero.
+static void buildLCPArray(const char* bases, int len, const int* sa, const int* isa, int* lcp)
+{
+    int slices = 4 * omp_get_max_threads();
+
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int s = 0; s < slices; s++)
+    {
+        int begin = (int) ((long long) len * s / slices);
+        int end = (int) ((long long) len * (s + 1) / slices);
+        int h = 0;
+
+        for (int i = begin; i < end; i++)
+        {
+            int k = isa[i];
+            if (k == 0)
+            {
+                lcp[0] = 0;
+                h = 0;
+                continue;
+            }
+
+            int j = sa[k - 1];
+            while (i + h < len && j + h < len && bases[i + h] == bases[j + h]) { h++; }
+            lcp[k] = h;
+            if (h > 0) { h--; }
+        }
+    }
+}
+
+//////////////////////////////////
+/// buildKmerTable
+//////////////////////////////////
+
+// SA interval of every k-mer of A, C, G, T. The suffixes shorter than the
+// k-mers sit between the intervals, so both ends are stored.
+static void buildKmerTable(const char* bases, int len, const int* sa, int kmer_len, int* range)
+{
+    int kmers = 1 << (2 * kmer_len);
+    unsigned int mask = kmers - 1;
+
+    memset(range, 0, 2 * (size_t) kmers * sizeof(int));
+
+    vector<int> code(len, -1);
+    unsigned int c = 0;
+    for (int i = 0; i < len; i++)
+    {
+        c = ((c << 2) | sa_code[(unsigned char) bases[i]]) & mask;
+        if (i >= kmer_len - 1) { code[i - kmer_len + 1] = c; }
+    }
+
+    #pragma omp parallel for
+    for (int k = 0; k < len; k++)
+    {
+        int kc = code[sa[k]];
+        if (kc < 0) { continue; }
+
+        if (k == 0 || code[sa[k - 1]] != kc) { range[2 * kc] = k; }
+        if (k == len - 1 || code[sa[k + 1]] != kc) { range[2 * kc + 1] = k + 1; }
+    }
+}
+
+extern "C"
+int createSuffixArray(char* refstr, size_t reflen, SuffixArrayIndex* index)
+{
+    initCodes();
+
+    // refstr is 's' + bases + '$'
+    int len = reflen - 3;
+    const char* bases = refstr + 1;
+
+    int kmer_len = 1;
+    while (kmer_len < SA_MAX_KMER_LEN && (2LL << (2 * (kmer_len + 1))) <= len)
+    {
+        kmer_len++;
+    }
+
+    index->str = refstr;
+    index->len = len;
+    index->kmer_len = kmer_len;
+    index->sa = (int*) malloc(len * sizeof(int));
+    index->isa = (int*) malloc(len * sizeof(int));
+    index->lcp = (int*) malloc(len * sizeof(int));
+    index->kmer_range = (int*) malloc(2 * ((size_t) 1 << (2 * kmer_len)) * sizeof(int));
+
+    if (!index->sa || !index->isa || !index->lcp || !index->kmer_range)
+    {
+        fprintf(stderr, "ERROR: out of memory for the suffix array of %d bases\n", len);
+        return -1;
+    }
+
+    index->bytes = 3 * (size_t) len * sizeof(int) + 2 * ((size_t) 1 << (2 * kmer_len)) * sizeof(int);
+
+    fprintf(stderr, "  Building suffix array... ");
+    double t0 = wallTime();
+    buildSuffixArray(bases, len, index->sa, index->isa);
+    double t1 = wallTime();
+    buildLCPArray(bases, len, index->sa, index->isa, index->lcp);
+    double t2 = wallTime();
+    buildKmerTable(bases, len, index->sa, kmer_len, index->kmer_range);
+    double t3 = wallTime();
+
+    fprintf(stderr, "%d bases [SA %.3fs, LCP %.3fs, %d-mer table %.3fs], %.1f MB (%.1f bytes/base)\n",
+            len, t1 - t0, t2 - t1, kmer_len, t3 - t2,
+            index->bytes / 1e6, (double) index->bytes / len);
+
+    return 0;
+}
+
+extern "C"
+int destroySuffixArray(SuffixArrayIndex* index)
+{
+    free(index->sa);
+    free(index->isa);
+    free(index->lcp);
+    free(index->kmer_range);
+
+    index->sa = index->isa = index->lcp = index->kmer_range = NULL;
+    index->len = 0;
+
+    return 0;
+}
+
+//////////////////////////////////
+/// matchQuery
+//////////////////////////////////
+
+// Narrows [lo, hi), all suffixes sharing the first d bases with qry, base by
+// base to the suffixes sharing the most bases with qry. A single suffix is
+// extended by comparing bases.
+static void narrowInterval(const SuffixArrayIndex* index,
+                           const char* qry,
+                           int qrylen,
+                           int* lo,
+                           int* hi,
+                           int* d)
+{
+    const char* bases = index->str + 1;
+    const int* sa = index->sa;
+
+    while (*d < qrylen)
+    {
+        int c = sa_code[(unsigned char) qry[*d]];
+        if (c >= SA_END) { break; }
+
+        if (*hi - *lo == 1)
+        {
+            const char* ref = bases + sa[*lo];
+            int reflen = index->len - sa[*lo];
+            while (*d < qrylen && *d < reflen && ref[*d] == qry[*d]) { (*d)++; }
+            break;
+        }
+
+        // first suffix with base >= c at depth d, then first with base > c
+        int a = *lo, b = *hi;
+        while (a < b)
+        {
+            int m = (a + b) / 2;
+            if (sa_code[(unsigned char) bases[sa[m] + *d]] < c) { a = m + 1; } else { b = m; }
+        }
+        int first = a;
+        b = *hi;
+        while (a < b)
+        {
+            int m = (a + b) / 2;
+            if (sa_code[(unsigned char) bases[sa[m] + *d]] <= c) { a = m + 1; } else { b = m; }
+        }
+
+        if (first == a) { break; }
+
+        *lo = first;
+        *hi = a;
+        (*d)++;
+    }
+}
+
+// Appends the alignments of one query, with the header line, to out
+static void matchQuery(const SuffixArrayIndex* index,
+                       const char* name,
+                       const char* query,
+                       int qrylen,
+                       int min_match_len,
+                       vector<int>& left,
+                       string& out)
+{
+    const char* bases = index->str + 1;
+    const int* sa = index->sa;
+    const int* isa = index->isa;
+    const int* lcp = index->lcp;
+    int len = index->len;
+    int kmer_len = index->kmer_len;
+
+    // query is 'q' + bases
+    const char* qry = query + 1;
+
+    int lo = 0, hi = 0, d = 0;
+    char buf[64];
+    bool header = false;
+
+    for (int p = 0; p + min_match_len <= qrylen; p++)
+    {
+        const char* q = qry + p;
+        int m = qrylen - p;
+
+        if (d - 1 >= min_match_len && sa[lo] + 1 < len)
+        {
+            // the suffix after the last match still matches d - 1 bases
+            int k = isa[sa[lo] + 1];
+            d--;
+            lo = k;
+            hi = k + 1;
+            while (lo > 0 && lcp[lo] >= d) { lo--; }
+            while (hi < len && lcp[hi] >= d) { hi++; }
+        }
+        else
+        {
+            lo = 0;
+            hi = len;
+            d = 0;
+
+            if (m >= kmer_len)
+            {
+                int kc = 0;
+                int j = 0;
+                for (; j < kmer_len; j++)
+                {
+                    int c = sa_code[(unsigned char) q[j]];
+                    if (c >= SA_END) { break; }
+                    kc = (kc << 2) | c;
+                }
+
+                if (j == kmer_len && index->kmer_range[2 * kc] < index->kmer_range[2 * kc + 1])
+                {
+                    lo = index->kmer_range[2 * kc];
+                    hi = index->kmer_range[2 * kc + 1];
+                    d = kmer_len;
+                }
+                else if ((j == kmer_len ? kmer_len - 1 : j) < min_match_len)
+                {
+                    // the longest match is shorter than the k-mer (or
+                    // stops at an ambiguous base) and than min_match_len
+                    continue;
+                }
+            }
+        }
+
+        narrowInterval(index, q, m, &lo, &hi, &d);
+
+        if (d < min_match_len) { continue; }
+
+        // widen to every suffix sharing min_match_len bases, the suffixes
+        // left of the match are collected first to print them in SA order
+        char flank = (p == 0) ? 'q' : qry[p - 1];
+
+        left.clear();
+        int run = d;
+        for (int k = lo - 1; k >= 0 && lcp[k + 1] >= min_match_len; k--)
+        {
+            run = min(run, lcp[k + 1]);
+            left.push_back(k);
+            left.push_back(run);
+        }
+
+        int widest = hi;
+        while (widest < len && lcp[widest] >= min_match_len) { widest++; }
+
+        run = d;
+        int i = left.size();
+        for (int k = (left.empty() ? lo : left[i - 2]); k < widest; k++)
+        {
+            int matchlen;
+            if (k < lo)
+            {
+                i -= 2;
+                matchlen = left[i + 1];
+            }
+            else
+            {
+                if (k >= hi) { run = min(run, lcp[k]); }
+                matchlen = run;
+            }
+
+            int r = sa[k];
+            if (r > 0 && bases[r - 1] == flank) { continue; }
+
+            if (!header)
+            {
+                out += "> ";
+                out += name;
+                out += "\n";
+                header = true;
+            }
+            sprintf(buf, "%d\t%d\t%d\n", r + 1, p + 1, matchlen);
+            out += buf;
+        }
+    }
+}
+
+//////////////////////////////////
+/// matchQueryBlockToSuffixArray
+//////////////////////////////////
+
+// Matches a block of queries read by getQueriesTexture and prints the
+// alignments in the format of getExactAlignments. The queries are matched
+// SA_QUERY_BATCH at a time, so only one batch of output is held in memory.
+// Returns the time spent matching.
+extern "C"
+float matchQueryBlockToSuffixArray(const SuffixArrayIndex* index,
+                                   QuerySet* queries,
+                                   int min_match_length)
+{
+    int count = queries->count;
+    vector<string> out(min(count, SA_QUERY_BATCH));
+    long long bases = 0;
+    double t_match = 0, t_output = 0;
+
+    flushOutput();
+
+    for (int batch = 0; batch < count; batch += SA_QUERY_BATCH)
+    {
+        int batch_end = min(count, batch + SA_QUERY_BATCH);
+        double t0 = wallTime();
+
+        #pragma omp parallel reduction(+:bases)
+        {
+            vector<int> left;
+
+            #pragma omp for schedule(dynamic, SA_QUERY_CHUNK)
+            for (int q = batch; q < batch_end; q++)
+            {
+                out[q - batch].clear();
+                matchQuery(index,
+                           queries->h_names[q],
+                           queries->h_tex_array + queries->h_addrs_tex_array[q],
+                           queries->h_lengths_array[q],
+                           min_match_length,
+                           left,
+                           out[q - batch]);
+                bases += queries->h_lengths_array[q];
+            }
+        }
+
+        double t1 = wallTime();
+
+        for (int q = batch; q < batch_end; q++)
+        {
+            fwrite(out[q - batch].data(), 1, out[q - batch].size(), stdout);
+        }
+
+        t_match += t1 - t0;
+        t_output += wallTime() - t1;
+    }
+
+    fprintf(stderr, "Suffix array: %d queries (%lld bp) in %.3f s, %.0f queries/s, %.2f Mbp/s, output %.3f s\n",
+            count, bases, t_match, count / t_match, bases / t_match / 1e6, t_output);
+
+    return t_match * 1000.0f;
+}
@@ -0,0 +1,688 @@
+//======================================================================================================================================================
+//======================================================================================================================================================
+//		BATCHED SOLVER
+//======================================================================================================================================================
+//======================================================================================================================================================
+
+// Advances a batch of instances in lockstep. The state of a batch is kept in SoA layout, value i of lane l at [i*lanes+l], so the Runge-Kutta
+// stage combinations, the final value and the error estimate run as contiguous vector loops across instances. Each lane keeps its own step
+// size and attempt count, lanes that have accepted their step (or failed) are masked out of the model evaluations until the next time instance.
+// The model (master) takes the SoA arrays as they are: its exp/pow/log/fmod calls, which have no vector versions without -ffast-math (which
+// would also drop the NAN/INF compensation in master), are made lane by lane for the active lanes only, the arithmetic around them runs as
+// simd loops across all lanes. Every lane does exactly the same floating point operations as the scalar solver, so results are identical to
+// modes 0 and 1.
+
+//======================================================================================================================================================
+//		BATCHED EMBEDDED FEHLBERG 7(8) STEP
+//======================================================================================================================================================
+
+// one step of all lanes from the same time instance with per-lane step sizes h, see embedded_fehlberg_7_8.c. Temporary storage is provided
+// by the caller: initvalu_temp and timeinst_temp hold EQUATIONS*lanes and lanes values, finavalu_temp 13 arrays of EQUATIONS*lanes values,
+// model_temp MODEL_TEMPS*lanes values
+
+void embedded_fehlberg_7_8_batch(	fp timeinst,
+														fp* h,
+														fp* initvalu,
+														fp* finavalu,
+														fp* error,
+														fp* parameter,
+														int lanes,
+														int* active,
+														fp* timeinst_temp,
+														fp* initvalu_temp,
+														fp** finavalu_temp,
+														double* model_temp) {
+
+	//======================================================================================================================================================
+	//	VARIABLES
+	//======================================================================================================================================================
+
+	static const fp c_1_11 = 41.0 / 840.0;
+	static const fp c6 = 34.0 / 105.0;
+	static const fp c_7_8= 9.0 / 35.0;
+	static const fp c_9_10 = 9.0 / 280.0;
+
+	static const fp a2 = 2.0 / 27.0;
+	static const fp a3 = 1.0 / 9.0;
+	static const fp a4 = 1.0 / 6.0;
+	static const fp a5 = 5.0 / 12.0;
+	static const fp a6 = 1.0 / 2.0;
+	static const fp a7 = 5.0 / 6.0;
+	static const fp a8 = 1.0 / 6.0;
+	static const fp a9 = 2.0 / 3.0;
+	static const fp a10 = 1.0 / 3.0;
+
+	static const fp b31 = 1.0 / 36.0;
+	static const fp b32 = 3.0 / 36.0;
+	static const fp b41 = 1.0 / 24.0;
+	static const fp b43 = 3.0 / 24.0;
+	static const fp b51 = 20.0 / 48.0;
+	static const fp b53 = -75.0 / 48.0;
+	static const fp b54 = 75.0 / 48.0;
+	static const fp b61 = 1.0 / 20.0;
+	static const fp b64 = 5.0 / 20.0;
+	static const fp b65 = 4.0 / 20.0;
+	static const fp b71 = -25.0 / 108.0;
+	static const fp b74 =  125.0 / 108.0;
+	static const fp b75 = -260.0 / 108.0;
+	static const fp b76 =  250.0 / 108.0;
+	static const fp b81 = 31.0/300.0;
+	static const fp b85 = 61.0/225.0;
+	static const fp b86 = -2.0/9.0;
+	static const fp b87 = 13.0/900.0;
+	static const fp b91 = 2.0;
+	static const fp b94 = -53.0/6.0;
+	static const fp b95 = 704.0 / 45.0;
+	static const fp b96 = -107.0 / 9.0;
+	static const fp b97 = 67.0 / 90.0;
+	static const fp b98 = 3.0;
+	static const fp b10_1 = -91.0 / 108.0;
+	static const fp b10_4 = 23.0 / 108.0;
+	static const fp b10_5 = -976.0 / 135.0;
+	static const fp b10_6 = 311.0 / 54.0;
+	static const fp b10_7 = -19.0 / 60.0;
+	static const fp b10_8 = 17.0 / 6.0;
+	static const fp b10_9 = -1.0 / 12.0;
+	static const fp b11_1 = 2383.0 / 4100.0;
+	static const fp b11_4 = -341.0 / 164.0;
+	static const fp b11_5 = 4496.0 / 1025.0;
+	static const fp b11_6 = -301.0 / 82.0;
+	static const fp b11_7 = 2133.0 / 4100.0;
+	static const fp b11_8 = 45.0 / 82.0;
+	static const fp b11_9 = 45.0 / 164.0;
+	static const fp b11_10 = 18.0 / 41.0;
+	static const fp b12_1 = 3.0 / 205.0;
+	static const fp b12_6 = - 6.0 / 41.0;
+	static const fp b12_7 = - 3.0 / 205.0;
+	static const fp b12_8 = - 3.0 / 41.0;
+	static const fp b12_9 = 3.0 / 41.0;
+	static const fp b12_10 = 6.0 / 41.0;
+	static const fp b13_1 = -1777.0 / 4100.0;
+	static const fp b13_4 = -341.0 / 164.0;
+	static const fp b13_5 = 4496.0 / 1025.0;
+	static const fp b13_6 = -289.0 / 82.0;
+	static const fp b13_7 = 2193.0 / 4100.0;
+	static const fp b13_8 = 51.0 / 82.0;
+	static const fp b13_9 = 33.0 / 164.0;
+	static const fp b13_10 = 12.0 / 41.0;
+
+	static const fp err_factor  = -41.0 / 840.0;
+
+	int i, j, l;
+
+	//======================================================================================================================================================
+	//		EVALUATIONS
+	//======================================================================================================================================================
+
+	//===================================================================================================
+	//		1
+	//===================================================================================================
+
+	for(l=0; l<lanes; l++){
+		timeinst_temp[l] = timeinst;
+	}
+	for(i=0; i<EQUATIONS; i++){
+		#pragma omp simd
+		for(l=0; l<lanes; l++){
+			j = i*lanes+l;
+			initvalu_temp[j] = initvalu[j];
+		}
+	}
+
+	master(		timeinst_temp,
+						initvalu_temp,
+						parameter,
+						finavalu_temp[0],
+						lanes,
+						active,
+						model_temp);
+
+	//===================================================================================================
+	//		2
+	//===================================================================================================
+
+	for(l=0; l<lanes; l++){
+		timeinst_temp[l] = timeinst+a2*h[l];
+	}
+	for(i=0; i<EQUATIONS; i++){
+		#pragma omp simd
+		for(l=0; l<lanes; l++){
+			j = i*lanes+l;
+			initvalu_temp[j] = initvalu[j] + (a2*h[l]) * (finavalu_temp[0][j]);
+		}
+	}
+
+	master(		timeinst_temp,
+						initvalu_temp,
+						parameter,
+						finavalu_temp[1],
+						lanes,
+						active,
+						model_temp);
+
+	//===================================================================================================
+	//		3
+	//===================================================================================================
+
+	for(l=0; l<lanes; l++){
+		timeinst_temp[l] = timeinst+a3*h[l];
+	}
+	for(i=0; i<EQUATIONS; i++){
+		#pragma omp simd
+		for(l=0; l<lanes; l++){
+			j = i*lanes+l;
+			initvalu_temp[j] = initvalu[j] + h[l] * ( b31*finavalu_temp[0][j] + b32*finavalu_temp[1][j]);
+		}
+	}
+
+	master(		timeinst_temp,
+						initvalu_temp,
+						parameter,
+						finavalu_temp[2],
+						lanes,
+						active,
+						model_temp);
+
+	//===================================================================================================
+	//		4
+	//===================================================================================================
+
+	for(l=0; l<lanes; l++){
+		timeinst_temp[l] = timeinst+a4*h[l];
+	}
+	for(i=0; i<EQUATIONS; i++){
+		#pragma omp simd
+		for(l=0; l<lanes; l++){
+			j = i*lanes+l;
+			initvalu_temp[j] = initvalu[j] + h[l] * ( b41*finavalu_temp[0][j] + b43*finavalu_temp[2][j]);
+		}
+	}
+
+	master(		timeinst_temp,
+						initvalu_temp,
+						parameter,
+						finavalu_temp[3],
+						lanes,
+						active,
+						model_temp);
+
+	//===================================================================================================
+	//		5
+	//===================================================================================================
+
+	for(l=0; l<lanes; l++){
+		timeinst_temp[l] = timeinst+a5*h[l];
+	}
+	for(i=0; i<EQUATIONS; i++){
+		#pragma omp simd
+		for(l=0; l<lanes; l++){
+			j = i*lanes+l;
+			initvalu_temp[j] = initvalu[j] + h[l] * ( b51*finavalu_temp[0][j] + b53*finavalu_temp[2][j] + b54*finavalu_temp[3][j]);
+		}
+	}
+
+	master(		timeinst_temp,
+						initvalu_temp,
+						parameter,
+						finavalu_temp[4],
+						lanes,
+						active,
+						model_temp);
+
+	//===================================================================================================
+	//		6
+	//===================================================================================================
+
+	for(l=0; l<lanes; l++){
+		timeinst_temp[l] = timeinst+a6*h[l];
+	}
+	for(i=0; i<EQUATIONS; i++){
+		#pragma omp simd
+		for(l=0; l<lanes; l++){
+			j = i*lanes+l;
+			initvalu_temp[j] = initvalu[j] + h[l] * ( b61*finavalu_temp[0][j] + b64*finavalu_temp[3][j] + b65*finavalu_temp[4][j]);
+		}
+	}
+
+	master(		timeinst_temp,
+						initvalu_temp,
+						parameter,
+						finavalu_temp[5],
+						lanes,
+						active,
+						model_temp);
+
+	//===================================================================================================
+	//		7
+	//===================================================================================================
+
+	for(l=0; l<lanes; l++){
+		timeinst_temp[l] = timeinst+a7*h[l];
+	}
+	for(i=0; i<EQUATIONS; i++){
+		#pragma omp simd
+		for(l=0; l<lanes; l++){
+			j = i*lanes+l;
+			initvalu_temp[j] = initvalu[j] + h[l] * ( b71*finavalu_temp[0][j] + b74*finavalu_temp[3][j] + b75*finavalu_temp[4][j] + b76*finavalu_temp[5][j]);
+		}
+	}
+
+	master(		timeinst_temp,
+						initvalu_temp,
+						parameter,
+						finavalu_temp[6],
+						lanes,
+						active,
+						model_temp);
+
+	//===================================================================================================
+	//		8
+	//===================================================================================================
+
+	for(l=0; l<lanes; l++){
+		timeinst_temp[l] = timeinst+a8*h[l];
+	}
+	for(i=0; i<EQUATIONS; i++){
+		#pragma omp simd
+		for(l=0; l<lanes; l++){
+			j = i*lanes+l;
+			initvalu_temp[j] = initvalu[j] + h[l] * ( b81*finavalu_temp[0][j] + b85*finavalu_temp[4][j] + b86*finavalu_temp[5][j] + b87*finavalu_temp[6][j]);
+		}
+	}
+
+	master(		timeinst_temp,
+						initvalu_temp,
+						parameter,
+						finavalu_temp[7],
+						lanes,
+						active,
+						model_temp);
+
+	//===================================================================================================
+	//		9
+	//===================================================================================================
+
+	for(l=0; l<lanes; l++){
+		timeinst_temp[l] = timeinst+a9*h[l];
+	}
+	for(i=0; i<EQUATIONS; i++){
+		#pragma omp simd
+		for(l=0; l<lanes; l++){
+			j = i*lanes+l;
+			initvalu_temp[j] = initvalu[j] + h[l] * ( b91*finavalu_temp[0][j] + b94*finavalu_temp[3][j] + b95*finavalu_temp[4][j] + b96*finavalu_temp[5][j] + b97*finavalu_temp[6][j]+ b98*finavalu_temp[7][j]);
+		}
+	}
+
+	master(		timeinst_temp,
+						initvalu_temp,
+						parameter,
+						finavalu_temp[8],
+						lanes,
+						active,
+						model_temp);
+
+	//===================================================================================================
+	//		10
+	//===================================================================================================
+
+	for(l=0; l<lanes; l++){
+		timeinst_temp[l] = timeinst+a10*h[l];
+	}
+	for(i=0; i<EQUATIONS; i++){
+		#pragma omp simd
+		for(l=0; l<lanes; l++){
+			j = i*lanes+l;
+			initvalu_temp[j] = initvalu[j] + h[l] * ( b10_1*finavalu_temp[0][j] + b10_4*finavalu_temp[3][j] + b10_5*finavalu_temp[4][j] + b10_6*finavalu_temp[5][j] + b10_7*finavalu_temp[6][j] + b10_8*finavalu_temp[7][j] + b10_9*finavalu_temp[8][j]);
+		}
+	}
+
+	master(		timeinst_temp,
+						initvalu_temp,
+						parameter,
+						finavalu_temp[9],
+						lanes,
+						active,
+						model_temp);
+
+	//===================================================================================================
+	//		11
+	//===================================================================================================
+
+	for(l=0; l<lanes; l++){
+		timeinst_temp[l] = timeinst+h[l];
+	}
+	for(i=0; i<EQUATIONS; i++){
+		#pragma omp simd
+		for(l=0; l<lanes; l++){
+			j = i*lanes+l;
+			initvalu_temp[j] = initvalu[j] + h[l] * ( b11_1*finavalu_temp[0][j] + b11_4*finavalu_temp[3][j] + b11_5*finavalu_temp[4][j] + b11_6*finavalu_temp[5][j] + b11_7*finavalu_temp[6][j] + b11_8*finavalu_temp[7][j] + b11_9*finavalu_temp[8][j]+ b11_10 * finavalu_temp[9][j]);
+		}
+	}
+
+	master(		timeinst_temp,
+						initvalu_temp,
+						parameter,
+						finavalu_temp[10],
+						lanes,
+						active,
+						model_temp);
+
+	//===================================================================================================
+	//		12
+	//===================================================================================================
+
+	for(l=0; l<lanes; l++){
+		timeinst_temp[l] = timeinst;
+	}
+	for(i=0; i<EQUATIONS; i++){
+		#pragma omp simd
+		for(l=0; l<lanes; l++){
+			j = i*lanes+l;
+			initvalu_temp[j] = initvalu[j] + h[l] * ( b12_1*finavalu_temp[0][j] + b12_6*finavalu_temp[5][j] + b12_7*finavalu_temp[6][j] + b12_8*finavalu_temp[7][j] + b12_9*finavalu_temp[8][j] + b12_10 * finavalu_temp[9][j]);
+		}
+	}
+
+	master(		timeinst_temp,
+						initvalu_temp,
+						parameter,
+						finavalu_temp[11],
+						lanes,
+						active,
+						model_temp);
+
+	//===================================================================================================
+	//		13
+	//===================================================================================================
+
+	for(l=0; l<lanes; l++){
+		timeinst_temp[l] = timeinst+h[l];
+	}
+	for(i=0; i<EQUATIONS; i++){
+		#pragma omp simd
+		for(l=0; l<lanes; l++){
+			j = i*lanes+l;
+			initvalu_temp[j] = initvalu[j] + h[l] * ( b13_1*finavalu_temp[0][j] + b13_4*finavalu_temp[3][j] + b13_5*finavalu_temp[4][j] + b13_6*finavalu_temp[5][j] + b13_7*finavalu_temp[6][j] + b13_8*finavalu_temp[7][j] + b13_9*finavalu_temp[8][j] + b13_10*finavalu_temp[9][j] + finavalu_temp[11][j]);
+		}
+	}
+
+	master(		timeinst_temp,
+						initvalu_temp,
+						parameter,
+						finavalu_temp[12],
+						lanes,
+						active,
+						model_temp);
+
+	//======================================================================================================================================================
+	//		FINAL VALUE
+	//======================================================================================================================================================
+
+	for(i=0; i<EQUATIONS; i++){
+		#pragma omp simd
+		for(l=0; l<lanes; l++){
+			j = i*lanes+l;
+			finavalu[j]= initvalu[j] +  h[l] * (c_1_11 * (finavalu_temp[0][j] + finavalu_temp[10][j])  + c6 * finavalu_temp[5][j] + c_7_8 * (finavalu_temp[6][j] + finavalu_temp[7][j]) + c_9_10 * (finavalu_temp[8][j] + finavalu_temp[9][j]) );
+		}
+	}
+
+	//======================================================================================================================================================
+	//		RETURN
+	//======================================================================================================================================================
+
+	for(i=0; i<EQUATIONS; i++){
+		#pragma omp simd
+		for(l=0; l<lanes; l++){
+			j = i*lanes+l;
+			error[j] = fabs(err_factor * (finavalu_temp[0][j] + finavalu_temp[10][j] - finavalu_temp[11][j] - finavalu_temp[12][j]));
+		}
+	}
+
+}
+
+//======================================================================================================================================================
+//		BATCHED SOLVER FUNCTION
+//======================================================================================================================================================
+
+// solves lanes instances over the same interval as solver(), instance l reads and writes y[l], x[l] and params[l] (rows time instances each,
+// see solver.c) and is instance + l for the trajectory sink. status[l] gets the value solver() would have returned for that instance, the
+// function returns 0 if all lanes succeeded and -1 otherwise
+
+int solver_batch(	fp*** y,
+							fp** x,
+							int rows,
+							int xmax,
+							fp** params,
+							int lanes,
+							int* status,
+							trajectory_sink* sink,
+							int instance) {
+
+	//========================================================================================================================
+	//	VARIABLES
+	//========================================================================================================================
+
+	// solver parameters
+	fp err_exponent;
+	int error;
+	int outside;
+	fp h_init;
+	fp tolerance;
+	int xmin;
+	int pending;
+	int result;
+
+	// per-lane step control
+	fp* h = (fp *) malloc(lanes * sizeof(fp));
+	int* attempt = (int *) malloc(lanes * sizeof(int));
+	int* active = (int *) malloc(lanes * sizeof(int));
+
+	// SoA state, EQUATIONS (PARAMETERS) values per lane interleaved
+	fp* initvalu = (fp *) malloc(EQUATIONS * lanes * sizeof(fp));
+	fp* finavalu = (fp *) malloc(EQUATIONS * lanes * sizeof(fp));
+	fp* err = (fp *) malloc(EQUATIONS * lanes * sizeof(fp));
+	fp* parameter = (fp *) malloc(PARAMETERS * lanes * sizeof(fp));
+
+	// step temporaries, zeroed so that masked lanes never carry garbage through the vector loops
+	fp* timeinst_temp = (fp *) malloc(lanes * sizeof(fp));
+	fp* initvalu_temp = (fp *) calloc(EQUATIONS * lanes, sizeof(fp));
+	fp* finavalu_temp[13];
+	double* model_temp = (double *) calloc(MODEL_TEMPS * lanes, sizeof(double));
+
+	// memory
+	fp scale_min;
+	fp scale_fina;
+	fp yy;
+	fp scale;
+
+	// counters
+	int i, k, l;
+	int prev, next;
+
+	for(i=0; i<13; i++){
+		finavalu_temp[i] = (fp *) calloc(EQUATIONS * lanes, sizeof(fp));
+	}
+
+	//========================================================================================================================
+	//		INITIAL SETUP
+	//========================================================================================================================
+
+	// solver parameters
+	err_exponent = 1.0 / 7.0;
+	h_init = 1;
+	xmin = 0;
+	tolerance = 10 / (fp)(xmax-xmin);
+
+	for(l=0; l<lanes; l++){
+		status[l] = 0;
+		x[l][0] = 0;
+		sink_put(sink, instance + l, 0, x[l][0], y[l][0]);
+		for(i=0; i<PARAMETERS; i++){
+			parameter[i*lanes+l] = params[l][i];
+		}
+	}
+
+	//========================================================================================================================
+	//		CHECKING
+	//========================================================================================================================
+
+	if (xmax < xmin || h_init <= 0.0){
+		for(l=0; l<lanes; l++){
+			status[l] = -2;
+		}
+		xmax = xmin;
+	}
+
+	//========================================================================================================================
+	//		SOLVING
+	//========================================================================================================================
+
+	for(k=1; k<=xmax; k++) {
+
+		//==========================================================================================
+		//		REINITIALIZE LANES, GATHER PREVIOUS TIME INSTANCE
+		//==========================================================================================
+
+		prev = (k-1) % rows;
+		next = k % rows;
+		pending = 0;
+		for(l=0; l<lanes; l++){
+			x[l][next] = k-1;
+			h[l] = h_init;
+			attempt[l] = 0;
+			active[l] = status[l] == 0;
+			pending = pending + active[l];
+			if(active[l]){
+				for(i=0; i<EQUATIONS; i++){
+					initvalu[i*lanes+l] = y[l][prev][i];
+				}
+			}
+		}
+
+		//==========================================================================================
+		//		MAKE ATTEMPTS UNTIL EVERY LANE IS WITHIN TOLERANCE OR OUT OF ATTEMPTS
+		//==========================================================================================
+
+		while(pending > 0){
+
+			embedded_fehlberg_7_8_batch(	(fp)(k-1),
+															h,
+															initvalu,
+															finavalu,
+															err,
+															parameter,
+															lanes,
+															active,
+															timeinst_temp,
+															initvalu_temp,
+															finavalu_temp,
+															model_temp);
+
+			for(l=0; l<lanes; l++){
+
+				if(!active[l]){
+					continue;
+				}
+
+				//============================================================
+				//		SAME STEP CONTROL AS solver() FOR THIS LANE
+				//============================================================
+
+				error = 0;
+				outside = 0;
+				scale_min = MAX_SCALE_FACTOR;
+
+				for(i=0; i<EQUATIONS; i++){
+					if(err[i*lanes+l] > 0){
+						error = 1;
+					}
+				}
+
+				if (error == 1) {
+					for(i=0; i<EQUATIONS; i++){
+						if(initvalu[i*lanes+l] == 0.0){
+							yy = tolerance;
+						}
+						else{
+							yy = fabs(initvalu[i*lanes+l]);
+						}
+						scale = 0.8 * pow( tolerance * yy / err[i*lanes+l] , err_exponent );
+						if(scale<scale_min){
+							scale_min = scale;
+						}
+						if ( err[i*lanes+l] > ( tolerance * yy ) ){
+							outside = 1;
+						}
+					}
+					scale_fina = min( max(scale_min,MIN_SCALE_FACTOR), MAX_SCALE_FACTOR);
+				}
+
+				attempt[l] = attempt[l] + 1;
+
+				// outside tolerance: adjust step for the next attempt of this lane
+				if (outside == 1) {
+					h[l] = h[l] * scale_fina;
+					if (h[l] >= 0.9) {
+						h[l] = 0.9;
+					}
+					if ( x[l][next] + h[l] > (fp)xmax ){
+						h[l] = (fp)xmax - x[l][next];
+					}
+					else if ( x[l][next] + h[l] + 0.5 * h[l] > (fp)xmax ){
+						h[l] = 0.5 * h[l];
+					}
+				}
+
+				// lane done: within tolerance or out of attempts, save its time instance and values and mask it out
+				if (outside == 0 || attempt[l] >= ATTEMPTS) {
+					x[l][next] = x[l][next] + h[l];
+					for(i=0; i<EQUATIONS; i++){
+						y[l][next][i] = finavalu[i*lanes+l];
+					}
+					if (outside == 1) {
+						status[l] = -1;
+					}
+					else{
+						sink_put(sink, instance + l, k, x[l][next], y[l][next]);
+					}
+					active[l] = 0;
+					pending = pending - 1;
+				}
+
+			}
+
+		}
+
+	}
+
+	//========================================================================================================================
+	//		FREE MEMORY
+	//========================================================================================================================
+
+	free(h);
+	free(attempt);
+	free(active);
+	free(initvalu);
+	free(finavalu);
+	free(err);
+	free(parameter);
+	free(timeinst_temp);
+	free(initvalu_temp);
+	for(i=0; i<13; i++){
+		free(finavalu_temp[i]);
+	}
+	free(model_temp);
+
+	//========================================================================================================================
+	//		FINAL RETURN
+	//========================================================================================================================
+
+	result = 0;
+	for(l=0; l<lanes; l++){
+		if(status[l] != 0){
+			result = -1;
+		}
+	}
+
+	return result;
+
+}
@@ -1,21 +1,26 @@
 //=====================================================================
 //	MAIN FUNCTION
 //=====================================================================
-fp cam(fp timeinst,
+
+// evaluates one CaM compartment of lanes instances stored value by value (see ecc.c), the Ca concentration of the compartment is
+// value Ca_offset (ECC model, [mM]) of each instance. JCa gets the Ca flux of every lane; temp holds lanes values for the pow call.
+
+void cam(fp *timeinst,
 			fp *initvalu,
 			int initvalu_offset,
 			fp *parameter,
 			int parameter_offset,
 			fp *finavalu,
-			fp Ca){
+			int Ca_offset,
+			double *JCa,
+			int lanes,
+			int *active,
+			double *temp){
 
 	//=====================================================================
 	//	VARIABLES
 	//=====================================================================
 
-	// output
-	fp JCa;
-
 	// input data and output data variable references
 	int offset_1;
 	int offset_2;
@@ -40,30 +45,6 @@ fp cam(fp timeinst,
 	int parameter_offset_4;
 	int parameter_offset_5;
 
-	// decoding input initial values
-	fp CaM;
-	fp Ca2CaM;
-	fp Ca4CaM;
-	fp CaMB;
-	fp Ca2CaMB;
-	fp Ca4CaMB;           
-	fp Pb2;
-	fp Pb;
-	fp Pt;
-	fp Pt2;
-	fp Pa;                            
-	fp Ca4CaN;
-	fp CaMCa4CaN;
-	fp Ca2CaMCa4CaN;
-	fp Ca4CaMCa4CaN;
-
-	// decoding input parameters
-	fp CaMtot;
-	fp Btot;
-	fp CaMKIItot;
-	fp CaNtot;
-	fp PP1tot;
-
 	// constants
 	fp K;																			//
 	fp Mg;																			//
@@ -119,114 +100,39 @@ fp cam(fp timeinst,
 	fp k20can;
 	fp k24can;
 	fp k42can;
+	// per instance pow(T,3), lanes values in temp
+	double *t_T3;
 
-	// CaM Reaction fluxes
-	fp rcn02;
-	fp rcn24;
-
-	// CaM buffer fluxes
-	fp B;
-	fp rcn02B;
-	fp rcn24B;
-	fp rcn0B;
-	fp rcn2B;
-	fp rcn4B;
-
-	// CaN reaction fluxes 
-	fp Ca2CaN;
-	fp rcnCa4CaN;
-	fp rcn02CaN; 
-	fp rcn24CaN;
-	fp rcn0CaN;
-	fp rcn2CaN;
-	fp rcn4CaN;
-
-	// CaMKII reaction fluxes
-	fp Pix;
-	fp rcnCKib2;
-	fp rcnCKb2b;
-	fp rcnCKib;
-	fp T;
-	fp kbt;
-	fp rcnCKbt;
-	fp rcnCKtt2;
-	fp rcnCKta;
-	fp rcnCKt2a;
-	fp rcnCKt2b2;
-	fp rcnCKai;
-
-	// CaM equations
-	fp dCaM;
-	fp dCa2CaM;
-	fp dCa4CaM;
-	fp dCaMB;
-	fp dCa2CaMB;
-	fp dCa4CaMB;
-
-	// CaMKII equations
-	fp dPb2;																		// Pb2
-	fp dPb;																			// Pb
-	fp dPt;																			// Pt
-	fp dPt2;																		// Pt2
-	fp dPa;																			// Pa
-
-	// CaN equations
-	fp dCa4CaN;																		// Ca4CaN
-	fp dCaMCa4CaN;																	// CaMCa4CaN
-	fp dCa2CaMCa4CaN;																// Ca2CaMCa4CaN
-	fp dCa4CaMCa4CaN;																// Ca4CaMCa4CaN
+	// counters
+	int l;
 
 	//=====================================================================
 	//	COMPUTATION
 	//=====================================================================
 
 	// input data and output data variable references
-	offset_1  = initvalu_offset;
-	offset_2  = initvalu_offset+1;
-	offset_3  = initvalu_offset+2;
-	offset_4  = initvalu_offset+3;
-	offset_5  = initvalu_offset+4;
-	offset_6  = initvalu_offset+5;
-	offset_7  = initvalu_offset+6;
-	offset_8  = initvalu_offset+7;
-	offset_9  = initvalu_offset+8;
-	offset_10 = initvalu_offset+9;
-	offset_11 = initvalu_offset+10;
-	offset_12 = initvalu_offset+11;
-	offset_13 = initvalu_offset+12;
-	offset_14 = initvalu_offset+13;
-	offset_15 = initvalu_offset+14;
+	offset_1  = initvalu_offset*lanes;
+	offset_2  = (initvalu_offset+1)*lanes;
+	offset_3  = (initvalu_offset+2)*lanes;
+	offset_4  = (initvalu_offset+3)*lanes;
+	offset_5  = (initvalu_offset+4)*lanes;
+	offset_6  = (initvalu_offset+5)*lanes;
+	offset_7  = (initvalu_offset+6)*lanes;
+	offset_8  = (initvalu_offset+7)*lanes;
+	offset_9  = (initvalu_offset+8)*lanes;
+	offset_10 = (initvalu_offset+9)*lanes;
+	offset_11 = (initvalu_offset+10)*lanes;
+	offset_12 = (initvalu_offset+11)*lanes;
+	offset_13 = (initvalu_offset+12)*lanes;
+	offset_14 = (initvalu_offset+13)*lanes;
+	offset_15 = (initvalu_offset+14)*lanes;
 	
 	// input parameters variable references
-	parameter_offset_1  = parameter_offset;
-	parameter_offset_2  = parameter_offset+1;
-	parameter_offset_3  = parameter_offset+2;
-	parameter_offset_4  = parameter_offset+3;
-	parameter_offset_5  = parameter_offset+4;
-
-	// decoding input array
-	CaM				= initvalu[offset_1];
-	Ca2CaM			= initvalu[offset_2];
-	Ca4CaM			= initvalu[offset_3];
-	CaMB			= initvalu[offset_4];
-	Ca2CaMB			= initvalu[offset_5];
-	Ca4CaMB			= initvalu[offset_6];           
-	Pb2				= initvalu[offset_7];
-	Pb				= initvalu[offset_8];
-	Pt				= initvalu[offset_9];
-	Pt2				= initvalu[offset_10];
-	Pa				= initvalu[offset_11];                            
-	Ca4CaN			= initvalu[offset_12];
-	CaMCa4CaN		= initvalu[offset_13];
-	Ca2CaMCa4CaN	= initvalu[offset_14];
-	Ca4CaMCa4CaN	= initvalu[offset_15];
-
-	// decoding input parameters
-	CaMtot			= parameter[parameter_offset_1];
-	Btot			= parameter[parameter_offset_2];
-	CaMKIItot		= parameter[parameter_offset_3];
-	CaNtot			= parameter[parameter_offset_4];
-	PP1tot			= parameter[parameter_offset_5];
+	parameter_offset_1  = parameter_offset*lanes;
+	parameter_offset_2  = (parameter_offset+1)*lanes;
+	parameter_offset_3  = (parameter_offset+2)*lanes;
+	parameter_offset_4  = (parameter_offset+3)*lanes;
+	parameter_offset_5  = (parameter_offset+4)*lanes;
 
 	// values [CONSTANTS FOR ALL THREADS]
 	K = 135;																			//
@@ -290,83 +196,146 @@ fp cam(fp timeinst,
 	k24can = k24;
 	k42can = k20/2508;
 
-	// CaM Reaction fluxes
-	rcn02 = k02*pow(Ca,2)*CaM - k20*Ca2CaM;
-	rcn24 = k24*pow(Ca,2)*Ca2CaM - k42*Ca4CaM;
+	// per instance results of the calls
+	t_T3 = &temp[0];
+
+	// CaMKII pow call, every active instance in turn
+	for(l=0; l<lanes; l++){
+
+		if(active != NULL && active[l] == 0){
+			continue;
+		}
+
+		fp Pb	= initvalu[offset_8+l];
+		fp Pt	= initvalu[offset_9+l];
+		fp Pt2	= initvalu[offset_10+l];
+		fp Pa	= initvalu[offset_11+l];
+		fp T = Pb + Pt + Pt2 + Pa;
+		t_T3[l] = pow(T,3);
+
+	}
+
+	// arithmetic, all instances at once
+	#pragma omp simd
+	for(l=0; l<lanes; l++){
+
+		// Ca of the compartment, *** Converting from [mM] to [uM] ***
+		fp Ca = initvalu[Ca_offset*lanes+l]*1e3;
+
+		// decoding input initial values
+		fp CaM				= initvalu[offset_1+l];
+		fp Ca2CaM			= initvalu[offset_2+l];
+		fp Ca4CaM			= initvalu[offset_3+l];
+		fp CaMB			= initvalu[offset_4+l];
+		fp Ca2CaMB			= initvalu[offset_5+l];
+		fp Ca4CaMB			= initvalu[offset_6+l];           
+		fp Pb2				= initvalu[offset_7+l];
+		fp Pb				= initvalu[offset_8+l];
+		fp Pt				= initvalu[offset_9+l];
+		fp Pt2				= initvalu[offset_10+l];
+		fp Pa				= initvalu[offset_11+l];                            
+		fp Ca4CaN			= initvalu[offset_12+l];
+		fp CaMCa4CaN		= initvalu[offset_13+l];
+		fp Ca2CaMCa4CaN	= initvalu[offset_14+l];
+		fp Ca4CaMCa4CaN	= initvalu[offset_15+l];
+
+		// decoding input parameters
+		fp CaMtot			= parameter[parameter_offset_1+l];
+		fp Btot			= parameter[parameter_offset_2+l];
+		fp CaMKIItot		= parameter[parameter_offset_3+l];
+		fp CaNtot			= parameter[parameter_offset_4+l];
+		fp PP1tot			= parameter[parameter_offset_5+l];
+
+		// result of the call above
+		double T3 = t_T3[l];
+
+		// fluxes and equations
+		fp rcn02, rcn24;
+		fp B, rcn02B, rcn24B, rcn0B, rcn2B, rcn4B;
+		fp Ca2CaN, rcnCa4CaN, rcn02CaN, rcn24CaN, rcn0CaN, rcn2CaN, rcn4CaN;
+		fp Pix, rcnCKib2, rcnCKb2b, rcnCKib, T, kbt, rcnCKbt, rcnCKtt2, rcnCKta, rcnCKt2a, rcnCKt2b2, rcnCKai;
+		fp dCaM, dCa2CaM, dCa4CaM, dCaMB, dCa2CaMB, dCa4CaMB;
+		fp dPb2, dPb, dPt, dPt2, dPa;
+		fp dCa4CaN, dCaMCa4CaN, dCa2CaMCa4CaN, dCa4CaMCa4CaN;
+		fp JCa_l;
+
+		// CaM Reaction fluxes
+		rcn02 = k02*pow(Ca,2)*CaM - k20*Ca2CaM;
+		rcn24 = k24*pow(Ca,2)*Ca2CaM - k42*Ca4CaM;
 	
-	// CaM buffer fluxes
-	B = Btot - CaMB - Ca2CaMB - Ca4CaMB;
-	rcn02B = k02B*pow(Ca,2)*CaMB - k20B*Ca2CaMB;
-	rcn24B = k24B*pow(Ca,2)*Ca2CaMB - k42B*Ca4CaMB;
-	rcn0B = k0Bon*CaM*B - k0Boff*CaMB;
-	rcn2B = k2Bon*Ca2CaM*B - k2Boff*Ca2CaMB;
-	rcn4B = k4Bon*Ca4CaM*B - k4Boff*Ca4CaMB;
+		// CaM buffer fluxes
+		B = Btot - CaMB - Ca2CaMB - Ca4CaMB;
+		rcn02B = k02B*pow(Ca,2)*CaMB - k20B*Ca2CaMB;
+		rcn24B = k24B*pow(Ca,2)*Ca2CaMB - k42B*Ca4CaMB;
+		rcn0B = k0Bon*CaM*B - k0Boff*CaMB;
+		rcn2B = k2Bon*Ca2CaM*B - k2Boff*Ca2CaMB;
+		rcn4B = k4Bon*Ca4CaM*B - k4Boff*Ca4CaMB;
 	
-	// CaN reaction fluxes 
-	Ca2CaN = CaNtot - Ca4CaN - CaMCa4CaN - Ca2CaMCa4CaN - Ca4CaMCa4CaN;
-	rcnCa4CaN = kcanCaon*pow(Ca,2)*Ca2CaN - kcanCaoff*Ca4CaN;
-	rcn02CaN = k02can*pow(Ca,2)*CaMCa4CaN - k20can*Ca2CaMCa4CaN; 
-	rcn24CaN = k24can*pow(Ca,2)*Ca2CaMCa4CaN - k42can*Ca4CaMCa4CaN;
-	rcn0CaN = kcanCaM0on*CaM*Ca4CaN - kcanCaM0off*CaMCa4CaN;
-	rcn2CaN = kcanCaM2on*Ca2CaM*Ca4CaN - kcanCaM2off*Ca2CaMCa4CaN;
-	rcn4CaN = kcanCaM4on*Ca4CaM*Ca4CaN - kcanCaM4off*Ca4CaMCa4CaN;
-
-	// CaMKII reaction fluxes
-	Pix = 1 - Pb2 - Pb - Pt - Pt2 - Pa;
-	rcnCKib2 = kib2*Ca2CaM*Pix - kb2i*Pb2;
-	rcnCKb2b = kb24*pow(Ca,2)*Pb2 - kb42*Pb;
-	rcnCKib = kib*Ca4CaM*Pix - kbi*Pb;
-	T = Pb + Pt + Pt2 + Pa;
-	kbt = 0.055*T + 0.0074*pow(T,2) + 0.015*pow(T,3);
-	rcnCKbt = kbt*Pb - kpp1*PP1tot*Pt/(Kmpp1+CaMKIItot*Pt);
-	rcnCKtt2 = kt42*Pt - kt24*pow(Ca,2)*Pt2;
-	rcnCKta = kta*Pt - kat*Ca4CaM*Pa;
-	rcnCKt2a = kt2a*Pt2 - kat2*Ca2CaM*Pa;
-	rcnCKt2b2 = kpp1*PP1tot*Pt2/(Kmpp1+CaMKIItot*Pt2);
-	rcnCKai = kpp1*PP1tot*Pa/(Kmpp1+CaMKIItot*Pa);
-
-	// CaM equations
-	dCaM = 1e-3*(-rcn02 - rcn0B - rcn0CaN);
-	dCa2CaM = 1e-3*(rcn02 - rcn24 - rcn2B - rcn2CaN + CaMKIItot*(-rcnCKib2 + rcnCKt2a) );
-	dCa4CaM = 1e-3*(rcn24 - rcn4B - rcn4CaN + CaMKIItot*(-rcnCKib+rcnCKta) );
-	dCaMB = 1e-3*(rcn0B-rcn02B);
-	dCa2CaMB = 1e-3*(rcn02B + rcn2B - rcn24B);
-	dCa4CaMB = 1e-3*(rcn24B + rcn4B);
-
-	// CaMKII equations
-	dPb2 = 1e-3*(rcnCKib2 - rcnCKb2b + rcnCKt2b2);										// Pb2
-	dPb = 1e-3*(rcnCKib + rcnCKb2b - rcnCKbt);											// Pb
-	dPt = 1e-3*(rcnCKbt-rcnCKta-rcnCKtt2);												// Pt
-	dPt2 = 1e-3*(rcnCKtt2-rcnCKt2a-rcnCKt2b2);											// Pt2
-	dPa = 1e-3*(rcnCKta+rcnCKt2a-rcnCKai);												// Pa
-
-	// CaN equations
-	dCa4CaN = 1e-3*(rcnCa4CaN - rcn0CaN - rcn2CaN - rcn4CaN);							// Ca4CaN
-	dCaMCa4CaN = 1e-3*(rcn0CaN - rcn02CaN);												// CaMCa4CaN
-	dCa2CaMCa4CaN = 1e-3*(rcn2CaN+rcn02CaN-rcn24CaN);									// Ca2CaMCa4CaN
-	dCa4CaMCa4CaN = 1e-3*(rcn4CaN+rcn24CaN);											// Ca4CaMCa4CaN
-
-	// encode output array
-	finavalu[offset_1] = dCaM;
-	finavalu[offset_2] = dCa2CaM;
-	finavalu[offset_3] = dCa4CaM;
-	finavalu[offset_4] = dCaMB;
-	finavalu[offset_5] = dCa2CaMB;
-	finavalu[offset_6] = dCa4CaMB;
-	finavalu[offset_7] = dPb2;
-	finavalu[offset_8] = dPb;
-	finavalu[offset_9] = dPt;
-	finavalu[offset_10] = dPt2;
-	finavalu[offset_11] = dPa;
-	finavalu[offset_12] = dCa4CaN;
-	finavalu[offset_13] = dCaMCa4CaN;
-	finavalu[offset_14] = dCa2CaMCa4CaN;
-	finavalu[offset_15] = dCa4CaMCa4CaN;
-
-	// write to global variables for adjusting Ca buffering in EC coupling model
-	JCa = 1e-3*(2*CaMKIItot*(rcnCKtt2-rcnCKb2b) - 2*(rcn02+rcn24+rcn02B+rcn24B+rcnCa4CaN+rcn02CaN+rcn24CaN)); // [uM/msec]
-
-	// return
-	return JCa;
+		// CaN reaction fluxes 
+		Ca2CaN = CaNtot - Ca4CaN - CaMCa4CaN - Ca2CaMCa4CaN - Ca4CaMCa4CaN;
+		rcnCa4CaN = kcanCaon*pow(Ca,2)*Ca2CaN - kcanCaoff*Ca4CaN;
+		rcn02CaN = k02can*pow(Ca,2)*CaMCa4CaN - k20can*Ca2CaMCa4CaN; 
+		rcn24CaN = k24can*pow(Ca,2)*Ca2CaMCa4CaN - k42can*Ca4CaMCa4CaN;
+		rcn0CaN = kcanCaM0on*CaM*Ca4CaN - kcanCaM0off*CaMCa4CaN;
+		rcn2CaN = kcanCaM2on*Ca2CaM*Ca4CaN - kcanCaM2off*Ca2CaMCa4CaN;
+		rcn4CaN = kcanCaM4on*Ca4CaM*Ca4CaN - kcanCaM4off*Ca4CaMCa4CaN;
+
+		// CaMKII reaction fluxes
+		Pix = 1 - Pb2 - Pb - Pt - Pt2 - Pa;
+		rcnCKib2 = kib2*Ca2CaM*Pix - kb2i*Pb2;
+		rcnCKb2b = kb24*pow(Ca,2)*Pb2 - kb42*Pb;
+		rcnCKib = kib*Ca4CaM*Pix - kbi*Pb;
+		T = Pb + Pt + Pt2 + Pa;
+		kbt = 0.055*T + 0.0074*pow(T,2) + 0.015*T3;
+		rcnCKbt = kbt*Pb - kpp1*PP1tot*Pt/(Kmpp1+CaMKIItot*Pt);
+		rcnCKtt2 = kt42*Pt - kt24*pow(Ca,2)*Pt2;
+		rcnCKta = kta*Pt - kat*Ca4CaM*Pa;
+		rcnCKt2a = kt2a*Pt2 - kat2*Ca2CaM*Pa;
+		rcnCKt2b2 = kpp1*PP1tot*Pt2/(Kmpp1+CaMKIItot*Pt2);
+		rcnCKai = kpp1*PP1tot*Pa/(Kmpp1+CaMKIItot*Pa);
+
+		// CaM equations
+		dCaM = 1e-3*(-rcn02 - rcn0B - rcn0CaN);
+		dCa2CaM = 1e-3*(rcn02 - rcn24 - rcn2B - rcn2CaN + CaMKIItot*(-rcnCKib2 + rcnCKt2a) );
+		dCa4CaM = 1e-3*(rcn24 - rcn4B - rcn4CaN + CaMKIItot*(-rcnCKib+rcnCKta) );
+		dCaMB = 1e-3*(rcn0B-rcn02B);
+		dCa2CaMB = 1e-3*(rcn02B + rcn2B - rcn24B);
+		dCa4CaMB = 1e-3*(rcn24B + rcn4B);
+
+		// CaMKII equations
+		dPb2 = 1e-3*(rcnCKib2 - rcnCKb2b + rcnCKt2b2);										// Pb2
+		dPb = 1e-3*(rcnCKib + rcnCKb2b - rcnCKbt);											// Pb
+		dPt = 1e-3*(rcnCKbt-rcnCKta-rcnCKtt2);												// Pt
+		dPt2 = 1e-3*(rcnCKtt2-rcnCKt2a-rcnCKt2b2);											// Pt2
+		dPa = 1e-3*(rcnCKta+rcnCKt2a-rcnCKai);												// Pa
+
+		// CaN equations
+		dCa4CaN = 1e-3*(rcnCa4CaN - rcn0CaN - rcn2CaN - rcn4CaN);							// Ca4CaN
+		dCaMCa4CaN = 1e-3*(rcn0CaN - rcn02CaN);												// CaMCa4CaN
+		dCa2CaMCa4CaN = 1e-3*(rcn2CaN+rcn02CaN-rcn24CaN);									// Ca2CaMCa4CaN
+		dCa4CaMCa4CaN = 1e-3*(rcn4CaN+rcn24CaN);											// Ca4CaMCa4CaN
+
+		// encode output array
+		finavalu[offset_1+l] = dCaM;
+		finavalu[offset_2+l] = dCa2CaM;
+		finavalu[offset_3+l] = dCa4CaM;
+		finavalu[offset_4+l] = dCaMB;
+		finavalu[offset_5+l] = dCa2CaMB;
+		finavalu[offset_6+l] = dCa4CaMB;
+		finavalu[offset_7+l] = dPb2;
+		finavalu[offset_8+l] = dPb;
+		finavalu[offset_9+l] = dPt;
+		finavalu[offset_10+l] = dPt2;
+		finavalu[offset_11+l] = dPa;
+		finavalu[offset_12+l] = dCa4CaN;
+		finavalu[offset_13+l] = dCaMCa4CaN;
+		finavalu[offset_14+l] = dCa2CaMCa4CaN;
+		finavalu[offset_15+l] = dCa4CaMCa4CaN;
+
+		// write to global variables for adjusting Ca buffering in EC coupling model
+		JCa_l = 1e-3*(2*CaMKIItot*(rcnCKtt2-rcnCKb2b) - 2*(rcn02+rcn24+rcn02B+rcn24B+rcnCa4CaN+rcn02CaN+rcn24CaN)); // [uM/msec]
+		JCa[l] = JCa_l;
+
+	}
 
 }
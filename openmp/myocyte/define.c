@@ -8,3 +8,9 @@
 
 #define EQUATIONS 91
 #define PARAMETERS 16
+
+#define ECC_TEMPS 54												// workspace values per instance of ecc, see ecc.c
+#define MODEL_TEMPS (ECC_TEMPS+4)									// workspace values per instance of master, see master.c
+
+#define BATCH_LANES 8												// default number of instances per batch in mode 2
+#define SINK_DEPTH 4096												// records buffered between the solvers and the trajectory writer
@@ -1,12 +1,21 @@
 //=====================================================================
 //	MAIN FUNCTION
 //=====================================================================
-void ecc(	fp timeinst,
+
+// evaluates the model of lanes instances stored value by value, value i of instance l at [i*lanes+l] (lanes is 1 for a single instance).
+// The exp/log/pow/fmod calls of every active instance (active NULL for all) are made first, each distinct one once, into temp, ECC_TEMPS
+// values per instance; the rest of the model is arithmetic and runs as one simd loop across all lanes. The operations of every instance
+// are those of the original expressions, so results do not depend on lanes. Inactive lanes compute garbage that the caller ignores.
+
+void ecc(	fp *timeinst,
 				fp *initvalu,
 				int initvalu_offset,
 				fp *parameter,
 				int parameter_offset,
-				fp *finavalu){
+				fp *finavalu,
+				int lanes,
+				int *active,
+				double *temp){
 
 	//=====================================================================
 	//	VARIABLES
@@ -63,56 +72,6 @@ void ecc(	fp timeinst,
 	// initial data variable references
 	int parameter_offset_1;
 
-	// decoded input initial data			// GET VARIABLES FROM MEMORY AND SAVE LOCALLY !!!!!!!!!!!!!!!!!!
-	fp initvalu_1;
-	fp initvalu_2;
-	fp initvalu_3;
-	fp initvalu_4;
-	fp initvalu_5;
-	fp initvalu_6;
-	fp initvalu_7;
-	fp initvalu_8;
-	fp initvalu_9;
-	fp initvalu_10;
-	fp initvalu_11;
-	fp initvalu_12;
-	fp initvalu_13;
-	fp initvalu_14;
-	fp initvalu_15;
-	fp initvalu_16;
-	fp initvalu_17;
-	fp initvalu_18;
-	fp initvalu_19;
-	fp initvalu_20;
-	fp initvalu_21;
-	fp initvalu_22;
-	fp initvalu_23;
-	fp initvalu_24;
-	fp initvalu_25;
-	fp initvalu_26;
-	fp initvalu_27;
-	fp initvalu_28;
-	fp initvalu_29;
-	fp initvalu_30;
-	fp initvalu_31;
-	fp initvalu_32;
-	fp initvalu_33;
-	fp initvalu_34;
-	fp initvalu_35;
-	fp initvalu_36;
-	fp initvalu_37;
-	fp initvalu_38;
-	fp initvalu_39;
-	fp initvalu_40;
-	fp initvalu_41;
-	fp initvalu_42;
-	fp initvalu_43;
-	fp initvalu_44;
-	fp initvalu_45;
-	fp initvalu_46;
-
-	// decoded input parameters
-	fp parameter_1;
 
 	// matlab constants undefined in c
 	fp pi;
@@ -162,12 +121,8 @@ void ecc(	fp timeinst,
 	fp Cao;																			// Extracellular Ca  [mM]
 	fp Mgi;																			// Intracellular Mg  [mM]
 
+
 	// Nernst Potentials
-	fp ena_junc;																	// [mV]
-	fp ena_sl;																		// [mV]
-	fp ek;																			// [mV]
-	fp eca_junc;																	// [mV]
-	fp eca_sl;																		// [mV]
 	fp ecl;																			// [mV]
 
 	// Na transport parameters
@@ -260,282 +215,141 @@ void ecc(	fp timeinst,
 	fp Bmax_Csqn;																	// 140e-3*Vmyo/Vsr; [mM] 
 	fp koff_csqn;																	// [1/ms] 
 	fp kon_csqn;																	// [1/mM/ms] 
-
-	// I_Na: Fast Na Current
-	fp am;
-	fp bm;
-	fp ah;
-	fp bh;
-	fp aj;
-	fp bj;
-	fp I_Na_junc;
-	fp I_Na_sl;
-	fp I_Na;
-
-	// I_nabk: Na Background Current
-	fp I_nabk_junc;
-	fp I_nabk_sl;
-	fp I_nabk;
-
-	// I_nak: Na/K Pump Current
+	// constants of the currents
 	fp sigma;
-	fp fnak;
-	fp I_nak_junc;
-	fp I_nak_sl;
-	fp I_nak;
-
-	// I_kr: Rapidly Activating K Current
 	fp gkr;
-	fp xrss;
-	fp tauxr;
-	fp rkr;
-	fp I_kr;
-
-	// I_ks: Slowly Activating K Current
-	fp pcaks_junc; 
-	fp pcaks_sl;  
-	fp gks_junc;
-	fp gks_sl; 
-	fp eks;	
-	fp xsss;
-	fp tauxs; 
-	fp I_ks_junc;
-	fp I_ks_sl;
-	fp I_ks;
-
-	// I_kp: Plateau K current
-	fp kp_kp;
-	fp I_kp_junc;
-	fp I_kp_sl;
-	fp I_kp;
-
-	// I_to: Transient Outward K Current (slow and fast components)
-	fp xtoss;
-	fp ytoss;
-	fp rtoss;
-	fp tauxtos;
-	fp tauytos;
-	fp taurtos; 
-	fp I_tos;	
-
-	//
-	fp tauxtof;
-	fp tauytof;
-	fp I_tof;
-	fp I_to;
-
-	// I_ki: Time-Independent K Current
-	fp aki;
-	fp bki;
-	fp kiss;
-	fp I_ki;
-
-	// I_ClCa: Ca-activated Cl Current, I_Clbk: background Cl Current
-	fp I_ClCa_junc;
-	fp I_ClCa_sl;
-	fp I_ClCa;
-	fp I_Clbk;
-
-	// I_Ca: L-type Calcium Current
-	fp dss;
-	fp taud;
-	fp fss;
-	fp tauf;
-
-	//
-	fp ibarca_j;
-	fp ibarca_sl;
-	fp ibark;
-	fp ibarna_j;
-	fp ibarna_sl;
-	fp I_Ca_junc;
-	fp I_Ca_sl;
-	fp I_Ca;
-	fp I_CaK;
-	fp I_CaNa_junc;
-	fp I_CaNa_sl;
-	fp I_CaNa;
-	fp I_Catot;
-
-	// I_ncx: Na/Ca Exchanger flux
-	fp Ka_junc;
-	fp Ka_sl;
-	fp s1_junc;
-	fp s1_sl;
-	fp s2_junc;
-	fp s3_junc;
-	fp s2_sl;
-	fp s3_sl;
-	fp I_ncx_junc;
-	fp I_ncx_sl;
-	fp I_ncx;
-
-	// I_pca: Sarcolemmal Ca Pump Current
-	fp I_pca_junc;
-	fp I_pca_sl;
-	fp I_pca;
-
-	// I_cabk: Ca Background Current
-	fp I_cabk_junc;
-	fp I_cabk_sl;
-	fp I_cabk;
-	
-	// SR fluxes: Calcium Release, SR Ca pump, SR Ca leak														
 	fp MaxSR;
 	fp MinSR;
-	fp kCaSR;
-	fp koSRCa;
-	fp kiSRCa;
-	fp RI;
-	fp J_SRCarel;																	// [mM/ms]
-	fp J_serca;
-	fp J_SRleak;																		//   [mM/ms]
-
-	// Cytosolic Ca Buffers
-	fp J_CaB_cytosol;
-
-	// Junctional and SL Ca Buffers
-	fp J_CaB_junction;
-	fp J_CaB_sl;
-
-	// SR Ca Concentrations
 	fp oneovervsr;
-
-	// Sodium Concentrations
-	fp I_Na_tot_junc;																// [uA/uF]
-	fp I_Na_tot_sl;																	// [uA/uF]
 	fp oneovervsl;
 
-	// Potassium Concentration
-	fp I_K_tot;
-
-	// Calcium Concentrations
-	fp I_Ca_tot_junc;																// [uA/uF]
-	fp I_Ca_tot_sl;																	// [uA/uF]
-	fp junc_sl;
-	fp sl_junc;
-	fp sl_myo;
-	fp myo_sl;
-
-	//	Simulation type													
-	int state;																			// 0-none; 1-pace; 2-vclamp
-	fp I_app;
-	fp V_hold;
-	fp V_test;
-	fp V_clamp;
-	fp R_clamp;
-	
-	//	Membrane Potential
-	fp I_Na_tot;																		// [uA/uF]
-	fp I_Cl_tot;																		// [uA/uF]
-	fp I_Ca_tot;
-	fp I_tot;
+	// constant pow/sqrt terms of the currents
+	double Q10CaL_Qpow;
+	double Q10NCX_Qpow;
+	double Q10SLCaP_Qpow;
+	double Q10SRCaP_Qpow;
+	double Nao_3;
+	double KmNao_3;
+	double KmNai_3;
+	double KmPCa_16;
+	double sqrt_Ko;
+
+	// per instance results of the exp/log/pow/fmod calls, lanes values each in temp
+
+	double *t_ena_junc;
+	double *t_ena_sl;
+	double *t_ek;
+	double *t_eca_junc;
+	double *t_eca_sl;
+	double *t_am;
+	double *t_bm;
+	double *t_ah;
+	double *t_bh;
+	double *t_aj;
+	double *t_bj;
+	double *t_m3;
+	double *t_fnak;
+	double *t_nak_junc;
+	double *t_nak_sl;
+	double *t_xrss;
+	double *t_tauxr;
+	double *t_rkr;
+	double *t_gks_junc;
+	double *t_gks_sl;
+	double *t_eks;
+	double *t_xsss;
+	double *t_tauxs;
+	double *t_kp_kp;
+	double *t_xtoss;
+	double *t_ytoss;
+	double *t_rtoss;
+	double *t_tauxtos;
+	double *t_tauytos;
+	double *t_taurtos;
+	double *t_tauxtof;
+	double *t_tauytof;
+	double *t_aki;
+	double *t_bki;
+	double *t_dss;
+	double *t_taud;
+	double *t_fss;
+	double *t_tauf;
+	double *t_e2vfrt;
+	double *t_evfrt;
+	double *t_kact_junc;
+	double *t_kact_sl;
+	double *t_enu;
+	double *t_enu1;
+	double *t_na_junc3;
+	double *t_na_sl3;
+	double *t_nai_junc3;
+	double *t_nai_sl3;
+	double *t_ca_junc16;
+	double *t_ca_sl16;
+	double *t_ec50;
+	double *t_serca_f;
+	double *t_serca_r;
+	double *t_I_app;
+
+	// counters
+	int l;
+
 
 	//=====================================================================
 	//	EXECUTION
 	//=====================================================================
 
 	// variable references
-	offset_1  = initvalu_offset;
-	offset_2  = initvalu_offset+1;
-	offset_3  = initvalu_offset+2;
-	offset_4  = initvalu_offset+3;
-	offset_5  = initvalu_offset+4;
-	offset_6  = initvalu_offset+5;
-	offset_7  = initvalu_offset+6;
-	offset_8  = initvalu_offset+7;
-	offset_9  = initvalu_offset+8;
-	offset_10 = initvalu_offset+9;
-	offset_11 = initvalu_offset+10;
-	offset_12 = initvalu_offset+11;
-	offset_13 = initvalu_offset+12;
-	offset_14 = initvalu_offset+13;
-	offset_15 = initvalu_offset+14;
-	offset_16 = initvalu_offset+15;
-	offset_17 = initvalu_offset+16;
-	offset_18 = initvalu_offset+17;
-	offset_19 = initvalu_offset+18;
-	offset_20 = initvalu_offset+19;
-	offset_21 = initvalu_offset+20;
-	offset_22 = initvalu_offset+21;
-	offset_23 = initvalu_offset+22;
-	offset_24 = initvalu_offset+23;
-	offset_25 = initvalu_offset+24;
-	offset_26 = initvalu_offset+25;
-	offset_27 = initvalu_offset+26;
-	offset_28 = initvalu_offset+27;
-	offset_29 = initvalu_offset+28;
-	offset_30 = initvalu_offset+29;
-	offset_31 = initvalu_offset+30;
-	offset_32 = initvalu_offset+31;
-	offset_33 = initvalu_offset+32;
-	offset_34 = initvalu_offset+33;
-	offset_35 = initvalu_offset+34;
-	offset_36 = initvalu_offset+35;
-	offset_37 = initvalu_offset+36;
-	offset_38 = initvalu_offset+37;
-	offset_39 = initvalu_offset+38;
-	offset_40 = initvalu_offset+39;
-	offset_41 = initvalu_offset+40;
-	offset_42 = initvalu_offset+41;
-	offset_43 = initvalu_offset+42;
-	offset_44 = initvalu_offset+43;
-	offset_45 = initvalu_offset+44;
-	offset_46 = initvalu_offset+45;
+	offset_1  = initvalu_offset*lanes;
+	offset_2  = (initvalu_offset+1)*lanes;
+	offset_3  = (initvalu_offset+2)*lanes;
+	offset_4  = (initvalu_offset+3)*lanes;
+	offset_5  = (initvalu_offset+4)*lanes;
+	offset_6  = (initvalu_offset+5)*lanes;
+	offset_7  = (initvalu_offset+6)*lanes;
+	offset_8  = (initvalu_offset+7)*lanes;
+	offset_9  = (initvalu_offset+8)*lanes;
+	offset_10 = (initvalu_offset+9)*lanes;
+	offset_11 = (initvalu_offset+10)*lanes;
+	offset_12 = (initvalu_offset+11)*lanes;
+	offset_13 = (initvalu_offset+12)*lanes;
+	offset_14 = (initvalu_offset+13)*lanes;
+	offset_15 = (initvalu_offset+14)*lanes;
+	offset_16 = (initvalu_offset+15)*lanes;
+	offset_17 = (initvalu_offset+16)*lanes;
+	offset_18 = (initvalu_offset+17)*lanes;
+	offset_19 = (initvalu_offset+18)*lanes;
+	offset_20 = (initvalu_offset+19)*lanes;
+	offset_21 = (initvalu_offset+20)*lanes;
+	offset_22 = (initvalu_offset+21)*lanes;
+	offset_23 = (initvalu_offset+22)*lanes;
+	offset_24 = (initvalu_offset+23)*lanes;
+	offset_25 = (initvalu_offset+24)*lanes;
+	offset_26 = (initvalu_offset+25)*lanes;
+	offset_27 = (initvalu_offset+26)*lanes;
+	offset_28 = (initvalu_offset+27)*lanes;
+	offset_29 = (initvalu_offset+28)*lanes;
+	offset_30 = (initvalu_offset+29)*lanes;
+	offset_31 = (initvalu_offset+30)*lanes;
+	offset_32 = (initvalu_offset+31)*lanes;
+	offset_33 = (initvalu_offset+32)*lanes;
+	offset_34 = (initvalu_offset+33)*lanes;
+	offset_35 = (initvalu_offset+34)*lanes;
+	offset_36 = (initvalu_offset+35)*lanes;
+	offset_37 = (initvalu_offset+36)*lanes;
+	offset_38 = (initvalu_offset+37)*lanes;
+	offset_39 = (initvalu_offset+38)*lanes;
+	offset_40 = (initvalu_offset+39)*lanes;
+	offset_41 = (initvalu_offset+40)*lanes;
+	offset_42 = (initvalu_offset+41)*lanes;
+	offset_43 = (initvalu_offset+42)*lanes;
+	offset_44 = (initvalu_offset+43)*lanes;
+	offset_45 = (initvalu_offset+44)*lanes;
+	offset_46 = (initvalu_offset+45)*lanes;
 	
+
 	// variable references
-	parameter_offset_1  = parameter_offset;
-
-	// decoded input initial data
-	initvalu_1  = initvalu[offset_1 ];
-	initvalu_2  = initvalu[offset_2 ];
-	initvalu_3  = initvalu[offset_3 ];
-	initvalu_4  = initvalu[offset_4 ];
-	initvalu_5  = initvalu[offset_5 ];
-	initvalu_6  = initvalu[offset_6 ];
-	initvalu_7  = initvalu[offset_7 ];
-	initvalu_8  = initvalu[offset_8 ];
-	initvalu_9  = initvalu[offset_9 ];
-	initvalu_10 = initvalu[offset_10];
-	initvalu_11 = initvalu[offset_11];
-	initvalu_12 = initvalu[offset_12];
-	initvalu_13 = initvalu[offset_13];
-	initvalu_14 = initvalu[offset_14];
-	initvalu_15 = initvalu[offset_15];
-	initvalu_16 = initvalu[offset_16];
-	initvalu_17 = initvalu[offset_17];
-	initvalu_18 = initvalu[offset_18];
-	initvalu_19 = initvalu[offset_19];
-	initvalu_20 = initvalu[offset_20];
-	initvalu_21 = initvalu[offset_21];
-	initvalu_22 = initvalu[offset_22];
-	initvalu_23 = initvalu[offset_23];
-	initvalu_24 = initvalu[offset_24];
-	initvalu_25 = initvalu[offset_25];
-	initvalu_26 = initvalu[offset_26];
-	initvalu_27 = initvalu[offset_27];
-	initvalu_28 = initvalu[offset_28];
-	initvalu_29 = initvalu[offset_29];
-	initvalu_30 = initvalu[offset_30];
-	initvalu_31 = initvalu[offset_31];
-	initvalu_32 = initvalu[offset_32];
-	initvalu_33 = initvalu[offset_33];
-	initvalu_34 = initvalu[offset_34];
-	initvalu_35 = initvalu[offset_35];
-	initvalu_36 = initvalu[offset_36];
-	initvalu_37 = initvalu[offset_37];
-	initvalu_38 = initvalu[offset_38];
-	initvalu_39 = initvalu[offset_39];
-	initvalu_40 = initvalu[offset_40];
-	initvalu_41 = initvalu[offset_41];
-	initvalu_42 = initvalu[offset_42];
-	initvalu_43 = initvalu[offset_43];
-	initvalu_44 = initvalu[offset_44];
-	initvalu_45 = initvalu[offset_45];
-	initvalu_46 = initvalu[offset_46];
-
-	// decoded input parameters
-	parameter_1 = parameter[parameter_offset_1];
+	parameter_offset_1  = parameter_offset*lanes;
 
 	// matlab constants undefined in c
 	pi = 3.1416;
@@ -586,11 +400,6 @@ void ecc(	fp timeinst,
 	Mgi = 1;																			// Intracellular Mg  [mM]
 
 	// Nernst Potentials
-	ena_junc = (1/FoRT)*log(Nao/initvalu_32);													// [mV]
-	ena_sl = (1/FoRT)*log(Nao/initvalu_33);													// [mV]
-	ek = (1/FoRT)*log(Ko/initvalu_35);														// [mV]
-	eca_junc = (1/FoRT/2)*log(Cao/initvalu_36);												// [mV]
-	eca_sl = (1/FoRT/2)*log(Cao/initvalu_37);													// [mV]
 	ecl = (1/FoRT)*log(Cli/Clo);														// [mV]
 
 	// Na transport parameters
@@ -683,263 +492,575 @@ void ecc(	fp timeinst,
 	Bmax_Csqn = 2.7;																	// 140e-3*Vmyo/Vsr; [mM] 
 	koff_csqn = 65;																		// [1/ms] 
 	kon_csqn = 100;																		// [1/mM/ms] 
-
-	// I_Na: Fast Na Current
-	am = 0.32*(initvalu_39+47.13)/(1-exp(-0.1*(initvalu_39+47.13)));
-	bm = 0.08*exp(-initvalu_39/11);
-	if(initvalu_39 >= -40){
-		ah = 0; aj = 0;
-		bh = 1/(0.13*(1+exp(-(initvalu_39+10.66)/11.1)));
-		bj = 0.3*exp(-2.535e-7*initvalu_39)/(1+exp(-0.1*(initvalu_39+32)));
-	}
-	else{
-		ah = 0.135*exp((80+initvalu_39)/-6.8);
-		bh = 3.56*exp(0.079*initvalu_39)+3.1e5*exp(0.35*initvalu_39);
-		aj = (-127140*exp(0.2444*initvalu_39)-3.474e-5*exp(-0.04391*initvalu_39))*(initvalu_39+37.78)/(1+exp(0.311*(initvalu_39+79.23)));
-		bj = 0.1212*exp(-0.01052*initvalu_39)/(1+exp(-0.1378*(initvalu_39+40.14)));
-	}
-	finavalu[offset_1] = am*(1-initvalu_1)-bm*initvalu_1;
-	finavalu[offset_2] = ah*(1-initvalu_2)-bh*initvalu_2;
-	finavalu[offset_3] = aj*(1-initvalu_3)-bj*initvalu_3;
-	I_Na_junc = Fjunc*GNa*pow(initvalu_1,3)*initvalu_2*initvalu_3*(initvalu_39-ena_junc);
-	I_Na_sl = Fsl*GNa*pow(initvalu_1,3)*initvalu_2*initvalu_3*(initvalu_39-ena_sl);
-	I_Na = I_Na_junc+I_Na_sl;
-
-	// I_nabk: Na Background Current
-	I_nabk_junc = Fjunc*GNaB*(initvalu_39-ena_junc);
-	I_nabk_sl = Fsl*GNaB*(initvalu_39-ena_sl);
-	I_nabk = I_nabk_junc+I_nabk_sl;
-
-	// I_nak: Na/K Pump Current
+	// I_nak, I_kr, SR flux constants
 	sigma = (exp(Nao/67.3)-1)/7;
-	fnak = 1/(1+0.1245*exp(-0.1*initvalu_39*FoRT)+0.0365*sigma*exp(-initvalu_39*FoRT));
-	I_nak_junc = Fjunc*IbarNaK*fnak*Ko /(1+pow((KmNaip/initvalu_32),4)) /(Ko+KmKo);
-	I_nak_sl = Fsl*IbarNaK*fnak*Ko /(1+pow((KmNaip/initvalu_33),4)) /(Ko+KmKo);
-	I_nak = I_nak_junc+I_nak_sl;
-
-	// I_kr: Rapidly Activating K Current
 	gkr = 0.03*sqrt(Ko/5.4);
-	xrss = 1/(1+exp(-(initvalu_39+50)/7.5));
-	tauxr = 1/(0.00138*(initvalu_39+7)/(1-exp(-0.123*(initvalu_39+7)))+6.1e-4*(initvalu_39+10)/(exp(0.145*(initvalu_39+10))-1));
-	finavalu[offset_12] = (xrss-initvalu_12)/tauxr;
-	rkr = 1/(1+exp((initvalu_39+33)/22.4));
-	I_kr = gkr*initvalu_12*rkr*(initvalu_39-ek);
-
-	// I_ks: Slowly Activating K Current
-	pcaks_junc = -log10(initvalu_36)+3.0; 
-	pcaks_sl = -log10(initvalu_37)+3.0;  
-	gks_junc = 0.07*(0.057 +0.19/(1+ exp((-7.2+pcaks_junc)/0.6)));
-	gks_sl = 0.07*(0.057 +0.19/(1+ exp((-7.2+pcaks_sl)/0.6))); 
-	eks = (1/FoRT)*log((Ko+pNaK*Nao)/(initvalu_35+pNaK*initvalu_34));	
-	xsss = 1/(1+exp(-(initvalu_39-1.5)/16.7));
-	tauxs = 1/(7.19e-5*(initvalu_39+30)/(1-exp(-0.148*(initvalu_39+30)))+1.31e-4*(initvalu_39+30)/(exp(0.0687*(initvalu_39+30))-1)); 
-	finavalu[offset_13] = (xsss-initvalu_13)/tauxs;
-	I_ks_junc = Fjunc*gks_junc*pow(initvalu_12,2)*(initvalu_39-eks);
-	I_ks_sl = Fsl*gks_sl*pow(initvalu_13,2)*(initvalu_39-eks);
-	I_ks = I_ks_junc+I_ks_sl;
-
-	// I_kp: Plateau K current
-	kp_kp = 1/(1+exp(7.488-initvalu_39/5.98));
-	I_kp_junc = Fjunc*gkp*kp_kp*(initvalu_39-ek);
-	I_kp_sl = Fsl*gkp*kp_kp*(initvalu_39-ek);
-	I_kp = I_kp_junc+I_kp_sl;
-
-	// I_to: Transient Outward K Current (slow and fast components)
-	xtoss = 1/(1+exp(-(initvalu_39+3.0)/15));
-	ytoss = 1/(1+exp((initvalu_39+33.5)/10));
-	rtoss = 1/(1+exp((initvalu_39+33.5)/10));
-	tauxtos = 9/(1+exp((initvalu_39+3.0)/15))+0.5;
-	tauytos = 3e3/(1+exp((initvalu_39+60.0)/10))+30;
-	taurtos = 2800/(1+exp((initvalu_39+60.0)/10))+220; 
-	finavalu[offset_8] = (xtoss-initvalu_8)/tauxtos;
-	finavalu[offset_9] = (ytoss-initvalu_9)/tauytos;
-	finavalu[offset_40]= (rtoss-initvalu_40)/taurtos; 
-	I_tos = GtoSlow*initvalu_8*(initvalu_9+0.5*initvalu_40)*(initvalu_39-ek);									// [uA/uF]
-
-	//
-	tauxtof = 3.5*exp(-initvalu_39*initvalu_39/30/30)+1.5;
-	tauytof = 20.0/(1+exp((initvalu_39+33.5)/10))+20.0;
-	finavalu[offset_10] = (xtoss-initvalu_10)/tauxtof;
-	finavalu[offset_11] = (ytoss-initvalu_11)/tauytof;
-	I_tof = GtoFast*initvalu_10*initvalu_11*(initvalu_39-ek);
-	I_to = I_tos + I_tof;
-
-	// I_ki: Time-Independent K Current
-	aki = 1.02/(1+exp(0.2385*(initvalu_39-ek-59.215)));
-	bki =(0.49124*exp(0.08032*(initvalu_39+5.476-ek)) + exp(0.06175*(initvalu_39-ek-594.31))) /(1 + exp(-0.5143*(initvalu_39-ek+4.753)));
-	kiss = aki/(aki+bki);
-	I_ki = 0.9*sqrt(Ko/5.4)*kiss*(initvalu_39-ek);
-
-	// I_ClCa: Ca-activated Cl Current, I_Clbk: background Cl Current
-	I_ClCa_junc = Fjunc*GClCa/(1+KdClCa/initvalu_36)*(initvalu_39-ecl);
-	I_ClCa_sl = Fsl*GClCa/(1+KdClCa/initvalu_37)*(initvalu_39-ecl);
-	I_ClCa = I_ClCa_junc+I_ClCa_sl;
-	I_Clbk = GClB*(initvalu_39-ecl);
-
-	// I_Ca: L-type Calcium Current
-	dss = 1/(1+exp(-(initvalu_39+14.5)/6.0));
-	taud = dss*(1-exp(-(initvalu_39+14.5)/6.0))/(0.035*(initvalu_39+14.5));
-	fss = 1/(1+exp((initvalu_39+35.06)/3.6))+0.6/(1+exp((50-initvalu_39)/20));
-	tauf = 1/(0.0197*exp(-pow(0.0337*(initvalu_39+14.5),2))+0.02);
-	finavalu[offset_4] = (dss-initvalu_4)/taud;
-	finavalu[offset_5] = (fss-initvalu_5)/tauf;
-	finavalu[offset_6] = 1.7*initvalu_36*(1-initvalu_6)-11.9e-3*initvalu_6;											// fCa_junc  
-	finavalu[offset_7] = 1.7*initvalu_37*(1-initvalu_7)-11.9e-3*initvalu_7;											// fCa_sl
-
-	//
-	ibarca_j = pCa*4*(initvalu_39*Frdy*FoRT) * (0.341*initvalu_36*exp(2*initvalu_39*FoRT)-0.341*Cao) /(exp(2*initvalu_39*FoRT)-1);
-	ibarca_sl = pCa*4*(initvalu_39*Frdy*FoRT) * (0.341*initvalu_37*exp(2*initvalu_39*FoRT)-0.341*Cao) /(exp(2*initvalu_39*FoRT)-1);
-	ibark = pK*(initvalu_39*Frdy*FoRT)*(0.75*initvalu_35*exp(initvalu_39*FoRT)-0.75*Ko) /(exp(initvalu_39*FoRT)-1);
-	ibarna_j = pNa*(initvalu_39*Frdy*FoRT) *(0.75*initvalu_32*exp(initvalu_39*FoRT)-0.75*Nao)  /(exp(initvalu_39*FoRT)-1);
-	ibarna_sl = pNa*(initvalu_39*Frdy*FoRT) *(0.75*initvalu_33*exp(initvalu_39*FoRT)-0.75*Nao)  /(exp(initvalu_39*FoRT)-1);
-	I_Ca_junc = (Fjunc_CaL*ibarca_j*initvalu_4*initvalu_5*(1-initvalu_6)*pow(Q10CaL,Qpow))*0.45;
-	I_Ca_sl = (Fsl_CaL*ibarca_sl*initvalu_4*initvalu_5*(1-initvalu_7)*pow(Q10CaL,Qpow))*0.45;
-	I_Ca = I_Ca_junc+I_Ca_sl;
-	finavalu[offset_43]=-I_Ca*Cmem/(Vmyo*2*Frdy)*1e3;
-	I_CaK = (ibark*initvalu_4*initvalu_5*(Fjunc_CaL*(1-initvalu_6)+Fsl_CaL*(1-initvalu_7))*pow(Q10CaL,Qpow))*0.45;
-	I_CaNa_junc = (Fjunc_CaL*ibarna_j*initvalu_4*initvalu_5*(1-initvalu_6)*pow(Q10CaL,Qpow))*0.45;
-	I_CaNa_sl = (Fsl_CaL*ibarna_sl*initvalu_4*initvalu_5*(1-initvalu_7)*pow(Q10CaL,Qpow))*0.45;
-	I_CaNa = I_CaNa_junc+I_CaNa_sl;
-	I_Catot = I_Ca+I_CaK+I_CaNa;
-
-	// I_ncx: Na/Ca Exchanger flux
-	Ka_junc = 1/(1+pow((Kdact/initvalu_36),3));
-	Ka_sl = 1/(1+pow((Kdact/initvalu_37),3));
-	s1_junc = exp(nu*initvalu_39*FoRT)*pow(initvalu_32,3)*Cao;
-	s1_sl = exp(nu*initvalu_39*FoRT)*pow(initvalu_33,3)*Cao;
-	s2_junc = exp((nu-1)*initvalu_39*FoRT)*pow(Nao,3)*initvalu_36;
-	s3_junc = (KmCai*pow(Nao,3)*(1+pow((initvalu_32/KmNai),3))+pow(KmNao,3)*initvalu_36+ pow(KmNai,3)*Cao*(1+initvalu_36/KmCai)+KmCao*pow(initvalu_32,3)+pow(initvalu_32,3)*Cao+pow(Nao,3)*initvalu_36)*(1+ksat*exp((nu-1)*initvalu_39*FoRT));
-	s2_sl = exp((nu-1)*initvalu_39*FoRT)*pow(Nao,3)*initvalu_37;
-	s3_sl = (KmCai*pow(Nao,3)*(1+pow((initvalu_33/KmNai),3)) + pow(KmNao,3)*initvalu_37+pow(KmNai,3)*Cao*(1+initvalu_37/KmCai)+KmCao*pow(initvalu_33,3)+pow(initvalu_33,3)*Cao+pow(Nao,3)*initvalu_37)*(1+ksat*exp((nu-1)*initvalu_39*FoRT));
-	I_ncx_junc = Fjunc*IbarNCX*pow(Q10NCX,Qpow)*Ka_junc*(s1_junc-s2_junc)/s3_junc;
-	I_ncx_sl = Fsl*IbarNCX*pow(Q10NCX,Qpow)*Ka_sl*(s1_sl-s2_sl)/s3_sl;
-	I_ncx = I_ncx_junc+I_ncx_sl;
-	finavalu[offset_45]=2*I_ncx*Cmem/(Vmyo*2*Frdy)*1e3;
-
-	// I_pca: Sarcolemmal Ca Pump Current
-	I_pca_junc = 	Fjunc * 
-					pow(Q10SLCaP,Qpow) * 
-					IbarSLCaP * 
-					pow(initvalu_36,1.6) /
-					(pow(KmPCa,1.6) + pow(initvalu_36,1.6));
-	I_pca_sl = 	Fsl * 
-				pow(Q10SLCaP,Qpow) * 
-				IbarSLCaP * 
-				pow(initvalu_37,1.6) / 
-				(pow(KmPCa,1.6) + pow(initvalu_37,1.6));
-	I_pca = I_pca_junc+I_pca_sl;
-	finavalu[offset_44]=-I_pca*Cmem/(Vmyo*2*Frdy)*1e3;
-
-	// I_cabk: Ca Background Current
-	I_cabk_junc = Fjunc*GCaB*(initvalu_39-eca_junc);
-	I_cabk_sl = Fsl*GCaB*(initvalu_39-eca_sl);
-	I_cabk = I_cabk_junc+I_cabk_sl;
-	finavalu[offset_46]=-I_cabk*Cmem/(Vmyo*2*Frdy)*1e3;
-	
-	// SR fluxes: Calcium Release, SR Ca pump, SR Ca leak														
 	MaxSR = 15; 
 	MinSR = 1;
-	kCaSR = MaxSR - (MaxSR-MinSR)/(1+pow(ec50SR/initvalu_31,2.5));
-	koSRCa = koCa/kCaSR;
-	kiSRCa = kiCa*kCaSR;
-	RI = 1-initvalu_14-initvalu_15-initvalu_16;
-	finavalu[offset_14] = (kim*RI-kiSRCa*initvalu_36*initvalu_14)-(koSRCa*pow(initvalu_36,2)*initvalu_14-kom*initvalu_15);			// R
-	finavalu[offset_15] = (koSRCa*pow(initvalu_36,2)*initvalu_14-kom*initvalu_15)-(kiSRCa*initvalu_36*initvalu_15-kim*initvalu_16);			// O
-	finavalu[offset_16] = (kiSRCa*initvalu_36*initvalu_15-kim*initvalu_16)-(kom*initvalu_16-koSRCa*pow(initvalu_36,2)*RI);			// I
-	J_SRCarel = ks*initvalu_15*(initvalu_31-initvalu_36);													// [mM/ms]
-	J_serca = pow(Q10SRCaP,Qpow)*Vmax_SRCaP*(pow((initvalu_38/Kmf),hillSRCaP)-pow((initvalu_31/Kmr),hillSRCaP))
-										 /(1+pow((initvalu_38/Kmf),hillSRCaP)+pow((initvalu_31/Kmr),hillSRCaP));
-	J_SRleak = 5.348e-6*(initvalu_31-initvalu_36);													//   [mM/ms]
-
-	// Sodium and Calcium Buffering														
-	finavalu[offset_17] = kon_na*initvalu_32*(Bmax_Naj-initvalu_17)-koff_na*initvalu_17;								// NaBj      [mM/ms]
-	finavalu[offset_18] = kon_na*initvalu_33*(Bmax_Nasl-initvalu_18)-koff_na*initvalu_18;							// NaBsl     [mM/ms]
-
-	// Cytosolic Ca Buffers
-	finavalu[offset_19] = kon_tncl*initvalu_38*(Bmax_TnClow-initvalu_19)-koff_tncl*initvalu_19;						// TnCL      [mM/ms]
-	finavalu[offset_20] = kon_tnchca*initvalu_38*(Bmax_TnChigh-initvalu_20-initvalu_21)-koff_tnchca*initvalu_20;			// TnCHc     [mM/ms]
-	finavalu[offset_21] = kon_tnchmg*Mgi*(Bmax_TnChigh-initvalu_20-initvalu_21)-koff_tnchmg*initvalu_21;				// TnCHm     [mM/ms]
-	finavalu[offset_22] = 0;																		// CaM       [mM/ms]
-	finavalu[offset_23] = kon_myoca*initvalu_38*(Bmax_myosin-initvalu_23-initvalu_24)-koff_myoca*initvalu_23;				// Myosin_ca [mM/ms]
-	finavalu[offset_24] = kon_myomg*Mgi*(Bmax_myosin-initvalu_23-initvalu_24)-koff_myomg*initvalu_24;				// Myosin_mg [mM/ms]
-	finavalu[offset_25] = kon_sr*initvalu_38*(Bmax_SR-initvalu_25)-koff_sr*initvalu_25;								// SRB       [mM/ms]
-	J_CaB_cytosol = finavalu[offset_19] + finavalu[offset_20] + finavalu[offset_21] + finavalu[offset_22] + finavalu[offset_23] + finavalu[offset_24] + finavalu[offset_25];
-
-	// Junctional and SL Ca Buffers
-	finavalu[offset_26] = kon_sll*initvalu_36*(Bmax_SLlowj-initvalu_26)-koff_sll*initvalu_26;						// SLLj      [mM/ms]
-	finavalu[offset_27] = kon_sll*initvalu_37*(Bmax_SLlowsl-initvalu_27)-koff_sll*initvalu_27;						// SLLsl     [mM/ms]
-	finavalu[offset_28] = kon_slh*initvalu_36*(Bmax_SLhighj-initvalu_28)-koff_slh*initvalu_28;						// SLHj      [mM/ms]
-	finavalu[offset_29] = kon_slh*initvalu_37*(Bmax_SLhighsl-initvalu_29)-koff_slh*initvalu_29;						// SLHsl     [mM/ms]
-	J_CaB_junction = finavalu[offset_26]+finavalu[offset_28];
-	J_CaB_sl = finavalu[offset_27]+finavalu[offset_29];
-
-	// SR Ca Concentrations
-	finavalu[offset_30] = kon_csqn*initvalu_31*(Bmax_Csqn-initvalu_30)-koff_csqn*initvalu_30;						// Csqn      [mM/ms]
 	oneovervsr = 1/Vsr;
-	finavalu[offset_31] = J_serca*Vmyo*oneovervsr-(J_SRleak*Vmyo*oneovervsr+J_SRCarel)-finavalu[offset_30];   // Ca_sr     [mM/ms] %Ratio 3 leak current
-
-	// Sodium Concentrations
-	I_Na_tot_junc = I_Na_junc+I_nabk_junc+3*I_ncx_junc+3*I_nak_junc+I_CaNa_junc;		// [uA/uF]
-	I_Na_tot_sl = I_Na_sl+I_nabk_sl+3*I_ncx_sl+3*I_nak_sl+I_CaNa_sl;					// [uA/uF]
-	finavalu[offset_32] = -I_Na_tot_junc*Cmem/(Vjunc*Frdy)+J_na_juncsl/Vjunc*(initvalu_33-initvalu_32)-finavalu[offset_17];
 	oneovervsl = 1/Vsl;
-	finavalu[offset_33] = -I_Na_tot_sl*Cmem*oneovervsl/Frdy+J_na_juncsl*oneovervsl*(initvalu_32-initvalu_33)+J_na_slmyo*oneovervsl*(initvalu_34-initvalu_33)-finavalu[offset_18];
-	finavalu[offset_34] = J_na_slmyo/Vmyo*(initvalu_33-initvalu_34);											// [mM/msec] 
-
-	// Potassium Concentration
-	I_K_tot = I_to+I_kr+I_ks+I_ki-2*I_nak+I_CaK+I_kp;									// [uA/uF]
-	finavalu[offset_35] = 0;															// [mM/msec]
-
-	// Calcium Concentrations
-	I_Ca_tot_junc = I_Ca_junc+I_cabk_junc+I_pca_junc-2*I_ncx_junc;						// [uA/uF]
-	I_Ca_tot_sl = I_Ca_sl+I_cabk_sl+I_pca_sl-2*I_ncx_sl;								// [uA/uF]
-	finavalu[offset_36] = -I_Ca_tot_junc*Cmem/(Vjunc*2*Frdy)+J_ca_juncsl/Vjunc*(initvalu_37-initvalu_36)
-	         - J_CaB_junction+(J_SRCarel)*Vsr/Vjunc+J_SRleak*Vmyo/Vjunc;				// Ca_j
-	finavalu[offset_37] = -I_Ca_tot_sl*Cmem/(Vsl*2*Frdy)+J_ca_juncsl/Vsl*(initvalu_36-initvalu_37)
-	         + J_ca_slmyo/Vsl*(initvalu_38-initvalu_37)-J_CaB_sl;									// Ca_sl
-	finavalu[offset_38] = -J_serca-J_CaB_cytosol +J_ca_slmyo/Vmyo*(initvalu_37-initvalu_38);
-	junc_sl=J_ca_juncsl/Vsl*(initvalu_36-initvalu_37);
-	sl_junc=J_ca_juncsl/Vjunc*(initvalu_37-initvalu_36);
-	sl_myo=J_ca_slmyo/Vsl*(initvalu_38-initvalu_37);
-	myo_sl=J_ca_slmyo/Vmyo*(initvalu_37-initvalu_38);
-
-	// Simulation type													
-	state = 1;																			
-	switch(state){
-		case 0:
-			I_app = 0;
-			break;
-		case 1:																			// pace w/ current injection at cycleLength 'cycleLength'
-			if(fmod(timeinst,parameter_1) <= 5){
-				I_app = 9.5;
-			}
-			else{
-				I_app = 0.0;
-			}
-			break;
-		case 2:     
-			V_hold = -55;
-			V_test = 0;
-			if(timeinst>0.5 & timeinst<200.5){
-				V_clamp = V_test;
-			}
-			else{
-				V_clamp = V_hold;
-			}
-			R_clamp = 0.04;
-			I_app = (V_clamp-initvalu_39)/R_clamp;
-			break;
-	} 
-
-	// Membrane Potential												
-	I_Na_tot = I_Na_tot_junc + I_Na_tot_sl;												// [uA/uF]
-	I_Cl_tot = I_ClCa+I_Clbk;															// [uA/uF]
-	I_Ca_tot = I_Ca_tot_junc+I_Ca_tot_sl;
-	I_tot = I_Na_tot+I_Cl_tot+I_Ca_tot+I_K_tot;
-	finavalu[offset_39] = -(I_tot-I_app);
-
-	// Set unused output values to 0 (MATLAB does it by default)
-	finavalu[offset_41] = 0;
-	finavalu[offset_42] = 0;
+
+	// constant pow/sqrt terms
+	Q10CaL_Qpow = pow(Q10CaL,Qpow);
+	Q10NCX_Qpow = pow(Q10NCX,Qpow);
+	Q10SLCaP_Qpow = pow(Q10SLCaP,Qpow);
+	Q10SRCaP_Qpow = pow(Q10SRCaP,Qpow);
+	Nao_3 = pow(Nao,3);
+	KmNao_3 = pow(KmNao,3);
+	KmNai_3 = pow(KmNai,3);
+	KmPCa_16 = pow(KmPCa,1.6);
+	sqrt_Ko = sqrt(Ko/5.4);
+
+	// per instance results of the calls
+
+	t_ena_junc = &temp[0*lanes];
+	t_ena_sl = &temp[1*lanes];
+	t_ek = &temp[2*lanes];
+	t_eca_junc = &temp[3*lanes];
+	t_eca_sl = &temp[4*lanes];
+	t_am = &temp[5*lanes];
+	t_bm = &temp[6*lanes];
+	t_ah = &temp[7*lanes];
+	t_bh = &temp[8*lanes];
+	t_aj = &temp[9*lanes];
+	t_bj = &temp[10*lanes];
+	t_m3 = &temp[11*lanes];
+	t_fnak = &temp[12*lanes];
+	t_nak_junc = &temp[13*lanes];
+	t_nak_sl = &temp[14*lanes];
+	t_xrss = &temp[15*lanes];
+	t_tauxr = &temp[16*lanes];
+	t_rkr = &temp[17*lanes];
+	t_gks_junc = &temp[18*lanes];
+	t_gks_sl = &temp[19*lanes];
+	t_eks = &temp[20*lanes];
+	t_xsss = &temp[21*lanes];
+	t_tauxs = &temp[22*lanes];
+	t_kp_kp = &temp[23*lanes];
+	t_xtoss = &temp[24*lanes];
+	t_ytoss = &temp[25*lanes];
+	t_rtoss = &temp[26*lanes];
+	t_tauxtos = &temp[27*lanes];
+	t_tauytos = &temp[28*lanes];
+	t_taurtos = &temp[29*lanes];
+	t_tauxtof = &temp[30*lanes];
+	t_tauytof = &temp[31*lanes];
+	t_aki = &temp[32*lanes];
+	t_bki = &temp[33*lanes];
+	t_dss = &temp[34*lanes];
+	t_taud = &temp[35*lanes];
+	t_fss = &temp[36*lanes];
+	t_tauf = &temp[37*lanes];
+	t_e2vfrt = &temp[38*lanes];
+	t_evfrt = &temp[39*lanes];
+	t_kact_junc = &temp[40*lanes];
+	t_kact_sl = &temp[41*lanes];
+	t_enu = &temp[42*lanes];
+	t_enu1 = &temp[43*lanes];
+	t_na_junc3 = &temp[44*lanes];
+	t_na_sl3 = &temp[45*lanes];
+	t_nai_junc3 = &temp[46*lanes];
+	t_nai_sl3 = &temp[47*lanes];
+	t_ca_junc16 = &temp[48*lanes];
+	t_ca_sl16 = &temp[49*lanes];
+	t_ec50 = &temp[50*lanes];
+	t_serca_f = &temp[51*lanes];
+	t_serca_r = &temp[52*lanes];
+	t_I_app = &temp[53*lanes];
+
+	//=====================================================================
+	//	EXP/LOG/POW CALLS, EVERY ACTIVE INSTANCE IN TURN
+	//=====================================================================
+
+	for(l=0; l<lanes; l++){
+
+		if(active != NULL && active[l] == 0){
+			continue;
+		}
+
+		// decoded input initial data
+		fp initvalu_1  = initvalu[offset_1 +l];
+		fp initvalu_31 = initvalu[offset_31+l];
+		fp initvalu_32 = initvalu[offset_32+l];
+		fp initvalu_33 = initvalu[offset_33+l];
+		fp initvalu_34 = initvalu[offset_34+l];
+		fp initvalu_35 = initvalu[offset_35+l];
+		fp initvalu_36 = initvalu[offset_36+l];
+		fp initvalu_37 = initvalu[offset_37+l];
+		fp initvalu_38 = initvalu[offset_38+l];
+		fp initvalu_39 = initvalu[offset_39+l];
+
+		// decoded input parameters
+		fp parameter_1 = parameter[parameter_offset_1+l];
+
+		// values of this instance
+		fp ena_junc, ena_sl, ek, eca_junc, eca_sl;
+		fp am, bm, ah, bh, aj, bj;
+		fp fnak;
+		fp xrss, tauxr, rkr;
+		fp pcaks_junc, pcaks_sl, gks_junc, gks_sl, eks, xsss, tauxs;
+		fp kp_kp;
+		fp xtoss, ytoss, rtoss, tauxtos, tauytos, taurtos, tauxtof, tauytof;
+		fp aki, bki;
+		fp dss, taud, fss, tauf;
+		int state;
+		fp I_app, V_hold, V_test, V_clamp, R_clamp;
+
+		// Nernst Potentials
+		ena_junc = (1/FoRT)*log(Nao/initvalu_32);													// [mV]
+		ena_sl = (1/FoRT)*log(Nao/initvalu_33);													// [mV]
+		ek = (1/FoRT)*log(Ko/initvalu_35);														// [mV]
+		eca_junc = (1/FoRT/2)*log(Cao/initvalu_36);												// [mV]
+		eca_sl = (1/FoRT/2)*log(Cao/initvalu_37);													// [mV]
+
+		// I_Na: Fast Na Current
+		am = 0.32*(initvalu_39+47.13)/(1-exp(-0.1*(initvalu_39+47.13)));
+		bm = 0.08*exp(-initvalu_39/11);
+		if(initvalu_39 >= -40){
+			ah = 0; aj = 0;
+			bh = 1/(0.13*(1+exp(-(initvalu_39+10.66)/11.1)));
+			bj = 0.3*exp(-2.535e-7*initvalu_39)/(1+exp(-0.1*(initvalu_39+32)));
+		}
+		else{
+			ah = 0.135*exp((80+initvalu_39)/-6.8);
+			bh = 3.56*exp(0.079*initvalu_39)+3.1e5*exp(0.35*initvalu_39);
+			aj = (-127140*exp(0.2444*initvalu_39)-3.474e-5*exp(-0.04391*initvalu_39))*(initvalu_39+37.78)/(1+exp(0.311*(initvalu_39+79.23)));
+			bj = 0.1212*exp(-0.01052*initvalu_39)/(1+exp(-0.1378*(initvalu_39+40.14)));
+		}
+
+		// I_nak: Na/K Pump Current
+		fnak = 1/(1+0.1245*exp(-0.1*initvalu_39*FoRT)+0.0365*sigma*exp(-initvalu_39*FoRT));
+
+		// I_kr: Rapidly Activating K Current
+		xrss = 1/(1+exp(-(initvalu_39+50)/7.5));
+		tauxr = 1/(0.00138*(initvalu_39+7)/(1-exp(-0.123*(initvalu_39+7)))+6.1e-4*(initvalu_39+10)/(exp(0.145*(initvalu_39+10))-1));
+		rkr = 1/(1+exp((initvalu_39+33)/22.4));
+
+		// I_ks: Slowly Activating K Current
+		pcaks_junc = -log10(initvalu_36)+3.0;
+		pcaks_sl = -log10(initvalu_37)+3.0;
+		gks_junc = 0.07*(0.057 +0.19/(1+ exp((-7.2+pcaks_junc)/0.6)));
+		gks_sl = 0.07*(0.057 +0.19/(1+ exp((-7.2+pcaks_sl)/0.6)));
+		eks = (1/FoRT)*log((Ko+pNaK*Nao)/(initvalu_35+pNaK*initvalu_34));
+		xsss = 1/(1+exp(-(initvalu_39-1.5)/16.7));
+		tauxs = 1/(7.19e-5*(initvalu_39+30)/(1-exp(-0.148*(initvalu_39+30)))+1.31e-4*(initvalu_39+30)/(exp(0.0687*(initvalu_39+30))-1));
+
+		// I_kp: Plateau K current
+		kp_kp = 1/(1+exp(7.488-initvalu_39/5.98));
+
+		// I_to: Transient Outward K Current (slow and fast components)
+		xtoss = 1/(1+exp(-(initvalu_39+3.0)/15));
+		ytoss = 1/(1+exp((initvalu_39+33.5)/10));
+		rtoss = 1/(1+exp((initvalu_39+33.5)/10));
+		tauxtos = 9/(1+exp((initvalu_39+3.0)/15))+0.5;
+		tauytos = 3e3/(1+exp((initvalu_39+60.0)/10))+30;
+		taurtos = 2800/(1+exp((initvalu_39+60.0)/10))+220;
+		tauxtof = 3.5*exp(-initvalu_39*initvalu_39/30/30)+1.5;
+		tauytof = 20.0/(1+exp((initvalu_39+33.5)/10))+20.0;
+
+		// I_ki: Time-Independent K Current
+		aki = 1.02/(1+exp(0.2385*(initvalu_39-ek-59.215)));
+		bki =(0.49124*exp(0.08032*(initvalu_39+5.476-ek)) + exp(0.06175*(initvalu_39-ek-594.31))) /(1 + exp(-0.5143*(initvalu_39-ek+4.753)));
+
+		// I_Ca: L-type Calcium Current
+		dss = 1/(1+exp(-(initvalu_39+14.5)/6.0));
+		taud = dss*(1-exp(-(initvalu_39+14.5)/6.0))/(0.035*(initvalu_39+14.5));
+		fss = 1/(1+exp((initvalu_39+35.06)/3.6))+0.6/(1+exp((50-initvalu_39)/20));
+		tauf = 1/(0.0197*exp(-pow(0.0337*(initvalu_39+14.5),2))+0.02);
+
+		// Simulation type
+		state = 1;
+		switch(state){
+			case 0:
+				I_app = 0;
+				break;
+			case 1:																			// pace w/ current injection at cycleLength 'cycleLength'
+				if(fmod(timeinst[l],parameter_1) <= 5){
+					I_app = 9.5;
+				}
+				else{
+					I_app = 0.0;
+				}
+				break;
+			case 2:
+				V_hold = -55;
+				V_test = 0;
+				if(timeinst[l]>0.5 & timeinst[l]<200.5){
+					V_clamp = V_test;
+				}
+				else{
+					V_clamp = V_hold;
+				}
+				R_clamp = 0.04;
+				I_app = (V_clamp-initvalu_39)/R_clamp;
+				break;
+		}
+
+		// save for the arithmetic below, rates as their fp values, call results that enter expressions directly as they are
+		t_ena_junc[l] = ena_junc;
+		t_ena_sl[l] = ena_sl;
+		t_ek[l] = ek;
+		t_eca_junc[l] = eca_junc;
+		t_eca_sl[l] = eca_sl;
+		t_am[l] = am;
+		t_bm[l] = bm;
+		t_ah[l] = ah;
+		t_bh[l] = bh;
+		t_aj[l] = aj;
+		t_bj[l] = bj;
+		t_m3[l] = pow(initvalu_1,3);
+		t_fnak[l] = fnak;
+		t_nak_junc[l] = pow((KmNaip/initvalu_32),4);
+		t_nak_sl[l] = pow((KmNaip/initvalu_33),4);
+		t_xrss[l] = xrss;
+		t_tauxr[l] = tauxr;
+		t_rkr[l] = rkr;
+		t_gks_junc[l] = gks_junc;
+		t_gks_sl[l] = gks_sl;
+		t_eks[l] = eks;
+		t_xsss[l] = xsss;
+		t_tauxs[l] = tauxs;
+		t_kp_kp[l] = kp_kp;
+		t_xtoss[l] = xtoss;
+		t_ytoss[l] = ytoss;
+		t_rtoss[l] = rtoss;
+		t_tauxtos[l] = tauxtos;
+		t_tauytos[l] = tauytos;
+		t_taurtos[l] = taurtos;
+		t_tauxtof[l] = tauxtof;
+		t_tauytof[l] = tauytof;
+		t_aki[l] = aki;
+		t_bki[l] = bki;
+		t_dss[l] = dss;
+		t_taud[l] = taud;
+		t_fss[l] = fss;
+		t_tauf[l] = tauf;
+		t_e2vfrt[l] = exp(2*initvalu_39*FoRT);
+		t_evfrt[l] = exp(initvalu_39*FoRT);
+		t_kact_junc[l] = pow((Kdact/initvalu_36),3);
+		t_kact_sl[l] = pow((Kdact/initvalu_37),3);
+		t_enu[l] = exp(nu*initvalu_39*FoRT);
+		t_enu1[l] = exp((nu-1)*initvalu_39*FoRT);
+		t_na_junc3[l] = pow(initvalu_32,3);
+		t_na_sl3[l] = pow(initvalu_33,3);
+		t_nai_junc3[l] = pow((initvalu_32/KmNai),3);
+		t_nai_sl3[l] = pow((initvalu_33/KmNai),3);
+		t_ca_junc16[l] = pow(initvalu_36,1.6);
+		t_ca_sl16[l] = pow(initvalu_37,1.6);
+		t_ec50[l] = pow(ec50SR/initvalu_31,2.5);
+		t_serca_f[l] = pow((initvalu_38/Kmf),hillSRCaP);
+		t_serca_r[l] = pow((initvalu_31/Kmr),hillSRCaP);
+		t_I_app[l] = I_app;
+
+	}
+
+
+	//=====================================================================
+	//	ARITHMETIC, ALL INSTANCES AT ONCE
+	//=====================================================================
+
+	#pragma omp simd
+	for(l=0; l<lanes; l++){
+
+		// decoded input initial data
+		fp initvalu_1  = initvalu[offset_1 +l];
+		fp initvalu_2  = initvalu[offset_2 +l];
+		fp initvalu_3  = initvalu[offset_3 +l];
+		fp initvalu_4  = initvalu[offset_4 +l];
+		fp initvalu_5  = initvalu[offset_5 +l];
+		fp initvalu_6  = initvalu[offset_6 +l];
+		fp initvalu_7  = initvalu[offset_7 +l];
+		fp initvalu_8  = initvalu[offset_8 +l];
+		fp initvalu_9  = initvalu[offset_9 +l];
+		fp initvalu_10 = initvalu[offset_10+l];
+		fp initvalu_11 = initvalu[offset_11+l];
+		fp initvalu_12 = initvalu[offset_12+l];
+		fp initvalu_13 = initvalu[offset_13+l];
+		fp initvalu_14 = initvalu[offset_14+l];
+		fp initvalu_15 = initvalu[offset_15+l];
+		fp initvalu_16 = initvalu[offset_16+l];
+		fp initvalu_17 = initvalu[offset_17+l];
+		fp initvalu_18 = initvalu[offset_18+l];
+		fp initvalu_19 = initvalu[offset_19+l];
+		fp initvalu_20 = initvalu[offset_20+l];
+		fp initvalu_21 = initvalu[offset_21+l];
+		fp initvalu_23 = initvalu[offset_23+l];
+		fp initvalu_24 = initvalu[offset_24+l];
+		fp initvalu_25 = initvalu[offset_25+l];
+		fp initvalu_26 = initvalu[offset_26+l];
+		fp initvalu_27 = initvalu[offset_27+l];
+		fp initvalu_28 = initvalu[offset_28+l];
+		fp initvalu_29 = initvalu[offset_29+l];
+		fp initvalu_30 = initvalu[offset_30+l];
+		fp initvalu_31 = initvalu[offset_31+l];
+		fp initvalu_32 = initvalu[offset_32+l];
+		fp initvalu_33 = initvalu[offset_33+l];
+		fp initvalu_34 = initvalu[offset_34+l];
+		fp initvalu_35 = initvalu[offset_35+l];
+		fp initvalu_36 = initvalu[offset_36+l];
+		fp initvalu_37 = initvalu[offset_37+l];
+		fp initvalu_38 = initvalu[offset_38+l];
+		fp initvalu_39 = initvalu[offset_39+l];
+		fp initvalu_40 = initvalu[offset_40+l];
+
+		// results of the calls above
+		fp ena_junc = t_ena_junc[l];
+		fp ena_sl = t_ena_sl[l];
+		fp ek = t_ek[l];
+		fp eca_junc = t_eca_junc[l];
+		fp eca_sl = t_eca_sl[l];
+		fp am = t_am[l];
+		fp bm = t_bm[l];
+		fp ah = t_ah[l];
+		fp bh = t_bh[l];
+		fp aj = t_aj[l];
+		fp bj = t_bj[l];
+		double m3 = t_m3[l];
+		fp fnak = t_fnak[l];
+		double nak_junc = t_nak_junc[l];
+		double nak_sl = t_nak_sl[l];
+		fp xrss = t_xrss[l];
+		fp tauxr = t_tauxr[l];
+		fp rkr = t_rkr[l];
+		fp gks_junc = t_gks_junc[l];
+		fp gks_sl = t_gks_sl[l];
+		fp eks = t_eks[l];
+		fp xsss = t_xsss[l];
+		fp tauxs = t_tauxs[l];
+		fp kp_kp = t_kp_kp[l];
+		fp xtoss = t_xtoss[l];
+		fp ytoss = t_ytoss[l];
+		fp rtoss = t_rtoss[l];
+		fp tauxtos = t_tauxtos[l];
+		fp tauytos = t_tauytos[l];
+		fp taurtos = t_taurtos[l];
+		fp tauxtof = t_tauxtof[l];
+		fp tauytof = t_tauytof[l];
+		fp aki = t_aki[l];
+		fp bki = t_bki[l];
+		fp dss = t_dss[l];
+		fp taud = t_taud[l];
+		fp fss = t_fss[l];
+		fp tauf = t_tauf[l];
+		double e2vfrt = t_e2vfrt[l];
+		double evfrt = t_evfrt[l];
+		double kact_junc = t_kact_junc[l];
+		double kact_sl = t_kact_sl[l];
+		double enu = t_enu[l];
+		double enu1 = t_enu1[l];
+		double na_junc3 = t_na_junc3[l];
+		double na_sl3 = t_na_sl3[l];
+		double nai_junc3 = t_nai_junc3[l];
+		double nai_sl3 = t_nai_sl3[l];
+		double ca_junc16 = t_ca_junc16[l];
+		double ca_sl16 = t_ca_sl16[l];
+		double ec50 = t_ec50[l];
+		double serca_f = t_serca_f[l];
+		double serca_r = t_serca_r[l];
+		fp I_app = t_I_app[l];
+
+		// currents and fluxes
+		fp I_Na_junc, I_Na_sl, I_Na;
+		fp I_nabk_junc, I_nabk_sl, I_nabk;
+		fp I_nak_junc, I_nak_sl, I_nak;
+		fp I_kr;
+		fp I_ks_junc, I_ks_sl, I_ks;
+		fp I_kp_junc, I_kp_sl, I_kp;
+		fp I_tos, I_tof, I_to;
+		fp kiss, I_ki;
+		fp I_ClCa_junc, I_ClCa_sl, I_ClCa, I_Clbk;
+		fp ibarca_j, ibarca_sl, ibark, ibarna_j, ibarna_sl;
+		fp I_Ca_junc, I_Ca_sl, I_Ca, I_CaK, I_CaNa_junc, I_CaNa_sl, I_CaNa, I_Catot;
+		fp Ka_junc, Ka_sl, s1_junc, s1_sl, s2_junc, s3_junc, s2_sl, s3_sl;
+		fp I_ncx_junc, I_ncx_sl, I_ncx;
+		fp I_pca_junc, I_pca_sl, I_pca;
+		fp I_cabk_junc, I_cabk_sl, I_cabk;
+		fp kCaSR, koSRCa, kiSRCa, RI, J_SRCarel, J_serca, J_SRleak;
+		fp J_CaB_cytosol, J_CaB_junction, J_CaB_sl;
+		fp I_Na_tot_junc, I_Na_tot_sl, I_K_tot, I_Ca_tot_junc, I_Ca_tot_sl;
+		fp I_Na_tot, I_Cl_tot, I_Ca_tot, I_tot;
+
+		// I_Na: Fast Na Current
+		finavalu[offset_1+l] = am*(1-initvalu_1)-bm*initvalu_1;
+		finavalu[offset_2+l] = ah*(1-initvalu_2)-bh*initvalu_2;
+		finavalu[offset_3+l] = aj*(1-initvalu_3)-bj*initvalu_3;
+		I_Na_junc = Fjunc*GNa*m3*initvalu_2*initvalu_3*(initvalu_39-ena_junc);
+		I_Na_sl = Fsl*GNa*m3*initvalu_2*initvalu_3*(initvalu_39-ena_sl);
+		I_Na = I_Na_junc+I_Na_sl;
+
+		// I_nabk: Na Background Current
+		I_nabk_junc = Fjunc*GNaB*(initvalu_39-ena_junc);
+		I_nabk_sl = Fsl*GNaB*(initvalu_39-ena_sl);
+		I_nabk = I_nabk_junc+I_nabk_sl;
+
+		// I_nak: Na/K Pump Current
+		I_nak_junc = Fjunc*IbarNaK*fnak*Ko /(1+nak_junc) /(Ko+KmKo);
+		I_nak_sl = Fsl*IbarNaK*fnak*Ko /(1+nak_sl) /(Ko+KmKo);
+		I_nak = I_nak_junc+I_nak_sl;
+
+		// I_kr: Rapidly Activating K Current
+		finavalu[offset_12+l] = (xrss-initvalu_12)/tauxr;
+		I_kr = gkr*initvalu_12*rkr*(initvalu_39-ek);
+
+		// I_ks: Slowly Activating K Current
+		finavalu[offset_13+l] = (xsss-initvalu_13)/tauxs;
+		I_ks_junc = Fjunc*gks_junc*pow(initvalu_12,2)*(initvalu_39-eks);
+		I_ks_sl = Fsl*gks_sl*pow(initvalu_13,2)*(initvalu_39-eks);
+		I_ks = I_ks_junc+I_ks_sl;
+
+		// I_kp: Plateau K current
+		I_kp_junc = Fjunc*gkp*kp_kp*(initvalu_39-ek);
+		I_kp_sl = Fsl*gkp*kp_kp*(initvalu_39-ek);
+		I_kp = I_kp_junc+I_kp_sl;
+
+		// I_to: Transient Outward K Current (slow and fast components)
+		finavalu[offset_8+l] = (xtoss-initvalu_8)/tauxtos;
+		finavalu[offset_9+l] = (ytoss-initvalu_9)/tauytos;
+		finavalu[offset_40+l]= (rtoss-initvalu_40)/taurtos; 
+		I_tos = GtoSlow*initvalu_8*(initvalu_9+0.5*initvalu_40)*(initvalu_39-ek);									// [uA/uF]
+
+		//
+		finavalu[offset_10+l] = (xtoss-initvalu_10)/tauxtof;
+		finavalu[offset_11+l] = (ytoss-initvalu_11)/tauytof;
+		I_tof = GtoFast*initvalu_10*initvalu_11*(initvalu_39-ek);
+		I_to = I_tos + I_tof;
+
+		// I_ki: Time-Independent K Current
+		kiss = aki/(aki+bki);
+		I_ki = 0.9*sqrt_Ko*kiss*(initvalu_39-ek);
+
+		// I_ClCa: Ca-activated Cl Current, I_Clbk: background Cl Current
+		I_ClCa_junc = Fjunc*GClCa/(1+KdClCa/initvalu_36)*(initvalu_39-ecl);
+		I_ClCa_sl = Fsl*GClCa/(1+KdClCa/initvalu_37)*(initvalu_39-ecl);
+		I_ClCa = I_ClCa_junc+I_ClCa_sl;
+		I_Clbk = GClB*(initvalu_39-ecl);
+
+		// I_Ca: L-type Calcium Current
+		finavalu[offset_4+l] = (dss-initvalu_4)/taud;
+		finavalu[offset_5+l] = (fss-initvalu_5)/tauf;
+		finavalu[offset_6+l] = 1.7*initvalu_36*(1-initvalu_6)-11.9e-3*initvalu_6;											// fCa_junc  
+		finavalu[offset_7+l] = 1.7*initvalu_37*(1-initvalu_7)-11.9e-3*initvalu_7;											// fCa_sl
+
+		//
+		ibarca_j = pCa*4*(initvalu_39*Frdy*FoRT) * (0.341*initvalu_36*e2vfrt-0.341*Cao) /(e2vfrt-1);
+		ibarca_sl = pCa*4*(initvalu_39*Frdy*FoRT) * (0.341*initvalu_37*e2vfrt-0.341*Cao) /(e2vfrt-1);
+		ibark = pK*(initvalu_39*Frdy*FoRT)*(0.75*initvalu_35*evfrt-0.75*Ko) /(evfrt-1);
+		ibarna_j = pNa*(initvalu_39*Frdy*FoRT) *(0.75*initvalu_32*evfrt-0.75*Nao)  /(evfrt-1);
+		ibarna_sl = pNa*(initvalu_39*Frdy*FoRT) *(0.75*initvalu_33*evfrt-0.75*Nao)  /(evfrt-1);
+		I_Ca_junc = (Fjunc_CaL*ibarca_j*initvalu_4*initvalu_5*(1-initvalu_6)*Q10CaL_Qpow)*0.45;
+		I_Ca_sl = (Fsl_CaL*ibarca_sl*initvalu_4*initvalu_5*(1-initvalu_7)*Q10CaL_Qpow)*0.45;
+		I_Ca = I_Ca_junc+I_Ca_sl;
+		finavalu[offset_43+l]=-I_Ca*Cmem/(Vmyo*2*Frdy)*1e3;
+		I_CaK = (ibark*initvalu_4*initvalu_5*(Fjunc_CaL*(1-initvalu_6)+Fsl_CaL*(1-initvalu_7))*Q10CaL_Qpow)*0.45;
+		I_CaNa_junc = (Fjunc_CaL*ibarna_j*initvalu_4*initvalu_5*(1-initvalu_6)*Q10CaL_Qpow)*0.45;
+		I_CaNa_sl = (Fsl_CaL*ibarna_sl*initvalu_4*initvalu_5*(1-initvalu_7)*Q10CaL_Qpow)*0.45;
+		I_CaNa = I_CaNa_junc+I_CaNa_sl;
+		I_Catot = I_Ca+I_CaK+I_CaNa;
+
+		// I_ncx: Na/Ca Exchanger flux
+		Ka_junc = 1/(1+kact_junc);
+		Ka_sl = 1/(1+kact_sl);
+		s1_junc = enu*na_junc3*Cao;
+		s1_sl = enu*na_sl3*Cao;
+		s2_junc = enu1*Nao_3*initvalu_36;
+		s3_junc = (KmCai*Nao_3*(1+nai_junc3)+KmNao_3*initvalu_36+ KmNai_3*Cao*(1+initvalu_36/KmCai)+KmCao*na_junc3+na_junc3*Cao+Nao_3*initvalu_36)*(1+ksat*enu1);
+		s2_sl = enu1*Nao_3*initvalu_37;
+		s3_sl = (KmCai*Nao_3*(1+nai_sl3) + KmNao_3*initvalu_37+KmNai_3*Cao*(1+initvalu_37/KmCai)+KmCao*na_sl3+na_sl3*Cao+Nao_3*initvalu_37)*(1+ksat*enu1);
+		I_ncx_junc = Fjunc*IbarNCX*Q10NCX_Qpow*Ka_junc*(s1_junc-s2_junc)/s3_junc;
+		I_ncx_sl = Fsl*IbarNCX*Q10NCX_Qpow*Ka_sl*(s1_sl-s2_sl)/s3_sl;
+		I_ncx = I_ncx_junc+I_ncx_sl;
+		finavalu[offset_45+l]=2*I_ncx*Cmem/(Vmyo*2*Frdy)*1e3;
+
+		// I_pca: Sarcolemmal Ca Pump Current
+		I_pca_junc = 	Fjunc * 
+						Q10SLCaP_Qpow * 
+						IbarSLCaP * 
+						ca_junc16 /
+						(KmPCa_16 + ca_junc16);
+		I_pca_sl = 	Fsl * 
+					Q10SLCaP_Qpow * 
+					IbarSLCaP * 
+					ca_sl16 / 
+					(KmPCa_16 + ca_sl16);
+		I_pca = I_pca_junc+I_pca_sl;
+		finavalu[offset_44+l]=-I_pca*Cmem/(Vmyo*2*Frdy)*1e3;
+
+		// I_cabk: Ca Background Current
+		I_cabk_junc = Fjunc*GCaB*(initvalu_39-eca_junc);
+		I_cabk_sl = Fsl*GCaB*(initvalu_39-eca_sl);
+		I_cabk = I_cabk_junc+I_cabk_sl;
+		finavalu[offset_46+l]=-I_cabk*Cmem/(Vmyo*2*Frdy)*1e3;
+	
+		// SR fluxes: Calcium Release, SR Ca pump, SR Ca leak														
+		kCaSR = MaxSR - (MaxSR-MinSR)/(1+ec50);
+		koSRCa = koCa/kCaSR;
+		kiSRCa = kiCa*kCaSR;
+		RI = 1-initvalu_14-initvalu_15-initvalu_16;
+		finavalu[offset_14+l] = (kim*RI-kiSRCa*initvalu_36*initvalu_14)-(koSRCa*pow(initvalu_36,2)*initvalu_14-kom*initvalu_15);			// R
+		finavalu[offset_15+l] = (koSRCa*pow(initvalu_36,2)*initvalu_14-kom*initvalu_15)-(kiSRCa*initvalu_36*initvalu_15-kim*initvalu_16);			// O
+		finavalu[offset_16+l] = (kiSRCa*initvalu_36*initvalu_15-kim*initvalu_16)-(kom*initvalu_16-koSRCa*pow(initvalu_36,2)*RI);			// I
+		J_SRCarel = ks*initvalu_15*(initvalu_31-initvalu_36);													// [mM/ms]
+		J_serca = Q10SRCaP_Qpow*Vmax_SRCaP*(serca_f-serca_r)
+											 /(1+serca_f+serca_r);
+		J_SRleak = 5.348e-6*(initvalu_31-initvalu_36);													//   [mM/ms]
+
+		// Sodium and Calcium Buffering														
+		finavalu[offset_17+l] = kon_na*initvalu_32*(Bmax_Naj-initvalu_17)-koff_na*initvalu_17;								// NaBj      [mM/ms]
+		finavalu[offset_18+l] = kon_na*initvalu_33*(Bmax_Nasl-initvalu_18)-koff_na*initvalu_18;							// NaBsl     [mM/ms]
+
+		// Cytosolic Ca Buffers
+		finavalu[offset_19+l] = kon_tncl*initvalu_38*(Bmax_TnClow-initvalu_19)-koff_tncl*initvalu_19;						// TnCL      [mM/ms]
+		finavalu[offset_20+l] = kon_tnchca*initvalu_38*(Bmax_TnChigh-initvalu_20-initvalu_21)-koff_tnchca*initvalu_20;			// TnCHc     [mM/ms]
+		finavalu[offset_21+l] = kon_tnchmg*Mgi*(Bmax_TnChigh-initvalu_20-initvalu_21)-koff_tnchmg*initvalu_21;				// TnCHm     [mM/ms]
+		finavalu[offset_22+l] = 0;																		// CaM       [mM/ms]
+		finavalu[offset_23+l] = kon_myoca*initvalu_38*(Bmax_myosin-initvalu_23-initvalu_24)-koff_myoca*initvalu_23;				// Myosin_ca [mM/ms]
+		finavalu[offset_24+l] = kon_myomg*Mgi*(Bmax_myosin-initvalu_23-initvalu_24)-koff_myomg*initvalu_24;				// Myosin_mg [mM/ms]
+		finavalu[offset_25+l] = kon_sr*initvalu_38*(Bmax_SR-initvalu_25)-koff_sr*initvalu_25;								// SRB       [mM/ms]
+		J_CaB_cytosol = finavalu[offset_19+l] + finavalu[offset_20+l] + finavalu[offset_21+l] + finavalu[offset_22+l] + finavalu[offset_23+l] + finavalu[offset_24+l] + finavalu[offset_25+l];
+
+		// Junctional and SL Ca Buffers
+		finavalu[offset_26+l] = kon_sll*initvalu_36*(Bmax_SLlowj-initvalu_26)-koff_sll*initvalu_26;						// SLLj      [mM/ms]
+		finavalu[offset_27+l] = kon_sll*initvalu_37*(Bmax_SLlowsl-initvalu_27)-koff_sll*initvalu_27;						// SLLsl     [mM/ms]
+		finavalu[offset_28+l] = kon_slh*initvalu_36*(Bmax_SLhighj-initvalu_28)-koff_slh*initvalu_28;						// SLHj      [mM/ms]
+		finavalu[offset_29+l] = kon_slh*initvalu_37*(Bmax_SLhighsl-initvalu_29)-koff_slh*initvalu_29;						// SLHsl     [mM/ms]
+		J_CaB_junction = finavalu[offset_26+l]+finavalu[offset_28+l];
+		J_CaB_sl = finavalu[offset_27+l]+finavalu[offset_29+l];
+
+		// SR Ca Concentrations
+		finavalu[offset_30+l] = kon_csqn*initvalu_31*(Bmax_Csqn-initvalu_30)-koff_csqn*initvalu_30;						// Csqn      [mM/ms]
+		finavalu[offset_31+l] = J_serca*Vmyo*oneovervsr-(J_SRleak*Vmyo*oneovervsr+J_SRCarel)-finavalu[offset_30+l];   // Ca_sr     [mM/ms] %Ratio 3 leak current
+
+		// Sodium Concentrations
+		I_Na_tot_junc = I_Na_junc+I_nabk_junc+3*I_ncx_junc+3*I_nak_junc+I_CaNa_junc;		// [uA/uF]
+		I_Na_tot_sl = I_Na_sl+I_nabk_sl+3*I_ncx_sl+3*I_nak_sl+I_CaNa_sl;					// [uA/uF]
+		finavalu[offset_32+l] = -I_Na_tot_junc*Cmem/(Vjunc*Frdy)+J_na_juncsl/Vjunc*(initvalu_33-initvalu_32)-finavalu[offset_17+l];
+		finavalu[offset_33+l] = -I_Na_tot_sl*Cmem*oneovervsl/Frdy+J_na_juncsl*oneovervsl*(initvalu_32-initvalu_33)+J_na_slmyo*oneovervsl*(initvalu_34-initvalu_33)-finavalu[offset_18+l];
+		finavalu[offset_34+l] = J_na_slmyo/Vmyo*(initvalu_33-initvalu_34);											// [mM/msec] 
+
+		// Potassium Concentration
+		I_K_tot = I_to+I_kr+I_ks+I_ki-2*I_nak+I_CaK+I_kp;									// [uA/uF]
+		finavalu[offset_35+l] = 0;															// [mM/msec]
+
+		// Calcium Concentrations
+		I_Ca_tot_junc = I_Ca_junc+I_cabk_junc+I_pca_junc-2*I_ncx_junc;						// [uA/uF]
+		I_Ca_tot_sl = I_Ca_sl+I_cabk_sl+I_pca_sl-2*I_ncx_sl;								// [uA/uF]
+		finavalu[offset_36+l] = -I_Ca_tot_junc*Cmem/(Vjunc*2*Frdy)+J_ca_juncsl/Vjunc*(initvalu_37-initvalu_36)
+		         - J_CaB_junction+(J_SRCarel)*Vsr/Vjunc+J_SRleak*Vmyo/Vjunc;				// Ca_j
+		finavalu[offset_37+l] = -I_Ca_tot_sl*Cmem/(Vsl*2*Frdy)+J_ca_juncsl/Vsl*(initvalu_36-initvalu_37)
+		         + J_ca_slmyo/Vsl*(initvalu_38-initvalu_37)-J_CaB_sl;									// Ca_sl
+		finavalu[offset_38+l] = -J_serca-J_CaB_cytosol +J_ca_slmyo/Vmyo*(initvalu_37-initvalu_38);
+
+		// Membrane Potential												
+		I_Na_tot = I_Na_tot_junc + I_Na_tot_sl;												// [uA/uF]
+		I_Cl_tot = I_ClCa+I_Clbk;															// [uA/uF]
+		I_Ca_tot = I_Ca_tot_junc+I_Ca_tot_sl;
+		I_tot = I_Na_tot+I_Cl_tot+I_Ca_tot+I_K_tot;
+		finavalu[offset_39+l] = -(I_tot-I_app);
+
+		// Set unused output values to 0 (MATLAB does it by default)
+		finavalu[offset_41+l] = 0;
+		finavalu[offset_42+l] = 0;
+
+	}
 
 }
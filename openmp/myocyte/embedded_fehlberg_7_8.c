@@ -86,8 +86,7 @@ static fp embedded_fehlberg_7_8(	fp timeinst,
 															fp* initvalu,
 															fp* finavalu,
 															fp* error,
-															fp* parameter,
-															int mode) {
+															fp* parameter) {
 
 	// printf("initvalu[0] = %f\n", initvalu[0]);
 	// printf("initvalu[10] = %f\n", initvalu[10]);
@@ -179,6 +178,7 @@ static fp embedded_fehlberg_7_8(	fp timeinst,
 	fp timeinst_temp;
 	fp* initvalu_temp;
 	fp** finavalu_temp;
+	double temp[MODEL_TEMPS];
 
 	int i;
 
@@ -207,11 +207,13 @@ static fp embedded_fehlberg_7_8(	fp timeinst,
 		// printf("initvalu[%d] = %f\n", i, initvalu[i]);
 	}
 
-	master(	timeinst_temp,
+	master(	&timeinst_temp,
 					initvalu_temp,
 					parameter,
 					finavalu_temp[0],
-					mode);
+					1,
+					NULL,
+					temp);
 
 	// for(i=0; i<EQUATIONS; i++){
 		// printf("finavalu_temp[0][%d] = %f\n", i, finavalu_temp[0][i]);
@@ -226,11 +228,13 @@ static fp embedded_fehlberg_7_8(	fp timeinst,
 		initvalu_temp[i] = initvalu[i] + h2_7 * (finavalu_temp[0][i]);
 	}
 
-	master(	timeinst_temp,
+	master(	&timeinst_temp,
 					initvalu_temp,
 					parameter,
 					finavalu_temp[1],
-					mode);
+					1,
+					NULL,
+					temp);
 
 	// for(i=0; i<EQUATIONS; i++){
 		// printf("finavalu_temp[1][%d] = %f\n", i, finavalu_temp[1][i]);
@@ -245,11 +249,13 @@ static fp embedded_fehlberg_7_8(	fp timeinst,
 		initvalu_temp[i] = initvalu[i] + h * ( b31*finavalu_temp[0][i] + b32*finavalu_temp[1][i]);
 	}
 
-	master(	timeinst_temp,
+	master(	&timeinst_temp,
 					initvalu_temp,
 					parameter,
 					finavalu_temp[2],
-					mode);
+					1,
+					NULL,
+					temp);
 
 	// for(i=0; i<EQUATIONS; i++){
 		// printf("finavalu_temp[2][%d] = %f\n", i, finavalu_temp[2][i]);
@@ -264,11 +270,13 @@ static fp embedded_fehlberg_7_8(	fp timeinst,
 		initvalu_temp[i] = initvalu[i] + h * ( b41*finavalu_temp[0][i] + b43*finavalu_temp[2][i]) ;
 	}
 
-	master(	timeinst_temp,
+	master(	&timeinst_temp,
 					initvalu_temp,
 					parameter,
 					finavalu_temp[3],
-					mode);
+					1,
+					NULL,
+					temp);
 
 	// for(i=0; i<EQUATIONS; i++){
 		// printf("finavalu_temp[3][%d] = %f\n", i, finavalu_temp[3][i]);
@@ -283,11 +291,13 @@ static fp embedded_fehlberg_7_8(	fp timeinst,
 		initvalu_temp[i] = initvalu[i] + h * ( b51*finavalu_temp[0][i] + b53*finavalu_temp[2][i] + b54*finavalu_temp[3][i]) ;
 	}
 
-	master(	timeinst_temp,
+	master(	&timeinst_temp,
 					initvalu_temp,
 					parameter,
 					finavalu_temp[4],
-					mode);
+					1,
+					NULL,
+					temp);
 
 	// for(i=0; i<EQUATIONS; i++){
 		// printf("finavalu_temp[4][%d] = %f\n", i, finavalu_temp[4][i]);
@@ -302,11 +312,13 @@ static fp embedded_fehlberg_7_8(	fp timeinst,
 		initvalu_temp[i] = initvalu[i] + h * ( b61*finavalu_temp[0][i] + b64*finavalu_temp[3][i] + b65*finavalu_temp[4][i]) ;
 	}
 
-	master(	timeinst_temp,
+	master(	&timeinst_temp,
 					initvalu_temp,
 					parameter,
 					finavalu_temp[5],
-					mode);
+					1,
+					NULL,
+					temp);
 
 	// for(i=0; i<EQUATIONS; i++){
 		// printf("finavalu_temp[5][%d] = %f\n", i, finavalu_temp[5][i]);
@@ -321,11 +333,13 @@ static fp embedded_fehlberg_7_8(	fp timeinst,
 		initvalu_temp[i] = initvalu[i] + h * ( b71*finavalu_temp[0][i] + b74*finavalu_temp[3][i] + b75*finavalu_temp[4][i] + b76*finavalu_temp[5][i]);
 	}
 
-	master(	timeinst_temp,
+	master(	&timeinst_temp,
 					initvalu_temp,
 					parameter,
 					finavalu_temp[6],
-					mode);
+					1,
+					NULL,
+					temp);
 
 	// for(i=0; i<EQUATIONS; i++){
 		// printf("finavalu_temp[6][%d] = %f\n", i, finavalu_temp[6][i]);
@@ -340,11 +354,13 @@ static fp embedded_fehlberg_7_8(	fp timeinst,
 		initvalu_temp[i] = initvalu[i] + h * ( b81*finavalu_temp[0][i] + b85*finavalu_temp[4][i] + b86*finavalu_temp[5][i] + b87*finavalu_temp[6][i]);
 	}
 
-	master(	timeinst_temp,
+	master(	&timeinst_temp,
 					initvalu_temp,
 					parameter,
 					finavalu_temp[7],
-					mode);
+					1,
+					NULL,
+					temp);
 
 	// for(i=0; i<EQUATIONS; i++){
 		// printf("finavalu_temp[7][%d] = %f\n", i, finavalu_temp[7][i]);
@@ -359,11 +375,13 @@ static fp embedded_fehlberg_7_8(	fp timeinst,
 		initvalu_temp[i] = initvalu[i] + h * ( b91*finavalu_temp[0][i] + b94*finavalu_temp[3][i] + b95*finavalu_temp[4][i] + b96*finavalu_temp[5][i] + b97*finavalu_temp[6][i]+ b98*finavalu_temp[7][i]) ;
 	}
 
-	master(	timeinst_temp,
+	master(	&timeinst_temp,
 					initvalu_temp,
 					parameter,
 					finavalu_temp[8],
-					mode);
+					1,
+					NULL,
+					temp);
 
 	// for(i=0; i<EQUATIONS; i++){
 		// printf("finavalu_temp[8][%d] = %f\n", i, finavalu_temp[8][i]);
@@ -378,11 +396,13 @@ static fp embedded_fehlberg_7_8(	fp timeinst,
 		initvalu_temp[i] = initvalu[i] + h * ( b10_1*finavalu_temp[0][i] + b10_4*finavalu_temp[3][i] + b10_5*finavalu_temp[4][i] + b10_6*finavalu_temp[5][i] + b10_7*finavalu_temp[6][i] + b10_8*finavalu_temp[7][i] + b10_9*finavalu_temp[8] [i]) ;
 	}
 
-	master(	timeinst_temp,
+	master(	&timeinst_temp,
 					initvalu_temp,
 					parameter,
 					finavalu_temp[9],
-					mode);
+					1,
+					NULL,
+					temp);
 
 	// for(i=0; i<EQUATIONS; i++){
 		// printf("finavalu_temp[9][%d] = %f\n", i, finavalu_temp[9][i]);
@@ -397,11 +417,13 @@ static fp embedded_fehlberg_7_8(	fp timeinst,
 		initvalu_temp[i] = initvalu[i] + h * ( b11_1*finavalu_temp[0][i] + b11_4*finavalu_temp[3][i] + b11_5*finavalu_temp[4][i] + b11_6*finavalu_temp[5][i] + b11_7*finavalu_temp[6][i] + b11_8*finavalu_temp[7][i] + b11_9*finavalu_temp[8][i]+ b11_10 * finavalu_temp[9][i]);
 	}
 
-	master(	timeinst_temp,
+	master(	&timeinst_temp,
 					initvalu_temp,
 					parameter,
 					finavalu_temp[10],
-					mode);
+					1,
+					NULL,
+					temp);
 
 	// for(i=0; i<EQUATIONS; i++){
 		// printf("finavalu_temp[10][%d] = %f\n", i, finavalu_temp[10][i]);
@@ -416,11 +438,13 @@ static fp embedded_fehlberg_7_8(	fp timeinst,
 		initvalu_temp[i] = initvalu[i] + h * ( b12_1*finavalu_temp[0][i] + b12_6*finavalu_temp[5][i] + b12_7*finavalu_temp[6][i] + b12_8*finavalu_temp[7][i] + b12_9*finavalu_temp[8][i] + b12_10 * finavalu_temp[9][i]) ;
 	}
 
-	master(	timeinst_temp,
+	master(	&timeinst_temp,
 					initvalu_temp,
 					parameter,
 					finavalu_temp[11],
-					mode);
+					1,
+					NULL,
+					temp);
 
 	// for(i=0; i<EQUATIONS; i++){
 		// printf("finavalu_temp[11][%d] = %f\n", i, finavalu_temp[11][i]);
@@ -435,11 +459,13 @@ static fp embedded_fehlberg_7_8(	fp timeinst,
 		initvalu_temp[i] = initvalu[i] + h * ( b13_1*finavalu_temp[0][i] + b13_4*finavalu_temp[3][i] + b13_5*finavalu_temp[4][i] + b13_6*finavalu_temp[5][i] + b13_7*finavalu_temp[6][i] + b13_8*finavalu_temp[7][i] + b13_9*finavalu_temp[8][i] + b13_10*finavalu_temp[9][i] + finavalu_temp[11][i]) ;
 	}
 
-	master(	timeinst_temp,
+	master(	&timeinst_temp,
 					initvalu_temp,
 					parameter,
 					finavalu_temp[12],
-					mode);
+					1,
+					NULL,
+					temp);
 
 	// for(i=0; i<EQUATIONS; i++){
 		// printf("finavalu_temp[12][%d] = %f\n", i, finavalu_temp[12][i]);
@@ -475,6 +501,9 @@ static fp embedded_fehlberg_7_8(	fp timeinst,
 	//======================================================================================================================================================
 
 	free(initvalu_temp);
+	for (i= 0; i<13; i++){
+		free(finavalu_temp[i]);
+	}
 	free(finavalu_temp);
 
 }
@@ -1,6 +1,10 @@
 //=====================================================================
 //	MAIN FUNCTION
 //=====================================================================
+
+// final adjustments of lanes instances stored value by value (see ecc.c), JCaDyad, JCaSL and JCaCyt hold the Ca fluxes of cam for
+// every lane. All arithmetic, one simd loop across the lanes.
+
 void fin(	fp *initvalu,
 				int initvalu_offset_ecc,
 				int initvalu_offset_Dyad,
@@ -8,19 +12,17 @@ void fin(	fp *initvalu,
 				int initvalu_offset_Cyt,
 				fp *parameter,
 				fp *finavalu,
-				fp JCaDyad,
-				fp JCaSL,
-				fp JCaCyt){
+				double *JCaDyad,
+				double *JCaSL,
+				double *JCaCyt,
+				int lanes){
 
 //=====================================================================
 //	VARIABLES
 //=====================================================================
 
-	// decoded input parameters
-	fp BtotDyad;																		//
-	fp CaMKIItotDyad;																	//
-
 	// compute variables
+
 	fp Vmyo;																			// [L]
 	fp Vdyad;																			// [L]
 	fp VSL;																				// [L]
@@ -32,23 +34,13 @@ void fin(	fp *initvalu,
 	fp k2Bon;																			// [uM^-1 s^-1]
 	fp k4Boff;																			// [s^-1]
 	fp k4Bon;																			// [uM^-1 s^-1]
-	fp CaMtotDyad;
-	fp Bdyad;																			// [uM dyad]
-	fp J_cam_dyadSL;																	// [uM/msec dyad]
-	fp J_ca2cam_dyadSL;																	// [uM/msec dyad]
-	fp J_ca4cam_dyadSL;																	// [uM/msec dyad]
-	fp J_cam_SLmyo;																		// [umol/msec]
-	fp J_ca2cam_SLmyo;																	// [umol/msec]
-	fp J_ca4cam_SLmyo;																	// [umol/msec]
+	// counters
+	int l;
 
 //=====================================================================
 //	COMPUTATION
 //=====================================================================
 
-	// decoded input parameters
-	BtotDyad      = parameter[2];														//
-	CaMKIItotDyad = parameter[3];														//
-
 	// set variables
 	Vmyo = 2.1454e-11;																	// [L]
 	Vdyad = 1.7790e-14;																	// [L]
@@ -62,47 +54,71 @@ void fin(	fp *initvalu,
 	k4Boff = k2Boff;																	// [s^-1]
 	k4Bon = k0Bon;																		// [uM^-1 s^-1]
 
-	// ADJUST ECC incorporate Ca buffering from CaM, convert JCaCyt from uM/msec to mM/msec
-	finavalu[initvalu_offset_ecc+35] = finavalu[initvalu_offset_ecc+35] + 1e-3*JCaDyad;
-	finavalu[initvalu_offset_ecc+36] = finavalu[initvalu_offset_ecc+36] + 1e-3*JCaSL;
-	finavalu[initvalu_offset_ecc+37] = finavalu[initvalu_offset_ecc+37] + 1e-3*JCaCyt; 
-
-	// incorporate CaM diffusion between compartments
-	CaMtotDyad = initvalu[initvalu_offset_Dyad+0]
-			   + initvalu[initvalu_offset_Dyad+1]
-			   + initvalu[initvalu_offset_Dyad+2]
-			   + initvalu[initvalu_offset_Dyad+3]
-			   + initvalu[initvalu_offset_Dyad+4]
-			   + initvalu[initvalu_offset_Dyad+5]
-			   + CaMKIItotDyad * (  initvalu[initvalu_offset_Dyad+6]
-								  + initvalu[initvalu_offset_Dyad+7]
-								  + initvalu[initvalu_offset_Dyad+8]
-								  + initvalu[initvalu_offset_Dyad+9])
-			   + initvalu[initvalu_offset_Dyad+12]
-			   + initvalu[initvalu_offset_Dyad+13]
-			   + initvalu[initvalu_offset_Dyad+14];
-	Bdyad = BtotDyad - CaMtotDyad;																				// [uM dyad]
-	J_cam_dyadSL = 1e-3 * (  k0Boff*initvalu[initvalu_offset_Dyad+0] - k0Bon*Bdyad*initvalu[initvalu_offset_SL+0]);			// [uM/msec dyad]
-	J_ca2cam_dyadSL = 1e-3 * (  k2Boff*initvalu[initvalu_offset_Dyad+1] - k2Bon*Bdyad*initvalu[initvalu_offset_SL+1]);		// [uM/msec dyad]
-	J_ca4cam_dyadSL = 1e-3 * (  k2Boff*initvalu[initvalu_offset_Dyad+2] - k4Bon*Bdyad*initvalu[initvalu_offset_SL+2]);		// [uM/msec dyad]
+	#pragma omp simd
+	for(l=0; l<lanes; l++){
+
+		// decoded input parameters
+		fp BtotDyad      = parameter[2*lanes+l];														//
+		fp CaMKIItotDyad = parameter[3*lanes+l];														//
+
+		// Ca fluxes of cam
+		fp JCaDyad_l = JCaDyad[l];
+		fp JCaSL_l = JCaSL[l];
+		fp JCaCyt_l = JCaCyt[l];
+
+		// fluxes
+		fp CaMtotDyad;
+		fp Bdyad;																			// [uM dyad]
+		fp J_cam_dyadSL;																	// [uM/msec dyad]
+		fp J_ca2cam_dyadSL;																	// [uM/msec dyad]
+		fp J_ca4cam_dyadSL;																	// [uM/msec dyad]
+		fp J_cam_SLmyo;																		// [umol/msec]
+		fp J_ca2cam_SLmyo;																	// [umol/msec]
+		fp J_ca4cam_SLmyo;																	// [umol/msec]
+
+		// ADJUST ECC incorporate Ca buffering from CaM, convert JCaCyt from uM/msec to mM/msec
+		finavalu[(initvalu_offset_ecc+35)*lanes+l] = finavalu[(initvalu_offset_ecc+35)*lanes+l] + 1e-3*JCaDyad_l;
+		finavalu[(initvalu_offset_ecc+36)*lanes+l] = finavalu[(initvalu_offset_ecc+36)*lanes+l] + 1e-3*JCaSL_l;
+		finavalu[(initvalu_offset_ecc+37)*lanes+l] = finavalu[(initvalu_offset_ecc+37)*lanes+l] + 1e-3*JCaCyt_l; 
+
+		// incorporate CaM diffusion between compartments
+		CaMtotDyad = initvalu[(initvalu_offset_Dyad+0)*lanes+l]
+				   + initvalu[(initvalu_offset_Dyad+1)*lanes+l]
+				   + initvalu[(initvalu_offset_Dyad+2)*lanes+l]
+				   + initvalu[(initvalu_offset_Dyad+3)*lanes+l]
+				   + initvalu[(initvalu_offset_Dyad+4)*lanes+l]
+				   + initvalu[(initvalu_offset_Dyad+5)*lanes+l]
+				   + CaMKIItotDyad * (  initvalu[(initvalu_offset_Dyad+6)*lanes+l]
+									  + initvalu[(initvalu_offset_Dyad+7)*lanes+l]
+									  + initvalu[(initvalu_offset_Dyad+8)*lanes+l]
+									  + initvalu[(initvalu_offset_Dyad+9)*lanes+l])
+				   + initvalu[(initvalu_offset_Dyad+12)*lanes+l]
+				   + initvalu[(initvalu_offset_Dyad+13)*lanes+l]
+				   + initvalu[(initvalu_offset_Dyad+14)*lanes+l];
+		Bdyad = BtotDyad - CaMtotDyad;																				// [uM dyad]
+		J_cam_dyadSL = 1e-3 * (  k0Boff*initvalu[(initvalu_offset_Dyad+0)*lanes+l] - k0Bon*Bdyad*initvalu[(initvalu_offset_SL+0)*lanes+l]);			// [uM/msec dyad]
+		J_ca2cam_dyadSL = 1e-3 * (  k2Boff*initvalu[(initvalu_offset_Dyad+1)*lanes+l] - k2Bon*Bdyad*initvalu[(initvalu_offset_SL+1)*lanes+l]);		// [uM/msec dyad]
+		J_ca4cam_dyadSL = 1e-3 * (  k2Boff*initvalu[(initvalu_offset_Dyad+2)*lanes+l] - k4Bon*Bdyad*initvalu[(initvalu_offset_SL+2)*lanes+l]);		// [uM/msec dyad]
 	
-	J_cam_SLmyo = kSLmyo * (  initvalu[initvalu_offset_SL+0] - initvalu[initvalu_offset_Cyt+0]);								// [umol/msec]
-	J_ca2cam_SLmyo = kSLmyo * (  initvalu[initvalu_offset_SL+1] - initvalu[initvalu_offset_Cyt+1]);							// [umol/msec]
-	J_ca4cam_SLmyo = kSLmyo * (  initvalu[initvalu_offset_SL+2] - initvalu[initvalu_offset_Cyt+2]);							// [umol/msec]
+		J_cam_SLmyo = kSLmyo * (  initvalu[(initvalu_offset_SL+0)*lanes+l] - initvalu[(initvalu_offset_Cyt+0)*lanes+l]);								// [umol/msec]
+		J_ca2cam_SLmyo = kSLmyo * (  initvalu[(initvalu_offset_SL+1)*lanes+l] - initvalu[(initvalu_offset_Cyt+1)*lanes+l]);							// [umol/msec]
+		J_ca4cam_SLmyo = kSLmyo * (  initvalu[(initvalu_offset_SL+2)*lanes+l] - initvalu[(initvalu_offset_Cyt+2)*lanes+l]);							// [umol/msec]
 	
-	// ADJUST CAM Dyad 
-	finavalu[initvalu_offset_Dyad+0] = finavalu[initvalu_offset_Dyad+0] - J_cam_dyadSL;
-	finavalu[initvalu_offset_Dyad+1] = finavalu[initvalu_offset_Dyad+1] - J_ca2cam_dyadSL;
-	finavalu[initvalu_offset_Dyad+2] = finavalu[initvalu_offset_Dyad+2] - J_ca4cam_dyadSL;
+		// ADJUST CAM Dyad 
+		finavalu[(initvalu_offset_Dyad+0)*lanes+l] = finavalu[(initvalu_offset_Dyad+0)*lanes+l] - J_cam_dyadSL;
+		finavalu[(initvalu_offset_Dyad+1)*lanes+l] = finavalu[(initvalu_offset_Dyad+1)*lanes+l] - J_ca2cam_dyadSL;
+		finavalu[(initvalu_offset_Dyad+2)*lanes+l] = finavalu[(initvalu_offset_Dyad+2)*lanes+l] - J_ca4cam_dyadSL;
 	
-	// ADJUST CAM Sl
-	finavalu[initvalu_offset_SL+0] = finavalu[initvalu_offset_SL+0] + J_cam_dyadSL*Vdyad/VSL - J_cam_SLmyo/VSL;
-	finavalu[initvalu_offset_SL+1] = finavalu[initvalu_offset_SL+1] + J_ca2cam_dyadSL*Vdyad/VSL - J_ca2cam_SLmyo/VSL;
-	finavalu[initvalu_offset_SL+2] = finavalu[initvalu_offset_SL+2] + J_ca4cam_dyadSL*Vdyad/VSL - J_ca4cam_SLmyo/VSL;
-
-	// ADJUST CAM Cyt 
-	finavalu[initvalu_offset_Cyt+0] = finavalu[initvalu_offset_Cyt+0] + J_cam_SLmyo/Vmyo;
-	finavalu[initvalu_offset_Cyt+1] = finavalu[initvalu_offset_Cyt+1] + J_ca2cam_SLmyo/Vmyo;
-	finavalu[initvalu_offset_Cyt+2] = finavalu[initvalu_offset_Cyt+2] + J_ca4cam_SLmyo/Vmyo;
+		// ADJUST CAM Sl
+		finavalu[(initvalu_offset_SL+0)*lanes+l] = finavalu[(initvalu_offset_SL+0)*lanes+l] + J_cam_dyadSL*Vdyad/VSL - J_cam_SLmyo/VSL;
+		finavalu[(initvalu_offset_SL+1)*lanes+l] = finavalu[(initvalu_offset_SL+1)*lanes+l] + J_ca2cam_dyadSL*Vdyad/VSL - J_ca2cam_SLmyo/VSL;
+		finavalu[(initvalu_offset_SL+2)*lanes+l] = finavalu[(initvalu_offset_SL+2)*lanes+l] + J_ca4cam_dyadSL*Vdyad/VSL - J_ca4cam_SLmyo/VSL;
+
+		// ADJUST CAM Cyt 
+		finavalu[(initvalu_offset_Cyt+0)*lanes+l] = finavalu[(initvalu_offset_Cyt+0)*lanes+l] + J_cam_SLmyo/Vmyo;
+		finavalu[(initvalu_offset_Cyt+1)*lanes+l] = finavalu[(initvalu_offset_Cyt+1)*lanes+l] + J_ca2cam_SLmyo/Vmyo;
+		finavalu[(initvalu_offset_Cyt+2)*lanes+l] = finavalu[(initvalu_offset_Cyt+2)*lanes+l] + J_ca4cam_SLmyo/Vmyo;
+
+	}
 
 }
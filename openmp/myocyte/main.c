@@ -57,17 +57,31 @@
 // 1) When running with parallelization inside each simulation instance (value of 3rd command line parameter equal to 0), performance is bad because:
 // a) thread launch overhead
 // b) small amount of work for each forked thread
+//     This parallel region (opened in master for every one of the 13 model evaluations of every attempted step) was therefore removed, mode 0 now
+//     runs the instances one after another on a single thread and serves as the serial reference.
 // 2) When running with parallelization across simulation instances, code gets continues speedup with the increasing number of simulation insances which saturates
 //     around 4 instances on Quad Core CPU (roughly corresponding to the number of multiprocessorsXprocessors in GTX280), with the speedup of around 3.5x compared
 //     to serial C version of code, as expected.
+// 3) When running batched (value of 3rd command line parameter equal to 2), every thread advances batches of W instances in lockstep with a
+//     separate step size per instance, see batch.c. Instances are kept in SoA layout: the solver arithmetic and the arithmetic of the model run
+//     as simd loops across them, the exp/pow/log calls of the model stay scalar, one instance after another. Results are identical to modes 0 and 1.
+// 4) Without an output file every instance keeps its whole trajectory in memory, (xmax+1)*91 values, which limits the length of the simulation.
+//     With an output file only the current state is kept, sampled time instances are streamed to the file by a background writer thread, see
+//     sink.c. trajectory_read reads the file back.
 
 // The following are the command parameters to the application:
 // 1) Simulation time interval which is the number of miliseconds to simulate. Needs to be integer > 0
 // 2) Number of instances of simulation to run. Needs to be integer > 0.
-// 3) Method of parallelization. Need to be 0 for parallelization inside each simulation instance, or 1 for parallelization across instances.
+// 3) Method of parallelization. Need to be 0 for serial execution, 1 for parallelization across instances, or 2 for batches of instances
+//     integrated in lockstep, batches parallelized across threads.
 // 4) Number of threads to use. Needs to be integer > 0.
+// 5) Optional: number of instances per batch (W), used by mode 2 only. Needs to be integer > 0, default BATCH_LANES.
+// 6) Optional: binary trajectory output file, see 4) above.
+// 7) Optional: sampling stride, every stride-th time instance is written. Needs to be integer > 0, default 1.
 // Example:
 // a.out 100 100 1 4
+// a.out 100 1024 2 4 16
+// a.out 100000 1024 2 4 16 trajectory.bin 100
 
 //====================================================================================================100
 //	DEFINE / INCLUDE
@@ -79,14 +93,17 @@
 #include <string.h>
 
 #include <omp.h>
+#include <sys/resource.h>
 
 #include "define.c"
+#include "sink.c"
 #include "ecc.c"
 #include "cam.c"
 #include "fin.c"
 #include "master.c"
 #include "embedded_fehlberg_7_8.c"
 #include "solver.c"
+#include "batch.c"
 
 #include "file.c"
 #include "timer.c"
@@ -147,6 +164,26 @@ int main(int argc, char *argv []){
 
 	int threads;
 
+	//============================================================60
+	//		BATCHES
+	//============================================================60
+
+	int lanes;
+	int batch;
+	int batches;
+	int* batch_status;
+
+	//============================================================60
+	//		OUTPUT
+	//============================================================60
+
+	int rows;
+	int stride;
+	fp* y_mem;
+	trajectory_sink trajectory;
+	trajectory_sink* sink;
+	struct rusage usage;
+
 	//================================================================================80
 	// 	GET INPUT PARAMETERS
 	//================================================================================80
@@ -155,8 +192,8 @@ int main(int argc, char *argv []){
 	//		CHECK NUMBER OF ARGUMENTS
 	//============================================================60
 
-	if(argc!=5){
-		printf("ERROR: %d is the incorrect number of arguments, the number of arguments must be 4\n", argc-1);
+	if(argc<5 || argc>8){
+		printf("ERROR: %d is the incorrect number of arguments, the number of arguments must be 4 to 7\n", argc-1);
 		return 0;
 	}
 
@@ -192,8 +229,8 @@ int main(int argc, char *argv []){
 
 		mode = 0;
 		mode = atoi(argv[3]);
-		if(mode != 0 && mode != 1){
-			printf("ERROR: %d is the incorrect mode, it should be omitted or equal to 0 or 1\n", mode);
+		if(mode != 0 && mode != 1 && mode != 2){
+			printf("ERROR: %d is the incorrect mode, it should be omitted or equal to 0, 1 or 2\n", mode);
 			return 0;
 		}
 
@@ -208,6 +245,32 @@ int main(int argc, char *argv []){
 		}
 		omp_set_num_threads(threads);
 
+		//========================================40
+		//		BATCH WIDTH
+		//========================================40
+
+		lanes = BATCH_LANES;
+		if(argc>=6){
+			lanes = atoi(argv[5]);
+		}
+		if(lanes<=0){
+			printf("ERROR: %d is the incorrect number of instances per batch, use numbers > 0\n", lanes);
+			return 0;
+		}
+
+		//========================================40
+		//		OUTPUT
+		//========================================40
+
+		stride = 1;
+		if(argc==8){
+			stride = atoi(argv[7]);
+		}
+		if(stride<=0){
+			printf("ERROR: %d is the incorrect sampling stride, use numbers > 0\n", stride);
+			return 0;
+		}
+
 	}
 
 	time1 = get_time();
@@ -220,7 +283,8 @@ int main(int argc, char *argv []){
 	//		MEMORY CHECK
 	//============================================================60
 
-	memory = workload*(xmax+1)*EQUATIONS*4;
+	rows = argc>=7 ? 2 : xmax+1;														// streaming keeps the current state only
+	memory = workload*rows*EQUATIONS*4;
 	if(memory>1000000000){
 		printf("ERROR: trying to allocate more than 1.0GB of memory, decrease workload and span parameters or change memory parameter\n");
 		return 0;
@@ -230,17 +294,19 @@ int main(int argc, char *argv []){
 	// 	ALLOCATE ARRAYS
 	//============================================================60
 
+	// one block for all states, y[i][j] points into it
+	y_mem = (fp *) malloc((long)workload*rows*EQUATIONS* sizeof(fp));
 	y = (fp ***) malloc(workload* sizeof(fp **));
 	for(i=0; i<workload; i++){
-		y[i] = (fp**)malloc((1+xmax)*sizeof(fp*));
-		for(j=0; j<(1+xmax); j++){
-			y[i][j]= (fp *) malloc(EQUATIONS* sizeof(fp));
+		y[i] = (fp**)malloc(rows*sizeof(fp*));
+		for(j=0; j<rows; j++){
+			y[i][j]= &y_mem[((long)i*rows+j)*EQUATIONS];
 		}
 	}
 
 	x = (fp **) malloc(workload * sizeof(fp *));
 	for (i= 0; i<workload; i++){
-		x[i]= (fp *)malloc((1+xmax) *sizeof(fp));
+		x[i]= (fp *)malloc(rows *sizeof(fp));
 	}
 
 	params = (fp **) malloc(workload * sizeof(fp *));
@@ -248,6 +314,8 @@ int main(int argc, char *argv []){
 		params[i]= (fp *)malloc(PARAMETERS * sizeof(fp));
 	}
 
+	batch_status = (int *) malloc(workload * sizeof(int));
+
 	time2 = get_time();
 
 	//================================================================================80
@@ -272,6 +340,15 @@ int main(int argc, char *argv []){
 					0);
 	}
 
+	// trajectory sink
+	sink = NULL;
+	if(argc>=7){
+		if(sink_open(&trajectory, argv[6], workload, xmax, stride, SINK_DEPTH) != 0){
+			return 0;
+		}
+		sink = &trajectory;
+	}
+
 	time3 = get_time();
 
 	//================================================================================80
@@ -284,9 +361,11 @@ int main(int argc, char *argv []){
 
 			status = solver(	y[i],
 										x[i],
+										rows,
 										xmax,
 										params[i],
-										mode);
+										sink,
+										i);
 
 			// if(status !=0){
 				// printf("STATUS: %d\n", status);
@@ -295,16 +374,42 @@ int main(int argc, char *argv []){
 		}
 
 	}
-	else{
+	else if(mode == 1){
 
 		#pragma omp parallel for private(i, status) shared(y, x, xmax, params, mode)
 		for(i=0; i<workload; i++){
 
 			status = solver(	y[i],
 										x[i],
+										rows,
 										xmax,
 										params[i],
-										mode);
+										sink,
+										i);
+
+			// if(status !=0){
+				// printf("STATUS: %d\n", status);
+			// }
+
+		}
+
+	}
+	else{
+
+		batches = (workload + lanes - 1) / lanes;
+
+		#pragma omp parallel for private(batch, status) shared(y, x, xmax, params, lanes, batch_status) schedule(dynamic)
+		for(batch=0; batch<batches; batch++){
+
+			status = solver_batch(	&y[batch*lanes],
+												&x[batch*lanes],
+												rows,
+												xmax,
+												&params[batch*lanes],
+												min(lanes, workload - batch*lanes),
+												&batch_status[batch*lanes],
+												sink,
+												batch*lanes);
 
 			// if(status !=0){
 				// printf("STATUS: %d\n", status);
@@ -326,6 +431,11 @@ int main(int argc, char *argv []){
 		// }
 	// }
 
+	// drain the writer
+	if(sink != NULL){
+		sink_close(sink);
+	}
+
 	time4 = get_time();
 
 	//================================================================================80
@@ -334,12 +444,10 @@ int main(int argc, char *argv []){
 
 	// y values
 	for (i= 0; i< workload; i++){
-		for (j= 0; j< (1+xmax); j++){
-			free(y[i][j]);
-		}
 		free(y[i]);
 	}
 	free(y);
+	free(y_mem);
 
 	// x values
 	for (i= 0; i< workload; i++){
@@ -353,6 +461,8 @@ int main(int argc, char *argv []){
 	}
 	free(params);
 
+	free(batch_status);
+
 	time5= get_time();
 
 	//================================================================================80
@@ -368,6 +478,10 @@ int main(int argc, char *argv []){
 	printf("Total time:\n");
 	printf("%.12f s\n", 																											(float) (time5-time0) / 1000000);
 
+	getrusage(RUSAGE_SELF, &usage);
+	printf("State memory: %.3f MB (%d time instances per instance), peak resident: %.3f MB\n", (double)workload*rows*(EQUATIONS+1)*sizeof(fp) / 1e6, rows, (double)usage.ru_maxrss / 1e3);
+	printf("Throughput: %.1f simulated ms/s\n", (double)workload*xmax / ((double)(time4-time3) / 1000000));
+
 //====================================================================================================100
 //	END OF FILE
 //====================================================================================================100
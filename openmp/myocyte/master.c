@@ -2,11 +2,17 @@
 //	MAIN FUNCTION
 //=====================================================================
 
-void master(fp timeinst,
+// evaluates all 91 derivatives of lanes instances stored value by value, value i of instance l at [i*lanes+l] (lanes is 1 for
+// a single instance, see batch.c). active flags the instances to evaluate, NULL for all; temp is the workspace of the modules,
+// MODEL_TEMPS values per instance.
+
+void master(fp *timeinst,
 					fp* initvalu,
 					fp* parameter,
 					fp* finavalu,
-					int mode){
+					int lanes,
+					int *active,
+					double *temp){
 
 	//=====================================================================
 	//	VARIABLES
@@ -15,10 +21,12 @@ void master(fp timeinst,
 	// counters
 	int i;
 
-	// intermediate output on host
-	fp JCaDyad;
-	fp JCaSL;
-	fp JCaCyt;
+	// intermediate output on host, per instance
+	double *JCaDyad = &temp[0*lanes];
+	double *JCaSL = &temp[1*lanes];
+	double *JCaCyt = &temp[2*lanes];
+	double *temp_cam = &temp[3*lanes];
+	double *temp_ecc = &temp[4*lanes];
 
 	// offset pointers
 	int initvalu_offset_batch;															//
@@ -31,157 +39,67 @@ void master(fp timeinst,
 	int initvalu_offset_Cyt;																// 15 poitns
 	int parameter_offset_Cyt;
 
-	// module parameters
-	fp CaDyad;																					// from ECC model, *** Converting from [mM] to [uM] ***
-	fp CaSL;																						// from ECC model, *** Converting from [mM] to [uM] ***
-	fp CaCyt;																					// from ECC model, *** Converting from [mM] to [uM] ***
-
-		// thread counters
-		int th_id, nthreads;
-		int th_count[4];
-		int temp;
-
-	//=====================================================================
-	//	KERNELS FOR 1 WORKLOAD - PARALLEL
-	//=====================================================================
-
-	nthreads = omp_get_max_threads();
-
-	if(mode == 0){
-
-		// partition workload between threads
-		temp = 0;
-		for(i=0; i<4; i++){													// do for all 4 pieces of work
-			if(temp>=nthreads){											// limit according to number of threads
-				temp = 0;
-			}
-			th_count[i] = temp;												// assign thread to piece of work
-			temp = temp +1;
-		}
-
-		// run pieces of work in parallel
-		#pragma omp parallel private(th_id)
-		{
-
-			if (th_id == th_count[1]) {
-
-				// ecc function
-				initvalu_offset_ecc = 0;												// 46 points
-				parameter_offset_ecc = 0;
-				ecc(						timeinst,
-											initvalu,
-											initvalu_offset_ecc,
-											parameter,
-											parameter_offset_ecc,
-											finavalu);
-
-			}
-
-			if (th_id == th_count[2]) {
-
-				// cam function for Dyad
-				initvalu_offset_Dyad = 46;											// 15 points
-				parameter_offset_Dyad = 1;
-				CaDyad = initvalu[35]*1e3;											// from ECC model, *** Converting from [mM] to [uM] ***
-				JCaDyad = cam(timeinst,
-											initvalu,
-											initvalu_offset_Dyad,
-											parameter,
-											parameter_offset_Dyad,
-											finavalu,
-											CaDyad);
-
-			}
-
-			if (th_id == th_count[3]) {
-
-				// cam function for SL
-				initvalu_offset_SL = 61;											// 15 points
-				parameter_offset_SL = 6;
-				CaSL = initvalu[36]*1e3;											// from ECC model, *** Converting from [mM] to [uM] ***
-				JCaSL = cam(		timeinst,
-											initvalu,
-											initvalu_offset_SL,
-											parameter,
-											parameter_offset_SL,
-											finavalu,
-											CaSL);
-
-			}
-
-			if (th_id == th_count[4]) {
-
-				// cam function for Cyt
-				initvalu_offset_Cyt = 76;												// 15 poitns
-				parameter_offset_Cyt = 11;
-				CaCyt = initvalu[37]*1e3;											// from ECC model, *** Converting from [mM] to [uM] ***
-				JCaCyt = cam(	timeinst,
-											initvalu,
-											initvalu_offset_Cyt,
-											parameter,
-											parameter_offset_Cyt,
-											finavalu,
-											CaCyt);
-
-			}
-
-		}
-
-	}
-
 	//=====================================================================
-	//	KERNELS FOR MANY WORKLOAD - SERIAL
+	//	KERNELS
 	//=====================================================================
 
-	else{
-
-		// ecc function
-		initvalu_offset_ecc = 0;												// 46 points
-		parameter_offset_ecc = 0;
-		ecc(						timeinst,
-									initvalu,
-									initvalu_offset_ecc,
-									parameter,
-									parameter_offset_ecc,
-									finavalu);
-
-		// cam function for Dyad
-		initvalu_offset_Dyad = 46;											// 15 points
-		parameter_offset_Dyad = 1;
-		CaDyad = initvalu[35]*1e3;											// from ECC model, *** Converting from [mM] to [uM] ***
-		JCaDyad = cam(timeinst,
-									initvalu,
-									initvalu_offset_Dyad,
-									parameter,
-									parameter_offset_Dyad,
-									finavalu,
-									CaDyad);
-
-		// cam function for SL
-		initvalu_offset_SL = 61;											// 15 points
-		parameter_offset_SL = 6;
-		CaSL = initvalu[36]*1e3;											// from ECC model, *** Converting from [mM] to [uM] ***
-		JCaSL = cam(		timeinst,
-									initvalu,
-									initvalu_offset_SL,
-									parameter,
-									parameter_offset_SL,
-									finavalu,
-									CaSL);
-
-		// cam function for Cyt
-		initvalu_offset_Cyt = 76;												// 15 poitns
-		parameter_offset_Cyt = 11;
-		CaCyt = initvalu[37]*1e3;											// from ECC model, *** Converting from [mM] to [uM] ***
-		JCaCyt = cam(	timeinst,
-									initvalu,
-									initvalu_offset_Cyt,
-									parameter,
-									parameter_offset_Cyt,
-									finavalu,
-									CaCyt);
-
-	}
+	// ecc function
+	initvalu_offset_ecc = 0;												// 46 points
+	parameter_offset_ecc = 0;
+	ecc(						timeinst,
+								initvalu,
+								initvalu_offset_ecc,
+								parameter,
+								parameter_offset_ecc,
+								finavalu,
+								lanes,
+								active,
+								temp_ecc);
+
+	// cam function for Dyad
+	initvalu_offset_Dyad = 46;											// 15 points
+	parameter_offset_Dyad = 1;
+	cam(						timeinst,
+								initvalu,
+								initvalu_offset_Dyad,
+								parameter,
+								parameter_offset_Dyad,
+								finavalu,
+								35,																// CaDyad from ECC model, [mM]
+								JCaDyad,
+								lanes,
+								active,
+								temp_cam);
+
+	// cam function for SL
+	initvalu_offset_SL = 61;											// 15 points
+	parameter_offset_SL = 6;
+	cam(						timeinst,
+								initvalu,
+								initvalu_offset_SL,
+								parameter,
+								parameter_offset_SL,
+								finavalu,
+								36,																// CaSL from ECC model, [mM]
+								JCaSL,
+								lanes,
+								active,
+								temp_cam);
+
+	// cam function for Cyt
+	initvalu_offset_Cyt = 76;												// 15 poitns
+	parameter_offset_Cyt = 11;
+	cam(						timeinst,
+								initvalu,
+								initvalu_offset_Cyt,
+								parameter,
+								parameter_offset_Cyt,
+								finavalu,
+								37,																// CaCyt from ECC model, [mM]
+								JCaCyt,
+								lanes,
+								active,
+								temp_cam);
 
 	//=====================================================================
 	//	FINAL KERNEL
@@ -197,14 +115,15 @@ void master(fp timeinst,
 								finavalu,
 								JCaDyad,
 								JCaSL,
-								JCaCyt);
+								JCaCyt,
+								lanes);
 
 	//=====================================================================
 	//	COMPENSATION FOR NANs and INFs
 	//=====================================================================
 
 	// make sure function does not return NANs and INFs
-	for(i=0; i<EQUATIONS; i++){
+	for(i=0; i<EQUATIONS*lanes; i++){
 		if (isnan(finavalu[i]) == 1){ 
 			finavalu[i] = 0.0001;												// for NAN set rate of change to 0.0001
 		}
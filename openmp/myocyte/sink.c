@@ -0,0 +1,245 @@
+//======================================================================================================================================================
+//======================================================================================================================================================
+//		TRAJECTORY SINK
+//======================================================================================================================================================
+//======================================================================================================================================================
+
+// Streams sampled time instances of all instances to a binary file so that the solvers only have to keep the current state. Solver threads
+// copy a record into a ring of depth slots, a writer thread appends the records to the file in the order they arrive, so a record carries
+// its instance and sample number. Time instance k is sampled when k is a multiple of stride, the last time instance xmax is always sampled.
+//
+// File layout (native byte order), read back with trajectory_read:
+//		header:	char magic[8] "MYOTRAJ", int version, fp_bytes, equations, workload, xmax, stride, samples
+//		record:	int instance, int sample, fp x, fp y[equations]								(repeated, any order)
+
+#include <pthread.h>
+
+#define SINK_MAGIC "MYOTRAJ"
+#define SINK_VERSION 1
+
+typedef struct trajectory_sink{
+
+	FILE* fid;
+	int workload;
+	int xmax;
+	int stride;
+	int samples;																	// sampled time instances per instance
+	int depth;																		// records in the ring
+	int record;																		// bytes per record
+	char* ring;
+
+	long long produced;																// records handed over by the solvers
+	long long written;																// records appended to the file
+	int closed;
+
+	double time_write;																// writer busy time
+	double time_wait;																// solver time spent waiting for a free slot
+
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	pthread_t thread;
+
+} trajectory_sink;
+
+//======================================================================================================================================================
+//	SAMPLING
+//======================================================================================================================================================
+
+int sink_samples(	int xmax,
+						int stride){
+
+	return xmax / stride + 1 + (xmax % stride != 0);
+
+}
+
+// sample number of time instance k, -1 if k is not sampled
+
+int sink_sample_of(	trajectory_sink* sink,
+							int k){
+
+	if(k % sink->stride == 0){
+		return k / sink->stride;
+	}
+	if(k == sink->xmax){
+		return sink->samples - 1;
+	}
+	return -1;
+
+}
+
+//======================================================================================================================================================
+//	WRITER THREAD
+//======================================================================================================================================================
+
+void* sink_write(void* arg){
+
+	trajectory_sink* sink = (trajectory_sink*)arg;
+	long long first;
+	long long count;
+	long long slot;
+	long long run;
+	double time0;
+
+	while(1){
+
+		// wait for records
+		pthread_mutex_lock(&sink->lock);
+		while(sink->written == sink->produced && !sink->closed){
+			pthread_cond_wait(&sink->cond, &sink->lock);
+		}
+		first = sink->written;
+		count = sink->produced - sink->written;
+		pthread_mutex_unlock(&sink->lock);
+
+		if(count == 0){
+			break;																		// closed and drained
+		}
+
+		// append all available records, in at most two pieces around the end of the ring
+		time0 = omp_get_wtime();
+		while(count > 0){
+			slot = first % sink->depth;
+			run = sink->depth - slot < count ? sink->depth - slot : count;
+			fwrite(&sink->ring[slot*sink->record], sink->record, run, sink->fid);
+			first = first + run;
+			count = count - run;
+		}
+		sink->time_write = sink->time_write + omp_get_wtime() - time0;
+
+		// hand the slots back
+		pthread_mutex_lock(&sink->lock);
+		sink->written = first;
+		pthread_cond_broadcast(&sink->cond);
+		pthread_mutex_unlock(&sink->lock);
+
+	}
+
+	return NULL;
+
+}
+
+//======================================================================================================================================================
+//	OPEN
+//======================================================================================================================================================
+
+int sink_open(	trajectory_sink* sink,
+					char* filename,
+					int workload,
+					int xmax,
+					int stride,
+					int depth){
+
+	int header[7];
+
+	sink->fid = fopen(filename, "wb");
+	if(sink->fid == NULL){
+		printf("ERROR: the trajectory file %s was not created/opened for writing\n", filename);
+		return -1;
+	}
+
+	sink->workload = workload;
+	sink->xmax = xmax;
+	sink->stride = stride;
+	sink->samples = sink_samples(xmax, stride);
+	sink->depth = depth;
+	sink->record = 2 * sizeof(int) + (1 + EQUATIONS) * sizeof(fp);
+	sink->ring = (char*)malloc((long)depth * sink->record);
+	sink->produced = 0;
+	sink->written = 0;
+	sink->closed = 0;
+	sink->time_write = 0;
+	sink->time_wait = 0;
+
+	header[0] = SINK_VERSION;
+	header[1] = sizeof(fp);
+	header[2] = EQUATIONS;
+	header[3] = workload;
+	header[4] = xmax;
+	header[5] = stride;
+	header[6] = sink->samples;
+	fwrite(SINK_MAGIC, 1, 8, sink->fid);
+	fwrite(header, sizeof(int), 7, sink->fid);
+
+	pthread_mutex_init(&sink->lock, NULL);
+	pthread_cond_init(&sink->cond, NULL);
+	pthread_create(&sink->thread, NULL, sink_write, sink);
+
+	return 0;
+
+}
+
+//======================================================================================================================================================
+//	PUT
+//======================================================================================================================================================
+
+// called by the solvers after every time instance k, does nothing if there is no sink or k is not sampled. Thread-safe
+
+void sink_put(	trajectory_sink* sink,
+					int instance,
+					int k,
+					fp x,
+					fp* y){
+
+	int sample;
+	char* slot;
+	double time0;
+
+	if(sink == NULL){
+		return;
+	}
+	sample = sink_sample_of(sink, k);
+	if(sample < 0){
+		return;
+	}
+
+	pthread_mutex_lock(&sink->lock);
+
+	// wait for a free slot
+	if(sink->produced - sink->written >= sink->depth){
+		time0 = omp_get_wtime();
+		while(sink->produced - sink->written >= sink->depth){
+			pthread_cond_wait(&sink->cond, &sink->lock);
+		}
+		sink->time_wait = sink->time_wait + omp_get_wtime() - time0;
+	}
+
+	slot = &sink->ring[(sink->produced % sink->depth) * sink->record];
+	memcpy(slot, &instance, sizeof(int));
+	memcpy(slot + sizeof(int), &sample, sizeof(int));
+	memcpy(slot + 2 * sizeof(int), &x, sizeof(fp));
+	memcpy(slot + 2 * sizeof(int) + sizeof(fp), y, EQUATIONS * sizeof(fp));
+
+	sink->produced = sink->produced + 1;
+	pthread_cond_broadcast(&sink->cond);
+	pthread_mutex_unlock(&sink->lock);
+
+}
+
+//======================================================================================================================================================
+//	CLOSE
+//======================================================================================================================================================
+
+// drains the ring, closes the file and prints the writer statistics
+
+void sink_close(trajectory_sink* sink){
+
+	long long bytes;
+
+	pthread_mutex_lock(&sink->lock);
+	sink->closed = 1;
+	pthread_cond_broadcast(&sink->cond);
+	pthread_mutex_unlock(&sink->lock);
+
+	pthread_join(sink->thread, NULL);
+	fclose(sink->fid);
+
+	bytes = sink->written * sink->record;
+	printf("Trajectory: %lld records, %.3f MB, stride %d\n", sink->written, (double)bytes / 1e6, sink->stride);
+	printf("Writer busy %.6f s (%.1f MB/s), solvers waited %.6f s for free slots\n",
+			sink->time_write, sink->time_write > 0 ? (double)bytes / 1e6 / sink->time_write : 0.0, sink->time_wait);
+
+	free(sink->ring);
+	pthread_mutex_destroy(&sink->lock);
+	pthread_cond_destroy(&sink->cond);
+
+}
@@ -46,6 +46,8 @@
 
 //	7) The original solver cannot handle cases when equations return NAN and INF values due to discontinuities and /0. That is why equations provided by user need to make sure that no NAN and INF are returned.
 
+//	8) y and x hold rows time instances, time instance k is kept in row k % rows: rows = xmax+1 keeps the whole trajectory, rows = 2 only the current state. Sampled time instances are handed to the trajectory sink (sink.c), if there is one.
+
 //	Last update: 15 DEC 09
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -72,9 +74,11 @@
 
 int solver(	fp** y,
 					fp* x,
+					int rows,
 					int xmax,
 					fp* params,
-					int mode) {
+					trajectory_sink* sink,
+					int instance) {
 
 	//========================================================================================================================
 	//	VARIABLES
@@ -99,6 +103,7 @@ int solver(	fp** y,
 
 	// counters
 	int i, j, k;
+	int prev, next;
 
 	//========================================================================================================================
 	//		INITIAL SETUP
@@ -114,6 +119,7 @@ int solver(	fp** y,
 
 	// save value for initial time instance
 	x[0] = 0;
+	sink_put(sink, instance, 0, x[0], y[0]);
 
 	//========================================================================================================================
 	//		CHECKING
@@ -141,7 +147,9 @@ int solver(	fp** y,
 
 	for(k=1; k<=xmax; k++) {											// start after initial value
 
-		x[k] = k-1;
+		prev = (k-1) % rows;
+		next = k % rows;
+		x[next] = k-1;
 		h = h_init;
 
 		//==========================================================================================
@@ -169,13 +177,12 @@ int solver(	fp** y,
 			//		EVALUATE ALL EQUATIONS
 			//============================================================
 
-			embedded_fehlberg_7_8(	x[k],
+			embedded_fehlberg_7_8(	x[next],
 														h,
-														y[k-1],
-														y[k],
+														y[prev],
+														y[next],
 														err,
-														params,
-														mode);
+														params);
 
 			//============================================================
 			//		IF THERE WAS NO ERROR FOR ANY OF EQUATIONS, SET SCALE AND LEAVE THE LOOP
@@ -196,11 +203,11 @@ int solver(	fp** y,
 			//============================================================
 
 			for(i=0; i<EQUATIONS; i++){
-				if(y[k-1][i] == 0.0){
+				if(y[prev][i] == 0.0){
 					yy[i] = tolerance;
 				}
 				else{
-					yy[i] = fabs(y[k-1][i]);
+					yy[i] = fabs(y[prev][i]);
 				}
 				scale[i] = 0.8 * pow( tolerance * yy[i] / err[i] , err_exponent );
 				if(scale[i]<scale_min){
@@ -235,12 +242,12 @@ int solver(	fp** y,
 			}
 
 			// if instance+step exceeds range limit, limit to that range
-			if ( x[k] + h > (fp)xmax ){
-				h = (fp)xmax - x[k];
+			if ( x[next] + h > (fp)xmax ){
+				h = (fp)xmax - x[next];
 			}
 
 			// if getting closer to range limit, decrease step
-			else if ( x[k] + h + 0.5 * h > (fp)xmax ){
+			else if ( x[next] + h + 0.5 * h > (fp)xmax ){
 				h = 0.5 * h;
 			}
 
@@ -250,7 +257,7 @@ int solver(	fp** y,
 		//		SAVE TIME INSTANCE THAT SOLVER ENDED UP USING
 		//==========================================================================================
 
-		x[k] = x[k] + h;
+		x[next] = x[next] + h;
 
 		//==========================================================================================
 		//		IF MAXIMUM NUMBER OF ATTEMPTS REACHED AND CANNOT GIVE SOLUTION, EXIT PROGRAM WITH ERROR
@@ -260,6 +267,12 @@ int solver(	fp** y,
 			return -1; 
 		}
 
+		//==========================================================================================
+		//		HAND SAMPLED TIME INSTANCES TO THE TRAJECTORY SINK
+		//==========================================================================================
+
+		sink_put(sink, instance, k, x[next], y[next]);
+
 	}
 
 	//========================================================================================================================
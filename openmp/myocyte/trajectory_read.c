@@ -0,0 +1,139 @@
+//====================================================================================================100
+//		TRAJECTORY READER
+//====================================================================================================100
+
+// Reads a trajectory file written by myocyte (see sink.c).
+// 1) File name.
+// 2) Optional: instance to print. Without it only the header and the number of samples found per instance are printed.
+// 3) Optional: equation to print, otherwise all of them.
+// Printed rows are "time value value ...", one per sampled time instance, in time order. Samples that are missing (instance failed) are
+// reported and skipped.
+// Example:
+// trajectory_read trajectory.bin
+// trajectory_read trajectory.bin 5 38
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define fp float
+
+int main(int argc, char *argv []){
+
+	FILE* fid;
+	char magic[8];
+	int header[7];
+	int version, fp_bytes, equations, workload, xmax, stride, samples;
+	int instance, equation;
+	int record_instance, record_sample;
+	int i, k;
+	long long records;
+	int* found;
+	fp* values;																	// x, y[equations] for every sample of the printed instance
+	char* present;
+
+	if(argc<2 || argc>4){
+		printf("usage: trajectory_read <file> [instance] [equation]\n");
+		return 0;
+	}
+
+	fid = fopen(argv[1], "rb");
+	if(fid == NULL){
+		printf("ERROR: the trajectory file %s was not opened for reading\n", argv[1]);
+		return 0;
+	}
+
+	//================================================================================80
+	//		HEADER
+	//================================================================================80
+
+	if(fread(magic, 1, 8, fid) != 8 || strcmp(magic, "MYOTRAJ") != 0 || fread(header, sizeof(int), 7, fid) != 7){
+		printf("ERROR: %s is not a myocyte trajectory file\n", argv[1]);
+		return 0;
+	}
+	version = header[0];
+	fp_bytes = header[1];
+	equations = header[2];
+	workload = header[3];
+	xmax = header[4];
+	stride = header[5];
+	samples = header[6];
+	if(version != 1 || fp_bytes != sizeof(fp)){
+		printf("ERROR: unsupported trajectory file version %d with %d byte values\n", version, fp_bytes);
+		return 0;
+	}
+
+	instance = argc>=3 ? atoi(argv[2]) : -1;
+	equation = argc>=4 ? atoi(argv[3]) : -1;
+	if(instance >= workload || equation >= equations){
+		printf("ERROR: instance %d / equation %d out of range\n", instance, equation);
+		return 0;
+	}
+
+	//================================================================================80
+	//		RECORDS
+	//================================================================================80
+
+	found = (int*)calloc(workload, sizeof(int));
+	values = (fp*)malloc((long)samples * (1 + equations) * sizeof(fp));
+	present = (char*)calloc(samples, 1);
+
+	records = 0;
+	while(fread(&record_instance, sizeof(int), 1, fid) == 1){
+		if(fread(&record_sample, sizeof(int), 1, fid) != 1){
+			break;
+		}
+		if(record_instance < 0 || record_instance >= workload || record_sample < 0 || record_sample >= samples){
+			printf("ERROR: corrupt record %lld\n", records);
+			return 0;
+		}
+		found[record_instance] = found[record_instance] + 1;
+		if(record_instance == instance){
+			if(fread(&values[(long)record_sample * (1 + equations)], sizeof(fp), 1 + equations, fid) != (size_t)(1 + equations)){
+				break;
+			}
+			present[record_sample] = 1;
+		}
+		else{
+			fseek(fid, (1 + equations) * sizeof(fp), SEEK_CUR);
+		}
+		records = records + 1;
+	}
+	fclose(fid);
+
+	//================================================================================80
+	//		PRINT
+	//================================================================================80
+
+	if(instance < 0){
+		printf("%d instances, %d equations, xmax %d, stride %d, %d samples per instance, %lld records\n",
+				workload, equations, xmax, stride, samples, records);
+		for(i=0; i<workload; i++){
+			if(found[i] != samples){
+				printf("instance %d: %d of %d samples\n", i, found[i], samples);
+			}
+		}
+	}
+	else{
+		for(k=0; k<samples; k++){
+			if(!present[k]){
+				printf("# sample %d missing\n", k);
+				continue;
+			}
+			printf("%f", values[(long)k * (1 + equations)]);
+			for(i=0; i<equations; i++){
+				if(equation < 0 || equation == i){
+					printf(" %f", values[(long)k * (1 + equations) + 1 + i]);
+				}
+			}
+			printf("\n");
+		}
+	}
+
+	free(found);
+	free(values);
+	free(present);
+
+	return 0;
+
+}
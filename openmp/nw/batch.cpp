@@ -0,0 +1,412 @@
+////////////////////////////////////////////////////////////////////////////////
+// Inter-sequence batch mode
+//
+// Many short pairs are read from a FASTA file (records taken two at a time)
+// and aligned NW_LANES at a time, one pair per SIMD lane: the DP row is
+// stored interleaved by lane as 16-bit saturating scores, so every cell
+// update is a few vector adds/maxes over all lanes (SSE2, 8 lanes per
+// register; other targets use an omp simd loop clamped to the short range). Pairs are sorted by
+// size so a batch pads little, batches are spread over threads. A lane whose
+// own cells or borders touch the clamp is redone with the 32-bit linear engine.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define NW_LANES 16                 // default pairs per batch
+#define NW_PAD 23                   // '*', residue of padding cells
+#define NW_TBL 32                   // row stride of the 16-bit blosum62 copy
+
+struct nw_pair
+{
+    char *a, *b;
+    int alen, blen;
+    int score;
+    int saturated;
+    char *ops;
+    long nops;
+};
+
+// blosum62 index of a residue letter, unknown letters score as 'X'
+int nw_residue(int c)
+{
+    const char *order = "ARNDCQEGHILKMFPSTWYVBZX*";
+    const char *p = strchr(order, c >= 'a' && c <= 'z' ? c - 'a' + 'A' : c);
+    return (p && c) ? (int)(p - order) : 22;
+}
+
+// reads every record of a FASTA file as residue indices, returns the number of records
+int nw_read_fasta(const char *path, char ***seqs, int **lens)
+{
+    FILE *fp = fopen(path, "r");
+    if (!fp)
+    {
+        fprintf(stderr, "error: can not open %s\n", path);
+        exit(1);
+    }
+
+    int count = 0, cap = 0;
+    long len = 0, len_cap = 0;
+    char *cur = NULL;
+    char line[4096];
+    *seqs = NULL;
+    *lens = NULL;
+
+    while (fgets(line, sizeof(line), fp))
+    {
+        if (line[0] == '>')
+        {
+            if (count == cap)
+            {
+                cap = cap ? 2*cap : 1024;
+                *seqs = (char **)realloc(*seqs, cap*sizeof(char *));
+                *lens = (int *)realloc(*lens, cap*sizeof(int));
+            }
+            len_cap = 256;
+            cur = (char *)malloc(len_cap);
+            (*seqs)[count] = cur;
+            (*lens)[count] = 0;
+            len = 0;
+            count++;
+            continue;
+        }
+        if (!cur)
+            continue;
+        for (char *c = line; *c; ++c)
+        {
+            if (*c == '\n' || *c == '\r' || *c == ' ' || *c == '\t')
+                continue;
+            if (len == len_cap)
+            {
+                len_cap = 2*len_cap;
+                cur = (char *)realloc(cur, len_cap);
+                (*seqs)[count - 1] = cur;
+            }
+            cur[len++] = nw_residue(*c);
+            (*lens)[count - 1] = len;
+        }
+    }
+
+    fclose(fp);
+    return count;
+}
+
+// aligns up to L pairs at once, pairs beyond n are empty lanes
+template <int L>
+void nw_batch_kernel(nw_pair **pairs, int n, int penalty, int traceback, const short *tbl)
+{
+    int alen[L], blen[L];
+    int maxA = 0, maxB = 0;
+    for (int l = 0; l < L; ++l)
+    {
+        alen[l] = l < n ? pairs[l]->alen : 0;
+        blen[l] = l < n ? pairs[l]->blen : 0;
+        maxA = alen[l] > maxA ? alen[l] : maxA;
+        maxB = blen[l] > maxB ? blen[l] : maxB;
+    }
+
+    // column residues interleaved by lane, padded with '*'
+    unsigned char *bres = (unsigned char *)malloc( (long)(maxB + 1)*L );
+    for (int j = 0; j < maxB; ++j)
+        for (int l = 0; l < L; ++l)
+            bres[(long)j*L + l] = j < blen[l] ? pairs[l]->b[j] : NW_PAD;
+
+    short *H = (short *)malloc( (long)(maxB + 1)*L*sizeof(short) );
+    unsigned char *dir = traceback ? (unsigned char *)malloc( (long)maxA*maxB*L + 1 ) : NULL;
+    short diag[L] __attribute__ ((aligned (64)));
+    short aoff[L] __attribute__ ((aligned (64)));
+    short hi[L] __attribute__ ((aligned (64)));
+    short lo[L] __attribute__ ((aligned (64)));
+    short alim[L] __attribute__ ((aligned (64)));
+    short blim[L] __attribute__ ((aligned (64)));
+    int score[L];
+
+    for (int j = 0; j <= maxB; ++j)
+    {
+        int v = -j*penalty < SHRT_MIN ? SHRT_MIN : -j*penalty;
+        for (int l = 0; l < L; ++l)
+            H[(long)j*L + l] = v;
+    }
+    // extremes of the cells inside each lane's own alen x blen rectangle, the
+    // padding beyond it is ignored; the clamped borders are checked at the end
+    for (int l = 0; l < L; ++l)
+    {
+        hi[l] = 0;
+        lo[l] = 0;
+        alim[l] = alen[l] < SHRT_MAX ? alen[l] : SHRT_MAX;
+        blim[l] = blen[l] < SHRT_MAX ? blen[l] : SHRT_MAX;
+        score[l] = H[(long)blen[l]*L + l];
+    }
+
+    for (int i = 1; i <= maxA; ++i)
+    {
+        int first = -i*penalty < SHRT_MIN ? SHRT_MIN : -i*penalty;
+        for (int l = 0; l < L; ++l)
+        {
+            aoff[l] = (i <= alen[l] ? pairs[l]->a[i - 1] : NW_PAD)*NW_TBL;
+            diag[l] = H[l];
+            H[l] = first;
+        }
+
+
+#ifdef __SSE2__
+        // lanes are independent, so each group of 8 (one register) sweeps the whole row with its
+        // diagonal and clamp detection kept in registers; saturating adds pin overflowing lanes.
+        // The per-lane substitution scores are inserted straight from the lanes' blosum62 rows.
+        for (int c = 0; c < L; c += 8)
+        {
+            __m128i vp = _mm_set1_epi16(penalty);
+            __m128i vblim = _mm_load_si128((const __m128i *)&blim[c]);
+            __m128i row_out = _mm_cmpgt_epi16(_mm_set1_epi16(i < SHRT_MAX ? i : SHRT_MAX), _mm_load_si128((const __m128i *)&alim[c]));
+            int jin = blim[c];
+            for (int l = c + 1; l < c + 8; ++l)
+                jin = blim[l] < jin ? blim[l] : jin;
+            __m128i dg = _mm_load_si128((const __m128i *)&diag[c]);
+            __m128i vhi = _mm_load_si128((const __m128i *)&hi[c]);
+            __m128i vlo = _mm_load_si128((const __m128i *)&lo[c]);
+            __m128i e = _mm_subs_epi16(_mm_load_si128((const __m128i *)&H[c]), vp);
+            const short *t0 = &tbl[aoff[c]], *t1 = &tbl[aoff[c + 1]], *t2 = &tbl[aoff[c + 2]], *t3 = &tbl[aoff[c + 3]];
+            const short *t4 = &tbl[aoff[c + 4]], *t5 = &tbl[aoff[c + 5]], *t6 = &tbl[aoff[c + 6]], *t7 = &tbl[aoff[c + 7]];
+            for (int j = 1; j <= maxB; ++j)
+            {
+                short *h = &H[(long)j*L + c];
+                __m128i up = _mm_load_si128((const __m128i *)h);
+                const unsigned char *r = &bres[(long)(j - 1)*L + c];
+                __m128i sv = _mm_cvtsi32_si128(t0[r[0]]);
+                sv = _mm_insert_epi16(sv, t1[r[1]], 1);
+                sv = _mm_insert_epi16(sv, t2[r[2]], 2);
+                sv = _mm_insert_epi16(sv, t3[r[3]], 3);
+                sv = _mm_insert_epi16(sv, t4[r[4]], 4);
+                sv = _mm_insert_epi16(sv, t5[r[5]], 5);
+                sv = _mm_insert_epi16(sv, t6[r[6]], 6);
+                sv = _mm_insert_epi16(sv, t7[r[7]], 7);
+                __m128i d = _mm_adds_epi16(dg, sv);
+                __m128i u = _mm_subs_epi16(up, vp);
+                __m128i v = _mm_max_epi16(d, _mm_max_epi16(u, e));
+                if (dir)
+                {
+                    // 0 = diagonal, 1 = up (consume a), 2 = left (consume b), same preference as nw_full
+                    __m128i is_u = _mm_and_si128(_mm_cmpeq_epi16(v, u), _mm_set1_epi16(1));
+                    __m128i st = _mm_andnot_si128(_mm_cmpeq_epi16(v, d), _mm_sub_epi16(_mm_set1_epi16(2), is_u));
+                    _mm_storel_epi64((__m128i *)&dir[((long)(i - 1)*maxB + j - 1)*L + c], _mm_packus_epi16(st, st));
+                }
+                _mm_store_si128((__m128i *)h, v);
+                // cells outside the lane's rectangle count as 0, columns up to jin are inside for all 8
+                __m128i out = j <= jin ? row_out :
+                              _mm_or_si128(row_out, _mm_cmpgt_epi16(_mm_set1_epi16(j < SHRT_MAX ? j : SHRT_MAX), vblim));
+                __m128i in = _mm_andnot_si128(out, v);
+                vhi = _mm_max_epi16(vhi, in);
+                vlo = _mm_min_epi16(vlo, in);
+                dg = up;
+                e = _mm_subs_epi16(v, vp);
+            }
+            _mm_store_si128((__m128i *)&hi[c], vhi);
+            _mm_store_si128((__m128i *)&lo[c], vlo);
+        }
+#else
+        short *S = (short *)malloc( (long)(maxB + 1)*L*sizeof(short) );
+        unsigned char step[L] __attribute__ ((aligned (64)));
+
+        // substitution scores of the whole row, the per-lane table lookup does not vectorize
+        for (int j = 0; j < maxB; ++j)
+            for (int l = 0; l < L; ++l)
+                S[(long)j*L + l] = tbl[aoff[l] + bres[(long)j*L + l]];
+
+        for (int j = 1; j <= maxB; ++j)
+        {
+            short *h = &H[(long)j*L];
+            const short *w = &H[(long)(j - 1)*L];
+            const short *sub = &S[(long)(j - 1)*L];
+            unsigned char *t = dir ? &dir[((long)(i - 1)*maxB + j - 1)*L] : NULL;
+#pragma omp simd
+            for (int l = 0; l < L; ++l)
+            {
+                int d = diag[l] + sub[l];
+                int u = h[l] - penalty;
+                int e = w[l] - penalty;
+                int v = d >= u ? (d >= e ? d : e) : (u >= e ? u : e);
+                // 0 = diagonal, 1 = up (consume a), 2 = left (consume b), same preference as nw_full
+                step[l] = v == d ? 0 : (v == u ? 1 : 2);
+                v = v > SHRT_MAX ? SHRT_MAX : (v < SHRT_MIN ? SHRT_MIN : v);
+                diag[l] = h[l];
+                h[l] = v;
+                // cells outside the lane's rectangle count as 0
+                v = i <= alen[l] && j <= blen[l] ? v : 0;
+                hi[l] = v > hi[l] ? v : hi[l];
+                lo[l] = v < lo[l] ? v : lo[l];
+            }
+            if (t)
+                memcpy(t, step, L);
+        }
+        free(S);
+#endif
+
+        for (int l = 0; l < L; ++l)
+            if (i == alen[l])
+                score[l] = H[(long)blen[l]*L + l];
+    }
+
+    for (int l = 0; l < n; ++l)
+    {
+        nw_pair *p = pairs[l];
+        p->score = score[l];
+        // the first row and column are -j*penalty and -i*penalty, clamped beyond -SHRT_MIN
+        p->saturated = hi[l] >= SHRT_MAX || lo[l] <= SHRT_MIN ||
+                       (long)p->alen*penalty >= -SHRT_MIN || (long)p->blen*penalty >= -SHRT_MIN;
+        if (!traceback || p->saturated)
+            continue;
+
+        // walk the direction bytes of this lane back from the corner
+        p->ops = (char *)malloc( (long)p->alen + p->blen + 1 );
+        p->nops = 0;
+        int i = p->alen, j = p->blen;
+        while (i > 0 || j > 0)
+        {
+            int step = i == 0 ? 2 : (j == 0 ? 1 : dir[((long)(i - 1)*maxB + j - 1)*L + l]);
+            p->ops[p->nops++] = step == 0 ? 'M' : (step == 1 ? 'D' : 'I');
+            if (step != 2) i--;
+            if (step != 1) j--;
+        }
+        for (long x = 0, y = p->nops - 1; x < y; ++x, --y)
+        {
+            char c = p->ops[x]; p->ops[x] = p->ops[y]; p->ops[y] = c;
+        }
+    }
+
+    free(bres);
+    free(H);
+    free(dir);
+}
+
+int nw_pair_cmp(const void *x, const void *y)
+{
+    const nw_pair *p = *(const nw_pair **)x;
+    const nw_pair *q = *(const nw_pair **)y;
+    long long cp = (long long)p->alen*p->blen, cq = (long long)q->alen*q->blen;
+    if (cp != cq)
+        return cp < cq ? 1 : -1;
+    return p->alen != q->alen ? q->alen - p->alen : q->blen - p->blen;
+}
+
+// aligns every pair of a FASTA file in SIMD batches, then again one pair at a time
+// with the tiled single-pair engine, and compares scores and GCUPS
+void nw_batch(const char *path, int penalty, int lanes, int traceback)
+{
+    char **seqs;
+    int *lens;
+    int count = nw_read_fasta(path, &seqs, &lens);
+    if (count < 2 || count % 2)
+    {
+        fprintf(stderr, "error: %s must hold an even number (>= 2) of records, read as pairs\n", path);
+        exit(1);
+    }
+
+    int npairs = count/2;
+    nw_pair *pairs = (nw_pair *)calloc(npairs, sizeof(nw_pair));
+    nw_pair **order = (nw_pair **)malloc(npairs*sizeof(nw_pair *));
+    double cells = 0;
+    for (int k = 0; k < npairs; ++k)
+    {
+        pairs[k].a = seqs[2*k];
+        pairs[k].alen = lens[2*k];
+        pairs[k].b = seqs[2*k + 1];
+        pairs[k].blen = lens[2*k + 1];
+        order[k] = &pairs[k];
+        cells += (double)pairs[k].alen*pairs[k].blen;
+    }
+    qsort(order, npairs, sizeof(nw_pair *), nw_pair_cmp);
+
+    // 16-bit copy of blosum62, rows padded to NW_TBL
+    short tbl[24*NW_TBL];
+    for (int r = 0; r < 24; ++r)
+        for (int c = 0; c < NW_TBL; ++c)
+            tbl[r*NW_TBL + c] = c < 24 ? blosum62[r][c] : 0;
+
+    printf("Batch of %d pairs, %d lanes, %.0f cells\n", npairs, lanes, cells);
+
+    int nbatch = (npairs + lanes - 1)/lanes;
+    long long start_time = get_time();
+#ifdef OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (int bt = 0; bt < nbatch; ++bt)
+    {
+        int n = npairs - bt*lanes < lanes ? npairs - bt*lanes : lanes;
+        if (lanes == 8)
+            nw_batch_kernel<8>(&order[bt*lanes], n, penalty, traceback, tbl);
+        else if (lanes == 16)
+            nw_batch_kernel<16>(&order[bt*lanes], n, penalty, traceback, tbl);
+        else
+            nw_batch_kernel<32>(&order[bt*lanes], n, penalty, traceback, tbl);
+    }
+
+    // lanes that hit the 16-bit clamp are redone in 32 bits, largest first (the sort order)
+    int redone = 0;
+#ifdef OPENMP
+#pragma omp parallel for schedule(dynamic) reduction(+: redone)
+#endif
+    for (int k = 0; k < npairs; ++k)
+    {
+        nw_pair *p = order[k];
+        if (!p->saturated)
+            continue;
+        int *row = (int *)malloc( (p->blen + 1)*sizeof(int) );
+        nw_last_row(p->a, 1, p->alen, p->b, 1, p->blen, penalty, NW_TILE, row);
+        p->score = row[p->blen];
+        free(row);
+        if (traceback)
+        {
+            p->ops = (char *)malloc( (long)p->alen + p->blen + 1 );
+            p->nops = 0;
+            nw_hirschberg(p->a, p->alen, p->b, p->blen, penalty, NW_TILE, p->ops, &p->nops);
+        }
+        redone++;
+    }
+    long long end_time = get_time();
+    double batch_seconds = (double)(end_time - start_time)/(1000*1000);
+
+    // reference: the same pairs one at a time through the tiled single-pair engine
+    int mismatches = 0;
+    start_time = get_time();
+    for (int k = 0; k < npairs; ++k)
+    {
+        int *row = (int *)malloc( (pairs[k].blen + 1)*sizeof(int) );
+        nw_last_row(pairs[k].a, 1, pairs[k].alen, pairs[k].b, 1, pairs[k].blen, penalty, NW_TILE, row);
+        if (row[pairs[k].blen] != pairs[k].score)
+            mismatches++;
+        free(row);
+    }
+    end_time = get_time();
+    double single_seconds = (double)(end_time - start_time)/(1000*1000);
+
+    printf("Batch time: %.3f seconds, %.3f GCUPS (%d pairs redone in 32 bits)\n", batch_seconds, cells/batch_seconds*1e-9, redone);
+    printf("Single-pair time: %.3f seconds, %.3f GCUPS\n", single_seconds, cells/single_seconds*1e-9);
+    printf("Speedup: %.2fx, score mismatches: %d\n", single_seconds/batch_seconds, mismatches);
+
+    FILE *fpo = fopen("result.txt","w");
+    for (int k = 0; k < npairs; ++k)
+    {
+        fprintf(fpo, "%d %d", k, pairs[k].score);
+        if (traceback)
+        {
+            if (nw_path_score(pairs[k].a, pairs[k].b, pairs[k].ops, pairs[k].nops, penalty) != pairs[k].score)
+                mismatches++;
+            fprintf(fpo, " ");
+            nw_write_path(fpo, pairs[k].ops, pairs[k].nops);
+            free(pairs[k].ops);
+        }
+        else
+            fprintf(fpo, "\n");
+    }
+    fclose(fpo);
+    if (traceback)
+        printf("Tracebacks checked, total mismatches: %d\n", mismatches);
+
+    for (int k = 0; k < count; ++k)
+        free(seqs[k]);
+    free(seqs);
+    free(lens);
+    free(pairs);
+    free(order);
+}
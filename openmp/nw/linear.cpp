@@ -0,0 +1,253 @@
+////////////////////////////////////////////////////////////////////////////////
+// Linear-memory Needleman-Wunsch
+//
+// Scores straight from the two residue sequences and blosum62, no (n+1)^2
+// reference/score matrices. The DP matrix is swept in tiles by the tile
+// scheduler keeping only the bottom row of every tile column and the right
+// column of every tile row, O(n+m) ints: a tile only overwrites boundaries
+// that nothing but itself still has to read. The alignment is recovered
+// with Hirschberg's divide and conquer on those last-row sweeps, leaves are
+// solved with a small full matrix.
+////////////////////////////////////////////////////////////////////////////////
+
+#define NW_TILE 256                 // default tile edge of the linear engine
+#define NW_SERIAL_CELLS (1 << 20)   // sub-problems below this are swept by one thread as one tile
+#define NW_BASE_CELLS (1 << 16)     // Hirschberg leaves solved with a full matrix
+
+// sweep one tile in place: top holds H[r0][c0..c0+w] and becomes H[r0+h][c0..c0+w],
+// left holds H[r0+1..r0+h][c0] and becomes H[r0+1..r0+h][c0+w]
+void nw_tile(const char *a, int astep, const char *b, int bstep,
+        int r0, int h, int c0, int w, int penalty, int *top, int *left)
+{
+    for ( int i = 0; i < h; ++i )
+    {
+        const int *s = blosum62[(int)a[(long)(r0 + i)*astep]];
+        int diag = top[0];
+        top[0] = left[i];
+        for ( int x = 1; x <= w; ++x )
+        {
+            int up = top[x];
+            top[x] = maximum( diag + s[(int)b[(long)(c0 + x - 1)*bstep]],
+                    top[x - 1] - penalty,
+                    up - penalty);
+            diag = up;
+        }
+        left[i] = top[w];
+    }
+}
+
+struct nw_sweep
+{
+    const char *a, *b;
+    int astep, bstep, alen, blen;
+    int th, tw, penalty;
+    int *top, *left;
+};
+
+void nw_sweep_tile(int bi, int bj, void *arg)
+{
+    nw_sweep *s = (nw_sweep *)arg;
+    int h = s->alen - bi*s->th < s->th ? s->alen - bi*s->th : s->th;
+    int w = s->blen - bj*s->tw < s->tw ? s->blen - bj*s->tw : s->tw;
+    nw_tile(s->a, s->astep, s->b, s->bstep, bi*s->th, h, bj*s->tw, w, s->penalty,
+            &s->top[(long)bj*(s->tw + 1)], &s->left[(long)bi*s->th]);
+}
+
+// last row H[alen][0..blen] of the global alignment of a against b, the
+// sequences are read as a[i*astep] and b[j*bstep] so that a negative step
+// sweeps them backwards
+void nw_last_row(const char *a, int astep, int alen, const char *b, int bstep, int blen,
+        int penalty, int tile, int *row)
+{
+    int th = tile, tw = tile;
+    if ( (long long)alen*blen < NW_SERIAL_CELLS )
+    {
+        th = alen > 0 ? alen : 1;
+        tw = blen > 0 ? blen : 1;
+    }
+    int ntr = (alen + th - 1)/th;
+    int ntc = (blen + tw - 1)/tw;
+
+    int *top = (int *)malloc( (long)ntc*(tw + 1)*sizeof(int) );
+    int *left = (int *)malloc( (long)(ntr > 0 ? ntr : 1)*th*sizeof(int) );
+
+    for ( int bj = 0; bj < ntc; ++bj )
+        for ( int x = 0; x <= tw; ++x )
+            top[(long)bj*(tw + 1) + x] = -(bj*tw + x)*penalty;
+    for ( int i = 0; i < ntr*th; ++i )
+        left[i] = -(i + 1)*penalty;
+
+    nw_sweep sweep = { a, b, astep, bstep, alen, blen, th, tw, penalty, top, left };
+    nw_tile_graph(ntr, ntc, nw_sweep_tile, &sweep);
+
+    row[0] = -alen*penalty;
+    for ( int j = 1; j <= blen; ++j )
+        row[j] = -j*penalty;
+    for ( int bj = 0; bj < ntc && alen > 0; ++bj )
+    {
+        int w = blen - bj*tw < tw ? blen - bj*tw : tw;
+        for ( int x = 0; x <= w; ++x )
+            row[bj*tw + x] = top[(long)bj*(tw + 1) + x];
+    }
+
+    free(top);
+    free(left);
+}
+
+// full-matrix alignment of a small sub-problem, ops are appended in path order:
+// 'M' consumes a and b, 'D' consumes a only, 'I' consumes b only
+void nw_full(const char *a, int alen, const char *b, int blen, int penalty, char *ops, long *nops)
+{
+    int cols = blen + 1;
+    int *H = (int *)malloc( (long)(alen + 1)*cols*sizeof(int) );
+
+    for ( int j = 0; j <= blen; ++j )
+        H[j] = -j*penalty;
+    for ( int i = 1; i <= alen; ++i )
+    {
+        const int *s = blosum62[(int)a[i - 1]];
+        H[(long)i*cols] = -i*penalty;
+        for ( int j = 1; j <= blen; ++j )
+            H[(long)i*cols + j] = maximum( H[(long)(i - 1)*cols + j - 1] + s[(int)b[j - 1]],
+                    H[(long)i*cols + j - 1] - penalty,
+                    H[(long)(i - 1)*cols + j] - penalty);
+    }
+
+    // walk back from the corner, then reverse the ops of this leaf
+    long start = *nops;
+    int i = alen, j = blen;
+    while ( i > 0 || j > 0 )
+    {
+        if ( i > 0 && j > 0 && H[(long)i*cols + j] == H[(long)(i - 1)*cols + j - 1] + blosum62[(int)a[i - 1]][(int)b[j - 1]] )
+        {
+            ops[(*nops)++] = 'M'; i--; j--;
+        }
+        else if ( i > 0 && H[(long)i*cols + j] == H[(long)(i - 1)*cols + j] - penalty )
+        {
+            ops[(*nops)++] = 'D'; i--;
+        }
+        else
+        {
+            ops[(*nops)++] = 'I'; j--;
+        }
+    }
+    for ( long l = start, r = *nops - 1; l < r; ++l, --r )
+    {
+        char t = ops[l]; ops[l] = ops[r]; ops[r] = t;
+    }
+
+    free(H);
+}
+
+// Hirschberg: split a in half, find where an optimal path crosses the middle
+// row from a forward and a backward last-row sweep, recurse on both quadrants
+void nw_hirschberg(const char *a, int alen, const char *b, int blen, int penalty, int tile,
+        char *ops, long *nops)
+{
+    if ( alen == 0 || blen == 0 || alen == 1 || (long long)(alen + 1)*(blen + 1) <= NW_BASE_CELLS )
+    {
+        nw_full(a, alen, b, blen, penalty, ops, nops);
+        return;
+    }
+
+    int mid = alen/2;
+    int *fwd = (int *)malloc( (blen + 1)*sizeof(int) );
+    int *bwd = (int *)malloc( (blen + 1)*sizeof(int) );
+
+    nw_last_row(a, 1, mid, b, 1, blen, penalty, tile, fwd);
+    nw_last_row(a + alen - 1, -1, alen - mid, b + blen - 1, -1, blen, penalty, tile, bwd);
+
+    int split = 0;
+    long long best = (long long)fwd[0] + bwd[blen];
+    for ( int k = 1; k <= blen; ++k )
+    {
+        if ( (long long)fwd[k] + bwd[blen - k] > best )
+        {
+            best = (long long)fwd[k] + bwd[blen - k];
+            split = k;
+        }
+    }
+
+    free(fwd);
+    free(bwd);
+
+    nw_hirschberg(a, mid, b, split, penalty, tile, ops, nops);
+    nw_hirschberg(a + mid, alen - mid, b + split, blen - split, penalty, tile, ops, nops);
+}
+
+// score of an alignment path, to check the traceback against the sweep
+long long nw_path_score(const char *a, const char *b, const char *ops, long nops, int penalty)
+{
+    long long score = 0;
+    int i = 0, j = 0;
+    for ( long k = 0; k < nops; ++k )
+    {
+        if ( ops[k] == 'M' )
+            score += blosum62[(int)a[i++]][(int)b[j++]];
+        else if ( ops[k] == 'D' )
+        {
+            score -= penalty; i++;
+        }
+        else
+        {
+            score -= penalty; j++;
+        }
+    }
+    return score;
+}
+
+// run-length encoded path, e.g. 12M1I3M
+void nw_write_path(FILE *fpo, const char *ops, long nops)
+{
+    long run = 0;
+    for ( long k = 0; k < nops; ++k )
+    {
+        run++;
+        if ( k == nops - 1 || ops[k + 1] != ops[k] )
+        {
+            fprintf(fpo, "%ld%c", run, ops[k]);
+            run = 0;
+        }
+    }
+    fprintf(fpo, "\n");
+}
+
+// score (and with traceback set, Hirschberg alignment) of two sequences in O(n+m) memory
+void nw_linear(const char *a, int alen, const char *b, int blen, int penalty, int tile, int traceback)
+{
+    int *row = (int *)malloc( (blen + 1)*sizeof(int) );
+
+    printf("Linear-memory sweep, tile %d\n", tile);
+    long long start_time = get_time();
+    nw_last_row(a, 1, alen, b, 1, blen, penalty, tile, row);
+    long long end_time = get_time();
+
+    double cells = (double)alen*blen;
+    double seconds = (double)(end_time - start_time)/(1000*1000);
+    int score = row[blen];
+    printf("Score: %d\n", score);
+    printf("Score time: %.3f seconds, %.3f GCUPS\n", seconds, cells/seconds*1e-9);
+    free(row);
+
+    if ( !traceback )
+        return;
+
+    char *ops = (char *)malloc( (long)alen + blen );
+    long nops = 0;
+
+    start_time = get_time();
+    nw_hirschberg(a, alen, b, blen, penalty, tile, ops, &nops);
+    end_time = get_time();
+
+    seconds = (double)(end_time - start_time)/(1000*1000);
+    printf("Traceback time: %.3f seconds, %.3f GCUPS (alignment cells / time)\n", seconds, cells/seconds*1e-9);
+    printf("Path length %ld, path score %s the sweep\n", nops,
+            nw_path_score(a, b, ops, nops, penalty) == score ? "matches" : "DOES NOT MATCH");
+
+    FILE *fpo = fopen("result.txt","w");
+    fprintf(fpo, "score %d\n", score);
+    nw_write_path(fpo, ops, nops);
+    fclose(fpo);
+
+    free(ops);
+}
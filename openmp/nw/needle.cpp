@@ -4,8 +4,10 @@
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
+#include <limits.h>
 #include <sys/time.h>
 #include <omp.h>
+#include "../../common/omp_rt.h"
 #define OPENMP
 //#define NUM_THREAD 4
 
@@ -74,6 +76,10 @@ int blosum62[24][24] = {
 {-4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4,  1}
 };
 
+#include "tiles.cpp"
+#include "linear.cpp"
+#include "batch.cpp"
+
 double gettime() {
   struct timeval t;
   gettimeofday(&t,NULL);
@@ -93,13 +99,103 @@ main( int argc, char** argv)
 
 void usage(int argc, char **argv)
 {
-	fprintf(stderr, "Usage: %s <max_rows/max_cols> <penalty> <num_threads>\n", argv[0]);
+	fprintf(stderr, "Usage: %s <max_rows/max_cols> <penalty> <num_threads> [mode] [tile]\n", argv[0]);
 	fprintf(stderr, "\t<dimension>      - x and y dimensions\n");
 	fprintf(stderr, "\t<penalty>        - penalty(positive integer)\n");
 	fprintf(stderr, "\t<num_threads>    - no. of threads\n");
+	fprintf(stderr, "\t[mode]           - full (default, (n+1)^2 matrices, one parallel loop per block diagonal), tasks ((n+1)^2 matrices, tile tasks),\n");
+	fprintf(stderr, "\t                   linear (O(n) memory + Hirschberg traceback) or score (O(n) memory, score only)\n");
+	fprintf(stderr, "\t[tile]           - tile edge of the tasks and linear modes (default %d)\n", NW_TILE);
+	fprintf(stderr, "   or: %s -batch <pairs.fasta> <penalty> <num_threads> [lanes] [traceback]\n", argv[0]);
+	fprintf(stderr, "\t<pairs.fasta>    - records aligned two at a time (1st vs 2nd, 3rd vs 4th, ...)\n");
+	fprintf(stderr, "\t[lanes]          - pairs per SIMD batch, 8, 16 or 32 (default %d)\n", NW_LANES);
+	fprintf(stderr, "\t[traceback]      - 1 to write the alignment of every pair (default 0)\n");
 	exit(1);
 }
 
+#ifdef OMP_OFFLOAD
+#pragma omp declare target
+#endif
+// one tile of nw_optimized, computed in local copies
+void nw_block(int *input_itemsets, int *referrence, int max_cols, int penalty,
+        int b_index_x, int b_index_y)
+{
+    int input_itemsets_l[(BLOCK_SIZE + 1) *(BLOCK_SIZE+1)] __attribute__ ((aligned (64)));
+    int reference_l[BLOCK_SIZE * BLOCK_SIZE] __attribute__ ((aligned (64)));
+
+    // Copy referrence to local memory
+    for ( int i = 0; i < BLOCK_SIZE; ++i )
+    {
+#pragma omp simd
+        for ( int j = 0; j < BLOCK_SIZE; ++j)
+        {
+            reference_l[i*BLOCK_SIZE + j] = referrence[max_cols*(b_index_y*BLOCK_SIZE + i + 1) + b_index_x*BLOCK_SIZE +  j + 1];
+        }
+    }
+
+    // Copy input_itemsets to local memory
+    for ( int i = 0; i < BLOCK_SIZE + 1; ++i )
+    {
+#pragma omp simd
+        for ( int j = 0; j < BLOCK_SIZE + 1; ++j)
+        {
+            input_itemsets_l[i*(BLOCK_SIZE + 1) + j] = input_itemsets[max_cols*(b_index_y*BLOCK_SIZE + i) + b_index_x*BLOCK_SIZE +  j];
+        }
+    }
+
+    // Compute
+    for ( int i = 1; i < BLOCK_SIZE + 1; ++i )
+    {
+        for ( int j = 1; j < BLOCK_SIZE + 1; ++j)
+        {
+            input_itemsets_l[i*(BLOCK_SIZE + 1) + j] = maximum( input_itemsets_l[(i - 1)*(BLOCK_SIZE + 1) + j - 1] + reference_l[(i - 1)*BLOCK_SIZE + j - 1],
+                    input_itemsets_l[i*(BLOCK_SIZE + 1) + j - 1] - penalty,
+                    input_itemsets_l[(i - 1)*(BLOCK_SIZE + 1) + j] - penalty);
+        }
+    }
+
+    // Copy results to global memory
+    for ( int i = 0; i < BLOCK_SIZE; ++i )
+    {
+#pragma omp simd
+        for ( int j = 0; j < BLOCK_SIZE; ++j)
+        {
+            input_itemsets[max_cols*(b_index_y*BLOCK_SIZE + i + 1) + b_index_x*BLOCK_SIZE +  j + 1] = input_itemsets_l[(i + 1)*(BLOCK_SIZE+1) + j + 1];
+        }
+    }
+}
+#ifdef OMP_OFFLOAD
+#pragma omp end declare target
+#endif
+
+#ifndef OMP_OFFLOAD
+struct nw_diagonal
+{
+    int *input_itemsets, *referrence;
+    int max_cols, penalty, blk;
+};
+
+// omp_rt_for body: tiles begin to end-1 of block diagonal blk of the
+// top-left matrix
+void nw_top_left(int begin, int end, void *arg)
+{
+    nw_diagonal *d = (nw_diagonal *)arg;
+    for( int b_index_x = begin; b_index_x < end; ++b_index_x)
+        nw_block(d->input_itemsets, d->referrence, d->max_cols, d->penalty,
+                b_index_x, d->blk - 1 - b_index_x);
+}
+
+// omp_rt_for body: tiles begin to end-1 of block diagonal blk of the
+// bottom-right matrix
+void nw_bottom_right(int begin, int end, void *arg)
+{
+    nw_diagonal *d = (nw_diagonal *)arg;
+    for( int b_index_x = begin; b_index_x < end; ++b_index_x)
+        nw_block(d->input_itemsets, d->referrence, d->max_cols, d->penalty,
+                b_index_x, (d->max_cols-1)/BLOCK_SIZE + d->blk - 2 - b_index_x);
+}
+#endif
+
 void nw_optimized(int *input_itemsets, int *output_itemsets, int *referrence,
         int max_rows, int max_cols, int penalty)
 {
@@ -109,128 +205,82 @@ void nw_optimized(int *input_itemsets, int *output_itemsets, int *referrence,
     {
 
     #pragma omp target 
-#endif
     for( int blk = 1; blk <= (max_cols-1)/BLOCK_SIZE; blk++ )
     {
-#ifdef OPENMP
 #pragma omp parallel for schedule(static) shared(input_itemsets, referrence) firstprivate(blk, max_rows, max_cols, penalty)
-#endif
         for( int b_index_x = 0; b_index_x < blk; ++b_index_x)
-        {
-            int b_index_y = blk - 1 - b_index_x;
-            int input_itemsets_l[(BLOCK_SIZE + 1) *(BLOCK_SIZE+1)] __attribute__ ((aligned (64)));
-            int reference_l[BLOCK_SIZE * BLOCK_SIZE] __attribute__ ((aligned (64)));
-
-            // Copy referrence to local memory
-            for ( int i = 0; i < BLOCK_SIZE; ++i )
-            {
-#pragma omp simd
-                for ( int j = 0; j < BLOCK_SIZE; ++j)
-                {
-                    reference_l[i*BLOCK_SIZE + j] = referrence[max_cols*(b_index_y*BLOCK_SIZE + i + 1) + b_index_x*BLOCK_SIZE +  j + 1];
-                }
-            }
-
-            // Copy input_itemsets to local memory
-            for ( int i = 0; i < BLOCK_SIZE + 1; ++i )
-            {
-#pragma omp simd
-                for ( int j = 0; j < BLOCK_SIZE + 1; ++j)
-                {
-                    input_itemsets_l[i*(BLOCK_SIZE + 1) + j] = input_itemsets[max_cols*(b_index_y*BLOCK_SIZE + i) + b_index_x*BLOCK_SIZE +  j];
-                }
-            }
-
-            // Compute
-            for ( int i = 1; i < BLOCK_SIZE + 1; ++i )
-            {
-                for ( int j = 1; j < BLOCK_SIZE + 1; ++j)
-                {
-                    input_itemsets_l[i*(BLOCK_SIZE + 1) + j] = maximum( input_itemsets_l[(i - 1)*(BLOCK_SIZE + 1) + j - 1] + reference_l[(i - 1)*BLOCK_SIZE + j - 1],
-                            input_itemsets_l[i*(BLOCK_SIZE + 1) + j - 1] - penalty,
-                            input_itemsets_l[(i - 1)*(BLOCK_SIZE + 1) + j] - penalty);
-                }
-            }
-
-            // Copy results to global memory
-            for ( int i = 0; i < BLOCK_SIZE; ++i )
-            {
-#pragma omp simd
-                for ( int j = 0; j < BLOCK_SIZE; ++j)
-                {
-                    input_itemsets[max_cols*(b_index_y*BLOCK_SIZE + i + 1) + b_index_x*BLOCK_SIZE +  j + 1] = input_itemsets_l[(i + 1)*(BLOCK_SIZE+1) + j + 1];
-                }
-            }
-            
-        }
+            nw_block(input_itemsets, referrence, max_cols, penalty, b_index_x, blk - 1 - b_index_x);
     }    
         
     printf("Processing bottom-right matrix\n");
 
-#ifdef OMP_OFFLOAD
     #pragma omp target
-#endif
     for ( int blk = 2; blk <= (max_cols-1)/BLOCK_SIZE; blk++ )
     {
-#ifdef OPENMP
 #pragma omp parallel for schedule(static) shared(input_itemsets, referrence) firstprivate(blk, max_rows, max_cols, penalty)
-#endif
         for( int b_index_x = blk - 1; b_index_x < (max_cols-1)/BLOCK_SIZE; ++b_index_x)
-        {
-            int b_index_y = (max_cols-1)/BLOCK_SIZE + blk - 2 - b_index_x;
-
-            int input_itemsets_l[(BLOCK_SIZE + 1) *(BLOCK_SIZE+1)] __attribute__ ((aligned (64)));
-            int reference_l[BLOCK_SIZE * BLOCK_SIZE] __attribute__ ((aligned (64)));
- 
-            // Copy referrence to local memory
-            for ( int i = 0; i < BLOCK_SIZE; ++i )
-            {
-#pragma omp simd
-                for ( int j = 0; j < BLOCK_SIZE; ++j)
-                {
-                    reference_l[i*BLOCK_SIZE + j] = referrence[max_cols*(b_index_y*BLOCK_SIZE + i + 1) + b_index_x*BLOCK_SIZE +  j + 1];
-                }
-            }
-
-            // Copy input_itemsets to local memory
-            for ( int i = 0; i < BLOCK_SIZE + 1; ++i )
-            {
-#pragma omp simd
-                for ( int j = 0; j < BLOCK_SIZE + 1; ++j)
-                {
-                    input_itemsets_l[i*(BLOCK_SIZE + 1) + j] = input_itemsets[max_cols*(b_index_y*BLOCK_SIZE + i) + b_index_x*BLOCK_SIZE +  j];
-                }
-            }
-
-            // Compute
-            for ( int i = 1; i < BLOCK_SIZE + 1; ++i )
-            {
-                for ( int j = 1; j < BLOCK_SIZE + 1; ++j)
-                {
-                    input_itemsets_l[i*(BLOCK_SIZE + 1) + j] = maximum( input_itemsets_l[(i - 1)*(BLOCK_SIZE + 1) + j - 1] + reference_l[(i - 1)*BLOCK_SIZE + j - 1],
-                            input_itemsets_l[i*(BLOCK_SIZE + 1) + j - 1] - penalty,
-                            input_itemsets_l[(i - 1)*(BLOCK_SIZE + 1) + j] - penalty);
-                }
-            }
-
-            // Copy results to global memory
-            for ( int i = 0; i < BLOCK_SIZE; ++i )
-            {
-#pragma omp simd
-                for ( int j = 0; j < BLOCK_SIZE; ++j)
-                {
-                    input_itemsets[max_cols*(b_index_y*BLOCK_SIZE + i + 1) + b_index_x*BLOCK_SIZE +  j + 1] = input_itemsets_l[(i + 1)*(BLOCK_SIZE+1) + j +1];
-                }
-            }
-        }
+            nw_block(input_itemsets, referrence, max_cols, penalty,
+                    b_index_x, (max_cols-1)/BLOCK_SIZE + blk - 2 - b_index_x);
     }
 
-#ifdef OMP_OFFLOAD
+    }
+#else
+    int nblk = (max_cols-1)/BLOCK_SIZE;
+
+    // a block diagonal is an omp_rt_for over its tiles, see omp_rt.h
+    #pragma omp parallel if (omp_rt_persistent())
+    {
+        nw_diagonal d = { input_itemsets, referrence, max_cols, penalty, 0 };
+
+        for( d.blk = 1; d.blk <= nblk; d.blk++ )
+            omp_rt_for(0, d.blk, OMP_RT_STATIC, 0, nw_top_left, &d);
+
+        #pragma omp master
+        printf("Processing bottom-right matrix\n");
+
+        for ( d.blk = 2; d.blk <= nblk; d.blk++ )
+            omp_rt_for(d.blk - 1, nblk, OMP_RT_STATIC, 0, nw_bottom_right, &d);
     }
 #endif
    
 }
 
+struct nw_matrix
+{
+    int *input_itemsets, *referrence;
+    int max_rows, max_cols, penalty, tile;
+};
+
+// one tile of the full matrices, computed in place
+void nw_matrix_tile(int bi, int bj, void *arg)
+{
+    nw_matrix *m = (nw_matrix *)arg;
+    int r0 = bi*m->tile, c0 = bj*m->tile;
+    int r1 = r0 + m->tile < m->max_rows - 1 ? r0 + m->tile : m->max_rows - 1;
+    int c1 = c0 + m->tile < m->max_cols - 1 ? c0 + m->tile : m->max_cols - 1;
+    int *M = m->input_itemsets;
+    long mc = m->max_cols;
+
+    for ( int i = r0 + 1; i <= r1; ++i )
+    {
+        for ( int j = c0 + 1; j <= c1; ++j )
+        {
+            M[i*mc + j] = maximum( M[(i - 1)*mc + j - 1] + m->referrence[i*mc + j],
+                    M[i*mc + j - 1] - m->penalty,
+                    M[(i - 1)*mc + j] - m->penalty);
+        }
+    }
+}
+
+// same result as nw_optimized, with every tile a task that waits only for its
+// north and west neighbours; any tile edge and any sequence length
+void nw_tasks(int *input_itemsets, int *referrence,
+        int max_rows, int max_cols, int penalty, int tile)
+{
+    nw_matrix m = { input_itemsets, referrence, max_rows, max_cols, penalty, tile };
+    nw_tile_graph((max_rows - 1 + tile - 1)/tile, (max_cols - 1 + tile - 1)/tile, nw_matrix_tile, &m);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //! Run a simple test for CUDA
 ////////////////////////////////////////////////////////////////////////////////
@@ -242,20 +292,62 @@ runTest( int argc, char** argv)
     //int *matrix_cuda, *matrix_cuda_out, *referrence_cuda;
     //int size;
     int omp_num_threads;
+    const char *mode = "full";
+    int tile = NW_TILE;
 
+    if (argc >= 5 && argc <= 7 && !strcmp(argv[1], "-batch"))
+    {
+        int lanes = argc >= 6 ? atoi(argv[5]) : NW_LANES;
+        if (lanes != 8 && lanes != 16 && lanes != 32)
+            usage(argc, argv);
+        omp_set_num_threads(atoi(argv[4]));
+        nw_batch(argv[2], atoi(argv[3]), lanes, argc >= 7 ? atoi(argv[6]) : 0);
+        return;
+    }
 
     // the lengths of the two sequences should be able to divided by 16.
     // And at current stage  max_rows needs to equal max_cols
-    if (argc == 4)
+    // (the linear modes take any length)
+    if (argc >= 4 && argc <= 6)
     {
         max_rows = atoi(argv[1]);
         max_cols = atoi(argv[1]);
         penalty = atoi(argv[2]);
         omp_num_threads = atoi(argv[3]);
+        if (argc >= 5)
+            mode = argv[4];
+        if (argc >= 6)
+            tile = atoi(argv[5]);
     }
     else{
         usage(argc, argv);
     }
+    if (strcmp(mode, "full") && strcmp(mode, "tasks") && strcmp(mode, "linear") && strcmp(mode, "score"))
+        usage(argc, argv);
+    if (max_rows <= 0 || tile <= 0)
+        usage(argc, argv);
+    omp_rt_init(omp_num_threads);
+
+    if (strcmp(mode, "full") && strcmp(mode, "tasks"))
+    {
+        // same sequences as the full mode, residues only
+        char *seq_a = (char *)malloc( max_rows );
+        char *seq_b = (char *)malloc( max_cols );
+
+        srand ( 7 );
+        for( int i = 0; i < max_rows; i++)
+            seq_a[i] = rand() % 10 + 1;
+        for( int j = 0; j < max_cols; j++)
+            seq_b[j] = rand() % 10 + 1;
+
+        printf("Start Needleman-Wunsch\n");
+        printf("Num of threads: %d\n", omp_num_threads);
+        nw_linear(seq_a, max_rows, seq_b, max_cols, penalty, tile, !strcmp(mode, "linear"));
+
+        free(seq_a);
+        free(seq_b);
+        return;
+    }
 
     max_rows = max_rows + 1;
     max_cols = max_cols + 1;
@@ -298,18 +390,36 @@ runTest( int argc, char** argv)
 
 
 
+    long long start_time;
+    if (!strcmp(mode, "tasks"))
+    {
+        printf("Num of threads: %d\n", omp_num_threads);
+        printf("Processing tile tasks, tile %d\n", tile);
+
+        start_time = get_time();
+
+        nw_tasks( input_itemsets, referrence,
+            max_rows, max_cols, penalty, tile );
+    }
+    else
+    {
     //Compute top-left matrix 
     printf("Num of threads: %d\n", omp_num_threads);
     printf("Processing top-left matrix\n");
    
-    long long start_time = get_time();
+    start_time = get_time();
 
     nw_optimized( input_itemsets, output_itemsets, referrence,
         max_rows, max_cols, penalty );
+    }
 
     long long end_time = get_time();
 
     printf("Total time: %.3f seconds\n", ((float) (end_time - start_time)) / (1000*1000));
+    printf("Score: %d\n", input_itemsets[(max_rows - 1) * max_cols + max_cols - 1]);
+    printf("%.3f GCUPS\n", (double)(max_rows - 1) * (max_cols - 1) / (end_time - start_time) * 1e-3);
+    if (!strcmp(mode, "full"))
+        omp_rt_report("block diagonals");
 
 #define TRACEBACK
 #ifdef TRACEBACK
@@ -0,0 +1,50 @@
+////////////////////////////////////////////////////////////////////////////////
+// Dependency-driven tile scheduler
+//
+// The DP matrix is cut into an ntr x ntc grid of tiles and tile (bi, bj)
+// depends only on its north (bi-1, bj) and west (bi, bj-1) neighbours. Every
+// tile is an OpenMP task with those two dependences, so a tile starts as soon
+// as its inputs are done instead of waiting for a barrier at the end of each
+// block anti-diagonal, and the narrow first and last diagonals overlap with
+// the wide ones.
+////////////////////////////////////////////////////////////////////////////////
+
+void nw_tile_graph(int ntr, int ntc, void (*run)(int bi, int bj, void *arg), void *arg)
+{
+    if ( ntr <= 0 || ntc <= 0 )
+        return;
+    if ( ntr == 1 && ntc == 1 )
+    {
+        run(0, 0, arg);
+        return;
+    }
+
+    // one byte per tile, only its address is used to name the dependence
+    char *dep = (char *)malloc( (long)ntr*ntc );
+
+#ifdef OPENMP
+#pragma omp parallel
+#pragma omp single
+#endif
+    {
+        // created in anti-diagonal order so the tasks that become ready first are queued first
+        for ( int d = 0; d < ntr + ntc - 1; ++d )
+        {
+            int lo = d - ntc + 1 > 0 ? d - ntc + 1 : 0;
+            int hi = d < ntr - 1 ? d : ntr - 1;
+            for ( int bi = lo; bi <= hi; ++bi )
+            {
+                int bj = d - bi;
+                long self = (long)bi*ntc + bj;
+                long north = bi > 0 ? self - ntc : self;
+                long west = bj > 0 ? self - 1 : self;
+#ifdef OPENMP
+#pragma omp task firstprivate(bi, bj) depend(in: dep[north], dep[west]) depend(out: dep[self])
+#endif
+                run(bi, bj, arg);
+            }
+        }
+    }
+
+    free(dep);
+}
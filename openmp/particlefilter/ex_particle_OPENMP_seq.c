@@ -9,19 +9,20 @@
 #include <sys/time.h>
 #include <omp.h>
 #include <limits.h>
+#include "../../common/philox.h"
 #define PI 3.1415926535897932
 /**
-@var M value for Linear Congruential Generator (LCG); use GCC's value
+@var SCAN_BLOCK elements per block of the parallel prefix sum; fixed so the CDF does not depend on the thread count
 */
-long M = INT_MAX;
+#define SCAN_BLOCK 4096
 /**
-@var A value for LCG
+@var STREAM_NOISE philox stream of the video noise (counter = voxel); particle x uses stream x
 */
-int A = 1103515245;
+#define STREAM_NOISE 0xFFFFFFFF00000000ull
 /**
-@var C value for LCG
+@var STREAM_RESAMPLE philox stream of the systematic resampling offset (counter = frame)
 */
-int C = 12345;
+#define STREAM_RESAMPLE 0xFFFFFFFF00000001ull
 /*****************************
 *GET_TIME
 *returns a long int representing the time
@@ -67,49 +68,20 @@ void setIf(int testValue, int newValue, int * array3D, int * dimX, int * dimY, i
 	}
 }
 /**
-* Generates a uniformly distributed random number using the provided seed and GCC's settings for the Linear Congruential Generator (LCG)
-* @see http://en.wikipedia.org/wiki/Linear_congruential_generator
-* @note This function is thread-safe
-* @param seed The seed array
-* @param index The specific index of the seed to be advanced
-* @return a uniformly distributed number [0, 1)
-*/
-double randu(int * seed, int index)
-{
-	int num = A*seed[index] + C;
-	seed[index] = num % M;
-	return fabs(seed[index]/((double) M));
-}
-/**
-* Generates a normally distributed random number using the Box-Muller transformation
-* @note This function is thread-safe
-* @param seed The seed array
-* @param index The specific index of the seed to be advanced
-* @return a double representing random number generated using the Box-Muller algorithm
-* @see http://en.wikipedia.org/wiki/Normal_distribution, section computing value for normal random distribution
-*/
-double randn(int * seed, int index){
-	/*Box-Muller algorithm*/
-	double u = randu(seed, index);
-	double v = randu(seed, index);
-	double cosine = cos(2*PI*v);
-	double rt = -2*log(u);
-	return sqrt(rt)*cosine;
-}
-/**
 * Sets values of 3D matrix using randomly generated numbers from a normal distribution
 * @param array3D The video to be modified
 * @param dimX The x dimension of the frame
 * @param dimY The y dimension of the frame
 * @param dimZ The number of frames
-* @param seed The seed array
+* @param seed The generator key
 */
-void addNoise(int * array3D, int * dimX, int * dimY, int * dimZ, int * seed){
+void addNoise(int * array3D, int * dimX, int * dimY, int * dimZ, uint64_t seed){
 	int x, y, z;
+	#pragma omp parallel for private(y, z)
 	for(x = 0; x < *dimX; x++){
 		for(y = 0; y < *dimY; y++){
 			for(z = 0; z < *dimZ; z++){
-				array3D[x * *dimY * *dimZ + y * *dimZ + z] = array3D[x * *dimY * *dimZ + y * *dimZ + z] + (int)(5*randn(seed, 0));
+				array3D[x * *dimY * *dimZ + y * *dimZ + z] = array3D[x * *dimY * *dimZ + y * *dimZ + z] + (int)(5*philox_normal(seed, STREAM_NOISE, x * *dimY * *dimZ + y * *dimZ + z));
 			}
 		}
 	}
@@ -220,9 +192,9 @@ void getneighbors(int * se, int numOnes, double * neighbors, int radius){
 * @param IszX The x dimension of the video
 * @param IszY The y dimension of the video
 * @param Nfr The number of frames of the video
-* @param seed The seed array used for number generation
+* @param seed The generator key used for number generation
 */
-void videoSequence(int * I, int IszX, int IszY, int Nfr, int * seed){
+void videoSequence(int * I, int IszX, int IszY, int Nfr, uint64_t seed){
 	int k;
 	int max_size = IszX*IszY*Nfr;
 	/*get object centers*/
@@ -242,7 +214,7 @@ void videoSequence(int * I, int IszX, int IszY, int Nfr, int * seed){
 	}
 	
 	/*dilate matrix*/
-	int * newMatrix = (int *)malloc(sizeof(int)*IszX*IszY*Nfr);
+	int * newMatrix = (int *)calloc(IszX*IszY*Nfr, sizeof(int));
 	imdilate_disk(I, IszX, IszY, Nfr, 5, newMatrix);
 	int x, y;
 	for(x = 0; x < IszX; x++){
@@ -298,36 +270,91 @@ int findIndex(double * CDF, int lengthCDF, double value){
 }
 /**
 * Finds the first element in the CDF that is greater than or equal to the provided value and returns that index
-* @note This function uses binary search before switching to sequential search
+* @note This function uses binary search
 * @param CDF The CDF
 * @param beginIndex The index to start searching from
 * @param endIndex The index to stop searching
 * @param value The value to find
-* @return The index of value in the CDF; if value is never found, returns the last index
-* @warning Use at your own risk; not fully tested
+* @return The index of value in the CDF; if value is never found, returns endIndex
 */
 int findIndexBin(double * CDF, int beginIndex, int endIndex, double value){
-	if(endIndex < beginIndex)
-	return -1;
-	int middleIndex = beginIndex + ((endIndex - beginIndex)/2);
-	/*check the value*/
-	if(CDF[middleIndex] >= value)
+	int middleIndex;
+	while(beginIndex < endIndex){
+		middleIndex = beginIndex + ((endIndex - beginIndex)/2);
+		if(CDF[middleIndex] >= value)
+		endIndex = middleIndex;
+		else
+		beginIndex = middleIndex + 1;
+	}
+	return endIndex;
+}
+/**
+* Computes the CDF as the inclusive prefix sum of the weights in parallel
+* @note Blocks of SCAN_BLOCK elements are summed independently, then offset by the sum of all blocks before them
+* @param weights The normalized weights
+* @param CDF The resulting CDF
+* @param Nparticles The number of particles
+* @param blockSum Scratch for one partial sum per block
+*/
+void cumSum(double * weights, double * CDF, int Nparticles, double * blockSum){
+	int nblocks = (Nparticles + SCAN_BLOCK - 1)/SCAN_BLOCK;
+	int b, x, end;
+	double sum, offset;
+	#pragma omp parallel for shared(weights, CDF, blockSum) private(b, x, end, sum)
+	for(b = 0; b < nblocks; b++){
+		end = (b+1)*SCAN_BLOCK < Nparticles ? (b+1)*SCAN_BLOCK : Nparticles;
+		sum = 0;
+		for(x = b*SCAN_BLOCK; x < end; x++){
+			sum += weights[x];
+			CDF[x] = sum;
+		}
+		blockSum[b] = sum;
+	}
+	offset = 0;
+	for(b = 0; b < nblocks; b++){
+		sum = blockSum[b];
+		blockSum[b] = offset;
+		offset += sum;
+	}
+	#pragma omp parallel for shared(CDF, blockSum) private(b, x, end)
+	for(b = 1; b < nblocks; b++){
+		end = (b+1)*SCAN_BLOCK < Nparticles ? (b+1)*SCAN_BLOCK : Nparticles;
+		for(x = b*SCAN_BLOCK; x < end; x++){
+			CDF[x] += blockSum[b];
+		}
+	}
+}
+/**
+* Systematic resampling: draws particle j from the first CDF entry >= u1 + j/Nparticles
+* @note The thresholds increase with j, so every thread binary searches once for the start of its contiguous range of j and then sweeps the CDF forward (merge-style), O(Nparticles) work in total; the result is the same as findIndex per particle
+* @param CDF The CDF
+* @param Nparticles The number of particles
+* @param u1 The first threshold, uniform in [0, 1/Nparticles)
+* @param arrayX The x locations of the current particles
+* @param arrayY The y locations of the current particles
+* @param xj The x locations of the resampled particles
+* @param yj The y locations of the resampled particles
+*/
+void resample(double * CDF, int Nparticles, double u1, double * arrayX, double * arrayY, double * xj, double * yj){
+	#pragma omp parallel shared(CDF, arrayX, arrayY, xj, yj)
 	{
-		/*check that it's good*/
-		if(middleIndex == 0)
-		return middleIndex;
-		else if(CDF[middleIndex-1] < value)
-		return middleIndex;
-		else if(CDF[middleIndex-1] == value)
-		{
-			while(middleIndex > 0 && CDF[middleIndex-1] == value)
-			middleIndex--;
-			return middleIndex;
+		int nthreads = omp_get_num_threads();
+		int tid = omp_get_thread_num();
+		int begin = (int)((long long)Nparticles*tid/nthreads);
+		int end = (int)((long long)Nparticles*(tid+1)/nthreads);
+		int i, j;
+		double u;
+		if(begin < end){
+			i = findIndexBin(CDF, 0, Nparticles-1, u1 + begin/((double)(Nparticles)));
+			for(j = begin; j < end; j++){
+				u = u1 + j/((double)(Nparticles));
+				while(i < Nparticles-1 && CDF[i] < u)
+				i++;
+				xj[j] = arrayX[i];
+				yj[j] = arrayY[i];
+			}
 		}
 	}
-	if(CDF[middleIndex] > value)
-	return findIndexBin(CDF, beginIndex, middleIndex+1, value);
-	return findIndexBin(CDF, middleIndex-1, endIndex, value);
 }
 /**
 * The implementation of the particle filter using OpenMP for many frames
@@ -337,10 +364,10 @@ int findIndexBin(double * CDF, int beginIndex, int endIndex, double value){
 * @param IszX The x dimension of the video
 * @param IszY The y dimension of the video
 * @param Nfr The number of frames
-* @param seed The seed array used for random number generation
+* @param seed The generator key used for random number generation
 * @param Nparticles The number of particles to be used
 */
-void particleFilter(int * I, int IszX, int IszY, int Nfr, int * seed, int Nparticles){
+void particleFilter(int * I, int IszX, int IszY, int Nfr, uint64_t seed, int Nparticles){
 	
 	int max_size = IszX*IszY*Nfr;
 	long long start = get_time();
@@ -351,7 +378,7 @@ void particleFilter(int * I, int IszX, int IszY, int Nfr, int * seed, int Nparti
 	//expected object locations, compared to center
 	int radius = 5;
 	int diameter = radius*2 - 1;
-	int * disk = (int *)malloc(diameter*diameter*sizeof(int));
+	int * disk = (int *)calloc(diameter*diameter, sizeof(int));
 	strelDisk(disk, radius);
 	int countOnes = 0;
 	int x, y;
@@ -381,8 +408,8 @@ void particleFilter(int * I, int IszX, int IszY, int Nfr, int * seed, int Nparti
 	double * xj = (double *)malloc(sizeof(double)*Nparticles);
 	double * yj = (double *)malloc(sizeof(double)*Nparticles);
 	double * CDF = (double *)malloc(sizeof(double)*Nparticles);
-	double * u = (double *)malloc(sizeof(double)*Nparticles);
-	int * ind = (int*)malloc(sizeof(int)*countOnes*Nparticles);
+	double * blockSum = (double *)malloc(sizeof(double)*((Nparticles + SCAN_BLOCK - 1)/SCAN_BLOCK));
+	double * swap;
 	#pragma omp parallel for shared(arrayX, arrayY, xe, ye) private(x)
 	for(x = 0; x < Nparticles; x++){
 		arrayX[x] = xe;
@@ -391,38 +418,39 @@ void particleFilter(int * I, int IszX, int IszY, int Nfr, int * seed, int Nparti
 	int k;
 	
 	printf("TIME TO SET ARRAYS TOOK: %f\n", elapsed_time(get_weights, get_time()));
-	int indX, indY;
+	int indX, indY, index;
+	double likelihoodSum;
 	for(k = 1; k < Nfr; k++){
 		long long set_arrays = get_time();
 		//apply motion model
 		//draws sample from motion model (random walk). The only prior information
 		//is that the object moves 2x as fast as in the y direction
+		//particle x draws from its own stream at counters 2k and 2k+1, so the walk does not depend on the thread count
 		#pragma omp parallel for shared(arrayX, arrayY, Nparticles, seed) private(x)
 		for(x = 0; x < Nparticles; x++){
-			arrayX[x] += 1 + 5*randn(seed, x);
-			arrayY[x] += -2 + 2*randn(seed, x);
+			arrayX[x] += 1 + 5*philox_normal(seed, x, 2*(uint64_t)k);
+			arrayY[x] += -2 + 2*philox_normal(seed, x, 2*(uint64_t)k + 1);
 		}
 		long long error = get_time();
 		printf("TIME TO SET ERROR TOOK: %f\n", elapsed_time(set_arrays, error));
 		//particle filter likelihood
-		#pragma omp parallel for shared(likelihood, I, arrayX, arrayY, objxy, ind) private(x, y, indX, indY)
+		#pragma omp parallel for shared(likelihood, I, arrayX, arrayY, objxy) private(x, y, indX, indY, index, likelihoodSum)
 		for(x = 0; x < Nparticles; x++){
 			//compute the likelihood: remember our assumption is that you know
 			// foreground and the background image intensity distribution.
 			// Notice that we consider here a likelihood ratio, instead of
 			// p(z|x). It is possible in this case. why? a hometask for you.		
-			//calc ind
+			//calc ind on the fly, one disk sample at a time
+			likelihoodSum = 0;
 			for(y = 0; y < countOnes; y++){
 				indX = roundDouble(arrayX[x]) + objxy[y*2 + 1];
 				indY = roundDouble(arrayY[x]) + objxy[y*2];
-				ind[x*countOnes + y] = fabs(indX*IszY*Nfr + indY*Nfr + k);
-				if(ind[x*countOnes + y] >= max_size)
-					ind[x*countOnes + y] = 0;
+				index = fabs(indX*IszY*Nfr + indY*Nfr + k);
+				if(index >= max_size)
+					index = 0;
+				likelihoodSum += (pow((I[index] - 100),2) - pow((I[index]-228),2))/50.0;
 			}
-			likelihood[x] = 0;
-			for(y = 0; y < countOnes; y++)
-				likelihood[x] += (pow((I[ind[x*countOnes + y]] - 100),2) - pow((I[ind[x*countOnes + y]]-228),2))/50.0;
-			likelihood[x] = likelihood[x]/((double) countOnes);
+			likelihood[x] = likelihoodSum/((double) countOnes);
 		}
 		long long likelihood_time = get_time();
 		printf("TIME TO GET LIKELIHOODS TOOK: %f\n", elapsed_time(error, likelihood_time));
@@ -468,38 +496,19 @@ void particleFilter(int * I, int IszX, int IszY, int Nfr, int * seed, int Nparti
 		//resampling
 		
 		
-		CDF[0] = weights[0];
-		for(x = 1; x < Nparticles; x++){
-			CDF[x] = weights[x] + CDF[x-1];
-		}
+		cumSum(weights, CDF, Nparticles, blockSum);
 		long long cum_sum = get_time();
 		printf("TIME TO CALC CUM SUM TOOK: %f\n", elapsed_time(move_time, cum_sum));
-		double u1 = (1/((double)(Nparticles)))*randu(seed, 0);
-		#pragma omp parallel for shared(u, u1, Nparticles) private(x)
-		for(x = 0; x < Nparticles; x++){
-			u[x] = u1 + x/((double)(Nparticles));
-		}
-		long long u_time = get_time();
-		printf("TIME TO CALC U TOOK: %f\n", elapsed_time(cum_sum, u_time));
-		int j, i;
-		
-		#pragma omp parallel for shared(CDF, Nparticles, xj, yj, u, arrayX, arrayY) private(i, j)
-		for(j = 0; j < Nparticles; j++){
-			i = findIndex(CDF, Nparticles, u[j]);
-			if(i == -1)
-				i = Nparticles-1;
-			xj[j] = arrayX[i];
-			yj[j] = arrayY[i];
-			
-		}
+		double u1 = (1/((double)(Nparticles)))*philox_uniform(seed, STREAM_RESAMPLE, k);
+		resample(CDF, Nparticles, u1, arrayX, arrayY, xj, yj);
 		long long xyj_time = get_time();
-		printf("TIME TO CALC NEW ARRAY X AND Y TOOK: %f\n", elapsed_time(u_time, xyj_time));
+		printf("TIME TO CALC NEW ARRAY X AND Y TOOK: %f\n", elapsed_time(cum_sum, xyj_time));
 		
-		//#pragma omp parallel for shared(weights, Nparticles) private(x)
+		//reassign arrayX and arrayY
+		swap = arrayX; arrayX = xj; xj = swap;
+		swap = arrayY; arrayY = yj; yj = swap;
+		#pragma omp parallel for shared(weights, Nparticles) private(x)
 		for(x = 0; x < Nparticles; x++){
-			//reassign arrayX and arrayY
-			arrayX[x] = xj[x];
-			arrayY[x] = yj[x];
 			weights[x] = 1/((double)(Nparticles));
 		}
 		long long reset = get_time();
@@ -514,14 +523,13 @@ void particleFilter(int * I, int IszX, int IszY, int Nfr, int * seed, int Nparti
 	free(arrayX);
 	free(arrayY);
 	free(CDF);
-	free(u);
-	free(ind);
+	free(blockSum);
 }
 int main(int argc, char * argv[]){
 	
-	char* usage = "openmp.out -x <dimX> -y <dimY> -z <Nfr> -np <Nparticles>";
+	char* usage = "openmp.out -x <dimX> -y <dimY> -z <Nfr> -np <Nparticles> [-seed <key>]";
 	//check number of arguments
-	if(argc != 9)
+	if(argc != 9 && argc != 11)
 	{
 		printf("%s\n", usage);
 		return 0;
@@ -577,13 +585,15 @@ int main(int argc, char * argv[]){
 		printf("Number of particles must be > 0\n");
 		return 0;
 	}
-	//establish seed
-	int * seed = (int *)malloc(sizeof(int)*Nparticles);
-	int i;
-	for(i = 0; i < Nparticles; i++)
-		seed[i] = time(0)*i;
+	//establish seed, every draw is a function of (seed, stream, counter) so a given key reproduces the run at any thread count
+	unsigned long long key = time(0);
+	if(argc == 11 && (strcmp( argv[9], "-seed" ) || sscanf( argv[10], "%llu", &key ) != 1)){
+		printf( "%s\n",usage );
+		return 0;
+	}
+	uint64_t seed = key;
 	//malloc matrix
-	int * I = (int *)malloc(sizeof(int)*IszX*IszY*Nfr);
+	int * I = (int *)calloc(IszX*IszY*Nfr, sizeof(int));
 	long long start = get_time();
 	//call video sequence
 	videoSequence(I, IszX, IszY, Nfr, seed);
@@ -593,9 +603,9 @@ int main(int argc, char * argv[]){
 	particleFilter(I, IszX, IszY, Nfr, seed, Nparticles);
 	long long endParticleFilter = get_time();
 	printf("PARTICLE FILTER TOOK %f\n", elapsed_time(endVideoSequence, endParticleFilter));
+	printf("PARTICLES PER SECOND: %f\n", (double)Nparticles*(Nfr-1)/elapsed_time(endVideoSequence, endParticleFilter));
 	printf("ENTIRE PROGRAM TOOK %f\n", elapsed_time(start, endParticleFilter));
 	
-	free(seed);
 	free(I);
 	return 0;
 }
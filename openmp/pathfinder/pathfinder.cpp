@@ -4,6 +4,7 @@
 #include <assert.h>
 
 #include "timer.h"
+#include "../../common/omp_rt.h"
 
 void run(int argc, char** argv);
 
@@ -71,6 +72,29 @@ fatal(char *s)
 #define CLAMP_RANGE(x, min, max) x = (x<(min)) ? min : ((x>(max)) ? max : x )
 #define MIN(a, b) ((a)<=(b) ? (a) : (b))
 
+/* the two result rows of run() and the step, for row_step */
+struct row_args
+{
+    int *src, *dst;
+    int t;
+};
+
+/* omp_rt_for body: columns begin to end-1 of step t */
+void row_step(int begin, int end, void *arg)
+{
+    row_args *a = (row_args *) arg;
+    int min;
+
+    for(int n = begin; n < end; n++){
+      min = a->src[n];
+      if (n > 0)
+        min = MIN(min, a->src[n-1]);
+      if (n < cols-1)
+        min = MIN(min, a->src[n+1]);
+      a->dst[n] = wall[a->t+1][n]+min;
+    }
+}
+
 int main(int argc, char** argv)
 {
     run(argc,argv);
@@ -85,29 +109,34 @@ void run(int argc, char** argv)
     unsigned long long cycles;
 
     int *src, *dst, *temp;
-    int min;
 
     dst = result;
     src = new int[cols];
 
+    omp_rt_init(0);
     pin_stats_reset();
-    for (int t = 0; t < rows-1; t++) {
+    /* a step is an omp_rt_for over the columns, see omp_rt.h */
+    #pragma omp parallel if (omp_rt_persistent())
+    {
+        row_args a = { src, dst, 0 };
+        for (int t = 0; t < rows-1; t++) {
+            int *tmp = a.src;
+            a.src = a.dst;
+            a.dst = tmp;
+            a.t = t;
+            omp_rt_for(0, cols, OMP_RT_STATIC, 0, row_step, &a);
+        }
+    }
+    /* the rows were swapped rows-1 times */
+    if ((rows-1) % 2) {
         temp = src;
         src = dst;
         dst = temp;
-        #pragma omp parallel for private(min)
-        for(int n = 0; n < cols; n++){
-          min = src[n];
-          if (n > 0)
-            min = MIN(min, src[n-1]);
-          if (n < cols-1)
-            min = MIN(min, src[n+1]);
-          dst[n] = wall[t+1][n]+min;
-        }
     }
 
     pin_stats_pause(cycles);
     pin_stats_dump(cycles);
+    omp_rt_report("steps");
 
 #ifdef BENCH_PRINT
     for (int i = 0; i < cols; i++)
@@ -0,0 +1,419 @@
+//====================================================================================================100
+//====================================================================================================100
+//	SRAD ENGINE BENCHMARK
+//====================================================================================================100
+//====================================================================================================100
+
+// Times the legacy kernels of srad_v1 and srad_v2 against the engine on the configurations of the
+// two front-ends, and the multi-image entry point against images denoised one at a time.
+//
+//	srad_v1: column major, 0-255 image extracted to exp(x/255), ROI the whole image, float
+//	srad_v2: row major, exp of a random matrix, ROI a 128x128 speckle at the corner, float
+//
+// Every configuration is also run through the engine in double. The report gives the best time of
+// the repetitions, the pixel updates per second and the largest difference of the engine result to
+// the legacy result (relative to its value) and of the float to the double result.
+//
+//	usage: srad_bench [threads] [repetitions]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+
+#include "srad_engine.h"
+
+#define IMAGES 64														// images of the multi-image run
+
+//====================================================================================================100
+//	LEGACY KERNELS
+//====================================================================================================100
+
+// srad_v1 (srad.c before the engine), column major
+static void legacy_v1(	float* image, long Nr, long Nc, int niter, float lambda,
+						int r1, int r2, int c1, int c2,
+						int* iN, int* iS, int* jW, int* jE,
+						float* dN, float* dS, float* dW, float* dE, float* c){
+
+	long NeROI = (r2-r1+1)*(c2-c1+1);
+	float meanROI, varROI, q0sqr, Jc, tmp, sum, sum2, G2, L, num, den, qsqr, D, cN, cS, cW, cE;
+	int iter;
+	long i, j, k;
+
+	for (iter=0; iter<niter; iter++){
+		sum=0;
+		sum2=0;
+		for (i=r1; i<=r2; i++) {
+			for (j=c1; j<=c2; j++) {
+				tmp   = image[i + Nr*j];
+				sum  += tmp ;
+				sum2 += tmp*tmp;
+			}
+		}
+		meanROI = sum / NeROI;
+		varROI  = (sum2 / NeROI) - meanROI*meanROI;
+		q0sqr   = varROI / (meanROI*meanROI);
+
+		#pragma omp parallel for private(i, j, k, Jc, G2, L, num, den, qsqr)
+		for (j=0; j<Nc; j++) {
+			for (i=0; i<Nr; i++) {
+				k = i + Nr*j;
+				Jc = image[k];
+				dN[k] = image[iN[i] + Nr*j] - Jc;
+				dS[k] = image[iS[i] + Nr*j] - Jc;
+				dW[k] = image[i + Nr*jW[j]] - Jc;
+				dE[k] = image[i + Nr*jE[j]] - Jc;
+				G2 = (dN[k]*dN[k] + dS[k]*dS[k]
+					+ dW[k]*dW[k] + dE[k]*dE[k]) / (Jc*Jc);
+				L = (dN[k] + dS[k] + dW[k] + dE[k]) / Jc;
+				num  = (0.5*G2) - ((1.0/16.0)*(L*L)) ;
+				den  = 1 + (.25*L);
+				qsqr = num/(den*den);
+				den = (qsqr-q0sqr) / (q0sqr * (1+q0sqr)) ;
+				c[k] = 1.0 / (1.0+den) ;
+				if (c[k] < 0)
+					{c[k] = 0;}
+				else if (c[k] > 1)
+					{c[k] = 1;}
+			}
+		}
+
+		#pragma omp parallel for private(i, j, k, D, cS, cN, cW, cE)
+		for (j=0; j<Nc; j++) {
+			for (i=0; i<Nr; i++) {
+				k = i + Nr*j;
+				cN = c[k];
+				cS = c[iS[i] + Nr*j];
+				cW = c[k];
+				cE = c[i + Nr*jE[j]];
+				D = cN*dN[k] + cS*dS[k] + cW*dW[k] + cE*dE[k];
+				image[k] = image[k] + 0.25*lambda*D;
+			}
+		}
+	}
+
+}
+
+// srad_v2 (srad.cpp before the engine), row major
+static void legacy_v2(	float* J, int rows, int cols, int niter, float lambda,
+						int r1, int r2, int c1, int c2,
+						int* iN, int* iS, int* jW, int* jE,
+						float* dN, float* dS, float* dW, float* dE, float* c){
+
+	int size_R = (r2-r1+1)*(c2-c1+1);
+	float q0sqr, sum, sum2, tmp, meanROI, varROI, Jc, G2, L, num, den, qsqr, cN, cS, cW, cE, D;
+	int iter, i, j, k;
+
+	for (iter=0; iter< niter; iter++){
+		sum=0; sum2=0;
+		for (i=r1; i<=r2; i++) {
+			for (j=c1; j<=c2; j++) {
+				tmp   = J[i * cols + j];
+				sum  += tmp ;
+				sum2 += tmp*tmp;
+			}
+		}
+		meanROI = sum / size_R;
+		varROI  = (sum2 / size_R) - meanROI*meanROI;
+		q0sqr   = varROI / (meanROI*meanROI);
+
+		#pragma omp parallel for private(i, j, k, Jc, G2, L, num, den, qsqr)
+		for (i = 0 ; i < rows ; i++) {
+			for (j = 0; j < cols; j++) {
+				k = i * cols + j;
+				Jc = J[k];
+				dN[k] = J[iN[i] * cols + j] - Jc;
+				dS[k] = J[iS[i] * cols + j] - Jc;
+				dW[k] = J[i * cols + jW[j]] - Jc;
+				dE[k] = J[i * cols + jE[j]] - Jc;
+				G2 = (dN[k]*dN[k] + dS[k]*dS[k]
+					+ dW[k]*dW[k] + dE[k]*dE[k]) / (Jc*Jc);
+				L = (dN[k] + dS[k] + dW[k] + dE[k]) / Jc;
+				num  = (0.5*G2) - ((1.0/16.0)*(L*L)) ;
+				den  = 1 + (.25*L);
+				qsqr = num/(den*den);
+				den = (qsqr-q0sqr) / (q0sqr * (1+q0sqr)) ;
+				c[k] = 1.0 / (1.0+den) ;
+				if (c[k] < 0) {c[k] = 0;}
+				else if (c[k] > 1) {c[k] = 1;}
+			}
+		}
+
+		#pragma omp parallel for private(i, j, k, D, cS, cN, cW, cE)
+		for (i = 0; i < rows; i++) {
+			for (j = 0; j < cols; j++) {
+				k = i * cols + j;
+				cN = c[k];
+				cS = c[iS[i] * cols + j];
+				cW = c[k];
+				cE = c[i * cols + jE[j]];
+				D = cN * dN[k] + cS * dS[k] + cW * dW[k] + cE * dE[k];
+				J[k] = J[k] + 0.25*lambda*D;
+			}
+		}
+	}
+
+}
+
+//====================================================================================================100
+//	INPUTS
+//====================================================================================================100
+
+// speckled 0-255 test image standing in for the PGM frame of srad_v1: smooth shapes under
+// multiplicative noise, deterministic
+static void speckle_image(float* image, long rows, long cols, unsigned seed){
+
+	long i, j;
+
+	srand(seed);
+	for(j=0; j<cols; j++){
+		for(i=0; i<rows; i++){
+			double x = (double)i/rows, y = (double)j/cols;
+			double base = 96 + 64*sin(6.28*x*2)*cos(6.28*y*3) + ((x-0.5)*(x-0.5)+(y-0.5)*(y-0.5) < 0.04 ? 64 : 0);
+			double noise = 0.5 + rand()/(double)RAND_MAX;
+			double v = base*noise;
+			image[i + rows*j] = v > 255 ? 255 : (v < 1 ? 1 : (float)(int)v);
+		}
+	}
+
+}
+
+// the input of srad_v2
+static void random_image(float* image, long rows, long cols){
+
+	long k;
+
+	srand(7);
+	for(k=0; k<rows*cols; k++){
+		image[k] = rand()/(float)RAND_MAX;
+	}
+	for(k=0; k<rows*cols; k++){
+		image[k] = (float)exp(image[k]);
+	}
+
+}
+
+//====================================================================================================100
+//	BENCHMARK
+//====================================================================================================100
+
+typedef struct bench_case{
+
+	const char* name;
+	int v2;																// srad_v2 configuration, else srad_v1
+	long rows;
+	long cols;
+	int niter;
+
+} bench_case;
+
+static double max_diff(const float* a, const float* b, long n){
+
+	double worst = 0, d;
+	long k;
+
+	for(k=0; k<n; k++){
+		d = fabs((double)a[k] - b[k]) / fmax(fabs((double)b[k]), 1e-30);
+		if(d > worst || d != d){
+			worst = d;
+		}
+	}
+
+	return worst;
+
+}
+
+static double max_diff_d(const float* a, const double* b, long n){
+
+	double worst = 0, d;
+	long k;
+
+	for(k=0; k<n; k++){
+		d = fabs(a[k] - b[k]) / fmax(fabs(b[k]), 1e-30);
+		if(d > worst || d != d){
+			worst = d;
+		}
+	}
+
+	return worst;
+
+}
+
+static void run_case(const bench_case* bc, srad_engine* engine, int reps){
+
+	long Ne = bc->rows*bc->cols;
+	float* input = (float*)malloc(sizeof(float)*Ne);
+	float* legacy = (float*)malloc(sizeof(float)*Ne);
+	float* image = (float*)malloc(sizeof(float)*Ne);
+	double* imaged = (double*)malloc(sizeof(double)*Ne);
+	float* dN = (float*)malloc(sizeof(float)*Ne);
+	float* dS = (float*)malloc(sizeof(float)*Ne);
+	float* dW = (float*)malloc(sizeof(float)*Ne);
+	float* dE = (float*)malloc(sizeof(float)*Ne);
+	float* c = (float*)malloc(sizeof(float)*Ne);
+	int* iN = (int*)malloc(sizeof(int)*bc->rows);
+	int* iS = (int*)malloc(sizeof(int)*bc->rows);
+	int* jW = (int*)malloc(sizeof(int)*bc->cols);
+	int* jE = (int*)malloc(sizeof(int)*bc->cols);
+	srad_params params;
+	double t, t_legacy = 1e30, t_float = 1e30, t_double = 1e30, updates;
+	long i, k;
+	int rep;
+
+	params.rows = bc->rows;
+	params.cols = bc->cols;
+	params.niter = bc->niter;
+	params.lambda = 0.5;
+	if(bc->v2){
+		params.layout = SRAD_ROW_MAJOR;
+		params.r1 = 0; params.r2 = 127;
+		params.c1 = 0; params.c2 = 127;
+		random_image(input, bc->rows, bc->cols);
+	}
+	else{
+		params.layout = SRAD_COL_MAJOR;
+		params.r1 = 0; params.r2 = bc->rows-1;
+		params.c1 = 0; params.c2 = bc->cols-1;
+		speckle_image(input, bc->rows, bc->cols, 1);
+		srad_extract_f(input, Ne);
+	}
+
+	for(i=0; i<bc->rows; i++){
+		iN[i] = i-1;
+		iS[i] = i+1;
+	}
+	for(i=0; i<bc->cols; i++){
+		jW[i] = i-1;
+		jE[i] = i+1;
+	}
+	iN[0] = 0;
+	iS[bc->rows-1] = bc->rows-1;
+	jW[0] = 0;
+	jE[bc->cols-1] = bc->cols-1;
+
+	for(rep=0; rep<reps; rep++){
+
+		memcpy(legacy, input, sizeof(float)*Ne);
+		t = omp_get_wtime();
+		if(bc->v2){
+			legacy_v2(legacy, bc->rows, bc->cols, bc->niter, params.lambda, params.r1, params.r2, params.c1, params.c2,
+						iN, iS, jW, jE, dN, dS, dW, dE, c);
+		}
+		else{
+			legacy_v1(legacy, bc->rows, bc->cols, bc->niter, params.lambda, params.r1, params.r2, params.c1, params.c2,
+						iN, iS, jW, jE, dN, dS, dW, dE, c);
+		}
+		t = omp_get_wtime() - t;
+		t_legacy = t < t_legacy ? t : t_legacy;
+
+		memcpy(image, input, sizeof(float)*Ne);
+		t = omp_get_wtime();
+		srad_run_f(engine, &params, image);
+		t = omp_get_wtime() - t;
+		t_float = t < t_float ? t : t_float;
+
+		for(k=0; k<Ne; k++){
+			imaged[k] = input[k];
+		}
+		t = omp_get_wtime();
+		srad_run_d(engine, &params, imaged);
+		t = omp_get_wtime() - t;
+		t_double = t < t_double ? t : t_double;
+
+	}
+
+	updates = (double)Ne*bc->niter;
+	printf("%-8s %5ldx%-5ld %4d it   legacy %8.4f s %7.1f Mpx/s   float %8.4f s %7.1f Mpx/s (%5.2fx)   double %8.4f s %7.1f Mpx/s\n",
+			bc->name, bc->rows, bc->cols, bc->niter,
+			t_legacy, updates/t_legacy/1e6, t_float, updates/t_float/1e6, t_legacy/t_float, t_double, updates/t_double/1e6);
+	printf("%-8s %30s max rel diff float-legacy %.3e   float-double %.3e   legacy-double %.3e\n", "", "",
+			max_diff(image, legacy, Ne), max_diff_d(image, imaged, Ne), max_diff_d(legacy, imaged, Ne));
+
+	free(input); free(legacy); free(image); free(imaged);
+	free(dN); free(dS); free(dW); free(dE); free(c);
+	free(iN); free(iS); free(jW); free(jE);
+
+}
+
+// IMAGES srad_v1 frames through srad_denoise_f at once and one call at a time
+static void run_images(srad_engine* engine, long rows, long cols, int niter, int reps){
+
+	long Ne = rows*cols;
+	float* input = (float*)malloc(sizeof(float)*Ne*IMAGES);
+	float* work = (float*)malloc(sizeof(float)*Ne*IMAGES);
+	float* images[IMAGES];
+	srad_params params[IMAGES];
+	double t, t_single = 1e30, t_multi = 1e30;
+	int k, rep;
+
+	for(k=0; k<IMAGES; k++){
+		speckle_image(input + Ne*k, rows, cols, k+1);
+		images[k] = work + Ne*k;
+		params[k].rows = rows;
+		params[k].cols = cols;
+		params[k].layout = SRAD_COL_MAJOR;
+		params[k].r1 = 0; params[k].r2 = rows-1;
+		params[k].c1 = 0; params[k].c2 = cols-1;
+		params[k].niter = niter;
+		params[k].lambda = 0.5;
+	}
+
+	for(rep=0; rep<reps; rep++){
+
+		memcpy(work, input, sizeof(float)*Ne*IMAGES);
+		t = omp_get_wtime();
+		for(k=0; k<IMAGES; k++){
+			srad_denoise_f(engine, &params[k], &images[k], 1);
+		}
+		t = omp_get_wtime() - t;
+		t_single = t < t_single ? t : t_single;
+
+		memcpy(work, input, sizeof(float)*Ne*IMAGES);
+		t = omp_get_wtime();
+		srad_denoise_f(engine, params, images, IMAGES);
+		t = omp_get_wtime() - t;
+		t_multi = t < t_multi ? t : t_multi;
+
+	}
+
+	printf("images   %5ldx%-5ld %4d it   %d images   one at a time %8.4f s %7.1f img/s   srad_denoise %8.4f s %7.1f img/s (%5.2fx)\n",
+			rows, cols, niter, IMAGES, t_single, IMAGES/t_single, t_multi, IMAGES/t_multi, t_single/t_multi);
+
+	free(input);
+	free(work);
+
+}
+
+int main(int argc, char* argv[]){
+
+	bench_case cases[] = {
+		{ "srad_v1", 0,  502,  458, 100 },								// the default run of srad_v1
+		{ "srad_v1", 0, 2048, 2048,  10 },
+		{ "srad_v2", 1, 2048, 2048,  10 },								// the default run of srad_v2 (2 iterations there)
+		{ "srad_v2", 1, 4096, 4096,  10 },
+	};
+	srad_engine* engine;
+	int threads, reps, i;
+
+	threads = argc > 1 ? atoi(argv[1]) : omp_get_max_threads();
+	reps = argc > 2 ? atoi(argv[2]) : 3;
+	omp_set_num_threads(threads);
+
+	engine = srad_create(threads);
+	if(engine == NULL){
+		printf("ERROR: can not create the SRAD engine\n");
+		return 1;
+	}
+
+	printf("threads %d, best of %d\n", threads, reps);
+	for(i=0; i<(int)(sizeof(cases)/sizeof(cases[0])); i++){
+		run_case(&cases[i], engine, reps);
+	}
+	run_images(engine, 502, 458, 100, reps);
+
+	srad_destroy(engine);
+
+	return 0;
+
+}
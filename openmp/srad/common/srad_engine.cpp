@@ -0,0 +1,509 @@
+//====================================================================================================100
+//====================================================================================================100
+//	SRAD ENGINE
+//====================================================================================================100
+//====================================================================================================100
+
+// The legacy kernels make two passes over the image per iteration: the first stores the four
+// directional derivatives and the diffusion coefficient of every pixel (five image sized scratch
+// arrays), the second reads them back to update the image, and the ROI statistics of the next
+// iteration take a third, serial pass. Neighbours are found through clamped index arrays, which
+// keeps the loops from vectorizing.
+//
+// Here an iteration is a single sweep. The image is seen as lines, the runs of pixels contiguous in
+// memory (columns for column major, rows for row major). Every thread owns a band of lines and keeps
+// the coefficients of two lines only: updating line l needs the coefficients of lines l and l+1, so
+// the coefficients of l+1 are computed, line l is written to the other image of a ping-pong pair,
+// and the two coefficient lines swap. Derivatives are recomputed rather than stored. The ROI sums
+// of the updated lines are kept per line, in double, for the next iteration; they are read by every
+// thread after the one barrier of the iteration. The boundary pixels of a line are done apart so
+// the loop over its interior has no clamping and vectorizes.
+//
+// The per pixel arithmetic is the expressions of the legacy kernels, in the same order and with the
+// same promotions, so for float images the engine differs from them only through the ROI statistics,
+// which the legacy kernels sum in float.
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+
+#include "srad_engine.h"
+
+#define SRAD_ALIGN 64													// alignment of the scratch buffers
+
+struct srad_engine{
+
+	int threads;														// threads of the kernels, < 1 for the OpenMP default
+
+	void* image;														// second image of the ping-pong
+	size_t image_size;
+	void* ring;															// two lines of coefficients per thread
+	size_t ring_size;
+	void* stats;														// ROI sum and sum of squares per line, for two iterations
+	size_t stats_size;
+
+	srad_engine** workers;												// single threaded engines of srad_denoise, one per thread
+	int nworkers;
+
+};
+
+//====================================================================================================100
+//	ENGINE
+//====================================================================================================100
+
+srad_engine* srad_create(int threads){
+
+	srad_engine* engine;
+
+	engine = (srad_engine*)calloc(1, sizeof(srad_engine));
+	if(engine == NULL){
+		return NULL;
+	}
+	engine->threads = threads;
+
+	return engine;
+
+}
+
+void srad_destroy(srad_engine* engine){
+
+	int i;
+
+	if(engine == NULL){
+		return;
+	}
+	for(i=0; i<engine->nworkers; i++){
+		srad_destroy(engine->workers[i]);
+	}
+	free(engine->workers);
+	free(engine->image);
+	free(engine->ring);
+	free(engine->stats);
+	free(engine);
+
+}
+
+static int engine_threads(const srad_engine* engine){
+
+	return engine->threads > 0 ? engine->threads : omp_get_max_threads();
+
+}
+
+// grow a scratch buffer to at least size bytes, 0 on success
+static int reserve(void** buffer, size_t* have, size_t size){
+
+	void* grown;
+
+	if(size <= *have){
+		return 0;
+	}
+	if(posix_memalign(&grown, SRAD_ALIGN, size)){
+		return -1;
+	}
+	free(*buffer);
+	*buffer = grown;
+	*have = size;
+
+	return 0;
+
+}
+
+int srad_check(const srad_params* params){
+
+	if(params->rows < 1 || params->cols < 1){
+		return -1;
+	}
+	if(params->layout != SRAD_COL_MAJOR && params->layout != SRAD_ROW_MAJOR){
+		return -1;
+	}
+	if(params->r1 < 0 || params->r1 > params->r2 || params->r2 >= params->rows){
+		return -1;
+	}
+	if(params->c1 < 0 || params->c1 > params->c2 || params->c2 >= params->cols){
+		return -1;
+	}
+	if(params->niter < 0){
+		return -1;
+	}
+
+	return 0;
+
+}
+
+//====================================================================================================100
+//	PIXEL
+//====================================================================================================100
+
+// diffusion coefficient from the N/S/W/E derivatives, saturated to 0-1 (NaN passes, as in the legacy kernels)
+template <typename T>
+static inline T coefficient(T Jc, T dN, T dS, T dW, T dE, T q0sqr){
+
+	T G2, L, num, den, qsqr, c;
+
+	G2 = (dN*dN + dS*dS + dW*dW + dE*dE) / (Jc*Jc);						// normalized discrete gradient mag squared (equ 52,53)
+	L = (dN + dS + dW + dE) / Jc;										// normalized discrete laplacian (equ 54)
+	num  = (0.5*G2) - ((1.0/16.0)*(L*L));								// ICOV (equ 31/35)
+	den  = 1 + (.25*L);
+	qsqr = num/(den*den);
+	den = (qsqr-q0sqr) / (q0sqr * (1+q0sqr));							// diffusion coefficent (equ 33)
+	c = 1.0 / (1.0+den);
+	c = c < 0 ? 0 : c;
+	c = c > 1 ? 1 : c;
+
+	return c;
+
+}
+
+// coefficient of pixel x of line J, xa/xb being its neighbours along the line and P/Q the lines before/after
+template <typename T, bool RowMajor>
+static inline T coefficient_at(const T* P, const T* J, const T* Q, long x, long xa, long xb, T q0sqr){
+
+	T Jc, dA, dB, dP, dQ;
+
+	Jc = J[x];
+	dA = J[xa] - Jc;
+	dB = J[xb] - Jc;
+	dP = P[x] - Jc;
+	dQ = Q[x] - Jc;
+
+	if(RowMajor){
+		return coefficient(Jc, dP, dQ, dA, dB, q0sqr);
+	}
+	return coefficient(Jc, dA, dB, dP, dQ, q0sqr);
+
+}
+
+// updated pixel x of line J, cl/cq being the coefficients of line J and of the line after
+template <typename T, bool RowMajor>
+static inline T update_at(const T* P, const T* J, const T* Q, const T* cl, const T* cq, long x, long xa, long xb, T lambda){
+
+	T Jc, dA, dB, dP, dQ, D;
+
+	Jc = J[x];
+	dA = J[xa] - Jc;
+	dB = J[xb] - Jc;
+	dP = P[x] - Jc;
+	dQ = Q[x] - Jc;
+
+	if(RowMajor){
+		D = cl[x]*dP + cq[x]*dQ + cl[x]*dA + cl[xb]*dB;					// divergence (equ 58)
+	}
+	else{
+		D = cl[x]*dA + cl[xb]*dB + cl[x]*dP + cq[x]*dQ;
+	}
+
+	return Jc + 0.25*lambda*D;											// image update (equ 61)
+
+}
+
+//====================================================================================================100
+//	LINE
+//====================================================================================================100
+
+// coefficients of line l into cl
+template <typename T, bool RowMajor>
+static void coefficient_line(const T* image, long l, long nlines, long len, T q0sqr, T* cl){
+
+	const T* J = image + l*len;
+	const T* P = image + (l > 0 ? l-1 : 0)*len;
+	const T* Q = image + (l < nlines-1 ? l+1 : l)*len;
+	long x;
+
+	cl[0] = coefficient_at<T, RowMajor>(P, J, Q, 0, 0, len > 1 ? 1 : 0, q0sqr);
+	#pragma omp simd
+	for(x=1; x<len-1; x++){
+		cl[x] = coefficient_at<T, RowMajor>(P, J, Q, x, x-1, x+1, q0sqr);
+	}
+	if(len > 1){
+		cl[len-1] = coefficient_at<T, RowMajor>(P, J, Q, len-1, len-2, len-1, q0sqr);
+	}
+
+}
+
+// line l of image updated into out, with the coefficients cl of line l and cq of the line after
+template <typename T, bool RowMajor>
+static void update_line(const T* image, T* out, long l, long nlines, long len, const T* cl, const T* cq, T lambda){
+
+	const T* J = image + l*len;
+	const T* P = image + (l > 0 ? l-1 : 0)*len;
+	const T* Q = image + (l < nlines-1 ? l+1 : l)*len;
+	T* O = out + l*len;
+	long x;
+
+	O[0] = update_at<T, RowMajor>(P, J, Q, cl, cq, 0, 0, len > 1 ? 1 : 0, lambda);
+	#pragma omp simd
+	for(x=1; x<len-1; x++){
+		O[x] = update_at<T, RowMajor>(P, J, Q, cl, cq, x, x-1, x+1, lambda);
+	}
+	if(len > 1){
+		O[len-1] = update_at<T, RowMajor>(P, J, Q, cl, cq, len-1, len-2, len-1, lambda);
+	}
+
+}
+
+// sum and sum of squares of pixels x1..x2 of a line
+template <typename T>
+static inline void line_stats(const T* J, long x1, long x2, double* stats){
+
+	double sum = 0, sum2 = 0;
+	long x;
+
+	#pragma omp simd reduction(+: sum, sum2)
+	for(x=x1; x<=x2; x++){
+		double tmp = J[x];
+		sum += tmp;
+		sum2 += tmp*tmp;
+	}
+	stats[0] = sum;
+	stats[1] = sum2;
+
+}
+
+//====================================================================================================100
+//	DIFFUSION
+//====================================================================================================100
+
+template <typename T, bool RowMajor>
+static int diffuse(srad_engine* engine, const srad_params* params, T* image){
+
+	long nlines, len, l1, l2, x1, x2;
+	double NeROI;
+	T lambda;
+	T* other;
+	T* ring;
+	double* stats;
+	int nthreads, niter;
+
+	// lines and ROI in line coordinates
+	nlines = RowMajor ? params->rows : params->cols;
+	len    = RowMajor ? params->cols : params->rows;
+	l1 = RowMajor ? params->r1 : params->c1;
+	l2 = RowMajor ? params->r2 : params->c2;
+	x1 = RowMajor ? params->c1 : params->r1;
+	x2 = RowMajor ? params->c2 : params->r2;
+	NeROI = (double)(params->r2-params->r1+1) * (params->c2-params->c1+1);
+	lambda = params->lambda;
+	niter = params->niter;
+
+	nthreads = engine_threads(engine);
+	if(nthreads > nlines){
+		nthreads = nlines;
+	}
+
+	if(reserve(&engine->image, &engine->image_size, nlines*len*sizeof(T))
+		|| reserve(&engine->ring, &engine->ring_size, nthreads*2*len*sizeof(T))
+		|| reserve(&engine->stats, &engine->stats_size, 2*2*nlines*sizeof(double))){
+		return -1;
+	}
+	other = (T*)engine->image;
+	ring = (T*)engine->ring;
+	stats = (double*)engine->stats;
+
+	#pragma omp parallel num_threads(nthreads)
+	{
+		int tid = omp_get_thread_num();
+		int nt = omp_get_num_threads();
+		long first = nlines*tid/nt;										// band of lines of this thread
+		long last = nlines*(tid+1)/nt;
+		T* cl = ring + 2*len*tid;
+		T* cq = cl + len;
+		T* in = image;
+		T* out = other;
+		T* t;
+		long l;
+		int iter;
+
+		for(l=first; l<last; l++){
+			if(l >= l1 && l <= l2){
+				line_stats(in + l*len, x1, x2, stats + 2*l);
+			}
+		}
+		#pragma omp barrier
+
+		for(iter=0; iter<niter; iter++){
+
+			double* cur = stats + 2*nlines*(iter%2);
+			double* next = stats + 2*nlines*((iter+1)%2);
+			double sum = 0, sum2 = 0, meanROI, varROI;
+			T q0sqr;
+
+			// ROI statistics, from the sums of the previous sweep
+			for(l=l1; l<=l2; l++){
+				sum += cur[2*l];
+				sum2 += cur[2*l+1];
+			}
+			meanROI = sum / NeROI;
+			varROI  = (sum2 / NeROI) - meanROI*meanROI;
+			q0sqr   = varROI / (meanROI*meanROI);
+
+			if(first < last){
+				coefficient_line<T, RowMajor>(in, first, nlines, len, q0sqr, cl);
+			}
+			for(l=first; l<last; l++){
+				if(l+1 < nlines){
+					coefficient_line<T, RowMajor>(in, l+1, nlines, len, q0sqr, cq);
+					update_line<T, RowMajor>(in, out, l, nlines, len, cl, cq, lambda);
+				}
+				else{
+					update_line<T, RowMajor>(in, out, l, nlines, len, cl, cl, lambda);
+				}
+				if(l >= l1 && l <= l2){
+					line_stats(out + l*len, x1, x2, next + 2*l);
+				}
+				t = cl; cl = cq; cq = t;
+			}
+
+			t = in; in = out; out = t;
+			#pragma omp barrier
+
+		}
+
+		// after an odd number of iterations the result is in the other image
+		if(in != image && first < last){
+			memcpy(image + first*len, in + first*len, (last-first)*len*sizeof(T));
+		}
+	}
+
+	return 0;
+
+}
+
+template <typename T>
+static int run(srad_engine* engine, const srad_params* params, T* image){
+
+	if(srad_check(params)){
+		return -1;
+	}
+	if(params->niter == 0){
+		return 0;
+	}
+	if(params->layout == SRAD_ROW_MAJOR){
+		return diffuse<T, true>(engine, params, image);
+	}
+	return diffuse<T, false>(engine, params, image);
+
+}
+
+int srad_run_f(srad_engine* engine, const srad_params* params, float* image){
+
+	return run(engine, params, image);
+
+}
+
+int srad_run_d(srad_engine* engine, const srad_params* params, double* image){
+
+	return run(engine, params, image);
+
+}
+
+//====================================================================================================100
+//	EXTRACT / COMPRESS
+//====================================================================================================100
+
+// the legacy expressions, computed in double (math.h in C++ would otherwise pick expf/logf for float)
+template <typename T>
+static void extract(T* image, long n, int nthreads){
+
+	long i;
+
+	#pragma omp parallel for num_threads(nthreads)
+	for(i=0; i<n; i++){
+		image[i] = exp((double)(image[i]/255));
+	}
+
+}
+
+template <typename T>
+static void compress(T* image, long n, int nthreads){
+
+	long i;
+
+	#pragma omp parallel for num_threads(nthreads)
+	for(i=0; i<n; i++){
+		image[i] = log((double)image[i])*255;
+	}
+
+}
+
+void srad_extract_f(float* image, long n){ extract(image, n, omp_get_max_threads()); }
+void srad_extract_d(double* image, long n){ extract(image, n, omp_get_max_threads()); }
+void srad_compress_f(float* image, long n){ compress(image, n, omp_get_max_threads()); }
+void srad_compress_d(double* image, long n){ compress(image, n, omp_get_max_threads()); }
+
+//====================================================================================================100
+//	MULTI-IMAGE
+//====================================================================================================100
+
+template <typename T>
+static int denoise_one(srad_engine* engine, const srad_params* params, T* image){
+
+	long n;
+
+	if(srad_check(params)){
+		return 1;
+	}
+	n = params->rows * params->cols;
+	extract(image, n, engine_threads(engine));
+	if(run(engine, params, image)){
+		return 1;
+	}
+	compress(image, n, engine_threads(engine));
+
+	return 0;
+
+}
+
+template <typename T>
+static int denoise(srad_engine* engine, const srad_params* params, T** images, int count){
+
+	int nthreads, failed, i, k;
+
+	nthreads = engine_threads(engine);
+	failed = 0;
+
+	// one image after the other with all threads
+	if(count < nthreads || nthreads == 1){
+		for(k=0; k<count; k++){
+			failed += denoise_one(engine, &params[k], images[k]);
+		}
+		return failed;
+	}
+
+	// whole images per thread, each with a single threaded engine of its own
+	if(engine->nworkers < nthreads){
+		srad_engine** workers = (srad_engine**)realloc(engine->workers, nthreads*sizeof(srad_engine*));
+		if(workers == NULL){
+			return count;
+		}
+		engine->workers = workers;
+		for(i=engine->nworkers; i<nthreads; i++){
+			workers[i] = srad_create(1);
+			if(workers[i] == NULL){
+				engine->nworkers = i;
+				return count;
+			}
+		}
+		engine->nworkers = nthreads;
+	}
+
+	#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads) reduction(+: failed)
+	for(k=0; k<count; k++){
+		failed += denoise_one(engine->workers[omp_get_thread_num()], &params[k], images[k]);
+	}
+
+	return failed;
+
+}
+
+int srad_denoise_f(srad_engine* engine, const srad_params* params, float** images, int count){
+
+	return denoise(engine, params, images, count);
+
+}
+
+int srad_denoise_d(srad_engine* engine, const srad_params* params, double** images, int count){
+
+	return denoise(engine, params, images, count);
+
+}
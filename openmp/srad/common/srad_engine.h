@@ -0,0 +1,82 @@
+//====================================================================================================100
+//====================================================================================================100
+//	SRAD ENGINE
+//====================================================================================================100
+//====================================================================================================100
+
+// Speckle reducing anisotropic diffusion as a library, shared by srad_v1 (column major PGM frames,
+// whole image ROI) and srad_v2 (row major random matrix, speckle ROI) and callable from other
+// programs. The image is given by its dimensions and storage order, the diffusion by the ROI whose
+// statistics drive it, lambda and the number of iterations. One kernel, templated on the element
+// type, serves float and double images.
+//
+// An engine owns the scratch of the computation (grown to the largest image it has seen) and the
+// number of OpenMP threads it runs with, so that repeated calls do not allocate. An engine must not
+// be used by two threads at once.
+
+#ifndef SRAD_ENGINE_H
+#define SRAD_ENGINE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// storage order of an image
+#define SRAD_COL_MAJOR 0												// pixel (i, j) at i + rows*j, as in srad_v1
+#define SRAD_ROW_MAJOR 1												// pixel (i, j) at i*cols + j, as in srad_v2
+
+typedef struct srad_params{
+
+	long rows;															// image size
+	long cols;
+	int layout;															// SRAD_COL_MAJOR or SRAD_ROW_MAJOR
+	int r1;																// ROI, first and last row and column (inclusive)
+	int r2;
+	int c1;
+	int c2;
+	int niter;															// number of iterations
+	double lambda;														// update step size
+
+} srad_params;
+
+typedef struct srad_engine srad_engine;
+
+// threads < 1 runs with the OpenMP default number of threads
+srad_engine* srad_create(int threads);
+void srad_destroy(srad_engine* engine);
+
+// 0 if the parameters describe a valid image and ROI, -1 otherwise
+int srad_check(const srad_params* params);
+
+// niter diffusion iterations over an image already scaled by srad_extract, in place
+int srad_run_f(srad_engine* engine, const srad_params* params, float* image);
+int srad_run_d(srad_engine* engine, const srad_params* params, double* image);
+
+// scale an image from 0-255 down to 0-1 and exponentiate, and back
+void srad_extract_f(float* image, long n);
+void srad_extract_d(double* image, long n);
+void srad_compress_f(float* image, long n);
+void srad_compress_d(double* image, long n);
+
+// denoises count 0-255 images in place (extract, diffuse, compress), image k with params[k].
+// With at least as many images as threads every thread takes whole images, otherwise the
+// images are done one after the other with all threads. Returns the number of images that
+// failed the parameter check (and were left untouched).
+int srad_denoise_f(srad_engine* engine, const srad_params* params, float** images, int count);
+int srad_denoise_d(srad_engine* engine, const srad_params* params, double** images, int count);
+
+#ifdef __cplusplus
+}
+
+// overloads on the element type for C++ callers
+inline int srad_run(srad_engine* engine, const srad_params* params, float* image){ return srad_run_f(engine, params, image); }
+inline int srad_run(srad_engine* engine, const srad_params* params, double* image){ return srad_run_d(engine, params, image); }
+inline void srad_extract(float* image, long n){ srad_extract_f(image, n); }
+inline void srad_extract(double* image, long n){ srad_extract_d(image, n); }
+inline void srad_compress(float* image, long n){ srad_compress_f(image, n); }
+inline void srad_compress(double* image, long n){ srad_compress_d(image, n); }
+inline int srad_denoise(srad_engine* engine, const srad_params* params, float** images, int count){ return srad_denoise_f(engine, params, images, count); }
+inline int srad_denoise(srad_engine* engine, const srad_params* params, double** images, int count){ return srad_denoise_d(engine, params, images, count); }
+#endif
+
+#endif
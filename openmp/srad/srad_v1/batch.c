@@ -0,0 +1,670 @@
+//====================================================================================================100
+//====================================================================================================100
+//	INCLUDE/DEFINE
+//====================================================================================================100
+//====================================================================================================100
+
+#include <pthread.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+// pipeline stages, every frame passes through all of them in order
+#define STAGE_READ 0
+#define STAGE_RESIZE 1
+#define STAGE_COMPUTE 2
+#define STAGE_WRITE 3
+#define STAGES 4
+
+#define BATCH_PATH 1024
+
+//====================================================================================================100
+//====================================================================================================100
+//	STRUCTURES
+//====================================================================================================100
+//====================================================================================================100
+
+// one slot of the bounded pipeline, reused for every frame that flows through it
+
+typedef struct frame_slot{
+
+	char in_name[BATCH_PATH];
+	char out_name[BATCH_PATH];
+	int ok;																// cleared by a stage that failed, later stages pass the slot through
+
+	fp* raw;															// image as read from file (column major)
+	int raw_rows;
+	int raw_cols;
+	long raw_cap;
+
+	fp* image;															// resized image (Nr x Nc, column major)
+
+	long long start;
+	long long stage_time[STAGES];
+
+} frame_slot;
+
+// FIFO of slots between two stages, can never hold more than the number of slots
+
+typedef struct frame_queue{
+
+	frame_slot** items;
+	int cap;
+	int head;
+	int count;
+	int closed;
+	int producers;														// workers still feeding this queue, last one to finish closes it
+	pthread_mutex_t lock;
+	pthread_cond_t ready;
+
+} frame_queue;
+
+// state shared by all workers of the pipeline
+
+typedef struct batch_state{
+
+	frame_queue queue[STAGES+1];										// queue[s] feeds stage s, queue[STAGES] returns slots to the feeder
+
+	long Nr;
+	long Nc;
+	int niter;
+	fp lambda;
+	int threads;
+
+	srad_params params;													// diffusion of every frame
+
+	// statistics, accumulated by the write stage
+	pthread_mutex_t stats_lock;
+	int frames_done;
+	int frames_failed;
+	long long stage_sum[STAGES];
+	long long stage_max[STAGES];
+	long long latency_sum;
+	long long latency_max;
+
+} batch_state;
+
+// argument of a worker thread
+
+typedef struct batch_worker{
+
+	batch_state* state;
+	int stage;
+	pthread_t thread;
+
+} batch_worker;
+
+//====================================================================================================100
+//====================================================================================================100
+//	QUEUE FUNCTIONS
+//====================================================================================================100
+//====================================================================================================100
+
+void queue_init(	frame_queue* q,
+						int cap,
+						int producers){
+
+	q->items = (frame_slot**)malloc(sizeof(frame_slot*) * cap);
+	q->cap = cap;
+	q->head = 0;
+	q->count = 0;
+	q->closed = 0;
+	q->producers = producers;
+	pthread_mutex_init(&q->lock, NULL);
+	pthread_cond_init(&q->ready, NULL);
+
+}
+
+void queue_destroy(frame_queue* q){
+
+	free(q->items);
+	pthread_mutex_destroy(&q->lock);
+	pthread_cond_destroy(&q->ready);
+
+}
+
+void queue_push(	frame_queue* q,
+						frame_slot* slot){
+
+	pthread_mutex_lock(&q->lock);
+	q->items[(q->head + q->count) % q->cap] = slot;
+	q->count++;
+	pthread_cond_signal(&q->ready);
+	pthread_mutex_unlock(&q->lock);
+
+}
+
+// blocks until a slot is available, returns NULL once the queue is closed and drained
+
+frame_slot* queue_pop(frame_queue* q){
+
+	frame_slot* slot = NULL;
+
+	pthread_mutex_lock(&q->lock);
+	while(q->count == 0 && !q->closed){
+		pthread_cond_wait(&q->ready, &q->lock);
+	}
+	if(q->count > 0){
+		slot = q->items[q->head];
+		q->head = (q->head + 1) % q->cap;
+		q->count--;
+	}
+	pthread_mutex_unlock(&q->lock);
+
+	return slot;
+
+}
+
+// called once by every producer when it is done, the last one wakes up all consumers
+
+void queue_close(frame_queue* q){
+
+	pthread_mutex_lock(&q->lock);
+	q->producers--;
+	if(q->producers <= 0){
+		q->closed = 1;
+		pthread_cond_broadcast(&q->ready);
+	}
+	pthread_mutex_unlock(&q->lock);
+
+}
+
+//====================================================================================================100
+//====================================================================================================100
+//	FRAME LIST FUNCTIONS
+//====================================================================================================100
+//====================================================================================================100
+
+int compare_names(	const void* a,
+							const void* b){
+
+	return strcmp(*(char* const*)a, *(char* const*)b);
+
+}
+
+// collects input frames from a directory (all *.pgm files, sorted by name) or from a list file (one path per line), returns their number or -1
+// if input cannot be read (reported here)
+
+int batch_list(	char* input,
+					char*** names){
+
+	//================================================================================80
+	//	VARIABLES
+	//================================================================================80
+
+	struct stat st;
+	DIR* dir;
+	struct dirent* entry;
+	FILE* fid;
+	char line[BATCH_PATH];
+	int count, cap;
+	size_t len;
+
+	count = 0;
+	cap = 64;
+	*names = (char**)malloc(sizeof(char*) * cap);
+
+	if(stat(input, &st) != 0){
+		printf("ERROR: cannot access %s\n", input);
+		return -1;
+	}
+
+	//================================================================================80
+	//	DIRECTORY
+	//================================================================================80
+
+	if(S_ISDIR(st.st_mode)){
+
+		dir = opendir(input);
+		if(dir == NULL){
+			printf("ERROR: cannot open directory %s\n", input);
+			return -1;
+		}
+		while((entry = readdir(dir)) != NULL){
+			len = strlen(entry->d_name);
+			if(len < 4 || strcmp(entry->d_name + len - 4, ".pgm") != 0){
+				continue;
+			}
+			if(count == cap){
+				cap = cap * 2;
+				*names = (char**)realloc(*names, sizeof(char*) * cap);
+			}
+			(*names)[count] = (char*)malloc(strlen(input) + len + 2);
+			sprintf((*names)[count], "%s/%s", input, entry->d_name);
+			count++;
+		}
+		closedir(dir);
+
+		qsort(*names, count, sizeof(char*), compare_names);
+
+	}
+
+	//================================================================================80
+	//	LIST FILE
+	//================================================================================80
+
+	else{
+
+		fid = fopen(input, "r");
+		if(fid == NULL){
+			printf("ERROR: cannot open list file %s\n", input);
+			return -1;
+		}
+		while(fgets(line, BATCH_PATH, fid) != NULL){
+			len = strlen(line);
+			while(len > 0 && (line[len-1] == '\n' || line[len-1] == '\r' || line[len-1] == ' ')){
+				line[--len] = '\0';
+			}
+			if(len == 0){
+				continue;
+			}
+			if(count == cap){
+				cap = cap * 2;
+				*names = (char**)realloc(*names, sizeof(char*) * cap);
+			}
+			(*names)[count] = strdup(line);
+			count++;
+		}
+		fclose(fid);
+
+	}
+
+	return count;
+
+}
+
+// output paths of the frames, out_dir/<frame>_out.pgm, or out_dir/<index>_<frame>_out.pgm for every frame if two frames of a list
+// share a name
+
+char** batch_out_names(	char** names,
+								int nframes,
+								char* out_dir){
+
+	char** out;
+	char** sorted;
+	char* base;
+	char* dot;
+	int indexed, f;
+
+	out = (char**)malloc(sizeof(char*) * nframes);
+	sorted = (char**)malloc(sizeof(char*) * nframes);
+
+	for(indexed=0; indexed<2; indexed++){
+
+		for(f=0; f<nframes; f++){
+			base = strrchr(names[f], '/');
+			base = (base == NULL) ? names[f] : base + 1;
+			dot = strrchr(base, '.');
+			out[f] = (char*)malloc(BATCH_PATH);
+			if(indexed){
+				snprintf(out[f], BATCH_PATH, "%s/%d_%.*s_out.pgm", out_dir, f, dot == NULL ? (int)strlen(base) : (int)(dot - base), base);
+			}
+			else{
+				snprintf(out[f], BATCH_PATH, "%s/%.*s_out.pgm", out_dir, dot == NULL ? (int)strlen(base) : (int)(dot - base), base);
+			}
+			sorted[f] = out[f];
+		}
+
+		// names are unique if no two neighbours are equal once sorted
+		qsort(sorted, nframes, sizeof(char*), compare_names);
+		for(f=1; f<nframes && strcmp(sorted[f-1], sorted[f]) != 0; f++){
+		}
+		if(f >= nframes || indexed){
+			break;
+		}
+
+		printf("WARNING: frames share the output name %s, output names are prefixed with the frame index\n", sorted[f]);
+		for(f=0; f<nframes; f++){
+			free(out[f]);
+		}
+
+	}
+
+	free(sorted);
+
+	return out;
+
+}
+
+//====================================================================================================100
+//====================================================================================================100
+//	STAGE FUNCTIONS
+//====================================================================================================100
+//====================================================================================================100
+
+void stage_read(	batch_state* state,
+						frame_slot* slot){
+
+	long elem;
+
+	if(read_graphics_size(slot->in_name, &slot->raw_rows, &slot->raw_cols) != 0){
+		slot->ok = 0;
+		return;
+	}
+
+	// grow the slot's raw buffer only when a larger frame comes along
+	elem = (long)slot->raw_rows * slot->raw_cols;
+	if(elem > slot->raw_cap){
+		free(slot->raw);
+		slot->raw = (fp*)malloc(sizeof(fp) * elem);
+		slot->raw_cap = elem;
+	}
+
+	read_graphics(	slot->in_name,
+							slot->raw,
+							slot->raw_rows,
+							slot->raw_cols,
+							1);
+
+}
+
+void stage_resize(	batch_state* state,
+							frame_slot* slot){
+
+	resize(	slot->raw,
+				slot->raw_rows,
+				slot->raw_cols,
+				slot->image,
+				state->Nr,
+				state->Nc,
+				1);
+
+	srad_extract(slot->image, state->Nr*state->Nc);
+
+}
+
+void stage_compute(	batch_state* state,
+								frame_slot* slot,
+								srad_engine* engine){
+
+	if(engine == NULL || srad(engine, &state->params, slot->image)){
+		slot->ok = 0;
+		return;
+	}
+
+	srad_compress(slot->image, state->Nr*state->Nc);
+
+}
+
+void stage_write(	batch_state* state,
+						frame_slot* slot){
+
+	write_graphics(	slot->out_name,
+							slot->image,
+							state->Nr,
+							state->Nc,
+							1,
+							255);
+
+}
+
+//====================================================================================================100
+//====================================================================================================100
+//	WORKER FUNCTION
+//====================================================================================================100
+//====================================================================================================100
+
+void* batch_worker_main(void* arg){
+
+	//================================================================================80
+	//	VARIABLES
+	//================================================================================80
+
+	batch_worker* worker = (batch_worker*)arg;
+	batch_state* state = worker->state;
+	int stage = worker->stage;
+	frame_slot* slot;
+	long long t0, t1;
+	int s;
+
+	// scratch of the compute stage, private to the worker
+	srad_engine* engine = NULL;
+
+	if(stage == STAGE_RESIZE){
+		omp_set_num_threads(1);												// extraction stays serial, the threads belong to the compute stage
+	}
+	if(stage == STAGE_COMPUTE){
+		omp_set_num_threads(state->threads);								// number of threads is per calling thread in OpenMP
+		engine = srad_create(state->threads);
+	}
+
+	//================================================================================80
+	//	PROCESS FRAMES UNTIL THE INPUT QUEUE IS DRAINED
+	//================================================================================80
+
+	while((slot = queue_pop(&state->queue[stage])) != NULL){
+
+		t0 = get_time();
+		if(slot->ok){
+			switch(stage){
+				case STAGE_READ:		stage_read(state, slot);								break;
+				case STAGE_RESIZE:		stage_resize(state, slot);								break;
+				case STAGE_COMPUTE:	stage_compute(state, slot, engine);				break;
+				case STAGE_WRITE:		stage_write(state, slot);								break;
+			}
+		}
+		t1 = get_time();
+		slot->stage_time[stage] = t1 - t0;
+
+		// last stage accounts the frame before its slot is recycled
+		if(stage == STAGE_WRITE){
+			pthread_mutex_lock(&state->stats_lock);
+			if(slot->ok){
+				state->frames_done++;
+				for(s=0; s<STAGES; s++){
+					state->stage_sum[s] += slot->stage_time[s];
+					if(slot->stage_time[s] > state->stage_max[s]){
+						state->stage_max[s] = slot->stage_time[s];
+					}
+				}
+				state->latency_sum += t1 - slot->start;
+				if(t1 - slot->start > state->latency_max){
+					state->latency_max = t1 - slot->start;
+				}
+			}
+			else{
+				state->frames_failed++;
+			}
+			pthread_mutex_unlock(&state->stats_lock);
+		}
+
+		queue_push(&state->queue[stage+1], slot);
+
+	}
+
+	queue_close(&state->queue[stage+1]);
+
+	srad_destroy(engine);
+
+	return NULL;
+
+}
+
+//====================================================================================================100
+//====================================================================================================100
+//	BATCH FUNCTION
+//====================================================================================================100
+//====================================================================================================100
+
+// denoises every frame of a directory or list file, overlapping read, resize, diffusion and write of
+// up to depth frames. Outputs go to out_dir as <frame>_out.pgm, see batch_out_names.
+
+int srad_batch(	char* input,
+					char* out_dir,
+					int depth,
+					int niter,
+					fp lambda,
+					long Nr,
+					long Nc,
+					int threads){
+
+	//================================================================================80
+	//	VARIABLES
+	//================================================================================80
+
+	char** names;
+	char** out_names;
+	int nframes;
+	int workers[STAGES] = {BATCH_IO_THREADS, 1, 1, BATCH_IO_THREADS};
+	char* stage_names[STAGES] = {"READ IMAGE FROM FILE", "RESIZE + EXTRACT IMAGE", "COMPUTE + COMPRESS IMAGE", "SAVE IMAGE INTO FILE"};
+	batch_state state;
+	frame_slot* slots;
+	batch_worker* pool;
+	frame_slot* slot;
+	int nworkers;
+	long long time0, time1;
+	double total;
+	int f, s, w;
+
+	//================================================================================80
+	//	FRAME LIST
+	//================================================================================80
+
+	nframes = batch_list(input, &names);
+	if(nframes <= 0){
+		if(nframes == 0){
+			printf("ERROR: no PGM frames found in %s\n", input);
+		}
+		free(names);
+		return 0;
+	}
+	if(depth < 1){
+		depth = 1;
+	}
+	if(depth > nframes){
+		depth = nframes;
+	}
+
+	//================================================================================80
+	//	SETUP
+	//================================================================================80
+
+	state.Nr = Nr;
+	state.Nc = Nc;
+	state.niter = niter;
+	state.lambda = lambda;
+	state.threads = threads;
+
+	state.params = srad_image(Nr, Nc, niter, lambda, 0, Nr - 1, 0, Nc - 1);
+	if(srad_check(&state.params)){
+		printf("ERROR: image size must be > 0 and iterations >= 0\n");
+		for(f=0; f<nframes; f++){
+			free(names[f]);
+		}
+		free(names);
+		return 0;
+	}
+
+	out_names = batch_out_names(names, nframes, out_dir);
+
+	pthread_mutex_init(&state.stats_lock, NULL);
+	state.frames_done = 0;
+	state.frames_failed = 0;
+	state.latency_sum = 0;
+	state.latency_max = 0;
+	for(s=0; s<STAGES; s++){
+		state.stage_sum[s] = 0;
+		state.stage_max[s] = 0;
+	}
+
+	// queue[0] is fed by this function, every other queue by the workers of the previous stage
+	queue_init(&state.queue[0], depth, 1);
+	for(s=1; s<=STAGES; s++){
+		queue_init(&state.queue[s], depth, workers[s-1]);
+	}
+
+	// slots start out in the return queue so that the feeder below can claim them
+	slots = (frame_slot*)calloc(depth, sizeof(frame_slot));
+	for(f=0; f<depth; f++){
+		slots[f].image = (fp*)malloc(sizeof(fp)*Nr*Nc);
+		queue_push(&state.queue[STAGES], &slots[f]);
+	}
+
+	nworkers = 0;
+	for(s=0; s<STAGES; s++){
+		nworkers += workers[s];
+	}
+	pool = (batch_worker*)malloc(sizeof(batch_worker) * nworkers);
+
+	//================================================================================80
+	//	RUN PIPELINE
+	//================================================================================80
+
+	time0 = get_time();
+
+	w = 0;
+	for(s=0; s<STAGES; s++){
+		for(f=0; f<workers[s]; f++){
+			pool[w].state = &state;
+			pool[w].stage = s;
+			pthread_create(&pool[w].thread, NULL, batch_worker_main, &pool[w]);
+			w++;
+		}
+	}
+
+	// feed frames, blocking on the return queue whenever depth frames are in flight
+	for(f=0; f<nframes; f++){
+
+		slot = queue_pop(&state.queue[STAGES]);
+
+		strncpy(slot->in_name, names[f], BATCH_PATH-1);
+		slot->in_name[BATCH_PATH-1] = '\0';
+		strncpy(slot->out_name, out_names[f], BATCH_PATH-1);
+		slot->out_name[BATCH_PATH-1] = '\0';
+		slot->ok = 1;
+		slot->start = get_time();
+
+		queue_push(&state.queue[STAGE_READ], slot);
+
+	}
+	queue_close(&state.queue[STAGE_READ]);
+
+	for(w=0; w<nworkers; w++){
+		pthread_join(pool[w].thread, NULL);
+	}
+
+	time1 = get_time();
+
+	//================================================================================80
+	//	DISPLAY TIMING
+	//================================================================================80
+
+	total = (double)(time1-time0) / 1000000;
+
+	printf("Batch of %d frames (%d failed), %d frames in flight, %ld x %ld, %d iterations\n", nframes, state.frames_failed, depth, Nr, Nc, niter);
+	printf("Latency of different stages of the pipeline (average / maximum per frame):\n");
+	for(s=0; s<STAGES; s++){
+		printf("%.6f s / %.6f s : %s\n",	state.frames_done ? (double)state.stage_sum[s] / state.frames_done / 1000000 : 0.0,
+															(double)state.stage_max[s] / 1000000,
+															stage_names[s]);
+	}
+	printf("%.6f s / %.6f s : END TO END\n",	state.frames_done ? (double)state.latency_sum / state.frames_done / 1000000 : 0.0,
+													(double)state.latency_max / 1000000);
+	printf("Total time:\n");
+	printf("%.12f s\n", total);
+	printf("Throughput:\n");
+	printf("%.3f frames/s\n", total > 0 ? state.frames_done / total : 0.0);
+
+	//================================================================================80
+	//	DEALLOCATE
+	//================================================================================80
+
+	for(s=0; s<=STAGES; s++){
+		queue_destroy(&state.queue[s]);
+	}
+	for(f=0; f<depth; f++){
+		free(slots[f].raw);
+		free(slots[f].image);
+	}
+	free(slots);
+	free(pool);
+	for(f=0; f<nframes; f++){
+		free(names[f]);
+		free(out_names[f]);
+	}
+	free(names);
+	free(out_names);
+	pthread_mutex_destroy(&state.stats_lock);
+
+	return 0;
+
+}
@@ -5,3 +5,7 @@
 //====================================================================================================100
 
 #define fp float
+
+// batch mode: frames in flight through the pipeline, worker threads for the file read/write stages
+#define BATCH_DEPTH 4
+#define BATCH_IO_THREADS 2
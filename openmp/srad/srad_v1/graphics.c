@@ -153,3 +153,50 @@ void read_graphics(	char* filename,
 	fclose(fid);
 
 }
+
+//====================================================================================================100
+//====================================================================================================100
+//	READ SIZE FUNCTION
+//====================================================================================================100
+//====================================================================================================100
+
+// reads dimensions from the same three-line PGM header that read_graphics skips, returns 0 on success
+
+int read_graphics_size(	char* filename,
+										int* data_rows,
+										int* data_cols){
+
+	//================================================================================80
+	//	VARIABLES
+	//================================================================================80
+
+	FILE* fid;
+	char magic[3];
+	int n;
+
+	//================================================================================80
+	//	OPEN FILE FOR READING
+	//================================================================================80
+
+	fid = fopen(filename, "r");
+	if( fid == NULL ){
+		printf( "The file was not opened for reading\n" );
+		return -1;
+	}
+
+	//================================================================================80
+	//	READ PGM FILE HEADER
+	//================================================================================80
+
+	n = fscanf(fid, "%2s %d %d", magic, data_cols, data_rows);
+
+	fclose(fid);
+
+	if(n != 3 || strcmp(magic, "P2") != 0 || *data_rows <= 0 || *data_cols <= 0){
+		printf( "The file is not an ASCII (P2) PGM image\n" );
+		return -1;
+	}
+
+	return 0;
+
+}
@@ -26,10 +26,14 @@
 #include <string.h>
 #include <omp.h>
 
+#include "../common/srad_engine.h"
+
 #include "define.c"
 #include "graphics.c"
 #include "resize.c"
 #include "timer.c"
+#include "srad.c"
+#include "batch.c"
 
 //====================================================================================================100
 //====================================================================================================100
@@ -75,32 +79,10 @@ int main(int argc, char *argv []){
 
     // size of IMAGE
 	int r1,r2,c1,c2;												// row/col coordinates of uniform ROI
-	long NeROI;														// ROI nbr of elements
-    
-    // ROI statistics
-    fp meanROI, varROI, q0sqr;											//local region statistics
-    
-    // surrounding pixel indicies
-    int *iN,*iS,*jE,*jW;    
-
-    // center pixel value
-    fp Jc;
-
-	// directional derivatives
-	fp *dN,*dS,*dW,*dE;
-    
-    // calculation variables
-    fp tmp,sum,sum2;
-    fp G2,L,num,den,qsqr,D;
-       
-    // diffusion coefficient
-    fp *c; 
-	fp cN,cS,cW,cE;
-    
-    // counters
-    int iter;   // primary loop
-    long i,j;    // image row/col
-    long k;      // image single index    
+
+	// diffusion (scratch of the computation, ROI, iterations)
+	srad_engine* engine;
+	srad_params params;
 
 	// number of threads
 	int threads;
@@ -111,7 +93,7 @@ int main(int argc, char *argv []){
 	// 	GET INPUT PARAMETERS
 	//================================================================================80
 
-	if(argc != 6){
+	if(argc < 6 || argc > 9){
 		printf("ERROR: wrong number of arguments\n");
 		return 0;
 	}
@@ -124,6 +106,21 @@ int main(int argc, char *argv []){
 	}
 
 	omp_set_num_threads(threads);
+
+	//================================================================================80
+	// 	BATCH MODE (DIRECTORY OR LIST OF PGM FRAMES)
+	//================================================================================80
+
+	if(argc > 6){
+		return srad_batch(	argv[6],
+									argc > 7 ? argv[7] : ".",
+									argc > 8 ? atoi(argv[8]) : BATCH_DEPTH,
+									niter,
+									lambda,
+									Nr,
+									Nc,
+									threads);
+	}
 	// printf("THREAD %d\n", omp_get_thread_num());
 	// printf("NUMBER OF THREADS: %d\n", omp_get_num_threads());
 
@@ -175,40 +172,17 @@ int main(int argc, char *argv []){
     c1     = 0;											// left column index of ROI
     c2     = Nc - 1;									// right column index of ROI
 
-    // ROI image size    
-    NeROI = (r2-r1+1)*(c2-c1+1);											// number of elements in ROI, ROI size
-    
-    // allocate variables for surrounding pixels
-    iN = malloc(sizeof(int*)*Nr) ;									// north surrounding element
-    iS = malloc(sizeof(int*)*Nr) ;									// south surrounding element
-    jW = malloc(sizeof(int*)*Nc) ;									// west surrounding element
-    jE = malloc(sizeof(int*)*Nc) ;									// east surrounding element
-    
-	// allocate variables for directional derivatives
-	dN = malloc(sizeof(fp)*Ne) ;											// north direction derivative
-    dS = malloc(sizeof(fp)*Ne) ;											// south direction derivative
-    dW = malloc(sizeof(fp)*Ne) ;											// west direction derivative
-    dE = malloc(sizeof(fp)*Ne) ;											// east direction derivative
-
-	// allocate variable for diffusion coefficient
-    c  = malloc(sizeof(fp)*Ne) ;											// diffusion coefficient
-        
-    // N/S/W/E indices of surrounding pixels (every element of IMAGE)
-	// #pragma omp parallel
-    for (i=0; i<Nr; i++) {
-        iN[i] = i-1;														// holds index of IMAGE row above
-        iS[i] = i+1;														// holds index of IMAGE row below
-    }
-	// #pragma omp parallel
-    for (j=0; j<Nc; j++) {
-        jW[j] = j-1;														// holds index of IMAGE column on the left
-        jE[j] = j+1;														// holds index of IMAGE column on the right
-    }
-	// N/S/W/E boundary conditions, fix surrounding indices outside boundary of IMAGE
-    iN[0]    = 0;															// changes IMAGE top row index from -1 to 0
-    iS[Nr-1] = Nr-1;														// changes IMAGE bottom row index from Nr to Nr-1 
-    jW[0]    = 0;															// changes IMAGE leftmost column index from -1 to 0
-    jE[Nc-1] = Nc-1;														// changes IMAGE rightmost column index from Nc to Nc-1
+	params = srad_image(Nr, Nc, niter, lambda, r1, r2, c1, c2);
+	if(srad_check(&params)){
+		printf("ERROR: image size and ROI must be > 0 and iterations >= 0\n");
+		return 0;
+	}
+
+	engine = srad_create(threads);
+	if(engine == NULL){
+		printf("ERROR: can not create the SRAD engine\n");
+		return 0;
+	}
 
 	time5 = get_time();
 
@@ -216,10 +190,7 @@ int main(int argc, char *argv []){
 	// 	SCALE IMAGE DOWN FROM 0-255 TO 0-1 AND EXTRACT
 	//================================================================================80
 
-	// #pragma omp parallel
-	for (i=0; i<Ne; i++) {													// do for the number of elements in input IMAGE
-		image[i] = exp(image[i]/255);											// exponentiate input IMAGE and copy to output image
-    }
+	srad_extract(image, Ne);
 
 	time6 = get_time();
 
@@ -227,111 +198,17 @@ int main(int argc, char *argv []){
 	// 	COMPUTATION
 	//================================================================================80
 
-	// printf("iterations: ");
-
-    // primary loop
-    for (iter=0; iter<niter; iter++){										// do for the number of iterations input parameter
-
-		// printf("%d ", iter);
-		// fflush(NULL);
-
-        // ROI statistics for entire ROI (single number for ROI)
-        sum=0; 
-		sum2=0;
-        for (i=r1; i<=r2; i++) {											// do for the range of rows in ROI
-            for (j=c1; j<=c2; j++) {										// do for the range of columns in ROI
-                tmp   = image[i + Nr*j];										// get coresponding value in IMAGE
-                sum  += tmp ;												// take corresponding value and add to sum
-                sum2 += tmp*tmp;											// take square of corresponding value and add to sum2
-            }
-        }
-        meanROI = sum / NeROI;												// gets mean (average) value of element in ROI
-        varROI  = (sum2 / NeROI) - meanROI*meanROI;							// gets variance of ROI
-        q0sqr   = varROI / (meanROI*meanROI);								// gets standard deviation of ROI
-
-        // directional derivatives, ICOV, diffusion coefficent
-		#pragma omp parallel for shared(image, dN, dS, dW, dE, c, Nr, Nc, iN, iS, jW, jE) private(i, j, k, Jc, G2, L, num, den, qsqr)
-		for (j=0; j<Nc; j++) {												// do for the range of columns in IMAGE
-
-            for (i=0; i<Nr; i++) {											// do for the range of rows in IMAGE 
-
-                // current index/pixel
-                k = i + Nr*j;												// get position of current element
-                Jc = image[k];													// get value of the current element
-
-                // directional derivates (every element of IMAGE)
-                dN[k] = image[iN[i] + Nr*j] - Jc;								// north direction derivative
-                dS[k] = image[iS[i] + Nr*j] - Jc;								// south direction derivative
-                dW[k] = image[i + Nr*jW[j]] - Jc;								// west direction derivative
-                dE[k] = image[i + Nr*jE[j]] - Jc;								// east direction derivative
-
-                // normalized discrete gradient mag squared (equ 52,53)
-                G2 = (dN[k]*dN[k] + dS[k]*dS[k]								// gradient (based on derivatives)
-                    + dW[k]*dW[k] + dE[k]*dE[k]) / (Jc*Jc);
-
-                // normalized discrete laplacian (equ 54)
-                L = (dN[k] + dS[k] + dW[k] + dE[k]) / Jc;					// laplacian (based on derivatives)
-
-                // ICOV (equ 31/35)
-                num  = (0.5*G2) - ((1.0/16.0)*(L*L)) ;						// num (based on gradient and laplacian)
-                den  = 1 + (.25*L);											// den (based on laplacian)
-                qsqr = num/(den*den);										// qsqr (based on num and den)
- 
-                // diffusion coefficent (equ 33) (every element of IMAGE)
-                den = (qsqr-q0sqr) / (q0sqr * (1+q0sqr)) ;					// den (based on qsqr and q0sqr)
-                c[k] = 1.0 / (1.0+den) ;									// diffusion coefficient (based on den)
-
-                // saturate diffusion coefficent to 0-1 range
-                if (c[k] < 0)												// if diffusion coefficient < 0
-					{c[k] = 0;}												// ... set to 0
-                else if (c[k] > 1)											// if diffusion coefficient > 1
-					{c[k] = 1;}												// ... set to 1
-
-            }
-
-        }
-
-        // divergence & image update
-		#pragma omp parallel for shared(image, c, Nr, Nc, lambda) private(i, j, k, D, cS, cN, cW, cE)
-        for (j=0; j<Nc; j++) {												// do for the range of columns in IMAGE
-
-			// printf("NUMBER OF THREADS: %d\n", omp_get_num_threads());
-
-            for (i=0; i<Nr; i++) {											// do for the range of rows in IMAGE
-
-                // current index
-                k = i + Nr*j;												// get position of current element
-
-                // diffusion coefficent
-                cN = c[k];													// north diffusion coefficient
-                cS = c[iS[i] + Nr*j];										// south diffusion coefficient
-                cW = c[k];													// west diffusion coefficient
-                cE = c[i + Nr*jE[j]];										// east diffusion coefficient
-
-                // divergence (equ 58)
-                D = cN*dN[k] + cS*dS[k] + cW*dW[k] + cE*dE[k];				// divergence
-
-                // image update (equ 61) (every element of IMAGE)
-                image[k] = image[k] + 0.25*lambda*D;								// updates image (based on input time step and divergence)
-
-            }
-
-        }
-
+	if(srad(engine, &params, image)){
+		printf("ERROR: can not allocate the scratch of the computation\n");
 	}
 
-	// printf("\n");
-
 	time7 = get_time();
 
 	//================================================================================80
 	// 	SCALE IMAGE UP FROM 0-1 TO 0-255 AND COMPRESS
 	//================================================================================80
 
-	// #pragma omp parallel
-	for (i=0; i<Ne; i++) {													// do for the number of elements in IMAGE
-		image[i] = log(image[i])*255;													// take logarithm of image, log compress
-	}
+	srad_compress(image, Ne);
 
 	time8 = get_time();
 
@@ -355,9 +232,7 @@ int main(int argc, char *argv []){
 	free(image_ori);
 	free(image);
 
-    free(iN); free(iS); free(jW); free(jE);									// deallocate surrounding pixel memory
-    free(dN); free(dS); free(dW); free(dE);									// deallocate directional derivative memory
-    free(c);																// deallocate diffusion coefficient memory
+	srad_destroy(engine);														// deallocate scratch of the computation
 
 	time10 = get_time();
 
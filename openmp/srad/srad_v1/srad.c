@@ -0,0 +1,92 @@
+//====================================================================================================100
+//====================================================================================================100
+//	SRAD ENGINE FOR fp
+//====================================================================================================100
+//====================================================================================================100
+
+// The diffusion is done by the SRAD engine (../common/srad_engine.cpp), shared with srad_v2. These
+// pick its float or double entry points for fp (see define.c).
+
+//====================================================================================================100
+//	PARAMETERS
+//====================================================================================================100
+
+// parameters of niter iterations over a column-major Nr x Nc IMAGE with ROI rows r1-r2, columns c1-c2
+
+srad_params srad_image(	long Nr,
+								long Nc,
+								int niter,
+								fp lambda,
+								int r1,
+								int r2,
+								int c1,
+								int c2){
+
+	srad_params params;
+
+	params.rows = Nr;
+	params.cols = Nc;
+	params.layout = SRAD_COL_MAJOR;
+	params.r1 = r1;
+	params.r2 = r2;
+	params.c1 = c1;
+	params.c2 = c2;
+	params.niter = niter;
+	params.lambda = lambda;
+
+	return params;
+
+}
+
+//====================================================================================================100
+//	EXTRACT FUNCTION
+//====================================================================================================100
+
+// scale IMAGE down from 0-255 to 0-1 and extract
+
+void srad_extract(	fp* image,
+							long Ne){
+
+	if(sizeof(fp) == sizeof(float)){
+		srad_extract_f((float*)image, Ne);
+	}
+	else{
+		srad_extract_d((double*)image, Ne);
+	}
+
+}
+
+//====================================================================================================100
+//	COMPRESS FUNCTION
+//====================================================================================================100
+
+// scale IMAGE up from 0-1 to 0-255 and compress
+
+void srad_compress(	fp* image,
+								long Ne){
+
+	if(sizeof(fp) == sizeof(float)){
+		srad_compress_f((float*)image, Ne);
+	}
+	else{
+		srad_compress_d((double*)image, Ne);
+	}
+
+}
+
+//====================================================================================================100
+//	COMPUTATION FUNCTION
+//====================================================================================================100
+
+// diffusion iterations over IMAGE, in place, 0 on success
+
+int srad(	srad_engine* engine,
+				const srad_params* params,
+				fp* image){
+
+	if(sizeof(fp) == sizeof(float)){
+		return srad_run_f(engine, params, (float*)image);
+	}
+	return srad_run_d(engine, params, (double*)image);
+
+}
@@ -12,6 +12,8 @@
 #include <math.h>
 #include <omp.h>
 
+#include "srad_engine.h"
+
 void random_matrix(float *I, int rows, int cols);
 
 void usage(int argc, char **argv)
@@ -32,17 +34,14 @@ void usage(int argc, char **argv)
 
 int main(int argc, char* argv[])
 {   
-	int rows, cols, size_I, size_R, niter = 10, iter, k;
-    float *I, *J, q0sqr, sum, sum2, tmp, meanROI,varROI ;
-	float Jc, G2, L, num, den, qsqr;
-	int *iN,*iS,*jE,*jW;
-	float *dN,*dS,*dW,*dE;
+	int rows, cols, size_I, k;
+    float *I, *J;
 	int r1, r2, c1, c2;
-	float cN,cS,cW,cE;
-	float *c, D;
 	float lambda;
-	int i, j;
+	int niter = 10;
     int nthreads;
+	srad_params params;
+	srad_engine* engine;
 
 	if (argc == 10)
 	{
@@ -64,38 +63,34 @@ int main(int argc, char* argv[])
 		usage(argc, argv);
     }
 
+	// the diffusion is done by the SRAD engine shared with srad_v1 (../common/srad_engine.cpp)
+	params.rows = rows;
+	params.cols = cols;
+	params.layout = SRAD_ROW_MAJOR;
+	params.r1 = r1;
+	params.r2 = r2;
+	params.c1 = c1;
+	params.c2 = c2;
+	params.lambda = lambda;
+#ifdef ITERATION
+	params.niter = niter;
+#else
+	params.niter = 1;
+#endif
+	if (srad_check(&params)){
+		fprintf(stderr, "the speckle must lie within the domain\n");
+		exit(1);
+	}
+
+#ifndef OPEN
+	nthreads = 1;
+#endif
+	engine = srad_create(nthreads);
 
 	size_I = cols * rows;
-    size_R = (r2-r1+1)*(c2-c1+1);   
 
 	I = (float *)malloc( size_I * sizeof(float) );
     J = (float *)malloc( size_I * sizeof(float) );
-	c  = (float *)malloc(sizeof(float)* size_I) ;
-
-    iN = (int *)malloc(sizeof(unsigned int*) * rows) ;
-    iS = (int *)malloc(sizeof(unsigned int*) * rows) ;
-    jW = (int *)malloc(sizeof(unsigned int*) * cols) ;
-    jE = (int *)malloc(sizeof(unsigned int*) * cols) ;    
-
-
-	dN = (float *)malloc(sizeof(float)* size_I) ;
-    dS = (float *)malloc(sizeof(float)* size_I) ;
-    dW = (float *)malloc(sizeof(float)* size_I) ;
-    dE = (float *)malloc(sizeof(float)* size_I) ;    
-    
-
-    for (int i=0; i< rows; i++) {
-        iN[i] = i-1;
-        iS[i] = i+1;
-    }    
-    for (int j=0; j< cols; j++) {
-        jW[j] = j-1;
-        jE[j] = j+1;
-    }
-    iN[0]    = 0;
-    iS[rows-1] = rows-1;
-    jW[0]    = 0;
-    jE[cols-1] = cols-1;
 	
 	printf("Randomizing the input matrix\n");
 
@@ -107,91 +102,10 @@ int main(int argc, char* argv[])
    
 	printf("Start the SRAD main loop\n");
 
-#ifdef ITERATION
-	for (iter=0; iter< niter; iter++){
-#endif        
-		sum=0; sum2=0;     
-		for (i=r1; i<=r2; i++) {
-            for (j=c1; j<=c2; j++) {
-                tmp   = J[i * cols + j];
-                sum  += tmp ;
-                sum2 += tmp*tmp;
-            }
-        }
-        meanROI = sum / size_R;
-        varROI  = (sum2 / size_R) - meanROI*meanROI;
-        q0sqr   = varROI / (meanROI*meanROI);
-		
-
-#ifdef OPEN
-		omp_set_num_threads(nthreads);
-		#pragma omp parallel for shared(J, dN, dS, dW, dE, c, rows, cols, iN, iS, jW, jE) private(i, j, k, Jc, G2, L, num, den, qsqr)
-#endif    
-		for (int i = 0 ; i < rows ; i++) {
-            for (int j = 0; j < cols; j++) { 
-		
-				k = i * cols + j;
-				Jc = J[k];
- 
-				// directional derivates
-                dN[k] = J[iN[i] * cols + j] - Jc;
-                dS[k] = J[iS[i] * cols + j] - Jc;
-                dW[k] = J[i * cols + jW[j]] - Jc;
-                dE[k] = J[i * cols + jE[j]] - Jc;
-			
-                G2 = (dN[k]*dN[k] + dS[k]*dS[k] 
-                    + dW[k]*dW[k] + dE[k]*dE[k]) / (Jc*Jc);
-
-   		        L = (dN[k] + dS[k] + dW[k] + dE[k]) / Jc;
-
-				num  = (0.5*G2) - ((1.0/16.0)*(L*L)) ;
-                den  = 1 + (.25*L);
-                qsqr = num/(den*den);
- 
-                // diffusion coefficent (equ 33)
-                den = (qsqr-q0sqr) / (q0sqr * (1+q0sqr)) ;
-                c[k] = 1.0 / (1.0+den) ;
-                
-                // saturate diffusion coefficent
-                if (c[k] < 0) {c[k] = 0;}
-                else if (c[k] > 1) {c[k] = 1;}
-   
-		}
-  
-    }
-#ifdef OPEN
-		omp_set_num_threads(nthreads);
-		#pragma omp parallel for shared(J, c, rows, cols, lambda) private(i, j, k, D, cS, cN, cW, cE)
-#endif 
-		for (int i = 0; i < rows; i++) {
-            for (int j = 0; j < cols; j++) {        
-
-                // current index
-                k = i * cols + j;
-                
-                // diffusion coefficent
-					cN = c[k];
-					cS = c[iS[i] * cols + j];
-					cW = c[k];
-					cE = c[i * cols + jE[j]];
-
-                // divergence (equ 58)
-                D = cN * dN[k] + cS * dS[k] + cW * dW[k] + cE * dE[k];
-                
-                // image update (equ 61)
-                J[k] = J[k] + 0.25*lambda*D;
-                #ifdef OUTPUT
-                //printf("%.5f ", J[k]); 
-                #endif //output
-            }
-	            #ifdef OUTPUT
-                //printf("\n"); 
-                #endif //output
-	     }
-
-#ifdef ITERATION
+	if (engine == NULL || srad_run(engine, &params, J)){
+		fprintf(stderr, "can not allocate the scratch of the SRAD engine\n");
+		exit(1);
 	}
-#endif
 
 
 #ifdef OUTPUT
@@ -209,10 +123,7 @@ int main(int argc, char* argv[])
 
 	free(I);
 	free(J);
-	free(iN); free(iS); free(jW); free(jE);
-    free(dN); free(dS); free(dW); free(dE);
-
-	free(c);
+	srad_destroy(engine);
 	return 0;
 }
 
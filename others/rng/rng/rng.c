@@ -2,13 +2,19 @@
 * @file rng.c
 * @author Michael Trotter & Matt Goodrum
 * @brief Uniform and Normal RNG Implemented in OpenMP
+*
+* randu/randn are the original seed-array LCG; new code should use the counter-based philox_uniform/philox_normal
+* from common/philox.h, which need no seed array and give the same numbers at any thread count.
 */
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
+#include <time.h>
 #include <sys/time.h>
 #include <omp.h>
 #include <limits.h>
+#include "../../../common/philox.h"
 #define PI acos(-1)
 /**
 @var M value for Linear Congruential Generator (LCG); use GCC's value
@@ -53,35 +59,110 @@ double randn(int * seed, int index){
 	return sqrt(rt)*cosine;
 }
 /**
-* A simple main that demonstrates how to setup the seed array for use
+* Returns the current time in seconds
 */
-int main(){
-	//define the length of the seed array
-	int length = 10000;
-	
-	//declare seed array
-	int * seed = (int *)malloc(sizeof(int)*length);
+double get_time(){
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec*1e-6;
+}
+/**
+* Fills out with one uniform (normal if normal != 0) draw per index from the seed-array LCG
+* @return the elapsed time in seconds
+*/
+double fill_lcg(double * out, int * seed, int length, int normal){
+	int x;
+	double start = get_time();
+	#pragma omp parallel for shared(out, seed, length, normal) private(x)
+	for(x = 0; x < length; x++){
+		out[x] = normal ? randn(seed, x) : randu(seed, x);
+	}
+	return get_time() - start;
+}
+/**
+* Fills out with one uniform (normal if normal != 0) draw per index from the counter-based generator, stream = index
+* @return the elapsed time in seconds
+*/
+double fill_philox(double * out, uint64_t key, uint64_t counter, int length, int normal){
+	int x;
+	double start = get_time();
+	if(normal){
+		#pragma omp parallel for shared(out, length) private(x)
+		for(x = 0; x < length; x++){
+			out[x] = philox_normal(key, x, counter);
+		}
+	}
+	else{
+		#pragma omp parallel for shared(out, length) private(x)
+		for(x = 0; x < length; x++){
+			out[x] = philox_uniform(key, x, counter);
+		}
+	}
+	return get_time() - start;
+}
+/**
+* Demonstrates both generators and measures their sampling throughput
+* usage: rng [samples] [threads]
+*/
+int main(int argc, char * argv[]){
+	//define the number of samples (one seed/stream per sample)
+	int length = argc > 1 ? atoi(argv[1]) : 10000000;
+	int threads = argc > 2 ? atoi(argv[2]) : omp_get_max_threads();
+	if(length <= 0 || threads <= 0){
+		printf("usage: rng [samples] [threads]\n");
+		return 0;
+	}
 	
-	//establish original values
+	//LCG: declare seed array and establish original values
 	//the current time * the index is good enough for most uses.
+	int * seed = (int *)malloc(sizeof(int)*length);
 	int x;
 	for(x = 0; x < length; x++)
 	{
 		seed[x] = time(0)*x;
 	}
 	
-	//make kernel calls etc; device functions can now use seed array to generate normal and uniform random numbers
+	//Philox: the key replaces the seed array, a draw is addressed by (stream, counter)
+	uint64_t key = time(0);
+	
 	/* Example
 	
-		#pragma omp parallel for shared(arrayX, arrayY, length, seed) private(x)
+		#pragma omp parallel for shared(arrayX, arrayY, length, key) private(x)
 		for(x = 0; x < length; x++){
-			arrayX[x] += 1 + 5*randn(seed, x);
-			arrayY[x] += -2 + 2*randn(seed, x);
+			arrayX[x] += 1 + 5*philox_normal(key, x, 2*frame);
+			arrayY[x] += -2 + 2*philox_normal(key, x, 2*frame + 1);
 		}
 	*/
 	
+	double * out = (double *)malloc(sizeof(double)*length);
+	double * ref = (double *)malloc(sizeof(double)*length);
+	
+	//reproducibility: the same (key, stream, counter) on one thread and on all threads
+	omp_set_num_threads(1);
+	fill_philox(ref, key, 0, length, 1);
+	omp_set_num_threads(threads);
+	fill_philox(out, key, 0, length, 1);
+	printf("philox normal draws identical on 1 and %d threads: %s\n", threads, memcmp(out, ref, sizeof(double)*length) ? "NO" : "yes");
+	
+	//throughput, best of a few runs
+	int normal, run;
+	double t, lcg_best, philox_best;
+	printf("%-8s %10s %16s %16s\n", "dist", "samples", "LCG Msamples/s", "Philox Msamples/s");
+	for(normal = 0; normal < 2; normal++){
+		lcg_best = philox_best = 1e30;
+		for(run = 0; run < 3; run++){
+			t = fill_lcg(out, seed, length, normal);
+			lcg_best = t < lcg_best ? t : lcg_best;
+			t = fill_philox(out, key, run, length, normal);
+			philox_best = t < philox_best ? t : philox_best;
+		}
+		printf("%-8s %10d %16.1f %16.1f\n", normal ? "normal" : "uniform", length, length/lcg_best*1e-6, length/philox_best*1e-6);
+	}
+	
 	//free allocated memory
 	free(seed);
+	free(out);
+	free(ref);
 	
 	return 0;
 }
\ No newline at end of file